@@ -0,0 +1,69 @@
+/*!
+ * MIT License
+ *
+ * Copyright (c) 2022 Kambiz Asadzadeh
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+
+#ifndef TEGRA_BENCHMARK_HPP
+#define TEGRA_BENCHMARK_HPP
+
+#include <chrono>
+#include <cstdio>
+#include <string_view>
+
+namespace Tegra::Benchmark {
+
+/*!
+ * @brief measure function runs a body a number of times and returns the best time in milliseconds.
+ * The body gets a fresh copy of its input each time, so setup is part of the body and should be cheap.
+ */
+template<typename Body>
+double measure(int repeats, Body&& body)
+{
+    double best = 0;
+    for (int i = 0; i < repeats; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        body();
+        const double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (i == 0 || elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+/*!
+ * @brief report function prints one line of a comparison between the old and the new implementation.
+ */
+inline void report(std::string_view name, double before, double after)
+{
+    std::printf("%-32.*s %10.3f ms %10.3f ms %8.1fx\n", static_cast<int>(name.size()), name.data(), before, after,
+                after > 0 ? before / after : 0.0);
+}
+
+inline void header()
+{
+    std::printf("%-32s %13s %13s %9s\n", "benchmark", "before", "after", "speedup");
+}
+
+}  // namespace Tegra::Benchmark
+
+#endif  // TEGRA_BENCHMARK_HPP
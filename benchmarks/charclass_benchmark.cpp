@@ -0,0 +1,93 @@
+#include "benchmark.hpp"
+#include "core/charclass.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <random>
+#include <string>
+
+TEGRA_USING_NAMESPACE Tegra;
+
+namespace {
+
+constexpr int Repeats = 20;
+
+//! About 1.6 MB of words, punctuation and runs of spaces, like a page after the tags are stripped.
+std::string page()
+{
+    static constexpr std::string_view parts[] = {"content ", "/path/to/page ", "(note) ", "[link] ", "a  b   c ", "{x-y} ", "plain text "};
+    std::mt19937 random(7);
+    std::string out;
+    while (out.size() < 1600 * 1024) {
+        out.append(parts[random() % std::size(parts)]);
+    }
+    return out;
+}
+
+void use(const std::string& content)
+{
+    static volatile std::size_t sink = 0;
+    sink = sink + content.size();
+}
+
+//! The implementations of Engine before the kernels, kept here as the baseline.
+void elementEraseScalar(std::string& content)
+{
+    std::erase_if(content, [](const char c) {
+        return c == '`' or c == '/' or c =='\\' or c == '~' or c == '?'
+               or c == '|' or c == '(' or c == ')' or c == '[' or c == ']'
+               or c == '{' or c == '}' or c == '-';
+    });
+}
+
+void removeDashesScalar(std::string& content)
+{
+    content.erase(std::remove(content.begin(), content.end(), '/'), content.end());
+}
+
+//! whiteSpaceReduce used to drop every space, this is the same collapse written as a scalar loop.
+void whiteSpaceReduceScalar(std::string& content)
+{
+    std::string out;
+    out.reserve(content.size());
+    bool run = false;
+    for (const char c : content) {
+        const bool space = std::isspace(static_cast<unsigned char>(c)) != 0;
+        if (!space) out.push_back(c);
+        else if (!run) out.push_back(' ');
+        run = space;
+    }
+    content.swap(out);
+}
+
+void whiteSpaceLeadingScalar(std::string& content)
+{
+    while (!content.empty() && std::isspace(static_cast<unsigned char>(*content.begin()))) {
+        content.erase(content.begin());
+    }
+}
+
+}  // namespace
+
+int main()
+{
+    const std::string input = page();
+    const std::string leading = std::string(100000, ' ') + "content";
+    static constexpr CharClass elements {"`/\\~?|()[]{}-"};
+    static constexpr CharClass dashes {"/"};
+
+    Benchmark::header();
+    Benchmark::report("elementErase",
+        Benchmark::measure(Repeats, [&] { std::string s = input; elementEraseScalar(s); use(s); }),
+        Benchmark::measure(Repeats, [&] { std::string s = input; CharKernel::removeAll(s, elements); use(s); }));
+    Benchmark::report("removeDashes",
+        Benchmark::measure(Repeats, [&] { std::string s = input; removeDashesScalar(s); use(s); }),
+        Benchmark::measure(Repeats, [&] { std::string s = input; CharKernel::removeAll(s, dashes); use(s); }));
+    Benchmark::report("whiteSpaceReduce",
+        Benchmark::measure(Repeats, [&] { std::string s = input; whiteSpaceReduceScalar(s); use(s); }),
+        Benchmark::measure(Repeats, [&] { std::string s = input; CharKernel::collapseRuns(s, CharClass::space(), ' '); use(s); }));
+    Benchmark::report("whiteSpaceLeading (100k spaces)",
+        Benchmark::measure(3, [&] { std::string s = leading; whiteSpaceLeadingScalar(s); use(s); }),
+        Benchmark::measure(Repeats, [&] { std::string s = leading; CharKernel::trimLeading(s, CharClass::space()); use(s); }));
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include "benchmark.hpp"
+#include "core/replacer.hpp"
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+TEGRA_USING_NAMESPACE Tegra;
+TEGRA_USING_NAMESPACE Tegra::CMS;
+
+namespace {
+
+constexpr int Repeats = 20;
+
+MapString placeholders(std::size_t keys)
+{
+    MapString map;
+    for (std::size_t i = 0; i < keys; ++i) {
+        map["{{key_" + std::to_string(i) + "}}"] = "value number " + std::to_string(i);
+    }
+    return map;
+}
+
+//! About 200 KB of markup with a placeholder of the map every few words, like a rendered template.
+std::string page(const MapString& map)
+{
+    static constexpr std::string_view parts[] = {"<div class=\"row\">", "plain text ", "<a href=\"/path\">", "</a> ", "{note} ", "</div>\n"};
+    std::vector<std::string_view> keys;
+    for (const auto& [key, value] : map) {
+        keys.push_back(key);
+    }
+    std::mt19937 random(7);
+    std::string out;
+    while (out.size() < 200 * 1024) {
+        out.append(parts[random() % std::size(parts)]);
+        if (random() % 4 == 0) {
+            out.append(keys[random() % keys.size()]);
+        }
+    }
+    return out;
+}
+
+void use(const std::string& content)
+{
+    static volatile std::size_t sink = 0;
+    sink = sink + content.size();
+}
+
+//! The implementation of Engine::fullReplacer before the Replacer, kept here as the baseline.
+std::string fullReplacerLoop(const std::string& content, const MapString& map)
+{
+    std::string rawContent = content;
+    std::size_t pos;
+    for (const auto& r : map) {
+        pos = rawContent.find(r.first);
+        while (pos != std::string::npos) {
+            rawContent.replace(pos, r.first.size(), r.second);
+            pos = rawContent.find(r.first, pos + r.first.size());
+        }
+    }
+    return rawContent;
+}
+
+}  // namespace
+
+int main()
+{
+    Benchmark::header();
+    for (const std::size_t keys : {10, 100, 1000}) {
+        const MapString map = placeholders(keys);
+        const std::string input = page(map);
+        if (fullReplacerLoop(input, map) != Replacer::cached(map)->replace(input, map)) {
+            std::printf("fullReplacer with %zu keys: the outputs differ\n", keys);
+            return 1;
+        }
+        Benchmark::report("fullReplacer (" + std::to_string(keys) + " keys)",
+            Benchmark::measure(Repeats, [&] { use(fullReplacerLoop(input, map)); }),
+            Benchmark::measure(Repeats, [&] { use(Replacer::cached(map)->replace(input, map)); }));
+    }
+    return 0;
+}
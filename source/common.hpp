@@ -116,6 +116,8 @@ struct CONFIG final {
   static constexpr std::string_view CMS_CONFIG_FILE = "config/system-config.json";
   static constexpr std::string_view CMS_TABLES_FILE = "config/system-tables.json";
   static constexpr std::string_view CMS_TABLES_PREFIX = "teg_";
+  static constexpr std::string_view CMS_MEMORY_SNAPSHOT_FILE = "storage/memory.snapshot";
+  static constexpr std::string_view CMS_SEARCH_INDEX_DIRECTORY = "storage/search";
   static constexpr std::string_view CMS_TABLES_VALUE_STRUCT = "_l";
   static constexpr std::string_view CMS_TABLES_TABLE_UNICODE = "utf-8";
   static constexpr std::string_view CMS_TABLES_COOKIE_PREFIX = "tegra_";
@@ -0,0 +1,504 @@
+#include "backup.hpp"
+#include "bulkloader.hpp"
+#include "seedfile.hpp"
+#include "tableregistry.hpp"
+#include "core.hpp"
+
+#if defined(TEGRA_BACKUP_ZLIB)
+#include <zlib.h>
+#endif
+
+TEGRA_USING_NAMESPACE Tegra::CMS;
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+TEGRA_ANONYMOUS_NAMESPACE_BEGIN
+
+#if defined(TEGRA_BACKUP_ZLIB)
+constexpr std::string_view ChunkSuffix = ".tsv.gz";
+#else
+constexpr std::string_view ChunkSuffix = ".tsv";
+#endif
+
+[[noreturn]] void fail(const std::string& message)
+{
+    throw Exception(Exception::Reason::IO, "Backup: " + message);
+}
+
+void writeChunk(const std::filesystem::path& path, std::string_view data, __tegra_maybe_unused int level)
+{
+#if defined(TEGRA_BACKUP_ZLIB)
+    const std::string mode = "wb" + std::to_string(std::clamp(level, 1, 9));
+    gzFile file = gzopen(path.string().c_str(), mode.c_str());
+    if (file == nullptr) fail("can not create [" + path.string() + "]");
+    //! gzwrite takes an unsigned length, large chunks are written in pieces.
+    constexpr std::size_t Piece = std::size_t(1) << 30;
+    for (std::size_t offset = 0; offset < data.size(); offset += Piece) {
+        const auto size = static_cast<unsigned>(std::min(Piece, data.size() - offset));
+        if (gzwrite(file, data.data() + offset, size) != static_cast<int>(size)) {
+            gzclose(file);
+            fail("can not write [" + path.string() + "]");
+        }
+    }
+    if (gzclose(file) != Z_OK) fail("can not write [" + path.string() + "]");
+#else
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.write(data.data(), static_cast<std::streamsize>(data.size()))) fail("can not write [" + path.string() + "]");
+#endif
+}
+
+std::string readChunk(const std::filesystem::path& path)
+{
+    std::string data;
+#if defined(TEGRA_BACKUP_ZLIB)
+    gzFile file = gzopen(path.string().c_str(), "rb");
+    if (file == nullptr) fail("can not open [" + path.string() + "]");
+    gzbuffer(file, 1 << 17);
+    char buffer[1 << 16];
+    int size = 0;
+    while ((size = gzread(file, buffer, sizeof(buffer))) > 0) {
+        data.append(buffer, static_cast<std::size_t>(size));
+    }
+    const bool failed = size < 0;
+    gzclose(file);
+    if (failed) fail("corrupt chunk [" + path.string() + "]");
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) fail("can not open [" + path.string() + "]");
+    data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+#endif
+    return data;
+}
+
+//! Text format of COPY: tab separated, \N is NULL, backslash escapes for control characters.
+void encodeRow(const SqlRow& row, std::size_t first, std::string& output)
+{
+    for (std::size_t c = first; c < row.size(); ++c) {
+        if (c != first) output.push_back('\t');
+        if (!row[c].has_value()) {
+            output.append("\\N");
+            continue;
+        }
+        for (const char ch : *row[c]) {
+            switch (ch) {
+            case '\\': output.append("\\\\"); break;
+            case '\t': output.append("\\t"); break;
+            case '\n': output.append("\\n"); break;
+            case '\r': output.append("\\r"); break;
+            default:   output.push_back(ch);
+            }
+        }
+    }
+    output.push_back('\n');
+}
+
+std::vector<SeedRow> decodeRows(std::string_view data, std::size_t columns)
+{
+    std::vector<SeedRow> rows;
+    std::size_t pos = 0;
+    while (pos < data.size()) {
+        auto end = data.find('\n', pos);
+        if (end == std::string_view::npos) end = data.size();
+        const std::string_view line = data.substr(pos, end - pos);
+        pos = end + 1;
+        SeedRow& row = rows.emplace_back();
+        row.reserve(columns);
+        std::size_t start = 0;
+        for (;;) {
+            auto tab = line.find('\t', start);
+            if (tab == std::string_view::npos) tab = line.size();
+            const std::string_view field = line.substr(start, tab - start);
+            SeedCell& cell = row.emplace_back();
+            if (field != "\\N") {
+                std::string value;
+                value.reserve(field.size());
+                for (std::size_t i = 0; i < field.size(); ++i) {
+                    if (field[i] != '\\' || i + 1 == field.size()) {
+                        value.push_back(field[i]);
+                        continue;
+                    }
+                    const char e = field[++i];
+                    switch (e) {
+                    case 't': value.push_back('\t'); break;
+                    case 'n': value.push_back('\n'); break;
+                    case 'r': value.push_back('\r'); break;
+                    case 'b': value.push_back('\b'); break;
+                    case 'f': value.push_back('\f'); break;
+                    case 'v': value.push_back('\v'); break;
+                    default:
+                        if (e >= '0' && e <= '7') {
+                            int code = e - '0';
+                            for (int k = 0; k < 2 && i + 1 < field.size() && field[i + 1] >= '0' && field[i + 1] <= '7'; ++k) {
+                                code = code * 8 + (field[++i] - '0');
+                            }
+                            value.push_back(static_cast<char>(code));
+                        } else {
+                            value.push_back(e);
+                        }
+                    }
+                }
+                cell.value = std::move(value);
+            }
+            if (tab == line.size()) break;
+            start = tab + 1;
+        }
+        if (row.size() != columns) {
+            fail("a row has " + std::to_string(row.size()) + " values for " + std::to_string(columns) + " columns");
+        }
+    }
+    return rows;
+}
+
+void appendJson(std::string& output, std::string_view text)
+{
+    output.push_back('"');
+    for (const char c : text) {
+        switch (c) {
+        case '"':  output.append("\\\""); break;
+        case '\\': output.append("\\\\"); break;
+        case '\n': output.append("\\n"); break;
+        case '\t': output.append("\\t"); break;
+        case '\r': output.append("\\r"); break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                output.append(escaped);
+            } else {
+                output.push_back(c);
+            }
+        }
+    }
+    output.push_back('"');
+}
+
+void appendJsonList(std::string& output, const VectorString& items)
+{
+    output.push_back('[');
+    for (std::size_t i = 0; i < items.size(); ++i) {
+        if (i != 0) output.push_back(',');
+        appendJson(output, items[i]);
+    }
+    output.push_back(']');
+}
+
+//! Every read of the transaction sees the state of its first statement.
+void beginSnapshot(Connection& connection)
+{
+    switch (connection.driver()) {
+    case DriverTypes::PostgreSQL:
+        connection.run("BEGIN ISOLATION LEVEL REPEATABLE READ");
+        break;
+    case DriverTypes::MySQL:
+        connection.run("SET TRANSACTION ISOLATION LEVEL REPEATABLE READ");
+        connection.run("START TRANSACTION WITH CONSISTENT SNAPSHOT");
+        break;
+    default:
+        connection.run("BEGIN");
+    }
+}
+
+void rollback(Connection& connection)
+{
+    if (connection.broken()) return;
+    try {
+        connection.run("ROLLBACK");
+    } catch (...) {
+        //! The original error is the one that matters.
+    }
+}
+
+std::string joined(const VectorString& items, std::string_view separator)
+{
+    std::string output;
+    for (std::size_t i = 0; i < items.size(); ++i) {
+        if (i != 0) output.append(separator);
+        output.append(items[i]);
+    }
+    return output;
+}
+
+TEGRA_NAMESPACE_END
+
+BackupEngine::BackupEngine(ConnectionPool& pool, const BackupOptions& options) : m_pool(pool), m_options(options)
+{
+    m_options.chunkBytes = std::max<std::size_t>(m_options.chunkBytes, 4096);
+    m_options.pageRows = std::max<std::size_t>(m_options.pageRows, 1);
+}
+
+template<typename Job>
+void BackupEngine::parallel(std::size_t count, std::size_t connections, const Job& job, const Session& begin)
+{
+    const std::size_t workers = std::min({m_options.parallelism == 0 ? connections : m_options.parallelism, connections, count});
+    std::atomic<std::size_t> next {0};
+    std::mutex mutex;
+    std::exception_ptr error;
+    m_bytes = 0;
+    m_started = std::chrono::steady_clock::now();
+    //! Each worker keeps one connection and takes the next table until the list is done or a table failed.
+    const auto work = [&] {
+        PooledConnection connection;
+        bool open = false;
+        try {
+            connection = m_pool.acquire();
+            if (begin) {
+                begin(*connection);
+                open = true;
+            }
+            for (std::size_t i = next++; i < count; i = next++) {
+                job(*connection, i);
+            }
+            if (open) {
+                open = false;
+                connection->run("COMMIT");
+            }
+        } catch (...) {
+            if (open) rollback(*connection);
+            std::lock_guard lock(mutex);
+            if (error == nullptr) error = std::current_exception();
+            next = count;
+        }
+    };
+    std::vector<std::thread> threads;
+    for (std::size_t w = 1; w < workers; ++w) {
+        threads.emplace_back(work);
+    }
+    if (workers > 0) work();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    if (error != nullptr) {
+        std::rethrow_exception(error);
+    }
+}
+
+void BackupEngine::throttle(u64 bytes)
+{
+    if (m_options.maxBytesPerSecond == 0) return;
+    //! Shared budget of all workers, a worker that is ahead of it sleeps until the budget catches up.
+    const u64 total = m_bytes += bytes;
+    const auto due = m_started + std::chrono::microseconds(total * 1000000 / m_options.maxBytesPerSecond);
+    if (due > std::chrono::steady_clock::now()) {
+        std::this_thread::sleep_until(due);
+    }
+}
+
+BackupTableReport BackupEngine::dump(Connection& connection, const std::string& table, const std::filesystem::path& directory,
+                                     VectorString& columns, VectorString& chunks)
+{
+    const auto start = std::chrono::steady_clock::now();
+    BackupTableReport report;
+    report.table = table;
+    columns = connection.run("SELECT * FROM " + table + " LIMIT 0").columns;
+
+    std::string buffer;
+    buffer.reserve(m_options.chunkBytes + (std::size_t(1) << 16));
+    const auto flush = [&] {
+        if (buffer.empty()) return;
+        char number[16];
+        std::snprintf(number, sizeof(number), ".%06zu", chunks.size());
+        std::string name = table + number + std::string(ChunkSuffix);
+        writeChunk(directory / name, buffer, m_options.compressionLevel);
+        chunks.push_back(std::move(name));
+        report.bytes += buffer.size();
+        throttle(buffer.size());
+        buffer.clear();
+    };
+
+    const bool copied = connection.copyOut(table, [&](std::string_view rows) {
+        buffer.append(rows);
+        report.rows += static_cast<u64>(std::count(rows.begin(), rows.end(), '\n'));
+        if (buffer.size() >= m_options.chunkBytes) flush();
+    });
+
+    if (!copied) {
+        //! Pages follow the primary key, so every page is one index range scan whatever its position.
+        const VectorString keys = connection.primaryKey(table);
+        const std::string limit = " LIMIT " + std::to_string(m_options.pageRows);
+        //! MySQL takes a bare * only as the first item, after other items it has to be qualified.
+        const std::string select = "SELECT " + (keys.empty() ? std::string() : joined(keys, ",") + ",") + table + ".* FROM " + table;
+        const std::string order = keys.empty() ? std::string() : " ORDER BY " + joined(keys, ",");
+        std::string placeholders;
+        for (std::size_t k = 0; k < keys.size(); ++k) placeholders.append(k == 0 ? "?" : ",?");
+        const std::string after = keys.size() == 1
+            ? " WHERE " + keys.front() + " > ?"
+            : " WHERE (" + joined(keys, ",") + ") > (" + placeholders + ")";
+
+        //! The pages are read inside the snapshot transaction of the worker, see backup().
+        SqlParams last;
+        for (u64 offset = 0;; offset += m_options.pageRows) {
+            ResultSet page;
+            if (keys.empty()) {
+                page = connection.execute(select + limit + " OFFSET " + std::to_string(offset));
+            } else if (last.empty()) {
+                page = connection.execute(select + order + limit);
+            } else {
+                page = connection.execute(select + after + order + limit, last);
+            }
+            for (const auto& row : page.rows) {
+                encodeRow(row, keys.size(), buffer);
+            }
+            report.rows += page.size();
+            if (buffer.size() >= m_options.chunkBytes) flush();
+            if (page.size() < m_options.pageRows) break;
+            if (!keys.empty()) last.assign(page.rows.back().begin(), page.rows.back().begin() + static_cast<std::ptrdiff_t>(keys.size()));
+        }
+    }
+    flush();
+    report.chunks = chunks.size();
+    report.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    return report;
+}
+
+BackupTableReport BackupEngine::load(Connection& connection, const std::string& table, const VectorString& columns,
+                                     const std::filesystem::path& directory, const VectorString& chunks)
+{
+    const auto start = std::chrono::steady_clock::now();
+    BackupTableReport report;
+    report.table = table;
+    report.chunks = chunks.size();
+    const std::string_view prefix = TableRegistry::prefix();
+    BulkLoadOptions options;
+    options.transaction = false;
+    BulkLoader loader(connection, options);
+    //! All chunks of a table go in one transaction, a failed restore leaves the table as empty as it was.
+    connection.run("BEGIN");
+    try {
+        for (const auto& chunk : chunks) {
+            const std::string data = readChunk(directory / chunk);
+            SeedTable seed;
+            //! The loader adds the prefix again.
+            seed.table = !prefix.empty() && table.starts_with(prefix) ? table.substr(prefix.size()) : table;
+            seed.columns = columns;
+            seed.rows = decodeRows(data, columns.size());
+            report.rows += loader.load(seed).rows;
+            report.bytes += data.size();
+            throttle(data.size());
+        }
+        //! Explicit ids don't move the sequence of a serial or identity column, the next insert would collide.
+        if (connection.driver() == DriverTypes::PostgreSQL && std::find(columns.begin(), columns.end(), "id") != columns.end()) {
+            connection.run("SELECT setval(pg_get_serial_sequence('" + table + "', 'id'), max(id)) FROM " + table);
+        }
+        connection.run("COMMIT");
+    } catch (...) {
+        rollback(connection);
+        throw;
+    }
+    report.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    return report;
+}
+
+BackupReport BackupEngine::backup(const VectorString& tables, const std::filesystem::path& directory)
+{
+    const auto start = std::chrono::steady_clock::now();
+    std::filesystem::create_directories(directory);
+    BackupReport report;
+    report.tables.resize(tables.size());
+    std::vector<VectorString> columns(tables.size());
+    std::vector<VectorString> chunks(tables.size());
+    const auto job = [&](Connection& connection, std::size_t i) {
+        report.tables[i] = dump(connection, tables[i], directory, columns[i], chunks[i]);
+    };
+    const std::size_t connections = m_pool.config().connections;
+    if (m_pool.config().driver == DriverTypes::PostgreSQL && connections > 1 && tables.size() > 1) {
+        //! The exporting transaction stays open until every worker imported its snapshot, so it keeps a connection.
+        auto leader = m_pool.acquire();
+        beginSnapshot(*leader);
+        try {
+            const std::string snapshot = std::string(leader->select("SELECT pg_export_snapshot()").text(0, 0));
+            parallel(tables.size(), connections - 1, job, [&snapshot](Connection& connection) {
+                beginSnapshot(connection);
+                connection.run("SET TRANSACTION SNAPSHOT '" + snapshot + "'");
+            });
+            leader->run("COMMIT");
+        } catch (...) {
+            rollback(*leader);
+            throw;
+        }
+    } else {
+        //! Without an exported snapshot one transaction is the only consistent view, the tables are dumped one by one.
+        parallel(tables.size(), 1, job, beginSnapshot);
+    }
+
+    std::string manifest = "{\n    \"format\": \"tegra-backup-1\",\n    \"compression\": ";
+    appendJson(manifest, ChunkSuffix.ends_with(".gz") ? "gzip" : "none");
+    manifest.append(",\n    \"driver\": ");
+    appendJson(manifest, ConnectionConfig::rdbmsOf(m_pool.config().driver));
+    manifest.append(",\n    \"tables\": [");
+    for (std::size_t i = 0; i < tables.size(); ++i) {
+        manifest.append(i == 0 ? "\n        {\"name\": " : ",\n        {\"name\": ");
+        appendJson(manifest, tables[i]);
+        manifest.append(", \"rows\": ").append(std::to_string(report.tables[i].rows));
+        manifest.append(", \"columns\": ");
+        appendJsonList(manifest, columns[i]);
+        manifest.append(", \"chunks\": ");
+        appendJsonList(manifest, chunks[i]);
+        manifest.push_back('}');
+    }
+    manifest.append("\n    ]\n}\n");
+
+    //! The manifest is written last and renamed into place, a backup without it is incomplete.
+    report.manifest = directory / ManifestName;
+    const auto temporary = directory / (std::string(ManifestName) + ".tmp");
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.write(manifest.data(), static_cast<std::streamsize>(manifest.size()))) fail("can not write the manifest");
+    }
+    std::filesystem::rename(temporary, report.manifest);
+    report.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    return report;
+}
+
+BackupReport BackupEngine::restore(const std::filesystem::path& directory, const VectorString& tables,
+                                   const std::vector<VectorString>& levels)
+{
+    const auto start = std::chrono::steady_clock::now();
+    BackupReport report;
+    report.manifest = directory / ManifestName;
+    const SeedNode root = SeedFile::read(report.manifest.string());
+    const SeedNode* list = root.find("tables");
+    if (list == nullptr) fail("the manifest has no tables");
+
+    struct Entry final
+    {
+        std::string     name    {};
+        VectorString    columns {};
+        VectorString    chunks  {};
+    };
+    std::vector<Entry> entries;
+    for (const auto& item : list->items) {
+        const SeedNode* name = item.find("name");
+        const SeedNode* columns = item.find("columns");
+        const SeedNode* chunks = item.find("chunks");
+        if (name == nullptr || columns == nullptr || chunks == nullptr) fail("broken manifest entry");
+        if (!tables.empty() && std::find(tables.begin(), tables.end(), name->text) == tables.end()) continue;
+        Entry& entry = entries.emplace_back();
+        entry.name = name->text;
+        for (const auto& column : columns->items) entry.columns.push_back(column.text);
+        for (const auto& chunk : chunks->items) entry.chunks.push_back(chunk.text);
+    }
+
+    //! A table is loaded after the tables its foreign keys point to, tables of one wave in parallel.
+    std::vector<std::vector<std::size_t>> waves(levels.size() + 1);
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        std::size_t wave = levels.size();
+        for (std::size_t l = 0; l < levels.size(); ++l) {
+            if (std::find(levels[l].begin(), levels[l].end(), entries[i].name) != levels[l].end()) {
+                wave = l;
+                break;
+            }
+        }
+        waves[wave].push_back(i);
+    }
+    report.tables.resize(entries.size());
+    for (const auto& wave : waves) {
+        parallel(wave.size(), m_pool.config().connections, [&](Connection& connection, std::size_t w) {
+            const Entry& entry = entries[wave[w]];
+            report.tables[wave[w]] = load(connection, entry.name, entry.columns, directory, entry.chunks);
+        });
+    }
+    report.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    return report;
+}
+
+TEGRA_NAMESPACE_END
@@ -0,0 +1,131 @@
+/*!
+ * MIT License
+ *
+ * Copyright (c) 2022 Kambiz Asadzadeh
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef TEGRA_BACKUP_HPP
+#define TEGRA_BACKUP_HPP
+
+#include "connectionpool.hpp"
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+/*!
+ * @brief The BackupOptions struct tunes the backup engine.
+ */
+struct BackupOptions final
+{
+    std::size_t parallelism         {0};                    ///<Tables that are copied at the same time, zero means the size of the pool.
+    std::size_t chunkBytes          {8 * 1024 * 1024};      ///<Uncompressed size of a chunk file, it bounds the memory of each worker.
+    std::size_t pageRows            {5000};                 ///<Rows of one keyset page when the driver has no COPY.
+    u64         maxBytesPerSecond   {0};                    ///<Throughput limit of all workers together, zero means no limit.
+    int         compressionLevel    {6};                    ///<Level of gzip, from 1 to 9.
+};
+
+/*!
+ * @brief The BackupTableReport struct is the result of one table.
+ */
+struct BackupTableReport final
+{
+    std::string                 table   {};
+    u64                         rows    {};
+    u64                         bytes   {};     ///<Uncompressed bytes of the rows.
+    std::size_t                 chunks  {};
+    std::chrono::microseconds   elapsed {};
+};
+
+/*!
+ * @brief The BackupReport struct is the result of a backup or a restore.
+ */
+struct BackupReport final
+{
+    std::vector<BackupTableReport>  tables      {};     ///<In the order of the request.
+    std::chrono::microseconds       elapsed     {};
+    std::filesystem::path           manifest    {};
+};
+
+/*!
+ * @brief The BackupEngine class copies tables to chunk files and back, one worker per table.
+ * Rows are written in the text format of COPY, so the files of every driver look the same:
+ * PostgreSQL streams them with COPY TO STDOUT, the other drivers page through the primary key.
+ * Each chunk holds up to BackupOptions::chunkBytes of rows and is compressed with gzip when zlib is available.
+ * A manifest.json lists the tables, their columns and their chunks.
+ * All tables are read from one snapshot: PostgreSQL workers import the snapshot of a REPEATABLE READ
+ * transaction, the other drivers dump the tables one by one inside a single consistent transaction.
+ * ======================================================
+ * ----> backup/manifest.json
+ * ----> backup/teg_config.000000.tsv.gz
+ * ======================================================
+ * Restores load the chunks of each table with the bulk loader in one transaction per table,
+ * wave by wave in dependency order, the tables of a wave in parallel.
+ */
+class BackupEngine final
+{
+public:
+    static constexpr std::string_view ManifestName = "manifest.json";
+
+    explicit BackupEngine(ConnectionPool& pool, const BackupOptions& options = {});
+    BackupEngine(const BackupEngine& rhsEngine) = delete;
+    BackupEngine& operator=(const BackupEngine& rhsEngine) = delete;
+
+    /*!
+     * @brief backup function copies tables into a directory.
+     * @param tables are full names of the tables.
+     * @param directory is created if it does not exist, old chunks of the same tables are replaced.
+     * @returns report of the tables, it throws the first error after all workers ended.
+     */
+    BackupReport backup(const VectorString& tables, const std::filesystem::path& directory);
+
+    /*!
+     * @brief restore function loads a backup into existing, empty tables.
+     * @param directory holds the manifest and the chunks.
+     * @param tables limits the restore to some tables, empty means all tables of the manifest.
+     * @param levels are the waves of SchemaBuilder::levels(), a wave starts after the previous one is loaded.
+     * Tables that are not part of any wave are loaded last.
+     */
+    BackupReport restore(const std::filesystem::path& directory, const VectorString& tables = {},
+                         const std::vector<VectorString>& levels = {});
+
+private:
+    BackupTableReport dump(Connection& connection, const std::string& table, const std::filesystem::path& directory,
+                           VectorString& columns, VectorString& chunks);
+    BackupTableReport load(Connection& connection, const std::string& table, const VectorString& columns,
+                           const std::filesystem::path& directory, const VectorString& chunks);
+    void throttle(u64 bytes);
+    using Session = std::function<void(Connection&)>;
+
+    /*!
+     * @brief parallel function runs a job per item over at most connections workers.
+     * @param begin opens a transaction on each worker connection, it is committed after the last item of the worker.
+     */
+    template<typename Job>
+    void parallel(std::size_t count, std::size_t connections, const Job& job, const Session& begin = {});
+
+    ConnectionPool&                         m_pool;
+    BackupOptions                           m_options   {};
+    std::atomic<u64>                        m_bytes     {};
+    std::chrono::steady_clock::time_point   m_started   {};
+};
+
+TEGRA_NAMESPACE_END
+
+#endif  // TEGRA_BACKUP_HPP
@@ -0,0 +1,262 @@
+#include "bulkloader.hpp"
+#include "seedfile.hpp"
+#include "tableregistry.hpp"
+#include "core.hpp"
+
+TEGRA_USING_NAMESPACE Tegra::CMS;
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+TEGRA_ANONYMOUS_NAMESPACE_BEGIN
+
+//! The smallest limit of bound parameters among the drivers (sqlite3).
+constexpr std::size_t MaxParameters = 32766;
+
+bool isSpace(char c) __tegra_noexcept
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+bool equalsNoCase(std::string_view a, std::string_view b) __tegra_noexcept
+{
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+        return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+    });
+}
+
+bool isNumber(std::string_view token) __tegra_noexcept
+{
+    std::size_t i = (!token.empty() && (token[0] == '-' || token[0] == '+')) ? 1 : 0;
+    bool digits = false;
+    bool dot = false;
+    for (; i < token.size(); ++i) {
+        if (std::isdigit(static_cast<unsigned char>(token[i]))) digits = true;
+        else if (token[i] == '.' && !dot) dot = true;
+        else return false;
+    }
+    return digits;
+}
+
+std::string_view trimmed(std::string_view text) __tegra_noexcept
+{
+    while (!text.empty() && isSpace(text.front())) text.remove_prefix(1);
+    while (!text.empty() && isSpace(text.back())) text.remove_suffix(1);
+    return text;
+}
+
+/*!
+ * @returns true if content is "(columns) VALUES ...", table definitions that are misplaced in the insert section are not.
+ */
+bool isValuesList(std::string_view content) __tegra_noexcept
+{
+    const auto close = content.find(')');
+    if (close == std::string_view::npos) return false;
+    const std::string_view rest = trimmed(content.substr(close + 1));
+    return equalsNoCase(rest.substr(0, 6), "VALUES");
+}
+
+TEGRA_NAMESPACE_END
+
+double BulkLoadReport::rowsPerSecond() const __tegra_noexcept
+{
+    const auto seconds = std::chrono::duration<double>(elapsed).count();
+    return seconds > 0 ? static_cast<double>(rows) / seconds : 0.0;
+}
+
+BulkLoader::BulkLoader(Connection& connection, const BulkLoadOptions& options) : m_connection(connection), m_options(options)
+{
+    m_options.batchSize = std::max<std::size_t>(m_options.batchSize, 1);
+}
+
+BulkLoadReport BulkLoader::load(const SeedTable& seed)
+{
+    const auto start = std::chrono::steady_clock::now();
+    BulkLoadReport report;
+    report.table = seed.table;
+    report.rows = seed.rows.size();
+    const std::string_view table = TableRegistry::name(TableRegistry::intern(seed.table));
+    if (seed.rows.empty() || seed.columns.empty()) {
+        return report;
+    }
+
+    if (m_options.transaction) m_connection.run("BEGIN");
+    try {
+        const bool expressions = std::any_of(seed.rows.begin(), seed.rows.end(), [](const SeedRow& row) {
+            return std::any_of(row.begin(), row.end(), [](const SeedCell& cell) { return cell.expression; });
+        });
+        if (m_options.useCopy && !expressions) {
+            std::vector<SqlRow> rows;
+            rows.reserve(seed.rows.size());
+            for (const auto& row : seed.rows) {
+                SqlRow& values = rows.emplace_back();
+                values.reserve(row.size());
+                for (const auto& cell : row) values.push_back(cell.value);
+            }
+            report.copied = m_connection.copy(table, seed.columns, rows);
+            report.statements = report.copied ? 1 : 0;
+        }
+        if (!report.copied) {
+            const std::size_t batch = std::min(m_options.batchSize, std::max<std::size_t>(MaxParameters / seed.columns.size(), 1));
+            for (std::size_t i = 0; i < seed.rows.size(); i += batch) {
+                report.statements += insertBatch(table, seed.columns, seed.rows.data() + i, std::min(batch, seed.rows.size() - i));
+            }
+        }
+        if (m_options.transaction) m_connection.run("COMMIT");
+    } catch (...) {
+        if (m_options.transaction && !m_connection.broken()) {
+            try {
+                m_connection.run("ROLLBACK");
+            } catch (...) {
+                //! The original error is the one that matters.
+            }
+        }
+        throw;
+    }
+    report.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    return report;
+}
+
+std::size_t BulkLoader::insertBatch(std::string_view table, const VectorString& columns, const SeedRow* rows, std::size_t count)
+{
+    std::string sql;
+    sql.reserve(32 + table.size() + columns.size() * (count * 2 + 16));
+    sql.append("INSERT INTO ").append(table).append(" (");
+    for (std::size_t c = 0; c < columns.size(); ++c) {
+        if (c != 0) sql.push_back(',');
+        sql.append(columns[c]);
+    }
+    sql.append(") VALUES ");
+    SqlParams params;
+    params.reserve(count * columns.size());
+    for (std::size_t r = 0; r < count; ++r) {
+        sql.append(r == 0 ? "(" : ",(");
+        for (std::size_t c = 0; c < rows[r].size(); ++c) {
+            if (c != 0) sql.push_back(',');
+            //! Expressions are inlined, full batches of plain values share one prepared statement.
+            if (rows[r][c].expression) {
+                sql.append(*rows[r][c].value);
+            } else {
+                sql.push_back('?');
+                params.push_back(rows[r][c].value);
+            }
+        }
+        sql.push_back(')');
+    }
+    m_connection.execute(sql, params);
+    return 1;
+}
+
+std::vector<SeedTable> BulkLoader::readSeeds(const std::string& path, std::string_view rdbms)
+{
+    std::vector<SeedTable> seeds;
+    for (const auto& entry : SeedFile::section(SeedFile::read(path), "insert", rdbms)) {
+        if (isValuesList(entry.content)) {
+            seeds.push_back(parseValues(entry.table, entry.content));
+        }
+    }
+    return seeds;
+}
+
+SeedTable BulkLoader::parseValues(std::string_view table, std::string_view content)
+{
+    SeedTable seed;
+    seed.table = std::string(table);
+    const auto fail = [&table](std::string_view message) {
+        throw Exception(Exception::Reason::IO, "Seed of table [" + std::string(table) + "]: " + std::string(message));
+    };
+    std::size_t pos = 0;
+    const auto skip = [&] { while (pos < content.size() && isSpace(content[pos])) ++pos; };
+
+    //! Columns.
+    skip();
+    if (pos == content.size() || content[pos] != '(') fail("expected a column list");
+    const auto close = content.find(')', pos);
+    if (close == std::string_view::npos) fail("unterminated column list");
+    for (std::string_view list = content.substr(pos + 1, close - pos - 1); !list.empty();) {
+        const auto comma = list.find(',');
+        std::string_view column = trimmed(list.substr(0, comma));
+        if (column.size() >= 2 && (column.front() == '`' || column.front() == '"')) column = column.substr(1, column.size() - 2);
+        if (!column.empty()) seed.columns.emplace_back(column);
+        if (comma == std::string_view::npos) break;
+        list.remove_prefix(comma + 1);
+    }
+    pos = close + 1;
+    skip();
+    if (!equalsNoCase(content.substr(pos, 6), "VALUES")) fail("expected VALUES");
+    pos += 6;
+
+    //! Rows, each cell is a quoted literal, a number, NULL or an expression.
+    for (;;) {
+        skip();
+        if (pos == content.size() || content[pos] == ';') break;
+        if (content[pos] == ',') {
+            ++pos;
+            continue;
+        }
+        if (content[pos] != '(') fail("expected '(' of a row");
+        ++pos;
+        SeedRow& row = seed.rows.emplace_back();
+        for (;;) {
+            skip();
+            if (pos == content.size()) fail("unterminated row");
+            SeedCell cell;
+            if (content[pos] == '\'') {
+                std::string literal;
+                for (++pos;; ++pos) {
+                    if (pos == content.size()) fail("unterminated string");
+                    if (content[pos] == '\'') {
+                        if (pos + 1 < content.size() && content[pos + 1] == '\'') {
+                            literal.push_back('\'');
+                            ++pos;
+                            continue;
+                        }
+                        ++pos;
+                        break;
+                    }
+                    literal.push_back(content[pos]);
+                }
+                cell.value = std::move(literal);
+                skip();
+            } else {
+                const auto start = pos;
+                int depth = 0;
+                char quote = 0;
+                for (; pos < content.size(); ++pos) {
+                    const char c = content[pos];
+                    if (quote != 0) {
+                        if (c == quote) quote = 0;
+                    } else if (c == '\'' || c == '"') {
+                        quote = c;
+                    } else if (c == '(') {
+                        ++depth;
+                    } else if (c == ')' || c == ',') {
+                        if (depth == 0) break;
+                        if (c == ')') --depth;
+                    }
+                }
+                const std::string_view token = trimmed(content.substr(start, pos - start));
+                if (token.empty()) fail("empty value");
+                if (!equalsNoCase(token, "NULL")) {
+                    cell.value = std::string(token);
+                    cell.expression = !isNumber(token);
+                }
+            }
+            row.push_back(std::move(cell));
+            if (pos == content.size()) fail("unterminated row");
+            if (content[pos] == ',') {
+                ++pos;
+                continue;
+            }
+            if (content[pos] != ')') fail("expected ',' or ')' inside a row");
+            ++pos;
+            break;
+        }
+        if (row.size() != seed.columns.size()) {
+            fail("row " + std::to_string(seed.rows.size()) + " has " + std::to_string(row.size())
+                 + " values for " + std::to_string(seed.columns.size()) + " columns");
+        }
+    }
+    return seed;
+}
+
+TEGRA_NAMESPACE_END
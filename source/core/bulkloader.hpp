@@ -0,0 +1,121 @@
+/*!
+ * MIT License
+ *
+ * Copyright (c) 2022 Kambiz Asadzadeh
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef TEGRA_BULKLOADER_HPP
+#define TEGRA_BULKLOADER_HPP
+
+#include "connection.hpp"
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+/*!
+ * @brief The SeedCell struct is one value of a seed row.
+ */
+struct SeedCell final
+{
+    SqlValue    value       {};     ///<Text of a literal, std::nullopt is NULL.
+    bool        expression  {};     ///<Raw sql such as NOW(), it is written into the statement as is.
+};
+
+using SeedRow = std::vector<SeedCell>;
+
+/*!
+ * @brief The SeedTable struct holds the rows of one table of the "insert" section of system-tables.json.
+ */
+struct SeedTable final
+{
+    std::string             table   {};     ///<Name of the table without prefix.
+    VectorString            columns {};
+    std::vector<SeedRow>    rows    {};
+};
+
+/*!
+ * @brief The BulkLoadOptions struct tunes the loader.
+ */
+struct BulkLoadOptions final
+{
+    std::size_t batchSize   {500};      ///<Rows of one multi-row INSERT statement.
+    bool        useCopy     {true};     ///<Use the bulk protocol of the driver (COPY FROM STDIN on PostgreSQL) when it's possible.
+    bool        transaction {true};     ///<Wrap each load in its own transaction, off when the caller runs one around several loads.
+};
+
+/*!
+ * @brief The BulkLoadReport struct is the result of loading one table.
+ */
+struct BulkLoadReport final
+{
+    std::string                 table       {};
+    std::size_t                 rows        {};
+    std::size_t                 statements  {};     ///<Round trips to the server, one for COPY.
+    bool                        copied      {};
+    std::chrono::microseconds   elapsed     {};
+
+    __tegra_no_discard double rowsPerSecond() const __tegra_noexcept;
+};
+
+/*!
+ * @brief The BulkLoader class loads seed rows with a few statements per table instead of one per row.
+ * Rows are grouped into multi-row INSERT ... VALUES batches that are prepared once and reused
+ * through the statement cache of the connection, or streamed with COPY on PostgreSQL.
+ * Each table is loaded inside its own transaction unless BulkLoadOptions::transaction is off.
+ */
+class BulkLoader final
+{
+public:
+    explicit BulkLoader(Connection& connection, const BulkLoadOptions& options = {});
+    BulkLoader(const BulkLoader& rhsLoader) = delete;
+    BulkLoader& operator=(const BulkLoader& rhsLoader) = delete;
+
+    /*!
+     * @brief load function inserts the rows of a table in one transaction.
+     * @param seed is the table and its rows, the table prefix is added by the loader.
+     * @returns report of the table, it throws and rolls back on error.
+     */
+    BulkLoadReport load(const SeedTable& seed);
+
+    /*!
+     * @brief readSeeds function reads the "insert" section of system-tables.json for a rdbms.
+     * @param path of the file.
+     * @param rdbms is "postgresql", "mysql" or "sqlite3", sqlite3 uses the postgresql rows.
+     * @returns tables in the order of the file, it throws if the file can't be read.
+     */
+    __tegra_no_discard static std::vector<SeedTable> readSeeds(const std::string& path, std::string_view rdbms);
+
+    /*!
+     * @brief parseValues function parses "(columns) VALUES (row), (row);" into a seed table.
+     * @param table is the name of the table.
+     * @param content is the text after "INSERT INTO table".
+     */
+    __tegra_no_discard static SeedTable parseValues(std::string_view table, std::string_view content);
+
+private:
+    std::size_t insertBatch(std::string_view table, const VectorString& columns, const SeedRow* rows, std::size_t count);
+
+    Connection&     m_connection;
+    BulkLoadOptions m_options {};
+};
+
+TEGRA_NAMESPACE_END
+
+#endif  // TEGRA_BULKLOADER_HPP
@@ -0,0 +1,238 @@
+#include "charclass.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__) || defined(_M_X64)) && (defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER))
+#define TEGRA_CHARKERNEL_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define TEGRA_CHARKERNEL_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+TEGRA_NAMESPACE_BEGIN(Tegra)
+
+TEGRA_ANONYMOUS_NAMESPACE_BEGIN
+
+//! Vector kernels compare each block against every member, so they are used for small classes only.
+constexpr std::size_t MaxVectorMembers = 16;
+
+struct Members final
+{
+    std::array<unsigned char, MaxVectorMembers> bytes {};
+    std::size_t                                 count {};
+};
+
+/*!
+ * @returns false if the class is too big (or empty) for the vector kernels.
+ */
+bool membersOf(const CharClass& cls, Members& members) __tegra_noexcept
+{
+    if (cls.count() > MaxVectorMembers || cls.count() == 0) return false;
+    for (std::size_t w = 0; w < 4; ++w) {
+        for (u64 bits = cls.word(w); bits != 0; bits &= bits - 1) {
+            members.bytes[members.count++] = static_cast<unsigned char>(w * 64 + static_cast<std::size_t>(std::countr_zero(bits)));
+        }
+    }
+    return true;
+}
+
+std::size_t findScalar(const char* data, std::size_t size, const CharClass& cls, bool member) __tegra_noexcept
+{
+    for (std::size_t i = 0; i < size; ++i) {
+        if (cls.contains(static_cast<unsigned char>(data[i])) == member) return i;
+    }
+    return std::string_view::npos;
+}
+
+#if defined(TEGRA_CHARKERNEL_SSE2)
+std::size_t findSse2(const char* data, std::size_t size, const CharClass& cls, const Members& members, bool member) __tegra_noexcept
+{
+    __m128i needles[MaxVectorMembers];
+    for (std::size_t k = 0; k < members.count; ++k) {
+        needles[k] = _mm_set1_epi8(static_cast<char>(members.bytes[k]));
+    }
+    std::size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i hits = _mm_setzero_si128();
+        for (std::size_t k = 0; k < members.count; ++k) {
+            hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, needles[k]));
+        }
+        u32 mask = static_cast<u32>(_mm_movemask_epi8(hits));
+        if (!member) mask = ~mask & 0xFFFFu;
+        if (mask != 0) return i + static_cast<std::size_t>(std::countr_zero(mask));
+    }
+    const std::size_t tail = findScalar(data + i, size - i, cls, member);
+    return tail == std::string_view::npos ? tail : i + tail;
+}
+#endif
+
+#if defined(TEGRA_CHARKERNEL_AVX2)
+__attribute__((target("avx2")))
+std::size_t findAvx2(const char* data, std::size_t size, const CharClass& cls, const Members& members, bool member) __tegra_noexcept
+{
+    __m256i needles[MaxVectorMembers];
+    for (std::size_t k = 0; k < members.count; ++k) {
+        needles[k] = _mm256_set1_epi8(static_cast<char>(members.bytes[k]));
+    }
+    std::size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i hits = _mm256_setzero_si256();
+        for (std::size_t k = 0; k < members.count; ++k) {
+            hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(block, needles[k]));
+        }
+        u32 mask = static_cast<u32>(_mm256_movemask_epi8(hits));
+        if (!member) mask = ~mask;
+        if (mask != 0) return i + static_cast<std::size_t>(std::countr_zero(mask));
+    }
+    const std::size_t tail = findScalar(data + i, size - i, cls, member);
+    return tail == std::string_view::npos ? tail : i + tail;
+}
+#endif
+
+CharKernel::Level detectLevel() __tegra_noexcept
+{
+#if defined(TEGRA_CHARKERNEL_AVX2)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return CharKernel::Level::AVX2;
+#endif
+#if defined(TEGRA_CHARKERNEL_SSE2)
+    return CharKernel::Level::SSE2;
+#else
+    return CharKernel::Level::Scalar;
+#endif
+}
+
+/*!
+ * @brief The Finder struct prepares a class once for all searches of an operation.
+ */
+struct Finder final
+{
+    explicit Finder(const CharClass& c) : cls(c)
+    {
+        level = CharKernel::level();
+        if (level != CharKernel::Level::Scalar && !membersOf(cls, members)) {
+            level = CharKernel::Level::Scalar;
+        }
+    }
+
+    std::size_t operator()(std::string_view content, bool member) const __tegra_noexcept
+    {
+        const char* data = content.data();
+        const std::size_t size = content.size();
+        if (level == CharKernel::Level::Scalar || size < 16) {
+            return findScalar(data, size, cls, member);
+        }
+#if defined(TEGRA_CHARKERNEL_AVX2)
+        if (level == CharKernel::Level::AVX2) return findAvx2(data, size, cls, members, member);
+#endif
+#if defined(TEGRA_CHARKERNEL_SSE2)
+        return findSse2(data, size, cls, members, member);
+#else
+        return findScalar(data, size, cls, member);
+#endif
+    }
+
+    const CharClass&  cls;
+    Members           members {};
+    CharKernel::Level level   {};
+};
+
+//! Bytes that are compacted one by one after a vector search found a member, dense classes stay in this loop.
+constexpr std::size_t ScalarWindow = 64;
+
+/*!
+ * @brief Shared loop of removeAll and collapseRuns.
+ * Clean runs are found by the vector kernels and moved in bulk, the bytes after a hit are compacted
+ * by a branchless loop so that text with many members does not pay one vector search per member.
+ * With a replacement, exactly one replacement byte is written for each maximal run of members.
+ * @returns the new size of content.
+ */
+std::size_t compact(std::string& content, const CharClass& cls, const char* replacement) __tegra_noexcept
+{
+    const Finder find(cls);
+    const std::string_view view {content};
+    char* data = content.data();
+    const std::size_t size = view.size();
+    std::size_t write = 0;
+    std::size_t read = 0;
+    bool inRun = false;
+    while (read < size) {
+        const std::size_t hit = find(view.substr(read), true);
+        const std::size_t next = hit == std::string_view::npos ? size : read + hit;
+        if (next != read) {
+            if (write != read) std::memmove(data + write, data + read, next - read);
+            write += next - read;
+            inRun = false;
+        }
+        read = next;
+        //! write never passes read, so the bytes are read before they can be overwritten.
+        const std::size_t end = std::min(size, read + ScalarWindow);
+        if (replacement == nullptr) {
+            for (; read < end; ++read) {
+                const char c = data[read];
+                data[write] = c;
+                write += cls.contains(static_cast<unsigned char>(c)) ? 0 : 1;
+            }
+        } else {
+            for (; read < end; ++read) {
+                const char c = data[read];
+                const bool member = cls.contains(static_cast<unsigned char>(c));
+                data[write] = member ? *replacement : c;
+                write += (member && inRun) ? 0 : 1;
+                inRun = member;
+            }
+        }
+    }
+    return write;
+}
+
+TEGRA_NAMESPACE_END
+
+CharKernel::Level CharKernel::level() __tegra_noexcept
+{
+    static const Level level = detectLevel();
+    return level;
+}
+
+std::size_t CharKernel::findFirst(std::string_view content, const CharClass& cls) __tegra_noexcept
+{
+    return Finder(cls)(content, true);
+}
+
+std::size_t CharKernel::findFirstNot(std::string_view content, const CharClass& cls) __tegra_noexcept
+{
+    return Finder(cls)(content, false);
+}
+
+void CharKernel::removeAll(std::string& content, const CharClass& cls) __tegra_noexcept
+{
+    content.resize(compact(content, cls, nullptr));
+}
+
+void CharKernel::collapseRuns(std::string& content, const CharClass& cls, char replacement) __tegra_noexcept
+{
+    content.resize(compact(content, cls, &replacement));
+}
+
+void CharKernel::trimLeading(std::string& content, const CharClass& cls) __tegra_noexcept
+{
+    const std::size_t first = findFirstNot(content, cls);
+    content.erase(0, first == std::string_view::npos ? content.size() : first);
+}
+
+void CharKernel::trimTrailing(std::string& content, const CharClass& cls) __tegra_noexcept
+{
+    std::size_t size = content.size();
+    while (size > 0 && cls.contains(static_cast<unsigned char>(content[size - 1]))) --size;
+    content.resize(size);
+}
+
+void CharKernel::trim(std::string& content, const CharClass& cls) __tegra_noexcept
+{
+    trimTrailing(content, cls);
+    trimLeading(content, cls);
+}
+
+TEGRA_NAMESPACE_END
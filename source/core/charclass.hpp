@@ -0,0 +1,168 @@
+/*!
+ * MIT License
+ *
+ * Copyright (c) 2022 Kambiz Asadzadeh
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef TEGRA_CHARCLASS_HPP
+#define TEGRA_CHARCLASS_HPP
+
+#include "common.hpp"
+
+TEGRA_USING_NAMESPACE Tegra::Types;
+
+TEGRA_NAMESPACE_BEGIN(Tegra)
+
+/*!
+ * @brief The CharClass class is a 256 bit table of bytes, for example the set of white spaces.
+ */
+class CharClass
+{
+public:
+    constexpr CharClass() = default;
+
+    /*!
+     * @brief Builds a class from the bytes of a string.
+     * @param bytes are the members of the class.
+     */
+    constexpr explicit CharClass(std::string_view bytes)
+    {
+        for (const char c : bytes) {
+            const auto b = static_cast<unsigned char>(c);
+            m_bits[b >> 6] |= u64(1) << (b & 63);
+        }
+    }
+
+    /*!
+     * @brief contains function checks a byte.
+     * @returns true if the byte is a member of the class.
+     */
+    __tegra_no_discard constexpr bool contains(unsigned char b) const __tegra_noexcept
+    {
+        return (m_bits[b >> 6] >> (b & 63)) & 1;
+    }
+
+    /*!
+     * @brief count function gets number of members.
+     * @returns as number of bytes inside the class.
+     */
+    __tegra_no_discard constexpr std::size_t count() const __tegra_noexcept
+    {
+        std::size_t n = 0;
+        for (const auto word : m_bits) {
+            n += static_cast<std::size_t>(std::popcount(word));
+        }
+        return n;
+    }
+
+    /*!
+     * @brief word function gets 64 members of the table, word 0 holds the bytes 0 to 63.
+     * @returns as bit mask.
+     */
+    __tegra_no_discard constexpr u64 word(std::size_t index) const __tegra_noexcept
+    {
+        return m_bits[index];
+    }
+
+    /*!
+     * @brief space function gets the white spaces of the "C" locale, same as std::isspace.
+     * @returns as class.
+     */
+    __tegra_no_discard static constexpr CharClass space() __tegra_noexcept
+    {
+        return CharClass(" \t\n\v\f\r");
+    }
+
+private:
+    std::array<u64, 4> m_bits {};
+};
+
+/*!
+ * @brief The CharKernel struct provides vectorized text filters driven by a CharClass.
+ * @details The implementation is selected once at runtime: AVX2, SSE2 or a scalar fallback.
+ * Vector kernels are used for classes with up to 16 members, bigger classes use the scalar table.
+ * Clean runs are copied in bulk and only the blocks that contain members are handled byte by byte.
+ */
+struct CharKernel final
+{
+    /*!
+     * @brief Instruction set used by the kernels.
+     */
+    enum class Level : u8
+    {
+        Scalar  =   0x0,
+        SSE2    =   0x1,
+        AVX2    =   0x2
+    };
+
+    /*!
+     * @brief level function gets the instruction set that is selected on this machine.
+     * @returns as Level enum.
+     */
+    __tegra_no_discard static Level level() __tegra_noexcept;
+
+    /*!
+     * @brief findFirst function finds the first byte that is a member of the class.
+     * @returns position of the byte or std::string_view::npos.
+     */
+    __tegra_no_discard static std::size_t findFirst(std::string_view content, const CharClass& cls) __tegra_noexcept;
+
+    /*!
+     * @brief findFirstNot function finds the first byte that is not a member of the class.
+     * @returns position of the byte or std::string_view::npos.
+     */
+    __tegra_no_discard static std::size_t findFirstNot(std::string_view content, const CharClass& cls) __tegra_noexcept;
+
+    /*!
+     * @brief removeAll function removes all bytes of the class from the content.
+     * @param content will be modified in place.
+     */
+    static void removeAll(std::string& content, const CharClass& cls) __tegra_noexcept;
+
+    /*!
+     * @brief collapseRuns function replaces each run of class bytes with one replacement byte.
+     * @param content will be modified in place.
+     * @param replacement is the byte that is written for each run.
+     */
+    static void collapseRuns(std::string& content, const CharClass& cls, char replacement) __tegra_noexcept;
+
+    /*!
+     * @brief trimLeading function removes the class bytes from the beginning of content at once.
+     * @param content will be modified in place.
+     */
+    static void trimLeading(std::string& content, const CharClass& cls) __tegra_noexcept;
+
+    /*!
+     * @brief trimTrailing function removes the class bytes from the end of content.
+     * @param content will be modified in place.
+     */
+    static void trimTrailing(std::string& content, const CharClass& cls) __tegra_noexcept;
+
+    /*!
+     * @brief trim function removes the class bytes from both sides of content.
+     * @param content will be modified in place.
+     */
+    static void trim(std::string& content, const CharClass& cls) __tegra_noexcept;
+};
+
+TEGRA_NAMESPACE_END
+
+#endif // TEGRA_CHARCLASS_HPP
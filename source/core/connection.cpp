@@ -0,0 +1,1422 @@
+#include "connection.hpp"
+#include "tableregistry.hpp"
+#include "core.hpp"
+
+#if __has_include(<nlohmann/json.hpp>)
+#include <nlohmann/json.hpp>
+#define TEGRA_CONNECTION_NLOHMANN
+#elif __has_include(<json/json.h>)
+#include <json/json.h>
+#define TEGRA_CONNECTION_JSONCPP
+#endif
+
+#if defined(TEGRA_DRIVER_SQLITE)
+#include <sqlite3.h>
+#endif
+
+#if defined(TEGRA_DRIVER_POSTGRESQL)
+#include <libpq-fe.h>
+#endif
+
+#if defined(TEGRA_DRIVER_MYSQL)
+#include <mysql.h>
+#include <errmsg.h>
+#endif
+
+TEGRA_USING_NAMESPACE Tegra::CMS;
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+TEGRA_ANONYMOUS_NAMESPACE_BEGIN
+
+const SqlValue NullValue {};
+
+#if defined(TEGRA_CONNECTION_NLOHMANN)
+using JsonNode = nlohmann::json;
+
+std::string textOf(const JsonNode& node, const char* key, const std::string& fallback)
+{
+    return node.contains(key) && node[key].is_string() ? node[key].get<std::string>() : fallback;
+}
+
+double numberOf(const JsonNode& node, const char* key, double fallback)
+{
+    return node.contains(key) && node[key].is_number() ? node[key].get<double>() : fallback;
+}
+#elif defined(TEGRA_CONNECTION_JSONCPP)
+using JsonNode = Json::Value;
+
+std::string textOf(const JsonNode& node, const char* key, const std::string& fallback)
+{
+    return node.isMember(key) && node[key].isString() ? node[key].asString() : fallback;
+}
+
+double numberOf(const JsonNode& node, const char* key, double fallback)
+{
+    return node.isMember(key) && node[key].isNumeric() ? node[key].asDouble() : fallback;
+}
+#endif
+
+[[noreturn]] void fail(std::string_view driver, std::string_view message)
+{
+    throw Exception(Exception::Reason::IO, std::string(driver) + ": " + std::string(message));
+}
+
+#if defined(TEGRA_DRIVER_SQLITE)
+
+class SQLiteStatement final : public Statement
+{
+public:
+    SQLiteStatement(sqlite3* db, sqlite3_stmt* statement) : m_db(db), m_statement(statement)
+    {
+    }
+
+    ~SQLiteStatement() override
+    {
+        sqlite3_finalize(m_statement);
+    }
+
+    ResultSet execute(const SqlParams& params) override
+    {
+        bind(params);
+        ResultSet result;
+        const int columns = sqlite3_column_count(m_statement);
+        result.columns.reserve(static_cast<std::size_t>(columns));
+        for (int c = 0; c < columns; ++c) {
+            result.columns.emplace_back(sqlite3_column_name(m_statement, c));
+        }
+        int step = SQLITE_ROW;
+        while ((step = sqlite3_step(m_statement)) == SQLITE_ROW) {
+            SqlRow& row = result.rows.emplace_back();
+            row.reserve(static_cast<std::size_t>(columns));
+            for (int c = 0; c < columns; ++c) {
+                if (sqlite3_column_type(m_statement, c) == SQLITE_NULL) {
+                    row.emplace_back();
+                } else {
+                    const auto* text = reinterpret_cast<const char*>(sqlite3_column_text(m_statement, c));
+                    row.emplace_back(std::string(text, static_cast<std::size_t>(sqlite3_column_bytes(m_statement, c))));
+                }
+            }
+        }
+        //! Bound parameters point into params, they must not outlive this call.
+        sqlite3_reset(m_statement);
+        sqlite3_clear_bindings(m_statement);
+        if (step != SQLITE_DONE) fail("sqlite3", sqlite3_errmsg(m_db));
+        result.affectedRows = static_cast<u64>(sqlite3_changes64(m_db));
+        result.lastInsertId = static_cast<u64>(sqlite3_last_insert_rowid(m_db));
+        return result;
+    }
+
+    ResultView query(const SqlParams& params) override
+    {
+        bind(params);
+        const int columns = sqlite3_column_count(m_statement);
+        VectorString names;
+        names.reserve(static_cast<std::size_t>(columns));
+        for (int c = 0; c < columns; ++c) {
+            names.emplace_back(sqlite3_column_name(m_statement, c));
+        }
+        //! Values of sqlite3 are only valid until the next step, they are copied into the arena of the view.
+        auto arena = CreateRef<ResultArena>();
+        std::vector<ResultView::Cell> cells;
+        int step = SQLITE_ROW;
+        while ((step = sqlite3_step(m_statement)) == SQLITE_ROW) {
+            for (int c = 0; c < columns; ++c) {
+                if (sqlite3_column_type(m_statement, c) == SQLITE_NULL) {
+                    cells.emplace_back();
+                } else {
+                    const auto* text = reinterpret_cast<const char*>(sqlite3_column_text(m_statement, c));
+                    const std::string_view copy = arena->store({text, static_cast<std::size_t>(sqlite3_column_bytes(m_statement, c))});
+                    cells.push_back({copy.data() != nullptr ? copy.data() : "", copy.size()});
+                }
+            }
+        }
+        sqlite3_reset(m_statement);
+        sqlite3_clear_bindings(m_statement);
+        if (step != SQLITE_DONE) fail("sqlite3", sqlite3_errmsg(m_db));
+        ResultView view(std::move(names), std::move(cells), std::move(arena));
+        view.affectedRows = static_cast<u64>(sqlite3_changes64(m_db));
+        view.lastInsertId = static_cast<u64>(sqlite3_last_insert_rowid(m_db));
+        return view;
+    }
+
+private:
+    void bind(const SqlParams& params)
+    {
+        sqlite3_reset(m_statement);
+        sqlite3_clear_bindings(m_statement);
+        for (std::size_t i = 0; i < params.size(); ++i) {
+            const int index = static_cast<int>(i + 1);
+            const int bound = params[i].has_value()
+                ? sqlite3_bind_text64(m_statement, index, params[i]->data(), params[i]->size(), SQLITE_STATIC, SQLITE_UTF8)
+                : sqlite3_bind_null(m_statement, index);
+            if (bound != SQLITE_OK) fail("sqlite3", sqlite3_errmsg(m_db));
+        }
+    }
+
+    sqlite3*        m_db        {};
+    sqlite3_stmt*   m_statement {};
+};
+
+class SQLiteConnection final : public Connection
+{
+public:
+    explicit SQLiteConnection(const ConnectionConfig& config) : Connection(config.statementCacheSize)
+    {
+        const std::string file = config.filename.empty() ? std::string(":memory:") : config.filename;
+        const int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX | SQLITE_OPEN_URI;
+        if (sqlite3_open_v2(file.c_str(), &m_db, flags, nullptr) != SQLITE_OK) {
+            const std::string message = m_db != nullptr ? sqlite3_errmsg(m_db) : "out of memory";
+            sqlite3_close_v2(m_db);
+            fail("sqlite3", message);
+        }
+        sqlite3_busy_timeout(m_db, config.timeout.count() > 0 ? static_cast<int>(config.timeout.count()) : 5000);
+    }
+
+    ~SQLiteConnection() override
+    {
+        //! Statements must be finalized before the database is closed.
+        clearStatements();
+        sqlite3_close_v2(m_db);
+    }
+
+    ResultSet run(std::string_view sql) override
+    {
+        //! Statements of the script are prepared and stepped one by one, the last one gives the rows.
+        ResultSet result;
+        const char* tail = sql.data();
+        const char* const end = sql.data() + sql.size();
+        while (tail < end) {
+            sqlite3_stmt* statement = nullptr;
+            if (sqlite3_prepare_v2(m_db, tail, static_cast<int>(end - tail), &statement, &tail) != SQLITE_OK) {
+                fail("sqlite3", sqlite3_errmsg(m_db));
+            }
+            if (statement == nullptr) break;
+            result = SQLiteStatement(m_db, statement).execute({});
+        }
+        return result;
+    }
+
+    bool ping() override
+    {
+        return sqlite3_exec(m_db, "SELECT 1", nullptr, nullptr, nullptr) == SQLITE_OK;
+    }
+
+    VectorString primaryKey(std::string_view table) override
+    {
+        //! pk is the position of the column inside the key, zero for other columns.
+        const ResultSet info = run("PRAGMA table_info(" + std::string(table) + ")");
+        std::vector<std::pair<int, std::string>> keys;
+        for (std::size_t r = 0; r < info.size(); ++r) {
+            const int position = std::atoi(info.value(r, "pk").value_or("0").c_str());
+            if (position > 0) keys.emplace_back(position, *info.value(r, "name"));
+        }
+        std::sort(keys.begin(), keys.end());
+        VectorString columns;
+        for (auto& key : keys) columns.push_back(std::move(key.second));
+        if (columns.empty()) columns.emplace_back("rowid");
+        return columns;
+    }
+
+    std::vector<ColumnInfo> describe(std::string_view table) override
+    {
+        const ResultSet info = run("PRAGMA table_info(" + std::string(table) + ")");
+        std::vector<ColumnInfo> columns;
+        columns.reserve(info.size());
+        for (std::size_t r = 0; r < info.size(); ++r) {
+            ColumnInfo& column = columns.emplace_back();
+            column.name = info.value(r, "name").value_or("");
+            column.type = info.value(r, "type").value_or("");
+            column.nullable = info.value(r, "notnull").value_or("0") == "0";
+            column.defaultValue = info.value(r, "dflt_value");
+            //! An INTEGER PRIMARY KEY of one column is the rowid of sqlite3.
+            column.identity = info.value(r, "pk").value_or("0") == "1" && column.type == "INTEGER";
+        }
+        return columns;
+    }
+
+    DriverTypes driver() const __tegra_noexcept override
+    {
+        return DriverTypes::SQLite;
+    }
+
+protected:
+    Scope<Statement> prepare(std::string_view sql) override
+    {
+        sqlite3_stmt* statement = nullptr;
+        if (sqlite3_prepare_v3(m_db, sql.data(), static_cast<int>(sql.size()), SQLITE_PREPARE_PERSISTENT, &statement, nullptr) != SQLITE_OK) {
+            fail("sqlite3", sqlite3_errmsg(m_db));
+        }
+        return CreateScope<SQLiteStatement>(m_db, statement);
+    }
+
+private:
+    sqlite3* m_db {};
+};
+
+#endif
+
+#if defined(TEGRA_DRIVER_POSTGRESQL)
+
+/*!
+ * @brief Rewrites '?' placeholders as $1, $2 ... outside of quoted strings, identifiers, comments and dollar quoted bodies.
+ * The jsonb operators ?| and ?& are kept, the bare ? operator is written as ?? (as in JDBC) and becomes a single ?.
+ */
+std::string numberedPlaceholders(std::string_view sql)
+{
+    const auto isTagStart = [](char c) { return std::isalpha(static_cast<unsigned char>(c)) || c == '_'; };
+    const auto isTagPart = [](char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; };
+
+    std::string output;
+    output.reserve(sql.size() + 16);
+    std::size_t number = 0;
+    std::size_t i = 0;
+    const std::size_t size = sql.size();
+    while (i < size) {
+        const char c = sql[i];
+        const char next = i + 1 < size ? sql[i + 1] : '\0';
+        std::size_t end = i + 1;
+        if (c == '\'' || c == '"') {
+            //! A doubled quote inside the literal toggles twice, so it's copied as part of it.
+            end = sql.find(c, i + 1);
+            end = end == std::string_view::npos ? size : end + 1;
+        } else if (c == '-' && next == '-') {
+            end = sql.find('\n', i + 2);
+            end = end == std::string_view::npos ? size : end + 1;
+        } else if (c == '/' && next == '*') {
+            //! Block comments of postgresql nest.
+            std::size_t depth = 1;
+            end = i + 2;
+            while (end < size && depth > 0) {
+                if (sql[end] == '/' && end + 1 < size && sql[end + 1] == '*') {
+                    ++depth;
+                    end += 2;
+                } else if (sql[end] == '*' && end + 1 < size && sql[end + 1] == '/') {
+                    --depth;
+                    end += 2;
+                } else {
+                    ++end;
+                }
+            }
+        } else if (c == '$' && (next == '$' || isTagStart(next)) && (i == 0 || !isTagPart(sql[i - 1]))) {
+            //! $tag$ ... $tag$, a $ followed by a digit is a numbered parameter and not a quote.
+            std::size_t tagEnd = i + 1;
+            while (tagEnd < size && isTagPart(sql[tagEnd])) ++tagEnd;
+            if (tagEnd < size && sql[tagEnd] == '$') {
+                const std::string_view tag = sql.substr(i, tagEnd - i + 1);
+                const std::size_t close = sql.find(tag, tagEnd + 1);
+                end = close == std::string_view::npos ? size : close + tag.size();
+            }
+        } else if (c == '?') {
+            if (next == '?') {
+                output.push_back('?');
+                i += 2;
+                continue;
+            }
+            const char after = i + 2 < size ? sql[i + 2] : '\0';
+            if ((next == '|' && after != '|') || (next == '&' && after != '&')) {
+                end = i + 2;
+            } else {
+                output.push_back('$');
+                output.append(std::to_string(++number));
+                ++i;
+                continue;
+            }
+        }
+        output.append(sql.substr(i, end - i));
+        i = end;
+    }
+    return output;
+}
+
+//! The statement without its trailing semicolons and blanks, so a clause can be appended to it.
+std::string_view withoutTerminator(std::string_view sql) __tegra_noexcept
+{
+    while (!sql.empty() && (sql.back() == ';' || std::isspace(static_cast<unsigned char>(sql.back())))) {
+        sql.remove_suffix(1);
+    }
+    return sql;
+}
+
+ResultSet resultOf(PGresult* pgResult)
+{
+    ResultSet result;
+    const int columns = PQnfields(pgResult);
+    const int rows = PQntuples(pgResult);
+    result.columns.reserve(static_cast<std::size_t>(columns));
+    for (int c = 0; c < columns; ++c) {
+        result.columns.emplace_back(PQfname(pgResult, c));
+    }
+    result.rows.reserve(static_cast<std::size_t>(rows));
+    for (int r = 0; r < rows; ++r) {
+        SqlRow& row = result.rows.emplace_back();
+        row.reserve(static_cast<std::size_t>(columns));
+        for (int c = 0; c < columns; ++c) {
+            if (PQgetisnull(pgResult, r, c)) {
+                row.emplace_back();
+            } else {
+                row.emplace_back(std::string(PQgetvalue(pgResult, r, c), static_cast<std::size_t>(PQgetlength(pgResult, r, c))));
+            }
+        }
+    }
+    const char* affected = PQcmdTuples(pgResult);
+    result.affectedRows = (affected != nullptr && *affected != '\0') ? std::strtoull(affected, nullptr, 10) : 0;
+    const Oid oid = PQoidValue(pgResult);
+    result.lastInsertId = oid == InvalidOid ? 0 : oid;
+    return result;
+}
+
+/*!
+ * @brief Wraps a result into a view, cells point into the PGresult and the view keeps it alive instead of copying the values.
+ */
+ResultView viewOf(PGresult* result)
+{
+    const Ref<const void> owner(result, PQclear);
+    const int columns = PQnfields(result);
+    const int rows = PQntuples(result);
+    VectorString names;
+    names.reserve(static_cast<std::size_t>(columns));
+    for (int c = 0; c < columns; ++c) {
+        names.emplace_back(PQfname(result, c));
+    }
+    std::vector<ResultView::Cell> cells;
+    cells.reserve(static_cast<std::size_t>(rows) * static_cast<std::size_t>(columns));
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c < columns; ++c) {
+            if (PQgetisnull(result, r, c)) {
+                cells.emplace_back();
+            } else {
+                cells.push_back({PQgetvalue(result, r, c), static_cast<std::size_t>(PQgetlength(result, r, c))});
+            }
+        }
+    }
+    const char* affected = PQcmdTuples(result);
+    ResultView view(std::move(names), std::move(cells), owner);
+    view.affectedRows = (affected != nullptr && *affected != '\0') ? std::strtoull(affected, nullptr, 10) : 0;
+    const Oid oid = PQoidValue(result);
+    view.lastInsertId = oid == InvalidOid ? 0 : oid;
+    return view;
+}
+
+class PostgreSQLConnection;
+
+class PostgreSQLStatement final : public Statement
+{
+public:
+    PostgreSQLStatement(PostgreSQLConnection& connection, std::string name) : m_connection(connection), m_name(std::move(name))
+    {
+    }
+
+    ~PostgreSQLStatement() override;
+    ResultSet execute(const SqlParams& params) override;
+    ResultView query(const SqlParams& params) override;
+
+private:
+    PGresult* run(const SqlParams& params);
+
+    PostgreSQLConnection&   m_connection;
+    std::string             m_name {};
+};
+
+class PostgreSQLConnection final : public Connection
+{
+public:
+    explicit PostgreSQLConnection(const ConnectionConfig& config) : Connection(config.statementCacheSize)
+    {
+        const std::string port = config.port != 0 ? std::to_string(config.port) : std::string("5432");
+        const std::string connectTimeout = std::to_string(std::max<long long>(config.acquireTimeout.count() / 1000, 2));
+        std::vector<const char*> keys {"host", "port", "dbname", "user", "password", "connect_timeout"};
+        std::vector<const char*> values {config.host.c_str(), port.c_str(), config.dbname.c_str(), config.user.c_str(), config.password.c_str(), connectTimeout.c_str()};
+        if (!config.clientEncoding.empty()) {
+            keys.push_back("client_encoding");
+            values.push_back(config.clientEncoding.c_str());
+        }
+        keys.push_back(nullptr);
+        values.push_back(nullptr);
+        m_connection = PQconnectdbParams(keys.data(), values.data(), 0);
+        if (PQstatus(m_connection) != CONNECTION_OK) {
+            const std::string message = PQerrorMessage(m_connection);
+            PQfinish(m_connection);
+            fail("postgresql", message);
+        }
+        if (config.timeout.count() > 0) {
+            run("SET statement_timeout = " + std::to_string(config.timeout.count()));
+        }
+    }
+
+    ~PostgreSQLConnection() override
+    {
+        clearStatements();
+        PQfinish(m_connection);
+    }
+
+    ResultSet run(std::string_view sql) override
+    {
+        return check(PQexec(m_connection, std::string(sql).c_str()));
+    }
+
+#if defined(LIBPQ_HAS_PIPELINING)
+    std::vector<ResultView> pipeline(const std::vector<QueryRequest>& queries) override
+    {
+        if (queries.size() < 2 || PQenterPipelineMode(m_connection) != 1) {
+            return Connection::pipeline(queries);
+        }
+        //! Statements are sent unnamed, every one is parsed and run in the same round trip.
+        std::size_t sent = 0;
+        for (const auto& query : queries) {
+            std::vector<const char*> values;
+            std::vector<int> lengths;
+            values.reserve(query.params.size());
+            lengths.reserve(query.params.size());
+            for (const auto& param : query.params) {
+                values.push_back(param.has_value() ? param->c_str() : nullptr);
+                lengths.push_back(param.has_value() ? static_cast<int>(param->size()) : 0);
+            }
+            if (PQsendQueryParams(m_connection, numberedPlaceholders(query.sql).c_str(), static_cast<int>(query.params.size()),
+                                  nullptr, values.data(), lengths.data(), nullptr, 0) != 1) {
+                break;
+            }
+            ++sent;
+        }
+        std::string error = sent < queries.size() ? PQerrorMessage(m_connection) : std::string();
+        if (PQpipelineSync(m_connection) != 1) {
+            markBroken();
+            fail("postgresql", PQerrorMessage(m_connection));
+        }
+
+        //! Every statement gives its result and a nullptr, the sync point closes the pipeline.
+        std::vector<ResultView> results;
+        results.reserve(sent);
+        for (;;) {
+            PGresult* result = PQgetResult(m_connection);
+            if (result == nullptr) {
+                if (PQstatus(m_connection) == CONNECTION_OK) continue;
+                markBroken();
+                if (error.empty()) error = PQerrorMessage(m_connection);
+                break;
+            }
+            const ExecStatusType status = PQresultStatus(result);
+            if (status == PGRES_PIPELINE_SYNC) {
+                PQclear(result);
+                break;
+            }
+            if (status == PGRES_COMMAND_OK || status == PGRES_TUPLES_OK) {
+                results.push_back(viewOf(result));
+            } else {
+                if (error.empty() && status != PGRES_PIPELINE_ABORTED) error = PQresultErrorMessage(result);
+                PQclear(result);
+                if (PQstatus(m_connection) != CONNECTION_OK) {
+                    markBroken();
+                    break;
+                }
+            }
+        }
+        PQexitPipelineMode(m_connection);
+        if (!error.empty()) fail("postgresql", error);
+        return results;
+    }
+#endif
+
+    bool ping() override
+    {
+        if (PQstatus(m_connection) != CONNECTION_OK) return false;
+        PGresult* result = PQexec(m_connection, "SELECT 1");
+        const bool alive = PQresultStatus(result) == PGRES_TUPLES_OK;
+        PQclear(result);
+        return alive;
+    }
+
+    u64 insert(std::string_view sql, const SqlParams& params, std::string_view idColumn) override
+    {
+        const ResultSet result = execute(std::string(withoutTerminator(sql)) + " RETURNING " + std::string(idColumn), params);
+        if (result.empty() || !result.rows.front().front().has_value()) return 0;
+        return std::strtoull(result.rows.front().front()->c_str(), nullptr, 10);
+    }
+
+    bool copyOut(std::string_view table, const std::function<void(std::string_view)>& sink) override
+    {
+        PGresult* start = PQexec(m_connection, ("COPY " + std::string(table) + " TO STDOUT").c_str());
+        if (PQresultStatus(start) != PGRES_COPY_OUT) {
+            check(start);
+            return false;
+        }
+        PQclear(start);
+        char* buffer = nullptr;
+        int size = 0;
+        //! Each call hands out one row, a connection left inside COPY can't be reused.
+        while ((size = PQgetCopyData(m_connection, &buffer, 0)) > 0) {
+            try {
+                sink(std::string_view(buffer, static_cast<std::size_t>(size)));
+            } catch (...) {
+                PQfreemem(buffer);
+                markBroken();
+                throw;
+            }
+            PQfreemem(buffer);
+        }
+        if (size == -2) {
+            markBroken();
+            fail("postgresql", PQerrorMessage(m_connection));
+        }
+        check(PQgetResult(m_connection));
+        while (PGresult* rest = PQgetResult(m_connection)) PQclear(rest);
+        return true;
+    }
+
+    VectorString primaryKey(std::string_view table) override
+    {
+        const ResultSet keys = execute("SELECT a.attname FROM pg_index i "
+                                       "JOIN pg_attribute a ON a.attrelid = i.indrelid AND a.attnum = ANY(i.indkey) "
+                                       "WHERE i.indrelid = ?::regclass AND i.indisprimary "
+                                       "ORDER BY array_position(i.indkey, a.attnum)", {std::string(table)});
+        VectorString columns;
+        for (const auto& row : keys.rows) columns.push_back(row.front().value_or(""));
+        return columns;
+    }
+
+    std::vector<ColumnInfo> describe(std::string_view table) override
+    {
+        const ResultSet info = execute("SELECT a.attname, format_type(a.atttypid, a.atttypmod), NOT a.attnotnull, "
+                                       "pg_get_expr(d.adbin, d.adrelid), a.attidentity <> '' OR pg_get_expr(d.adbin, d.adrelid) LIKE 'nextval(%' "
+                                       "FROM pg_attribute a LEFT JOIN pg_attrdef d ON d.adrelid = a.attrelid AND d.adnum = a.attnum "
+                                       "WHERE a.attrelid = to_regclass(?) AND a.attnum > 0 AND NOT a.attisdropped "
+                                       "ORDER BY a.attnum", {std::string(table)});
+        std::vector<ColumnInfo> columns;
+        columns.reserve(info.size());
+        for (const auto& row : info.rows) {
+            columns.push_back({row[0].value_or(""), row[1].value_or(""), row[2].value_or("f") == "t", row[3], row[4].value_or("f") == "t"});
+        }
+        return columns;
+    }
+
+    bool copy(std::string_view table, const VectorString& columns, const std::vector<SqlRow>& rows) override
+    {
+        std::string sql = "COPY " + std::string(table) + " (";
+        for (std::size_t c = 0; c < columns.size(); ++c) {
+            if (c != 0) sql.push_back(',');
+            sql.append(columns[c]);
+        }
+        sql.append(") FROM STDIN");
+        PGresult* start = PQexec(m_connection, sql.c_str());
+        if (PQresultStatus(start) != PGRES_COPY_IN) {
+            check(start);
+            return false;
+        }
+        PQclear(start);
+
+        //! Rows are sent in the text format of COPY, in chunks of about 64KiB.
+        std::string buffer;
+        buffer.reserve(std::size_t(1) << 16);
+        const auto flush = [this, &buffer] {
+            if (!buffer.empty() && PQputCopyData(m_connection, buffer.data(), static_cast<int>(buffer.size())) != 1) {
+                markBroken();
+                fail("postgresql", PQerrorMessage(m_connection));
+            }
+            buffer.clear();
+        };
+        for (const auto& row : rows) {
+            for (std::size_t c = 0; c < row.size(); ++c) {
+                if (c != 0) buffer.push_back('\t');
+                if (!row[c].has_value()) {
+                    buffer.append("\\N");
+                    continue;
+                }
+                for (const char ch : *row[c]) {
+                    switch (ch) {
+                    case '\\': buffer.append("\\\\"); break;
+                    case '\t':  buffer.append("\\t"); break;
+                    case '\n':  buffer.append("\\n"); break;
+                    case '\r':  buffer.append("\\r"); break;
+                    default:    buffer.push_back(ch);
+                    }
+                }
+            }
+            buffer.push_back('\n');
+            if (buffer.size() >= (std::size_t(1) << 16)) flush();
+        }
+        flush();
+        if (PQputCopyEnd(m_connection, nullptr) != 1) {
+            markBroken();
+            fail("postgresql", PQerrorMessage(m_connection));
+        }
+        //! The result of COPY is followed by a null result.
+        check(PQgetResult(m_connection));
+        while (PGresult* rest = PQgetResult(m_connection)) PQclear(rest);
+        return true;
+    }
+
+    DriverTypes driver() const __tegra_noexcept override
+    {
+        return DriverTypes::PostgreSQL;
+    }
+
+    /*!
+     * @brief verify function throws if the result is an error, the result is freed in that case.
+     */
+    PGresult* verify(PGresult* pgResult)
+    {
+        const ExecStatusType status = PQresultStatus(pgResult);
+        if (status != PGRES_COMMAND_OK && status != PGRES_TUPLES_OK) {
+            const std::string message = pgResult != nullptr ? PQresultErrorMessage(pgResult) : PQerrorMessage(m_connection);
+            PQclear(pgResult);
+            if (PQstatus(m_connection) != CONNECTION_OK) markBroken();
+            fail("postgresql", message);
+        }
+        return pgResult;
+    }
+
+    /*!
+     * @brief Converts a PGresult and frees it, errors are thrown.
+     */
+    ResultSet check(PGresult* pgResult)
+    {
+        ResultSet result = resultOf(verify(pgResult));
+        PQclear(pgResult);
+        return result;
+    }
+
+    PGconn* handle() const __tegra_noexcept
+    {
+        return m_connection;
+    }
+
+protected:
+    Scope<Statement> prepare(std::string_view sql) override
+    {
+        std::string name = "tegra_s" + std::to_string(++m_statements);
+        check(PQprepare(m_connection, name.c_str(), numberedPlaceholders(sql).c_str(), 0, nullptr));
+        return CreateScope<PostgreSQLStatement>(*this, std::move(name));
+    }
+
+private:
+    PGconn* m_connection {};
+    u64     m_statements {};
+};
+
+PostgreSQLStatement::~PostgreSQLStatement()
+{
+    if (PQstatus(m_connection.handle()) == CONNECTION_OK) {
+        PQclear(PQexec(m_connection.handle(), ("DEALLOCATE " + m_name).c_str()));
+    }
+}
+
+PGresult* PostgreSQLStatement::run(const SqlParams& params)
+{
+    std::vector<const char*> values;
+    std::vector<int> lengths;
+    values.reserve(params.size());
+    lengths.reserve(params.size());
+    for (const auto& param : params) {
+        values.push_back(param.has_value() ? param->c_str() : nullptr);
+        lengths.push_back(param.has_value() ? static_cast<int>(param->size()) : 0);
+    }
+    return m_connection.verify(PQexecPrepared(m_connection.handle(), m_name.c_str(), static_cast<int>(params.size()),
+                                              values.data(), lengths.data(), nullptr, 0));
+}
+
+ResultSet PostgreSQLStatement::execute(const SqlParams& params)
+{
+    PGresult* pgResult = run(params);
+    ResultSet result = resultOf(pgResult);
+    PQclear(pgResult);
+    return result;
+}
+
+ResultView PostgreSQLStatement::query(const SqlParams& params)
+{
+    return viewOf(run(params));
+}
+
+#endif
+
+#if defined(TEGRA_DRIVER_MYSQL)
+
+//! MariaDB uses my_bool and MySQL 8 uses bool for the flags of MYSQL_BIND.
+using MySqlFlag = std::remove_pointer_t<decltype(MYSQL_BIND::is_null)>;
+
+bool isLinkError(unsigned int error) __tegra_noexcept
+{
+    return error == CR_SERVER_GONE_ERROR || error == CR_SERVER_LOST;
+}
+
+class MySQLConnection;
+
+class MySQLStatement final : public Statement
+{
+public:
+    MySQLStatement(MySQLConnection& connection, MYSQL_STMT* statement) : m_connection(connection), m_statement(statement)
+    {
+    }
+
+    ~MySQLStatement() override
+    {
+        mysql_stmt_close(m_statement);
+    }
+
+    ResultSet execute(const SqlParams& params) override;
+    ResultView query(const SqlParams& params) override;
+
+private:
+    /*!
+     * @brief fetch function runs the statement and hands every cell to the sink, row by row, std::nullopt is NULL.
+     * @returns false if the statement has no result set.
+     */
+    template<typename Sink>
+    bool fetch(const SqlParams& params, VectorString& columns, const Sink& sink);
+
+    MySQLConnection&    m_connection;
+    MYSQL_STMT*         m_statement {};
+};
+
+class MySQLConnection final : public Connection
+{
+public:
+    explicit MySQLConnection(const ConnectionConfig& config) : Connection(config.statementCacheSize)
+    {
+        m_connection = mysql_init(nullptr);
+        if (m_connection == nullptr) fail("mysql", "out of memory");
+        const unsigned int connectTimeout = static_cast<unsigned int>(std::max<long long>(config.acquireTimeout.count() / 1000, 2));
+        mysql_options(m_connection, MYSQL_OPT_CONNECT_TIMEOUT, &connectTimeout);
+        if (config.timeout.count() > 0) {
+            const unsigned int seconds = static_cast<unsigned int>(std::max<long long>(config.timeout.count() / 1000, 1));
+            mysql_options(m_connection, MYSQL_OPT_READ_TIMEOUT, &seconds);
+            mysql_options(m_connection, MYSQL_OPT_WRITE_TIMEOUT, &seconds);
+        }
+        mysql_options(m_connection, MYSQL_SET_CHARSET_NAME, config.clientEncoding.empty() ? "utf8mb4" : config.clientEncoding.c_str());
+        if (mysql_real_connect(m_connection, config.host.c_str(), config.user.c_str(), config.password.c_str(),
+                               config.dbname.empty() ? nullptr : config.dbname.c_str(),
+                               config.port != 0 ? config.port : 3306, nullptr, CLIENT_MULTI_STATEMENTS) == nullptr) {
+            const std::string message = mysql_error(m_connection);
+            mysql_close(m_connection);
+            fail("mysql", message);
+        }
+    }
+
+    ~MySQLConnection() override
+    {
+        clearStatements();
+        mysql_close(m_connection);
+    }
+
+    ResultSet run(std::string_view sql) override
+    {
+        if (mysql_real_query(m_connection, sql.data(), static_cast<unsigned long>(sql.size())) != 0) raise();
+        ResultSet result;
+        for (;;) {
+            result = {};
+            if (MYSQL_RES* rows = mysql_store_result(m_connection); rows != nullptr) {
+                const unsigned int columns = mysql_num_fields(rows);
+                const MYSQL_FIELD* fields = mysql_fetch_fields(rows);
+                for (unsigned int c = 0; c < columns; ++c) {
+                    result.columns.emplace_back(fields[c].name);
+                }
+                while (MYSQL_ROW values = mysql_fetch_row(rows)) {
+                    const unsigned long* lengths = mysql_fetch_lengths(rows);
+                    SqlRow& row = result.rows.emplace_back();
+                    for (unsigned int c = 0; c < columns; ++c) {
+                        if (values[c] == nullptr) row.emplace_back();
+                        else row.emplace_back(std::string(values[c], lengths[c]));
+                    }
+                }
+                mysql_free_result(rows);
+            } else if (mysql_field_count(m_connection) != 0) {
+                raise();
+            } else {
+                result.affectedRows = mysql_affected_rows(m_connection);
+                result.lastInsertId = mysql_insert_id(m_connection);
+            }
+            //! Zero means there is another result, -1 the end of the script and more than zero a failed statement.
+            const int next = mysql_next_result(m_connection);
+            if (next < 0) break;
+            if (next > 0) raise();
+        }
+        return result;
+    }
+
+    bool ping() override
+    {
+        return mysql_ping(m_connection) == 0;
+    }
+
+    VectorString primaryKey(std::string_view table) override
+    {
+        const ResultSet keys = run("SHOW KEYS FROM " + std::string(table) + " WHERE Key_name = 'PRIMARY'");
+        std::vector<std::pair<int, std::string>> ordered;
+        for (std::size_t r = 0; r < keys.size(); ++r) {
+            ordered.emplace_back(std::atoi(keys.value(r, "Seq_in_index").value_or("0").c_str()), keys.value(r, "Column_name").value_or(""));
+        }
+        std::sort(ordered.begin(), ordered.end());
+        VectorString columns;
+        for (auto& key : ordered) columns.push_back(std::move(key.second));
+        return columns;
+    }
+
+    std::vector<ColumnInfo> describe(std::string_view table) override
+    {
+        const ResultSet info = execute("SELECT COLUMN_NAME, COLUMN_TYPE, IS_NULLABLE = 'YES', COLUMN_DEFAULT, EXTRA LIKE '%auto_increment%' "
+                                       "FROM information_schema.COLUMNS WHERE TABLE_SCHEMA = DATABASE() AND TABLE_NAME = ? "
+                                       "ORDER BY ORDINAL_POSITION", {std::string(table)});
+        std::vector<ColumnInfo> columns;
+        columns.reserve(info.size());
+        for (const auto& row : info.rows) {
+            columns.push_back({row[0].value_or(""), row[1].value_or(""), row[2].value_or("0") == "1", row[3], row[4].value_or("0") == "1"});
+        }
+        return columns;
+    }
+
+    DriverTypes driver() const __tegra_noexcept override
+    {
+        return DriverTypes::MySQL;
+    }
+
+    [[noreturn]] void raise(MYSQL_STMT* statement = nullptr)
+    {
+        const unsigned int error = statement != nullptr ? mysql_stmt_errno(statement) : mysql_errno(m_connection);
+        if (isLinkError(error)) markBroken();
+        fail("mysql", statement != nullptr ? mysql_stmt_error(statement) : mysql_error(m_connection));
+    }
+
+protected:
+    Scope<Statement> prepare(std::string_view sql) override
+    {
+        MYSQL_STMT* statement = mysql_stmt_init(m_connection);
+        if (statement == nullptr) raise();
+        if (mysql_stmt_prepare(statement, sql.data(), static_cast<unsigned long>(sql.size())) != 0) {
+            const unsigned int error = mysql_stmt_errno(statement);
+            const std::string message = mysql_stmt_error(statement);
+            mysql_stmt_close(statement);
+            if (isLinkError(error)) markBroken();
+            fail("mysql", message);
+        }
+        return CreateScope<MySQLStatement>(*this, statement);
+    }
+
+private:
+    MYSQL* m_connection {};
+};
+
+template<typename Sink>
+bool MySQLStatement::fetch(const SqlParams& params, VectorString& columns, const Sink& sink)
+{
+    std::vector<MYSQL_BIND> binds(params.size());
+    //! Not a vector, std::vector<bool> has no addressable elements and MySQL 8 flags are bool.
+    Scope<MySqlFlag[]> nulls = std::make_unique<MySqlFlag[]>(params.size());
+    for (std::size_t i = 0; i < params.size(); ++i) {
+        nulls[i] = !params[i].has_value();
+        binds[i].buffer_type = MYSQL_TYPE_STRING;
+        binds[i].buffer = params[i].has_value() ? const_cast<char*>(params[i]->data()) : nullptr;
+        binds[i].buffer_length = params[i].has_value() ? static_cast<unsigned long>(params[i]->size()) : 0;
+        binds[i].is_null = &nulls[i];
+    }
+    if (!binds.empty() && mysql_stmt_bind_param(m_statement, binds.data()) != 0) m_connection.raise(m_statement);
+    if (mysql_stmt_execute(m_statement) != 0) m_connection.raise(m_statement);
+
+    MYSQL_RES* metadata = mysql_stmt_result_metadata(m_statement);
+    if (metadata == nullptr) {
+        return false;
+    }
+    const unsigned int count = mysql_num_fields(metadata);
+    const MYSQL_FIELD* fields = mysql_fetch_fields(metadata);
+    columns.reserve(count);
+    for (unsigned int c = 0; c < count; ++c) {
+        columns.emplace_back(fields[c].name);
+    }
+    mysql_free_result(metadata);
+
+    //! Every column is fetched as text, longer values are read again with their real length.
+    std::vector<MYSQL_BIND> outputs(count);
+    std::vector<std::string> buffers(count, std::string(256, '\0'));
+    std::vector<unsigned long> lengths(count);
+    Scope<MySqlFlag[]> outputNulls = std::make_unique<MySqlFlag[]>(count);
+    for (unsigned int c = 0; c < count; ++c) {
+        outputs[c].buffer_type = MYSQL_TYPE_STRING;
+        outputs[c].buffer = buffers[c].data();
+        outputs[c].buffer_length = static_cast<unsigned long>(buffers[c].size());
+        outputs[c].length = &lengths[c];
+        outputs[c].is_null = &outputNulls[c];
+    }
+    if (mysql_stmt_bind_result(m_statement, outputs.data()) != 0) m_connection.raise(m_statement);
+    if (mysql_stmt_store_result(m_statement) != 0) m_connection.raise(m_statement);
+    std::string longer;
+    int fetched = 0;
+    while ((fetched = mysql_stmt_fetch(m_statement)) == 0 || fetched == MYSQL_DATA_TRUNCATED) {
+        for (unsigned int c = 0; c < count; ++c) {
+            if (outputNulls[c]) {
+                sink(c, std::nullopt);
+            } else if (lengths[c] <= buffers[c].size()) {
+                sink(c, std::string_view(buffers[c].data(), lengths[c]));
+            } else {
+                longer.assign(lengths[c], '\0');
+                MYSQL_BIND column {};
+                column.buffer_type = MYSQL_TYPE_STRING;
+                column.buffer = longer.data();
+                column.buffer_length = lengths[c];
+                mysql_stmt_fetch_column(m_statement, &column, c, 0);
+                sink(c, std::string_view(longer));
+            }
+        }
+    }
+    if (fetched == 1) m_connection.raise(m_statement);
+    mysql_stmt_free_result(m_statement);
+    return true;
+}
+
+ResultSet MySQLStatement::execute(const SqlParams& params)
+{
+    ResultSet result;
+    const bool rows = fetch(params, result.columns, [&result](std::size_t column, std::optional<std::string_view> value) {
+        if (column == 0) result.rows.emplace_back().reserve(result.columns.size());
+        if (value.has_value()) result.rows.back().emplace_back(std::string(*value));
+        else result.rows.back().emplace_back();
+    });
+    result.affectedRows = rows ? result.rows.size() : mysql_stmt_affected_rows(m_statement);
+    result.lastInsertId = mysql_stmt_insert_id(m_statement);
+    return result;
+}
+
+ResultView MySQLStatement::query(const SqlParams& params)
+{
+    //! The fetch buffers are reused for every row, cells are copied once into the arena of the view.
+    auto arena = CreateRef<ResultArena>();
+    VectorString names;
+    std::vector<ResultView::Cell> cells;
+    std::size_t rowCount = 0;
+    const bool rows = fetch(params, names, [&](std::size_t column, std::optional<std::string_view> value) {
+        if (column == 0) ++rowCount;
+        if (value.has_value()) {
+            const std::string_view copy = arena->store(*value);
+            cells.push_back({copy.data() != nullptr ? copy.data() : "", copy.size()});
+        } else {
+            cells.emplace_back();
+        }
+    });
+    ResultView view(std::move(names), std::move(cells), std::move(arena));
+    view.affectedRows = rows ? rowCount : mysql_stmt_affected_rows(m_statement);
+    view.lastInsertId = mysql_stmt_insert_id(m_statement);
+    return view;
+}
+
+#endif
+
+TEGRA_NAMESPACE_END
+
+bool ResultSet::empty() const __tegra_noexcept
+{
+    return rows.empty();
+}
+
+std::size_t ResultSet::size() const __tegra_noexcept
+{
+    return rows.size();
+}
+
+std::optional<std::size_t> ResultSet::column(std::string_view name) const __tegra_noexcept
+{
+    for (std::size_t c = 0; c < columns.size(); ++c) {
+        if (columns[c] == name) return c;
+    }
+    return std::nullopt;
+}
+
+const SqlValue& ResultSet::value(std::size_t row, std::string_view name) const
+{
+    const auto index = column(name);
+    return index.has_value() ? rows.at(row).at(*index) : NullValue;
+}
+
+std::string_view ResultArena::store(std::string_view value)
+{
+    if (value.size() > m_left) {
+        const std::size_t next = m_blocks.empty() ? FirstBlock : std::min(m_capacity, LastBlock);
+        const std::size_t size = std::max(next, value.size());
+        m_blocks.push_back(std::make_unique<char[]>(size));
+        m_cursor = m_blocks.back().get();
+        m_left = size;
+        m_capacity += size;
+    }
+    if (!value.empty()) {
+        std::memcpy(m_cursor, value.data(), value.size());
+    }
+    const std::string_view copy {m_cursor, value.size()};
+    m_cursor += value.size();
+    m_left -= value.size();
+    return copy;
+}
+
+std::size_t ResultArena::capacity() const __tegra_noexcept
+{
+    return m_capacity;
+}
+
+ResultView::ResultView(VectorString columns, std::vector<Cell> cells, Ref<const void> owner) __tegra_noexcept
+    : m_columns(std::move(columns)), m_cells(std::move(cells)), m_owner(std::move(owner))
+{
+    m_rows = m_columns.empty() ? 0 : m_cells.size() / m_columns.size();
+}
+
+ResultView ResultView::from(const ResultSet& result)
+{
+    auto arena = CreateRef<ResultArena>();
+    std::vector<Cell> cells;
+    cells.reserve(result.rows.size() * result.columns.size());
+    for (const auto& row : result.rows) {
+        for (const auto& value : row) {
+            if (value.has_value()) {
+                const std::string_view copy = arena->store(*value);
+                //! An empty value still needs an address to tell it from NULL.
+                cells.push_back({copy.data() != nullptr ? copy.data() : "", copy.size()});
+            } else {
+                cells.push_back({});
+            }
+        }
+    }
+    ResultView view(result.columns, std::move(cells), std::move(arena));
+    view.affectedRows = result.affectedRows;
+    view.lastInsertId = result.lastInsertId;
+    return view;
+}
+
+bool ResultView::empty() const __tegra_noexcept
+{
+    return m_rows == 0;
+}
+
+std::size_t ResultView::size() const __tegra_noexcept
+{
+    return m_rows;
+}
+
+const VectorString& ResultView::columns() const __tegra_noexcept
+{
+    return m_columns;
+}
+
+std::optional<std::size_t> ResultView::column(std::string_view name) const __tegra_noexcept
+{
+    for (std::size_t c = 0; c < m_columns.size(); ++c) {
+        if (m_columns[c] == name) return c;
+    }
+    return std::nullopt;
+}
+
+std::string_view ResultView::text(std::size_t row, std::size_t column) const __tegra_noexcept
+{
+    const Cell& cell = m_cells[row * m_columns.size() + column];
+    return cell.data != nullptr ? std::string_view(cell.data, cell.size) : std::string_view {};
+}
+
+bool ResultView::isNull(std::size_t row, std::size_t column) const __tegra_noexcept
+{
+    return m_cells[row * m_columns.size() + column].data == nullptr;
+}
+
+ResultView::Row ResultView::row(std::size_t index) const __tegra_noexcept
+{
+    return Row(*this, index);
+}
+
+ResultView::Row ResultView::operator[](std::size_t index) const __tegra_noexcept
+{
+    return Row(*this, index);
+}
+
+ResultView::Iterator ResultView::begin() const __tegra_noexcept
+{
+    return Iterator(this, 0);
+}
+
+ResultView::Iterator ResultView::end() const __tegra_noexcept
+{
+    return Iterator(this, m_rows);
+}
+
+ResultView::Row::Row(const ResultView& view, std::size_t index) __tegra_noexcept : m_view(&view), m_index(index)
+{
+}
+
+std::size_t ResultView::Row::index() const __tegra_noexcept
+{
+    return m_index;
+}
+
+std::string_view ResultView::Row::text(std::size_t column) const __tegra_noexcept
+{
+    return m_view->text(m_index, column);
+}
+
+bool ResultView::Row::isNull(std::size_t column) const __tegra_noexcept
+{
+    return m_view->isNull(m_index, column);
+}
+
+std::string_view ResultView::Row::operator[](std::size_t column) const __tegra_noexcept
+{
+    return m_view->text(m_index, column);
+}
+
+ResultView::Iterator::Iterator(const ResultView* view, std::size_t index) __tegra_noexcept : m_view(view), m_index(index)
+{
+}
+
+ResultView::Row ResultView::Iterator::operator*() const __tegra_noexcept
+{
+    return Row(*m_view, m_index);
+}
+
+ResultView::Iterator& ResultView::Iterator::operator++() __tegra_noexcept
+{
+    ++m_index;
+    return *this;
+}
+
+ResultView::Iterator ResultView::Iterator::operator++(int) __tegra_noexcept
+{
+    Iterator previous = *this;
+    ++m_index;
+    return previous;
+}
+
+ResultView Statement::query(const SqlParams& params)
+{
+    return ResultView::from(execute(params));
+}
+
+std::vector<ConnectionConfig> ConnectionConfig::fromFile(__tegra_maybe_unused const std::string& path)
+{
+    std::vector<ConnectionConfig> clients;
+#if defined(TEGRA_CONNECTION_NLOHMANN) || defined(TEGRA_CONNECTION_JSONCPP)
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return clients;
+    }
+    //! config.json of the framework has comments, both readers are told to skip them.
+#if defined(TEGRA_CONNECTION_NLOHMANN)
+    const JsonNode root = nlohmann::json::parse(file, nullptr, false, true);
+    if (root.is_discarded() || !root.contains("db_clients") || !root["db_clients"].is_array()) {
+        return clients;
+    }
+#else
+    JsonNode root;
+    Json::CharReaderBuilder builder;
+    builder["allowComments"] = true;
+    std::string errors;
+    if (!Json::parseFromStream(builder, file, &root, &errors) || !root["db_clients"].isArray()) {
+        return clients;
+    }
+#endif
+    for (const auto& item : root["db_clients"]) {
+        ConnectionConfig config;
+        config.name           = textOf(item, "name", config.name);
+        config.driver         = driverOf(textOf(item, "rdbms", std::string(TEGRA_RDBMS::PostgreSQL)));
+        config.host           = textOf(item, "host", config.host);
+        config.port           = static_cast<u16>(numberOf(item, "port", 0));
+        config.dbname         = textOf(item, "dbname", {});
+        config.user           = textOf(item, "user", {});
+        config.password       = textOf(item, "passwd", {});
+        config.filename       = textOf(item, "filename", {});
+        config.clientEncoding = textOf(item, "client_encoding", {});
+        config.connections    = std::max<std::size_t>(static_cast<std::size_t>(numberOf(item, "number_of_connections", 1)), 1);
+        const double timeout  = numberOf(item, "timeout", -1.0);
+        config.timeout        = std::chrono::milliseconds(timeout > 0 ? static_cast<long long>(timeout * 1000) : 0);
+        config.role           = textOf(item, "role", {}) == "replica" ? ClientRole::Replica : ClientRole::Primary;
+        const double sticky   = numberOf(item, "sticky_window", 2.0);
+        config.stickyWindow   = std::chrono::milliseconds(sticky > 0 ? static_cast<long long>(sticky * 1000) : 0);
+        const double cacheSize = numberOf(item, "query_cache_size", 64.0);
+        config.queryCacheSize = cacheSize > 0 ? static_cast<std::size_t>(cacheSize * 1024 * 1024) : 0;
+        const double cacheTtl = numberOf(item, "query_cache_ttl", 60.0);
+        config.queryCacheTtl  = std::chrono::milliseconds(cacheTtl > 0 ? static_cast<long long>(cacheTtl * 1000) : 0);
+        const double l2Ttl    = numberOf(item, "query_cache_l2_ttl", 0.0);
+        config.queryCacheL2Ttl = std::chrono::milliseconds(l2Ttl > 0 ? static_cast<long long>(l2Ttl * 1000) : 0);
+        const double sessionTtl = numberOf(item, "session_ttl", 1800.0);
+        config.sessionTtl     = std::chrono::milliseconds(sessionTtl > 0 ? static_cast<long long>(sessionTtl * 1000) : 1800000);
+        const double flush    = numberOf(item, "session_flush_interval", 1.0);
+        config.sessionFlushInterval = std::chrono::milliseconds(flush > 0 ? static_cast<long long>(flush * 1000) : 1000);
+        clients.push_back(std::move(config));
+    }
+#endif
+    return clients;
+}
+
+DriverTypes ConnectionConfig::driverOf(std::string_view rdbms) __tegra_noexcept
+{
+    if (rdbms == TEGRA_RDBMS::PostgreSQL) return DriverTypes::PostgreSQL;
+    if (rdbms == TEGRA_RDBMS::MySQL) return DriverTypes::MySQL;
+    if (rdbms == TEGRA_RDBMS::SQLite || rdbms == "sqlite") return DriverTypes::SQLite;
+    return DriverTypes::Unknown;
+}
+
+std::string_view ConnectionConfig::rdbmsOf(DriverTypes driver) __tegra_noexcept
+{
+    switch (driver) {
+    case DriverTypes::MySQL:
+        return TEGRA_RDBMS::MySQL;
+    case DriverTypes::SQLite:
+        return TEGRA_RDBMS::SQLite;
+    default:
+        return TEGRA_RDBMS::PostgreSQL;
+    }
+}
+
+Connection::Connection(std::size_t statementCacheSize) : m_capacity(std::max<std::size_t>(statementCacheSize, 1))
+{
+}
+
+Connection::~Connection() = default;
+
+Statement& Connection::statement(std::string_view sql)
+{
+    auto found = m_index.find(sql);
+    if (found != m_index.end()) {
+        ++m_hits;
+        m_lru.splice(m_lru.begin(), m_lru, found->second);
+    } else {
+        ++m_misses;
+        Scope<Statement> statement = prepare(sql);
+        m_lru.push_front({std::string(sql), std::move(statement)});
+        m_index.emplace(m_lru.front().sql, m_lru.begin());
+        if (m_lru.size() > m_capacity) {
+            m_index.erase(m_lru.back().sql);
+            m_lru.pop_back();
+        }
+    }
+    return *m_lru.front().statement;
+}
+
+Statement& Connection::statement(const StatementKey& key)
+{
+    if (key.slot < m_slots.size() && m_slots[key.slot]) {
+        ++m_hits;
+        return *m_slots[key.slot];
+    }
+    if (key.driver != DriverTypes::Default && key.driver != driver()) {
+        throw Exception(Exception::Reason::Core, "The statement is compiled for another driver: " + std::string(key.text));
+    }
+    ++m_misses;
+    if (key.slot >= m_slots.size()) {
+        m_slots.resize(key.slot + 1);
+    }
+    //! The compiled text holds the default table names, a configured prefix needs the text once more.
+    const bool compiled = key.render == nullptr || TableRegistry::prefix() == CONFIG::CMS_TABLES_PREFIX;
+    m_slots[key.slot] = compiled ? prepare(key.text) : prepare(key.render());
+    return *m_slots[key.slot];
+}
+
+ResultSet Connection::execute(std::string_view sql, const SqlParams& params)
+{
+    return statement(sql).execute(params);
+}
+
+ResultSet Connection::execute(const StatementKey& key, const SqlParams& params)
+{
+    return statement(key).execute(params);
+}
+
+ResultView Connection::select(std::string_view sql, const SqlParams& params)
+{
+    return statement(sql).query(params);
+}
+
+ResultView Connection::select(const StatementKey& key, const SqlParams& params)
+{
+    return statement(key).query(params);
+}
+
+u64 Connection::insert(std::string_view sql, const SqlParams& params, __tegra_maybe_unused std::string_view idColumn)
+{
+    return execute(sql, params).lastInsertId;
+}
+
+std::vector<ResultView> Connection::pipeline(const std::vector<QueryRequest>& queries)
+{
+    std::vector<ResultView> results;
+    results.reserve(queries.size());
+    for (const auto& query : queries) {
+        results.push_back(select(query.sql, query.params));
+    }
+    return results;
+}
+
+bool Connection::copy(__tegra_maybe_unused std::string_view table,
+                      __tegra_maybe_unused const VectorString& columns,
+                      __tegra_maybe_unused const std::vector<SqlRow>& rows)
+{
+    return false;
+}
+
+bool Connection::copyOut(__tegra_maybe_unused std::string_view table,
+                         __tegra_maybe_unused const std::function<void(std::string_view)>& sink)
+{
+    return false;
+}
+
+VectorString Connection::primaryKey(__tegra_maybe_unused std::string_view table)
+{
+    return {};
+}
+
+std::vector<ColumnInfo> Connection::describe(__tegra_maybe_unused std::string_view table)
+{
+    return {};
+}
+
+bool Connection::broken() const __tegra_noexcept
+{
+    return m_broken;
+}
+
+void Connection::markBroken() __tegra_noexcept
+{
+    m_broken = true;
+}
+
+void Connection::clearStatements()
+{
+    m_slots.clear();
+    m_index.clear();
+    m_lru.clear();
+}
+
+std::size_t Connection::cachedStatements() const __tegra_noexcept
+{
+    return m_lru.size();
+}
+
+std::size_t StatementKey::nextSlot() __tegra_noexcept
+{
+    static std::atomic<std::size_t> slots {0};
+    return slots.fetch_add(1, std::memory_order_relaxed);
+}
+
+u64 Connection::cacheHits() const __tegra_noexcept
+{
+    return m_hits;
+}
+
+u64 Connection::cacheMisses() const __tegra_noexcept
+{
+    return m_misses;
+}
+
+Scope<Connection> Connection::open(const ConnectionConfig& config)
+{
+    switch (config.driver) {
+#if defined(TEGRA_DRIVER_SQLITE)
+    case DriverTypes::SQLite:
+        return CreateScope<SQLiteConnection>(config);
+#endif
+#if defined(TEGRA_DRIVER_POSTGRESQL)
+    case DriverTypes::PostgreSQL:
+    case DriverTypes::Default:
+        return CreateScope<PostgreSQLConnection>(config);
+#endif
+#if defined(TEGRA_DRIVER_MYSQL)
+    case DriverTypes::MySQL:
+        return CreateScope<MySQLConnection>(config);
+#endif
+    default:
+        break;
+    }
+    fail("database", "The driver of client [" + config.name + "] is not available in this build.");
+}
+
+TEGRA_NAMESPACE_END
@@ -0,0 +1,528 @@
+/*!
+ * MIT License
+ *
+ * Copyright (c) 2022 Kambiz Asadzadeh
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef TEGRA_CONNECTION_HPP
+#define TEGRA_CONNECTION_HPP
+
+#include "database.hpp"
+
+TEGRA_USING_NAMESPACE Tegra::Types;
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+/*!
+ * @brief The ResultSet struct holds the rows of a statement in text form.
+ */
+struct ResultSet final
+{
+    VectorString            columns         {};
+    std::vector<SqlRow>     rows            {};
+    u64                     affectedRows    {};
+    u64                     lastInsertId    {};
+
+    __tegra_no_discard bool empty() const __tegra_noexcept;
+    __tegra_no_discard std::size_t size() const __tegra_noexcept;
+
+    /*!
+     * @brief column function gets the index of a column by its name.
+     * @returns index of the column or std::nullopt if there is no such column.
+     */
+    __tegra_no_discard std::optional<std::size_t> column(std::string_view name) const __tegra_noexcept;
+
+    /*!
+     * @brief value function gets a value by row index and column name.
+     * @returns the value, or NULL if there is no such column.
+     */
+    __tegra_no_discard const SqlValue& value(std::size_t row, std::string_view name) const;
+};
+
+/*!
+ * @brief The ResultArena class owns the text of a ResultView, values are copied into blocks that never move.
+ * Blocks grow from a few KiB, so a small result costs one allocation and a large one a handful.
+ */
+class ResultArena final
+{
+public:
+    ResultArena() = default;
+    ResultArena(const ResultArena& rhsArena) = delete;
+    ResultArena& operator=(const ResultArena& rhsArena) = delete;
+
+    /*!
+     * @brief store function copies a value into the arena.
+     * @returns the copy, it stays valid for the life of the arena.
+     */
+    std::string_view store(std::string_view value);
+
+    /*!
+     * @returns bytes that are allocated by the arena.
+     */
+    __tegra_no_discard std::size_t capacity() const __tegra_noexcept;
+
+private:
+    static constexpr std::size_t FirstBlock = 4096;
+    static constexpr std::size_t LastBlock  = 1024 * 1024;
+
+    std::vector<Scope<char[]>>  m_blocks    {};
+    char*                       m_cursor    {};
+    std::size_t                 m_left      {};
+    std::size_t                 m_capacity  {};
+};
+
+/*!
+ * @brief The ResultView class holds the rows of a statement without copying every cell into a string.
+ * Cells are string_views into one owner: the wire buffer of the driver (postgresql) or a ResultArena.
+ * Copies of a view share the owner, a view stays valid after its connection went back to the pool.
+ * Cells are read by row index and column index, a column index can be looked up once and used for every row.
+ * @example
+ * const ResultView view = connection.select("SELECT id, title FROM teg_menu_l WHERE language = ?", {"en"});
+ * const auto title = view.column("title");
+ * for (const auto row : view) {
+ *     render(row.get<u64>(0).value_or(0), row.text(*title));
+ * }
+ */
+class ResultView final
+{
+public:
+    /*!
+     * @brief The Cell struct is a value of the view, data is nullptr for NULL.
+     */
+    struct Cell final
+    {
+        const char* data {};
+        std::size_t size {};
+    };
+
+    /*!
+     * @brief The Row class is a handle of one row inside a ResultView, it's valid while the view is alive.
+     */
+    class Row final
+    {
+    public:
+        Row(const ResultView& view, std::size_t index) __tegra_noexcept;
+
+        __tegra_no_discard std::size_t index() const __tegra_noexcept;
+        __tegra_no_discard std::string_view text(std::size_t column) const __tegra_noexcept;
+        __tegra_no_discard bool isNull(std::size_t column) const __tegra_noexcept;
+
+        template<typename T>
+        __tegra_no_discard std::optional<T> get(std::size_t column) const;
+
+        __tegra_no_discard std::string_view operator[](std::size_t column) const __tegra_noexcept;
+
+    private:
+        const ResultView*   m_view  {};
+        std::size_t         m_index {};
+    };
+
+    /*!
+     * @brief The Iterator class walks the rows of a view.
+     */
+    class Iterator final
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = Row;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = void;
+        using reference         = Row;
+
+        Iterator() = default;
+        Iterator(const ResultView* view, std::size_t index) __tegra_noexcept;
+
+        __tegra_no_discard Row operator*() const __tegra_noexcept;
+        Iterator& operator++() __tegra_noexcept;
+        Iterator operator++(int) __tegra_noexcept;
+        __tegra_no_discard bool operator==(const Iterator& rhs) const __tegra_noexcept = default;
+
+    private:
+        const ResultView*   m_view  {};
+        std::size_t         m_index {};
+    };
+
+    ResultView() = default;
+
+    /*!
+     * @brief The drivers build views with this constructor.
+     * @param columns are the names of the columns.
+     * @param cells are the values row by row, they point into the memory that is kept by owner.
+     * @param owner keeps the memory of the cells alive.
+     */
+    ResultView(VectorString columns, std::vector<Cell> cells, Ref<const void> owner) __tegra_noexcept;
+
+    /*!
+     * @brief from function copies a ResultSet into one arena, it's used by the drivers that have no faster path.
+     */
+    __tegra_no_discard static ResultView from(const ResultSet& result);
+
+    __tegra_no_discard bool empty() const __tegra_noexcept;
+    __tegra_no_discard std::size_t size() const __tegra_noexcept;
+    __tegra_no_discard const VectorString& columns() const __tegra_noexcept;
+
+    /*!
+     * @brief column function gets the index of a column by its name, it should be called once and not per row.
+     * @returns index of the column or std::nullopt if there is no such column.
+     */
+    __tegra_no_discard std::optional<std::size_t> column(std::string_view name) const __tegra_noexcept;
+
+    /*!
+     * @brief text function reads a cell, NULL reads as an empty string.
+     */
+    __tegra_no_discard std::string_view text(std::size_t row, std::size_t column) const __tegra_noexcept;
+    __tegra_no_discard bool isNull(std::size_t row, std::size_t column) const __tegra_noexcept;
+
+    /*!
+     * @brief get function reads a cell as std::string_view, std::string, bool, an integral or a floating point type.
+     * @returns the value or std::nullopt if the cell is NULL or can not be converted.
+     */
+    template<typename T>
+    __tegra_no_discard std::optional<T> get(std::size_t row, std::size_t column) const;
+
+    __tegra_no_discard Row row(std::size_t index) const __tegra_noexcept;
+    __tegra_no_discard Row operator[](std::size_t index) const __tegra_noexcept;
+    __tegra_no_discard Iterator begin() const __tegra_noexcept;
+    __tegra_no_discard Iterator end() const __tegra_noexcept;
+
+    u64 affectedRows    {};
+    u64 lastInsertId    {};
+
+private:
+    VectorString        m_columns   {};
+    std::vector<Cell>   m_cells     {};     ///<Row after row, columns cells per row.
+    std::size_t         m_rows      {};
+    Ref<const void>     m_owner     {};
+};
+
+/*!
+ * @brief The ColumnInfo struct is a column of a table as the catalog of the server describes it.
+ */
+struct ColumnInfo final
+{
+    std::string                 name            {};
+    std::string                 type            {};     ///<Type as the server prints it, for example "character varying(50)".
+    bool                        nullable        {};
+    std::optional<std::string>  defaultValue    {};     ///<Default expression as the server prints it.
+    bool                        identity        {};     ///<Generated by an identity, a sequence or auto increment.
+};
+
+/*!
+ * @brief The QueryRequest struct is one statement of a pipeline.
+ */
+struct QueryRequest final
+{
+    std::string sql     {};     ///<Single statement with '?' placeholders.
+    SqlParams   params  {};
+};
+
+/*!
+ * @brief The role of a client inside "db_clients", reads can be routed to replicas and writes go to the primary.
+ */
+enum class ClientRole : u8
+{
+    Primary,    ///<Takes reads and writes.
+    Replica     ///<Read only copy of the primary.
+};
+
+/*!
+ * @brief The ConnectionConfig struct is one entry of "db_clients" inside config.json.
+ */
+struct ConnectionConfig final
+{
+    std::string                 name                {"default"};
+    DriverTypes                 driver              {DriverTypes::PostgreSQL};
+    std::string                 host                {"127.0.0.1"};
+    u16                         port                {};
+    std::string                 dbname              {};
+    std::string                 user                {};
+    std::string                 password            {};
+    std::string                 filename            {};                 ///<Database file of sqlite3, empty means an in-memory database.
+    std::string                 clientEncoding      {};
+    std::size_t                 connections         {1};                ///<Size of the pool [number_of_connections].
+    std::chrono::milliseconds   timeout             {};                 ///<Timeout of a statement, zero means no timeout.
+    std::chrono::milliseconds   acquireTimeout      {5000};             ///<Longest wait for a free connection of the pool.
+    std::chrono::milliseconds   healthCheckInterval {30000};            ///<Idle connections older than this are pinged before use.
+    std::size_t                 statementCacheSize  {64};               ///<Prepared statements that are kept per connection.
+    ClientRole                  role                {ClientRole::Primary};
+    std::chrono::milliseconds   stickyWindow        {2000};             ///<Reads of a session stay on the primary this long after its last write.
+    std::size_t                 queryCacheSize      {64 * 1024 * 1024}; ///<Memory of the query result cache in bytes, zero turns it off.
+    std::chrono::milliseconds   queryCacheTtl       {60000};            ///<Lifetime of a cached result.
+    std::chrono::milliseconds   queryCacheL2Ttl     {};                 ///<Lifetime of a result inside the "cache" table, zero keeps results in memory only.
+    std::chrono::milliseconds   sessionTtl          {1800000};          ///<Idle lifetime of a session, every read of the session extends it.
+    std::chrono::milliseconds   sessionFlushInterval {1000};            ///<Changed sessions are written to "members_session" in batches this often.
+
+    /*!
+     * @brief fromFile function reads the "db_clients" entries of the framework config file.
+     * @param path of the config file, comments are allowed.
+     * @returns list of the clients, empty if the file can not be read.
+     */
+    __tegra_no_discard static std::vector<ConnectionConfig> fromFile(const std::string& path = std::string(CONFIG::FRAMEWORK_CONFIG_FILE));
+
+    /*!
+     * @brief driverOf function maps a rdbms name of the config file to the driver type.
+     * @param rdbms is for example "postgresql", "mysql" or "sqlite3".
+     */
+    __tegra_no_discard static DriverTypes driverOf(std::string_view rdbms) __tegra_noexcept;
+
+    /*!
+     * @brief rdbmsOf function maps a driver type to its rdbms name of the config file.
+     * @returns "postgresql" for the default driver.
+     */
+    __tegra_no_discard static std::string_view rdbmsOf(DriverTypes driver) __tegra_noexcept;
+};
+
+/*!
+ * @brief The StatementKey struct identifies a statement that is composed at compile time, see sqlquery.hpp.
+ * Every key owns a slot number, a connection keeps the prepared statement of a key at its slot,
+ * so running a compiled query needs no hashing of the sql text.
+ */
+struct StatementKey final
+{
+    std::string_view    text        {};   ///<Final sql with the default table names.
+    std::size_t         slot        {};   ///<Index of the statement in a connection.
+    std::string         (*render)() {};   ///<Builds the sql again with the configured table names, nullptr if the text has them already.
+    DriverTypes         driver      {};   ///<Placeholder style, Default is '?' that every driver accepts.
+
+    /*!
+     * @brief nextSlot function hands out the slots of the keys, it is called once per key.
+     */
+    __tegra_no_discard static std::size_t nextSlot() __tegra_noexcept;
+};
+
+/*!
+ * @brief The Statement class is a prepared statement of a driver.
+ */
+class Statement
+{
+public:
+    virtual ~Statement() = default;
+
+    /*!
+     * @brief execute function runs the statement with new parameters.
+     * @param params are bound to the '?' placeholders in order.
+     */
+    virtual ResultSet execute(const SqlParams& params) = 0;
+
+    /*!
+     * @brief query function runs the statement and keeps the rows in one buffer instead of a string per cell.
+     * The default copies the result of execute into an arena.
+     */
+    virtual ResultView query(const SqlParams& params);
+};
+
+/*!
+ * @brief The Connection class is a driver agnostic database connection.
+ * Statements that are executed through it are prepared once and kept in a LRU cache,
+ * so a repeated query costs one round trip with no parsing on the server.
+ * Placeholders are written as '?' for every driver.
+ * A connection is used by one thread at a time, the pool takes care of it.
+ */
+class Connection
+{
+public:
+    explicit Connection(std::size_t statementCacheSize);
+    Connection(const Connection& rhsConnection) = delete;
+    Connection& operator=(const Connection& rhsConnection) = delete;
+    virtual ~Connection();
+
+    /*!
+     * @brief execute function runs a statement through the prepared statement cache.
+     * @param sql is a single statement with '?' placeholders.
+     * @param params are bound to the placeholders in order.
+     * @returns rows and counters of the statement.
+     */
+    ResultSet execute(std::string_view sql, const SqlParams& params = {});
+
+    /*!
+     * @brief execute function runs a compiled statement, it's prepared on first use and kept for the life of the connection.
+     * @param key of the statement, see SqlQuery::key().
+     * @param params are bound to the placeholders in order.
+     * @returns rows and counters of the statement.
+     */
+    ResultSet execute(const StatementKey& key, const SqlParams& params = {});
+
+    /*!
+     * @brief select function runs a statement like execute and returns the rows as a ResultView.
+     * It's the cheaper choice for listings, the view costs a few allocations whatever the number of cells.
+     */
+    ResultView select(std::string_view sql, const SqlParams& params = {});
+    ResultView select(const StatementKey& key, const SqlParams& params = {});
+
+    /*!
+     * @brief insert function runs an INSERT statement and gets the generated id in the same round trip.
+     * PostgreSQL appends RETURNING, the other drivers read the insert id of this connection.
+     * @param sql is a single INSERT statement with '?' placeholders and no RETURNING clause.
+     * @param params are bound to the placeholders in order.
+     * @param idColumn is the generated column.
+     * @returns the generated id, zero if none was generated.
+     */
+    virtual u64 insert(std::string_view sql, const SqlParams& params = {}, std::string_view idColumn = "id");
+
+    /*!
+     * @brief pipeline function sends several independent statements and reads all results after that,
+     * so they cost one round trip instead of one per statement.
+     * Drivers without pipelining run the statements one by one.
+     * @param queries are run in order, a failing statement makes the call throw after all results are read.
+     * @returns results in the order of queries.
+     */
+    virtual std::vector<ResultView> pipeline(const std::vector<QueryRequest>& queries);
+
+    /*!
+     * @brief run function executes sql text without preparing it, it may hold several statements.
+     * @returns rows of the last statement.
+     */
+    virtual ResultSet run(std::string_view sql) = 0;
+
+    /*!
+     * @brief copy function streams rows into a table with the bulk protocol of the driver.
+     * @param table is the full name of the table.
+     * @param columns are the target columns of the rows.
+     * @param rows are values in text form.
+     * @returns false if the driver has no bulk protocol, the caller falls back to INSERT.
+     */
+    virtual bool copy(std::string_view table, const VectorString& columns, const std::vector<SqlRow>& rows);
+
+    /*!
+     * @brief copyOut function streams all rows of a table with the bulk protocol of the driver.
+     * @param table is the full name of the table.
+     * @param sink receives the rows in the text format of COPY, one or more whole lines per call.
+     * @returns false if the driver has no bulk protocol, the caller falls back to SELECT.
+     */
+    virtual bool copyOut(std::string_view table, const std::function<void(std::string_view)>& sink);
+
+    /*!
+     * @brief primaryKey function gets the columns of the primary key of a table, used for keyset paging.
+     * @returns columns in key order, empty if the table has no key or the driver can't tell.
+     */
+    virtual VectorString primaryKey(std::string_view table);
+
+    /*!
+     * @brief describe function reads the columns of a table from the catalog of the server.
+     * @returns columns in table order, empty if the table does not exist or the driver can't tell.
+     */
+    virtual std::vector<ColumnInfo> describe(std::string_view table);
+
+    /*!
+     * @brief ping function checks that the server is still reachable.
+     */
+    virtual bool ping() = 0;
+
+    /*!
+     * @returns the driver of the connection.
+     */
+    __tegra_no_discard virtual DriverTypes driver() const __tegra_noexcept = 0;
+
+    /*!
+     * @brief broken function is true after the link to the server was lost, the pool drops such connections.
+     */
+    __tegra_no_discard bool broken() const __tegra_noexcept;
+
+    /*!
+     * @brief clearStatements function releases all prepared statements.
+     */
+    void clearStatements();
+
+    __tegra_no_discard std::size_t cachedStatements() const __tegra_noexcept;
+    __tegra_no_discard u64 cacheHits() const __tegra_noexcept;
+    __tegra_no_discard u64 cacheMisses() const __tegra_noexcept;
+
+    /*!
+     * @brief open function connects with the driver of the config.
+     * @returns a new connection, it throws if the driver is not compiled in or the server refuses.
+     */
+    __tegra_no_discard static Scope<Connection> open(const ConnectionConfig& config);
+
+protected:
+    /*!
+     * @brief prepare function compiles a statement on the server.
+     */
+    virtual Scope<Statement> prepare(std::string_view sql) = 0;
+
+    /*!
+     * @brief markBroken function is called by the drivers when the link to the server is lost.
+     */
+    void markBroken() __tegra_noexcept;
+
+private:
+    /*!
+     * @brief statement function gets a prepared statement from the caches, it's prepared on a miss.
+     */
+    Statement& statement(std::string_view sql);
+    Statement& statement(const StatementKey& key);
+
+    struct CacheEntry final
+    {
+        std::string         sql         {};
+        Scope<Statement>    statement   {};
+    };
+    using CacheList = std::list<CacheEntry>;
+
+    std::vector<Scope<Statement>>                           m_slots     {};   ///<Compiled statements by StatementKey::slot.
+    CacheList                                               m_lru       {};   ///<Most recently used first.
+    std::unordered_map<std::string_view, CacheList::iterator> m_index   {};   ///<Keys point into the entries of m_lru.
+    std::size_t                                             m_capacity  {};
+    u64                                                     m_hits      {};
+    u64                                                     m_misses    {};
+    bool                                                    m_broken    {};
+};
+
+/*!
+ * @brief fromColumnText function converts the text of a column to std::string_view, std::string, bool, an integral or a floating point type.
+ * @returns the value or std::nullopt if the text can not be converted.
+ */
+template<typename T>
+__tegra_no_discard std::optional<T> fromColumnText(std::string_view text)
+{
+    if constexpr (std::is_same_v<T, std::string_view>) {
+        return text;
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        return std::string(text);
+    } else if constexpr (std::is_same_v<T, bool>) {
+        if (text == "1" || text == "t" || text == "true" || text == "TRUE") return true;
+        if (text == "0" || text == "f" || text == "false" || text == "FALSE") return false;
+        return std::nullopt;
+    } else if constexpr (std::is_arithmetic_v<T>) {
+        T value {};
+        const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (error != std::errc() || end != text.data() + text.size()) return std::nullopt;
+        return value;
+    } else {
+        static_assert(std::is_arithmetic_v<T>, "Columns are read as text, bool and arithmetic types.");
+    }
+}
+
+template<typename T>
+std::optional<T> ResultView::get(std::size_t row, std::size_t column) const
+{
+    if (isNull(row, column)) return std::nullopt;
+    return fromColumnText<T>(text(row, column));
+}
+
+template<typename T>
+std::optional<T> ResultView::Row::get(std::size_t column) const
+{
+    return m_view->get<T>(m_index, column);
+}
+
+TEGRA_NAMESPACE_END
+
+#endif // TEGRA_CONNECTION_HPP
@@ -0,0 +1,223 @@
+#include "connectionpool.hpp"
+#include "core.hpp"
+
+TEGRA_USING_NAMESPACE Tegra::CMS;
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+PooledConnection::PooledConnection(ConnectionPool* pool, Scope<Connection> connection) __tegra_noexcept
+    : m_pool(pool), m_connection(std::move(connection))
+{
+}
+
+PooledConnection::PooledConnection(PooledConnection&& rhsConnection) __tegra_noexcept
+    : m_pool(std::exchange(rhsConnection.m_pool, nullptr)), m_connection(std::move(rhsConnection.m_connection))
+{
+}
+
+PooledConnection& PooledConnection::operator=(PooledConnection&& rhsConnection) __tegra_noexcept
+{
+    if (this != &rhsConnection) {
+        release();
+        m_pool = std::exchange(rhsConnection.m_pool, nullptr);
+        m_connection = std::move(rhsConnection.m_connection);
+    }
+    return *this;
+}
+
+PooledConnection::~PooledConnection()
+{
+    release();
+}
+
+Connection* PooledConnection::operator->() const __tegra_noexcept
+{
+    return m_connection.get();
+}
+
+Connection& PooledConnection::operator*() const __tegra_noexcept
+{
+    return *m_connection;
+}
+
+PooledConnection::operator bool() const __tegra_noexcept
+{
+    return m_connection != nullptr;
+}
+
+void PooledConnection::release()
+{
+    if (m_pool != nullptr && m_connection != nullptr) {
+        std::exchange(m_pool, nullptr)->release(std::move(m_connection));
+    }
+}
+
+ConnectionPool::ConnectionPool(const ConnectionConfig& config, Factory factory)
+    : m_config(config), m_factory(std::move(factory))
+{
+    m_config.connections = std::max<std::size_t>(m_config.connections, 1);
+    if (!m_factory) {
+        m_factory = [](const ConnectionConfig& c) { return Connection::open(c); };
+    }
+}
+
+ConnectionPool::~ConnectionPool()
+{
+    //! Leases must not outlive the pool.
+    std::lock_guard lock(m_mutex);
+    m_idle.clear();
+}
+
+PooledConnection ConnectionPool::acquire()
+{
+    return acquire(m_config.acquireTimeout);
+}
+
+PooledConnection ConnectionPool::acquire(std::chrono::milliseconds timeout)
+{
+    std::unique_lock lock(m_mutex);
+    //! No barging, a caller takes the fast path only if nobody is queued before it.
+    if (m_waiters.empty()) {
+        if (!m_idle.empty()) {
+            IdleConnection idle = std::move(m_idle.back());
+            m_idle.pop_back();
+            lock.unlock();
+            return PooledConnection(this, revive(std::move(idle)));
+        }
+        if (m_open < m_config.connections) {
+            ++m_open;
+            lock.unlock();
+            return PooledConnection(this, open());
+        }
+    }
+
+    Waiter waiter;
+    m_waiters.push_back(&waiter);
+    if (!waiter.ready.wait_for(lock, timeout, [&waiter] { return waiter.granted; })) {
+        m_waiters.erase(std::find(m_waiters.begin(), m_waiters.end(), &waiter));
+        throw Exception(Exception::Reason::IO, "No free connection of client [" + m_config.name + "] within "
+                        + std::to_string(timeout.count()) + "ms.");
+    }
+    lock.unlock();
+    if (waiter.connection == nullptr) {
+        return PooledConnection(this, open());
+    }
+    return PooledConnection(this, revive({std::move(waiter.connection), std::chrono::steady_clock::now()}));
+}
+
+ResultSet ConnectionPool::execute(std::string_view sql, const SqlParams& params)
+{
+    return acquire()->execute(sql, params);
+}
+
+ResultSet ConnectionPool::execute(const StatementKey& key, const SqlParams& params)
+{
+    return acquire()->execute(key, params);
+}
+
+ResultView ConnectionPool::select(std::string_view sql, const SqlParams& params)
+{
+    return acquire()->select(sql, params);
+}
+
+ResultView ConnectionPool::select(const StatementKey& key, const SqlParams& params)
+{
+    return acquire()->select(key, params);
+}
+
+void ConnectionPool::warmUp()
+{
+    std::vector<PooledConnection> leases;
+    for (;;) {
+        {
+            std::lock_guard lock(m_mutex);
+            if (m_open >= m_config.connections || !m_waiters.empty()) break;
+            ++m_open;
+        }
+        leases.emplace_back(this, open());
+    }
+}
+
+std::size_t ConnectionPool::size() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_open;
+}
+
+std::size_t ConnectionPool::idle() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_idle.size();
+}
+
+std::size_t ConnectionPool::waiting() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_waiters.size();
+}
+
+const ConnectionConfig& ConnectionPool::config() const __tegra_noexcept
+{
+    return m_config;
+}
+
+void ConnectionPool::release(Scope<Connection> connection)
+{
+    if (connection->broken()) {
+        //! The slot of a dead connection is passed on, the next waiter opens a fresh one.
+        connection.reset();
+        handOff(nullptr);
+        return;
+    }
+    handOff(std::move(connection));
+}
+
+void ConnectionPool::handOff(Scope<Connection> connection)
+{
+    std::lock_guard lock(m_mutex);
+    if (!m_waiters.empty()) {
+        Waiter* waiter = m_waiters.front();
+        m_waiters.pop_front();
+        waiter->connection = std::move(connection);
+        waiter->granted = true;
+        //! Notified under the lock, the waiter lives on the stack of its thread.
+        waiter->ready.notify_one();
+        return;
+    }
+    if (connection == nullptr) {
+        --m_open;
+        return;
+    }
+    m_idle.push_back({std::move(connection), std::chrono::steady_clock::now()});
+}
+
+Scope<Connection> ConnectionPool::open()
+{
+    //! The caller owns a slot of m_open, it is given up if the server refuses.
+    try {
+        return m_factory(m_config);
+    } catch (...) {
+        handOff(nullptr);
+        throw;
+    }
+}
+
+Scope<Connection> ConnectionPool::revive(IdleConnection idle)
+{
+    if (std::chrono::steady_clock::now() - idle.since < m_config.healthCheckInterval) {
+        return std::move(idle.connection);
+    }
+    bool alive = false;
+    try {
+        alive = idle.connection->ping();
+    } catch (...) {
+        alive = false;
+    }
+    if (alive) {
+        return std::move(idle.connection);
+    }
+    idle.connection.reset();
+    return open();
+}
+
+TEGRA_NAMESPACE_END
@@ -0,0 +1,156 @@
+/*!
+ * MIT License
+ *
+ * Copyright (c) 2022 Kambiz Asadzadeh
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef TEGRA_CONNECTIONPOOL_HPP
+#define TEGRA_CONNECTIONPOOL_HPP
+
+#include "connection.hpp"
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+class ConnectionPool;
+
+/*!
+ * @brief The PooledConnection class is a lease of a pool connection, it goes back to the pool when destroyed.
+ */
+class PooledConnection final
+{
+public:
+    PooledConnection() = default;
+    PooledConnection(ConnectionPool* pool, Scope<Connection> connection) __tegra_noexcept;
+    PooledConnection(const PooledConnection& rhsConnection) = delete;
+    PooledConnection& operator=(const PooledConnection& rhsConnection) = delete;
+    PooledConnection(PooledConnection&& rhsConnection) __tegra_noexcept;
+    PooledConnection& operator=(PooledConnection&& rhsConnection) __tegra_noexcept;
+    ~PooledConnection();
+
+    Connection* operator->() const __tegra_noexcept;
+    Connection& operator*() const __tegra_noexcept;
+    explicit operator bool() const __tegra_noexcept;
+
+    /*!
+     * @brief release function gives the connection back to the pool before the end of the scope.
+     */
+    void release();
+
+private:
+    ConnectionPool*     m_pool          {};
+    Scope<Connection>   m_connection    {};
+};
+
+/*!
+ * @brief The ConnectionPool class keeps a bounded set of open connections of one client.
+ * Connections are opened lazily up to ConnectionConfig::connections and reused in LIFO order,
+ * so the warmest connection (and its prepared statements) is handed out first.
+ * Waiters are served strictly in FIFO order: a released connection is handed straight to the
+ * oldest waiter and a new caller can never overtake a thread that is already waiting.
+ * Idle connections older than ConnectionConfig::healthCheckInterval are pinged before they are
+ * handed out and reopened if the server dropped them.
+ * @example
+ * ConnectionPool pool(config);
+ * auto rows = pool.execute("SELECT value FROM config WHERE name = ?", {"title"});
+ */
+class ConnectionPool final
+{
+public:
+    using Factory = std::function<Scope<Connection>(const ConnectionConfig&)>;
+
+    /*!
+     * @param config of the client.
+     * @param factory opens a connection, Connection::open is used if it is empty.
+     */
+    explicit ConnectionPool(const ConnectionConfig& config, Factory factory = {});
+    ConnectionPool(const ConnectionPool& rhsPool) = delete;
+    ConnectionPool(ConnectionPool&& rhsPool) noexcept = delete;
+    ConnectionPool& operator=(const ConnectionPool& rhsPool) = delete;
+    ConnectionPool& operator=(ConnectionPool&& rhsPool) noexcept = delete;
+    ~ConnectionPool();
+
+    /*!
+     * @brief acquire function leases a connection, waiting up to ConnectionConfig::acquireTimeout.
+     * @returns the lease, it throws if no connection got free in time.
+     */
+    __tegra_no_discard PooledConnection acquire();
+
+    /*!
+     * @brief acquire function leases a connection.
+     * @param timeout is the longest wait for a free connection.
+     */
+    __tegra_no_discard PooledConnection acquire(std::chrono::milliseconds timeout);
+
+    /*!
+     * @brief execute function runs a single statement on a leased connection.
+     */
+    ResultSet execute(std::string_view sql, const SqlParams& params = {});
+    ResultSet execute(const StatementKey& key, const SqlParams& params = {});
+
+    /*!
+     * @brief select function runs a single statement on a leased connection and returns the rows as a view.
+     * The view owns its data, it stays valid after the connection went back to the pool.
+     */
+    ResultView select(std::string_view sql, const SqlParams& params = {});
+    ResultView select(const StatementKey& key, const SqlParams& params = {});
+
+    /*!
+     * @brief warmUp function opens all connections of the pool up front.
+     */
+    void warmUp();
+
+    __tegra_no_discard std::size_t size() const;     ///<Open connections, leased or idle.
+    __tegra_no_discard std::size_t idle() const;     ///<Connections that wait in the pool.
+    __tegra_no_discard std::size_t waiting() const;  ///<Threads that wait for a connection.
+    __tegra_no_discard const ConnectionConfig& config() const __tegra_noexcept;
+
+private:
+    friend class PooledConnection;
+
+    struct IdleConnection final
+    {
+        Scope<Connection>                       connection  {};
+        std::chrono::steady_clock::time_point   since       {};
+    };
+
+    struct Waiter final
+    {
+        std::condition_variable ready       {};
+        Scope<Connection>       connection  {};   ///<Empty with granted set means permission to open one.
+        bool                    granted     {};
+    };
+
+    void release(Scope<Connection> connection);
+    Scope<Connection> open();
+    Scope<Connection> revive(IdleConnection idle);
+    void handOff(Scope<Connection> connection);
+
+    ConnectionConfig                m_config    {};
+    Factory                         m_factory   {};
+    mutable std::mutex              m_mutex     {};
+    std::vector<IdleConnection>     m_idle      {};   ///<Most recently released last.
+    std::deque<Waiter*>             m_waiters   {};
+    std::size_t                     m_open      {};   ///<Open connections plus the ones being opened.
+};
+
+TEGRA_NAMESPACE_END
+
+#endif  // TEGRA_CONNECTIONPOOL_HPP
@@ -1,49 +1,18 @@
 #include "core.hpp"
 #include "logger.hpp"
+#include "replacer.hpp"
+#include "text.hpp"
+#include "charclass.hpp"
+#include "entity.hpp"
+#include "linkrewriter.hpp"
+#include "tableregistry.hpp"
+#include "process.hpp"
+#include "metrics.hpp"
 
 TEGRA_USING_NAMESPACE Tegra::eLogger;
 
 TEGRA_NAMESPACE_BEGIN(Tegra::CMS)
 
-Exception::Exception(const Reason& reason, const std::string& message)
-{
-    m_exceptionData = new ExceptionData();
-    std::string eMessage{};
-    switch (reason) {
-    case Reason::Core:
-        eMessage=":[Core]:";
-        break;
-    case Reason::Framework:
-        eMessage=":[Framework]:";
-        break;
-    case Reason::IO:
-        eMessage=":[IO]:";
-        break;
-    case Reason::User:
-        eMessage=":[User]:";
-        break;
-    case Reason::System:
-        eMessage=":[System]:";
-        break;
-    case Reason::Other:
-        eMessage=":[Other]:";
-        break;
-    default:
-        break;
-    }
-    m_exceptionData->message = message;
-}
-
-Exception::~Exception()
-{
-    __tegra_safe_delete(m_exceptionData);
-};
-
-const char* Exception::what() const throw()
-{
-    return m_exceptionData->message.c_str();
-}
-
 void Termination::terminate(TerminateType terminateType)
 {
     switch (terminateType) {
@@ -84,9 +53,9 @@ EngineInterface::EngineInterface()
     }
 
          //! Page Init Time
-         //! ToDo...
+         //! Set by the requests that Metrics records, nothing has been served yet.
     {
-        if(!isset(m_bootParameter->pageInitTime)) { m_bootParameter->pageInitTime = 1316615272; }
+        if(!isset(m_bootParameter->pageInitTime)) { m_bootParameter->pageInitTime = 0; }
     }
 
          //! Page Size
@@ -101,11 +70,6 @@ EngineInterface::EngineInterface()
         if(!isset(m_bootParameter->pageSpeed)) { m_bootParameter->pageSpeed = 0; }
     }
 
-         //! Init Time
-         //! ToDo...
-    {
-        if(!isset(m_bootParameter->initTime)) { m_bootParameter->initTime = 1316615272; }
-    }
 
          //! User Mode
          //! ToDo...
@@ -161,6 +125,17 @@ EngineInterface::EngineInterface()
 #else
         m_bootParameter->hostType = HostType::Unknown;
 #endif
+    }
+
+         //! Init Time
+    {
+        if(!isset(m_bootParameter->initTime)) { m_bootParameter->initTime = std::time(nullptr); }
+        m_bootParameter->readyAfter = Metrics::uptime();
+    }
+
+         //! Requests of the web framework are timed into the page metrics.
+    {
+        Metrics::attach();
     }
 
 }
@@ -172,7 +147,7 @@ EngineInterface::~EngineInterface()
 
 std::time_t EngineInterface::getInitTime()
 {
-
+    return m_bootParameter->initTime;
 }
 
 std::optional<std::string> EngineInterface::getSaveState()
@@ -186,6 +161,7 @@ std::optional<std::string> EngineInterface::getSaveState()
 
 std::optional<u32> EngineInterface::getPageSize()
 {
+    m_bootParameter->pageSize = static_cast<u32>(std::min<u64>(Metrics::lastBytes(), std::numeric_limits<u32>::max()));
     if (isset(m_bootParameter->pageSize)) {
         return m_bootParameter->pageSize;
     } else {
@@ -195,11 +171,29 @@ std::optional<u32> EngineInterface::getPageSize()
 
 std::time_t EngineInterface::getPageInitTime()
 {
-  //ToDo...
+    if (const auto startedAt = Metrics::lastStartedAt(); startedAt != 0) {
+        m_bootParameter->pageInitTime = startedAt;
+    }
+    return m_bootParameter->pageInitTime;
+}
+
+std::chrono::milliseconds EngineInterface::getReadyAfter()
+{
+    return m_bootParameter->readyAfter;
+}
+
+std::chrono::microseconds EngineInterface::getPageLatency()
+{
+    m_bootParameter->pageLatency = Metrics::lastLatency();
+    return m_bootParameter->pageLatency;
 }
 
 std::optional<u32> EngineInterface::getPageSpeed()
 {
+    const auto summary = Metrics::summary(std::chrono::minutes(1));
+    if (summary.count > 0) {
+        m_bootParameter->pageSpeed = static_cast<u32>(std::chrono::duration_cast<std::chrono::milliseconds>(summary.p50).count());
+    }
     if (isset(m_bootParameter->pageSpeed)) {
         return m_bootParameter->pageSpeed;
     } else {
@@ -207,6 +201,11 @@ std::optional<u32> EngineInterface::getPageSpeed()
     }
 }
 
+MetricsSummary EngineInterface::getPageMetrics(std::chrono::seconds window)
+{
+    return Metrics::summary(window);
+}
+
 std::optional<s32> EngineInterface::getStateIndex()
 {
     if (isset(m_bootParameter->stateIndex)) {
@@ -293,30 +292,21 @@ std::string Engine::copyright() __tegra_noexcept
 }
 
 std::string command(const std::string& cmd) {
-    // Support Unix base.
-    std::string c = cmd;
-    std::string data;
-    FILE *stream;
-    const int max_buffer = 256;
-    char buffer[max_buffer];
-    c.append(" 2>&1");
-#ifdef PLATFORM_WINDOWS
-    stream = _popen(c.c_str(), "r");
-#else
-    stream = popen(c.c_str(), "r");
-#endif
-    if (stream)
-    {
-        while (!feof(stream))
-            if (fgets(buffer, max_buffer, stream) != nullptr)
-                data.append(buffer);
-#ifdef PLATFORM_WINDOWS
-        _pclose(stream);
-#else
-        pclose(stream);
-#endif
-    }
-    return data;
+    //! Runs on the shared executor, so the child has a timeout and the number of children is capped.
+    return ProcessExecutor::shared().shell(cmd).get().output;
+}
+
+std::future<std::string> commandAsync(const std::string& cmd) {
+    auto promise = CreateRef<std::promise<std::string>>();
+    auto future = promise->get_future();
+    command(cmd, [promise](std::string&& output) { promise->set_value(std::move(output)); });
+    return future;
+}
+
+void command(const std::string& cmd, std::function<void(std::string&&)> done) {
+    ProcessExecutor::shared().shell(cmd, [done = std::move(done)](ProcessResult&& result) {
+        done(std::move(result.output));
+    });
 }
 
 std::string convertStream(std::stringstream const& data) __tegra_noexcept
@@ -326,7 +316,7 @@ std::string convertStream(std::stringstream const& data) __tegra_noexcept
 
 std::string Engine::htmlEntityDecode(const std::string& content)
 {
-  //ToDo...
+    return EntityDecoder::decode(content);
 }
 
 bool Engine::findSubString(const std::vector<std::string>& list, const std::string& search)
@@ -341,12 +331,16 @@ void Engine::findAndReplaceContent(std::string& data, std::string toSearch, std:
 
 void Engine::findAndReplaceLink(std::string& data, std::string toSearch, std::string replaceUrl)
 {
-  //ToDo...
+    const auto rewriter = LinkRewriter::cached(MapString {{std::move(toSearch), std::move(replaceUrl)}});
+    std::string output;
+    if (rewriter->rewrite(data, output)) {
+        data.swap(output);
+    }
 }
 
 std::string Engine::linkConvertor(const std::string& uri)
 {
-  //ToDo...
+    return LinkRewriter::normalize(uri);
 }
 
 std::vector<std::string> Engine::filteredQueryFields(VectorString& fields)
@@ -356,46 +350,35 @@ std::vector<std::string> Engine::filteredQueryFields(VectorString& fields)
 
 std::string Engine::tablePrefix()
 {
-  //ToDo...
+    return std::string(Database::TableRegistry::prefix());
 }
 
 std::string Engine::tableUnicode()
 {
-  //ToDo...
+    return std::string(Database::TableRegistry::unicode());
 }
 
 std::string Engine::mixedTablePrefix(const std::string& p, const std::string& t)
 {
-  //ToDo...
+    return p + t;
 }
 
 std::string Engine::table(std::string_view tableName, TableType tableType)
 {
-  //ToDo...
+    //! Engine::TableType is the opaque declaration of Database::TableType.
+    const auto type = static_cast<Database::TableType>(static_cast<u8>(tableType));
+    return Database::TableRegistry::lookup(tableName, type);
 }
 
 VectorString Engine::tableFilter(const std::vector<std::string>& tables, TableType tableType)
 {
-  //ToDo...
+    const auto type = static_cast<Database::TableType>(static_cast<u8>(tableType));
+    return Database::TableRegistry::filter(tables, type);
 }
 
 std::string Engine::fullReplacer(const std::string& content, const MapString& map)
 {
-    std::string rawContent = content;
-    // Get the first occurrence
-    size_t pos;
-    for(const auto& r : map) {
-        pos = rawContent.find(r.first);
-        // Repeat till end is reached
-        while( pos != std::string::npos)
-        {
-            // Replace this occurrence of Sub String
-            rawContent.replace(pos, r.first.size(), r.second);
-            // Get the next occurrence from the current position
-            pos = rawContent.find(r.first, pos + r.first.size());
-        }
-    }
-    return rawContent;
+    return Replacer::cached(map)->replace(content, map);
 }
 
 void Engine::setLanguage(const std::string& l)
@@ -425,8 +408,9 @@ std::string Engine::reducePath(const std::string& path)
 
 std::string Engine::removeDashes(const std::string& src) __tegra_const_noexcept
 {
+    static constexpr CharClass dashes {"/"};
     std::string command = src;
-    command.erase(std::remove(command.begin(), command.end(), '/'), command.end());
+    CharKernel::removeAll(command, dashes);
     return command;
 }
 
@@ -435,134 +419,114 @@ std::string Engine::defaultLanguage()
   //ToDo...
 }
 
-std::string Engine::join(const std::vector<std::string>& strings,  const SepratorType& sep, const SepratorStyle& sepStyle) __tegra_noexcept
+TEGRA_ANONYMOUS_NAMESPACE_BEGIN
+
+std::string_view separatorOf(const Engine::SepratorType& sep) __tegra_noexcept
 {
-    std::string delim{__tegra_null_str};
+    using SepratorType = Engine::SepratorType;
     switch (sep) {
     case SepratorType::Comma:
-        delim=",";
-        break;
+        return ",";
     case SepratorType::Dash:
-        delim="-";
-        break;
+        return "-";
     case SepratorType::Slash:
-        delim="/";
-        break;
+        return "/";
     case SepratorType::BackSlash:
-        delim="\\";
-        break;
+        return "\\";
     case SepratorType::Dot:
-        delim=".";
-        break;
+        return ".";
     case SepratorType::Equal:
-        delim="=";
-        break;
+        return "=";
     case SepratorType::Quote:
-        delim="'";
-        break;
+        return "'";
     case SepratorType::Apostrophe:
-        delim="'";
-        break;
+        return "'";
     case SepratorType::Grave:
-        delim="`";
-        break;
+        return "`";
     case SepratorType::DoubleQuote:
-        delim="\"";
-        break;
+        return "\"";
     case SepratorType::Colon:
-        delim=":";
-        break;
+        return ":";
     case SepratorType::SemiColon:
-        delim=";";
-        break;
+        return ";";
     case SepratorType::Brvbar:
-        delim="¦";
-            break;
+        return "¦";
     case SepratorType::Lt:
-        delim="<";
-        break;
+        return "<";
     case SepratorType::Gt:
-        delim=">";
-        break;
+        return ">";
     case SepratorType::Percent:
-        delim="%";
-        break;
+        return "%";
     case SepratorType::And:
-        delim="&";
-        break;
+        return "&";
     case SepratorType::Sharp:
-        delim="#";
-        break;
+        return "#";
     case SepratorType::Dollar:
-        delim="$";
-        break;
+        return "$";
     case SepratorType::Atsign:
-        delim="@";
-        break;
+        return "@";
     case SepratorType::Sim:
-        delim="~";
-        break;
+        return "~";
     case SepratorType::Question:
-        delim="?";
-        break;
+        return "?";
     case SepratorType::Exclamation:
-        delim="!";
-        break;
+        return "!";
     case SepratorType::Hat:
-        delim="^";
-        break;
+        return "^";
     case SepratorType::LeftCurlyBracket:
-        delim="[";
-        break;
+        return "[";
     case SepratorType::RightCurlyBracket:
-        delim="]";
-        break;
+        return "]";
     case SepratorType::LeftSquareBracket:
-        delim="{";
-        break;
+        return "{";
     case SepratorType::RightSquareBracket:
-        delim="}";
-        break;
+        return "}";
     case SepratorType::LeftRoundBracket:
-        delim="(";
-        break;
+        return "(";
     case SepratorType::RightRoundBracket:
-        delim=")";
-        break;
-    default:
-        delim=",";
-        break;
-    }
-
-    switch (sepStyle) {
-    case SepratorStyle::WithSpace:
-        delim.append(" ");
-        break;
-    case SepratorStyle::Mixed:
-        delim.append("");
-        break;
+        return ")";
     default:
-        break;
+        return ",";
     }
+}
 
-    const auto res = std::accumulate(
-        strings.begin(), strings.end(),
-        std::string(),[&delim, sepStyle](const std::string& x, const std::string& y)
-        {
-            return x.empty() ? y : x + delim + y;
-        });
+TEGRA_NAMESPACE_END
 
+std::string Engine::join(const std::vector<std::string>& strings,  const SepratorType& sep, const SepratorStyle& sepStyle) __tegra_noexcept
+{
+    std::string res;
+    Text text(res);
+    join(text, strings, sep, sepStyle);
     return res;
 }
 
+void Engine::join(Text& output, const VectorString& strings, const SepratorType& sep, const SepratorStyle& sepStyle) __tegra_noexcept
+{
+    const std::string_view delim = separatorOf(sep);
+    const bool withSpace = sepStyle == SepratorStyle::WithSpace;
+
+    std::size_t hint = output.size();
+    for (const auto& s : strings) {
+        hint += s.size() + delim.size() + (withSpace ? 1 : 0);
+    }
+    output.reserve(hint);
+
+    //! Same as folding with x.empty() ? y : x + delim + y, without the temporaries.
+    const std::size_t begin = output.size();
+    for (const auto& s : strings) {
+        if (output.size() != begin) {
+            output.append(delim);
+            if (withSpace) output.append(' ');
+        }
+        output.append(s);
+    }
+}
+
 void Engine::elementErase(std::string& content) noexcept
 {
     try {
-        std::erase_if(content, [](const char c) {
-            return c == '`' or c == '/' or c =='\\' or c == '~' or c == '?'
-                   or c == '|' or c == '(' or c == ')' or c == '[' or c == ']'
-                   or c == '{' or c == '}' or c == '-';
-        });
+        static constexpr CharClass elements {"`/\\~?|()[]{}-"};
+        CharKernel::removeAll(content, elements);
     }
     catch(const Exception& e) {
         if(DeveloperMode::IsEnable) {
@@ -575,7 +539,7 @@ std::string Engine::whiteSpaceReduce(std::string& input) noexcept
 {
     try {
         if(!input.empty()) {
-            input.erase(std::remove(input.begin(), input.end(), ' '), input.end());
+            CharKernel::collapseRuns(input, CharClass::space(), ' ');
         }
     }
     catch(const Exception& e) {
@@ -590,9 +554,7 @@ std::string Engine::whiteSpaceLeading(std::string& input) noexcept
 {
     try {
         if(!input.empty()) {
-            while (std::isspace(*input.begin())) {
-                input.erase(input.begin());
-            }
+            CharKernel::trimLeading(input, CharClass::space());
         }
     }
     catch(const Exception& e) {
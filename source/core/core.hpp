@@ -26,6 +26,8 @@
 
 #include "common.hpp"
 #include "prestructure.hpp"
+#include "text.hpp"
+#include "metrics.hpp"
 
 TEGRA_USING_NAMESPACE Tegra::Types;
 
@@ -81,12 +83,26 @@ std::string stringFormat(const std::string& format, Args ... args)
 }
 
 /*!
- * @brief Invokes the command processor to execute a command.
+ * @brief Invokes the command processor to execute a command and waits for its output.
  * @param cmd holds the commands for function.
  * @returns data from terminal.
  */
 __tegra_maybe_unused std::string command(const std::string& cm);
 
+/*!
+ * @brief Invokes the command processor to execute a command without blocking the caller.
+ * @param cmd holds the commands for function.
+ * @returns future of the data from terminal.
+ */
+__tegra_maybe_unused std::future<std::string> commandAsync(const std::string& cmd);
+
+/*!
+ * @brief Invokes the command processor to execute a command and calls back with its output on a worker thread.
+ * @param cmd holds the commands for function.
+ * @param done receives the data from terminal, it should not block.
+ */
+__tegra_maybe_unused void command(const std::string& cmd, std::function<void(std::string&&)> done);
+
 /*!
  * @brief Maybe we need to convert stringstream to standard string.
  * @param data as stringstream content.
@@ -218,9 +234,9 @@ struct BootParameter final
     bool                            fastBoot       {};      ///<This property is set to true when the system is booted with the highest possible state.
     std::time_t                     initTime       {};      ///<The time spent on execution.
     std::optional<std::string>      saveState      {};      ///<The system save state applied during a save operation after execution or completion of the operation..
-    std::optional<u32>              pageSize       {};      ///<The size of the requested page.
+    std::optional<u32>              pageSize       {};      ///<The size of the requested page [bytes of the last response].
     std::time_t                     pageInitTime   {};      ///<The loading time of the requested page.
-    std::optional<u32>              pageSpeed      {};      ///<The loading speed of the requested page.
+    std::optional<u32>              pageSpeed      {};      ///<The loading speed of the requested page [median ms of the last minute].
     std::optional<s32>              stateIndex     {};      ///<The state of index for any page.
     std::optional<HostType>         hostType       {};      ///<This attribute specifies the type of site hosting. for example: Linux
     std::optional<StorageType>      storageType    {};      ///<This attribute specifies the type of storage to use.
@@ -229,6 +245,8 @@ struct BootParameter final
     std::optional<SystemType>       systemType     {};      ///<This attribute determines the type of system consumption.
     std::optional<SystemLicense>    systemLicense  {};      ///<The type of license to use the system.
     std::optional<SystemStatus>     systemStatus   {};      ///<This attribute specifies the state the system is in.
+    std::chrono::milliseconds       readyAfter     {};      ///<Time from the process start until the engine was ready.
+    std::chrono::microseconds       pageLatency    {};      ///<Latency of the last served request.
 };
 
 class EngineInterface
@@ -274,12 +292,31 @@ public:
      */
     virtual std::time_t                     getPageInitTime     () final;
 
+    /*!
+     * @brief Getting the time from the process start until the engine was ready.
+     * @returns returns as milliseconds.
+     */
+    virtual std::chrono::milliseconds       getReadyAfter       () final;
+
+    /*!
+     * @brief Getting the latency of the last served request.
+     * @returns returns as microseconds.
+     */
+    virtual std::chrono::microseconds       getPageLatency      () final;
+
     /*!
      * @brief Getting current page speed load.
      * @returns returns as counter of page speed.
      */
     virtual std::optional<u32>              getPageSpeed        () final;
 
+    /*!
+     * @brief Getting latency percentiles and response sizes of the recent requests.
+     * @param window is the time span, for example the last minute.
+     * @returns returns as MetricsSummary.
+     */
+    virtual MetricsSummary                  getPageMetrics      (std::chrono::seconds window) final;
+
     /*!
      * @brief Getting current system state index.
      * @returns returns as signed integer for state index.
@@ -451,6 +488,15 @@ public:
      */
     __tegra_no_discard std::string join(const VectorString& strings, const SepratorType& sep, const SepratorStyle& sepStyle) __tegra_noexcept;
 
+    /*!
+     * @brief join function will implode a vector of strings into the output.
+     * @param output is the sink that receives the result.
+     * @param strings are list of strings.
+     * @param sep is character of seprator.
+     * @param sepStyle is style of seprator.
+     */
+    void join(Text& output, const VectorString& strings, const SepratorType& sep, const SepratorStyle& sepStyle) __tegra_noexcept;
+
     /*!
      * \brief elementErase function will removes certain characters from a string.
      * \param content is the main content of string.
@@ -520,6 +566,7 @@ public:
 
     /*!
      * @brief Before displaying the contents of the pages, we need to replace some characters.
+     * The keys are matched in a single pass by the cached automaton of the map (see Replacer).
      * @param content as raw content.
      * @param map as data for replacing.
      * @returns content as string.
@@ -0,0 +1,437 @@
+#include "counterstore.hpp"
+#include "tableregistry.hpp"
+#include "sqlquery.hpp"
+#include "core.hpp"
+#include "logger.hpp"
+
+TEGRA_USING_NAMESPACE Tegra;
+TEGRA_USING_NAMESPACE Tegra::CMS;
+TEGRA_USING_NAMESPACE Tegra::eLogger;
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+TEGRA_ANONYMOUS_NAMESPACE_BEGIN
+
+//! Locks of the map of counters, the cells of a counter are not behind a lock.
+constexpr std::size_t MapShards = 64;
+
+//! Cells of a counter if the options give none.
+constexpr std::size_t MaxDefaultStripes = 16;
+
+//! Counters that a thread keeps without asking the map, the cache is emptied when it's full.
+constexpr std::size_t ThreadCacheSize = 1024;
+
+//! Ids of the stores, a new store at the address of an old one must not see the caches of the old one.
+std::atomic<u64> nextStoreId {1};
+
+std::chrono::milliseconds::rep nowMilliseconds() __tegra_noexcept
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void warn(std::string_view what, const std::exception& e)
+{
+    if(DeveloperMode::IsEnable) {
+        Log("The counters could not " + std::string(what) + ": " + std::string(e.what()), LoggerType::Warning);
+    }
+}
+
+/*!
+ * @brief Table and column names are written into the statements, so only plain identifiers are taken.
+ */
+void checkIdentifier(std::string_view name)
+{
+    if (!TableRegistry::identifier(name)) {
+        throw Exception(Exception::Reason::Core, "The counter name [" + std::string(name) + "] is not a plain identifier.");
+    }
+}
+
+std::string placeholders(std::size_t count, std::string_view row)
+{
+    std::string list;
+    list.reserve(count * (row.size() + 2));
+    for (std::size_t i = 0; i < count; ++i) {
+        if (i != 0) list.append(", ");
+        list.append(row);
+    }
+    return list;
+}
+
+TEGRA_NAMESPACE_END
+
+CounterStore::CounterStore(ConnectionPool& pool, const CounterStoreOptions& options) : m_pool(pool), m_options(options)
+{
+    if (m_options.stripes == 0) {
+        m_options.stripes = std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u), MaxDefaultStripes);
+    }
+    m_options.stripes   = std::bit_ceil(m_options.stripes);
+    m_options.batchSize = std::max<std::size_t>(m_options.batchSize, 1);
+    m_stripeMask = m_options.stripes - 1;
+    m_id = nextStoreId.fetch_add(1, std::memory_order_relaxed);
+    m_shards.reserve(MapShards);
+    for (std::size_t i = 0; i < MapShards; ++i) {
+        m_shards.push_back(CreateScope<Shard>());
+    }
+}
+
+CounterStore::~CounterStore()
+{
+    stop();
+    flush();
+}
+
+void CounterStore::add(std::string_view table, u64 id, std::string_view column, llong delta)
+{
+    //! A plain reference, copying the Ref would make all cores write its use count.
+    Counter& counter = counterOf(table, id, column);
+    Cell& cell = counter.cells[stripeOfThread() & m_stripeMask];
+    cell.delta.fetch_add(delta);
+    //! Pairs with flush, either flush sees the delta and keeps the counter or the delta sees that it's dropped.
+    if (counter.evicted.load()) {
+        cell.delta.fetch_sub(delta);
+        add(table, id, column, delta);
+        return;
+    }
+    //! Read first, so hot counters do not write the flag on every add.
+    if (!counter.used.load(std::memory_order_relaxed)) counter.used.store(true, std::memory_order_relaxed);
+}
+
+llong CounterStore::value(std::string_view table, u64 id, std::string_view column)
+{
+    Counter& counter = counterOf(table, id, column);
+    if (!counter.used.load(std::memory_order_relaxed)) counter.used.store(true, std::memory_order_relaxed);
+    if (counter.evicted.load()) {
+        return value(table, id, column);
+    }
+    if (counter.loaded.load(std::memory_order_acquire) == 0) {
+        load(counter);
+    }
+    //! A delta that flush moves is in two places or in none for a moment, such a read is done again.
+    for (;;) {
+        const u32 moves = counter.moves.load(std::memory_order_acquire);
+        if (moves % 2 != 0) {
+            std::this_thread::yield();
+            continue;
+        }
+        const llong cells = live(counter);
+        const llong pending = counter.pending.load(std::memory_order_acquire);
+        const llong base = counter.base.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (counter.moves.load(std::memory_order_relaxed) == moves) {
+            return base + pending + cells;
+        }
+    }
+}
+
+std::size_t CounterStore::flush()
+{
+    std::lock_guard flushLock(m_flushMutex);
+    std::vector<std::pair<Counter*, llong>> deltas;
+    std::vector<std::pair<Shard*, std::string>> idle;
+    for (const auto& shard : m_shards) {
+        std::shared_lock lock(shard->mutex);
+        for (const auto& [key, counter] : shard->counters) {
+            drain(*counter);
+            const llong total = counter->pending.load(std::memory_order_acquire);
+            if (total != 0) {
+                deltas.emplace_back(counter.get(), total);
+            }
+            //! Only the flush thread reads idle, so it's not atomic.
+            counter->idle = counter->used.exchange(false, std::memory_order_relaxed) ? 0 : counter->idle + 1;
+            if (total == 0 && m_options.idleFlushes != 0 && counter->idle >= m_options.idleFlushes) {
+                idle.emplace_back(shard.get(), key);
+            }
+        }
+    }
+
+    //! Deadlocks between processes are avoided by writing the rows of a table in the same order everywhere.
+    std::sort(deltas.begin(), deltas.end(), [](const auto& a, const auto& b) {
+        return std::tie(a.first->table, a.first->column, a.first->id) < std::tie(b.first->table, b.first->column, b.first->id);
+    });
+    std::size_t written = 0;
+    m_epoch.fetch_add(1, std::memory_order_acq_rel);
+    for (std::size_t first = 0; first < deltas.size();) {
+        std::size_t last = first + 1;
+        while (last < deltas.size() && last - first < m_options.batchSize
+               && deltas[last].first->table == deltas[first].first->table && deltas[last].first->column == deltas[first].first->column) {
+            ++last;
+        }
+        const std::vector<std::pair<Counter*, llong>> batch(deltas.begin() + static_cast<std::ptrdiff_t>(first),
+                                                            deltas.begin() + static_cast<std::ptrdiff_t>(last));
+        first = last;
+        try {
+            upsert(batch);
+        } catch (const std::exception& e) {
+            warn("be written", e);
+            continue;
+        }
+        for (const auto& [counter, delta] : batch) {
+            std::lock_guard lock(counter->mutex);
+            counter->moves.fetch_add(1, std::memory_order_acq_rel);
+            counter->base.fetch_add(delta, std::memory_order_acq_rel);
+            counter->pending.fetch_sub(delta, std::memory_order_acq_rel);
+            counter->moves.fetch_add(1, std::memory_order_release);
+        }
+        written += batch.size();
+    }
+    m_epoch.fetch_add(1, std::memory_order_acq_rel);
+    m_flushed += written;
+
+    for (const auto& [shard, key] : idle) {
+        std::unique_lock lock(shard->mutex);
+        const auto found = shard->counters.find(key);
+        if (found == shard->counters.end()) continue;
+        Counter& counter = *found->second;
+        if (counter.used.load(std::memory_order_relaxed) || counter.pending.load(std::memory_order_acquire) != 0) continue;
+        counter.evicted.store(true);
+        //! Sequentially consistent loads, a relaxed one could be done before the store is seen by add.
+        if (live(counter, std::memory_order_seq_cst) != 0) {
+            counter.evicted.store(false);
+            continue;
+        }
+        shard->counters.erase(found);
+        ++m_evicted;
+    }
+    return written;
+}
+
+void CounterStore::refresh()
+{
+    std::lock_guard flushLock(m_flushMutex);
+    const Stamp now = nowMilliseconds();
+    std::vector<Counter*> stale;
+    for (const auto& shard : m_shards) {
+        std::shared_lock lock(shard->mutex);
+        for (const auto& [key, counter] : shard->counters) {
+            const Stamp loaded = counter->loaded.load(std::memory_order_acquire);
+            if (loaded != 0 && now - loaded >= m_options.maxStaleness.count()) stale.push_back(counter.get());
+        }
+    }
+    std::sort(stale.begin(), stale.end(), [](const Counter* a, const Counter* b) {
+        return std::tie(a->table, a->column, a->id) < std::tie(b->table, b->column, b->id);
+    });
+    for (std::size_t first = 0; first < stale.size();) {
+        std::size_t last = first + 1;
+        while (last < stale.size() && last - first < m_options.batchSize
+               && stale[last]->table == stale[first]->table && stale[last]->column == stale[first]->column) {
+            ++last;
+        }
+        try {
+            load(std::vector<Counter*>(stale.begin() + static_cast<std::ptrdiff_t>(first), stale.begin() + static_cast<std::ptrdiff_t>(last)));
+        } catch (const std::exception& e) {
+            warn("be read", e);
+        }
+        first = last;
+    }
+}
+
+void CounterStore::start()
+{
+    std::lock_guard lock(m_threadMutex);
+    if (m_worker.joinable()) {
+        return;
+    }
+    m_stop = false;
+    m_worker = std::thread(&CounterStore::run, this);
+}
+
+void CounterStore::stop()
+{
+    {
+        std::lock_guard lock(m_threadMutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+}
+
+CounterStoreStats CounterStore::stats() const
+{
+    CounterStoreStats stats;
+    for (const auto& shard : m_shards) {
+        std::shared_lock lock(shard->mutex);
+        stats.counters += shard->counters.size();
+    }
+    stats.loads      = m_loads.load(std::memory_order_relaxed);
+    stats.statements = m_statements.load(std::memory_order_relaxed);
+    std::lock_guard lock(m_flushMutex);
+    stats.flushed = m_flushed;
+    stats.evicted = m_evicted;
+    return stats;
+}
+
+const CounterStoreOptions& CounterStore::options() const __tegra_noexcept
+{
+    return m_options;
+}
+
+CounterStore::Counter& CounterStore::counterOf(std::string_view table, u64 id, std::string_view column)
+{
+    //! The key is built in a buffer of the thread, a hot add does not allocate.
+    thread_local std::string key;
+    key.assign(table).push_back('\n');
+    key.append(column).push_back('\n');
+    key.append(std::to_string(id));
+
+    thread_local u64 owner {};
+    thread_local std::unordered_map<std::string, Ref<Counter>> cache;
+    if (owner != m_id || cache.size() >= ThreadCacheSize) {
+        cache.clear();
+        owner = m_id;
+    }
+    if (const auto found = cache.find(key); found != cache.end()) {
+        if (!found->second->evicted.load()) return *found->second;
+        cache.erase(found);
+    }
+
+    Shard& shard = *m_shards[std::hash<std::string> {}(key) % MapShards];
+    Ref<Counter> counter;
+    {
+        std::shared_lock lock(shard.mutex);
+        if (const auto found = shard.counters.find(key); found != shard.counters.end()) counter = found->second;
+    }
+    if (counter == nullptr) {
+        checkIdentifier(table);
+        checkIdentifier(column);
+        auto created = CreateRef<Counter>();
+        created->table  = std::string(TableRegistry::table(table, TableType::MixedStruct));
+        created->column = std::string(column);
+        created->id     = id;
+        created->select = selectOf(created->table, created->column);
+        created->cells  = std::make_unique<Cell[]>(m_options.stripes);
+        //! Another thread may have created it meanwhile, the one inside the map is used.
+        std::unique_lock lock(shard.mutex);
+        counter = shard.counters.try_emplace(key, std::move(created)).first->second;
+    }
+    cache.emplace(key, counter);
+    return *counter;
+}
+
+Ref<const SqlStatement> CounterStore::selectOf(const std::string& table, const std::string& column)
+{
+    std::lock_guard lock(m_selectMutex);
+    auto& statement = m_selects[table + '\n' + column];
+    if (statement == nullptr) {
+        statement = CreateRef<const SqlStatement>("SELECT " + column + " FROM " + table + " WHERE id = ?");
+    }
+    return statement;
+}
+
+std::size_t CounterStore::stripeOfThread() __tegra_noexcept
+{
+    //! Threads are given cells round robin, a pool of workers spreads evenly over the cores.
+    static std::atomic<std::size_t> next {};
+    thread_local const std::size_t stripe = next.fetch_add(1, std::memory_order_relaxed);
+    return stripe;
+}
+
+llong CounterStore::live(const Counter& counter, std::memory_order order) const __tegra_noexcept
+{
+    llong total = 0;
+    for (std::size_t i = 0; i < m_options.stripes; ++i) {
+        total += counter.cells[i].delta.load(order);
+    }
+    return total;
+}
+
+void CounterStore::drain(Counter& counter) const __tegra_noexcept
+{
+    bool moving = false;
+    for (std::size_t i = 0; i < m_options.stripes; ++i) {
+        const llong delta = counter.cells[i].delta.load(std::memory_order_acquire);
+        if (delta == 0) continue;
+        if (!moving) {
+            counter.moves.fetch_add(1, std::memory_order_acq_rel);
+            moving = true;
+        }
+        counter.pending.fetch_add(delta, std::memory_order_acq_rel);
+        counter.cells[i].delta.fetch_sub(delta, std::memory_order_acq_rel);
+    }
+    if (moving) {
+        counter.moves.fetch_add(1, std::memory_order_release);
+    }
+}
+
+void CounterStore::load(Counter& counter)
+{
+    const SqlParams params {std::to_string(counter.id)};
+    //! A total that was read while a flush wrote is not kept, the read is done again after the flush.
+    for (;;) {
+        const u64 epoch = m_epoch.load(std::memory_order_acquire);
+        if (epoch % 2 != 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        const ResultView rows = m_pool.select(counter.select->key(), params);
+        ++m_statements;
+        std::lock_guard lock(counter.mutex);
+        if (m_epoch.load(std::memory_order_acquire) != epoch) continue;
+        counter.base.store(rows.empty() ? 0 : rows.get<llong>(0, 0).value_or(0), std::memory_order_release);
+        counter.loaded.store(nowMilliseconds(), std::memory_order_release);
+        ++m_loads;
+        return;
+    }
+}
+
+void CounterStore::load(const std::vector<Counter*>& counters)
+{
+    //! All counters are of the same column of the same table, the caller holds the flush lock.
+    SqlParams params;
+    params.reserve(counters.size());
+    for (const Counter* counter : counters) params.emplace_back(std::to_string(counter->id));
+    const ResultView rows = m_pool.select("SELECT id, " + counters.front()->column + " FROM " + counters.front()->table
+                                          + " WHERE id IN (" + placeholders(counters.size(), "?") + ")", params);
+    ++m_statements;
+    std::unordered_map<u64, llong> totals;
+    for (std::size_t r = 0; r < rows.size(); ++r) {
+        totals[rows.get<u64>(r, 0).value_or(0)] = rows.get<llong>(r, 1).value_or(0);
+    }
+    const Stamp now = nowMilliseconds();
+    for (Counter* counter : counters) {
+        const auto found = totals.find(counter->id);
+        std::lock_guard lock(counter->mutex);
+        counter->base.store(found != totals.end() ? found->second : 0, std::memory_order_release);
+        counter->loaded.store(now, std::memory_order_release);
+    }
+    m_loads += counters.size();
+}
+
+void CounterStore::upsert(const std::vector<std::pair<Counter*, llong>>& deltas)
+{
+    const std::string& table = deltas.front().first->table;
+    const std::string& column = deltas.front().first->column;
+    std::string sql = "INSERT INTO " + table + " (id, " + column + ") VALUES " + placeholders(deltas.size(), "(?, ?)");
+    if (m_pool.config().driver == DriverTypes::MySQL) {
+        sql.append(" ON DUPLICATE KEY UPDATE " + column + " = " + column + " + VALUES(" + column + ")");
+    } else {
+        sql.append(" ON CONFLICT (id) DO UPDATE SET " + column + " = " + table + "." + column + " + excluded." + column);
+    }
+    SqlParams params;
+    params.reserve(deltas.size() * 2);
+    for (const auto& [counter, delta] : deltas) {
+        params.emplace_back(std::to_string(counter->id));
+        params.emplace_back(std::to_string(delta));
+    }
+    m_pool.execute(sql, params);
+    ++m_statements;
+}
+
+void CounterStore::run()
+{
+    std::unique_lock lock(m_threadMutex);
+    while (!m_stop) {
+        m_wake.wait_for(lock, m_options.flushInterval, [this] { return m_stop; });
+        lock.unlock();
+        try {
+            flush();
+            refresh();
+        } catch (const std::exception& e) {
+            warn("be flushed", e);
+        }
+        lock.lock();
+    }
+}
+
+TEGRA_NAMESPACE_END
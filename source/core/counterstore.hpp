@@ -0,0 +1,205 @@
+/*!
+ * MIT License
+ *
+ * Copyright (c) 2022 Kambiz Asadzadeh
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#ifndef TEGRA_COUNTERSTORE_HPP
+#define TEGRA_COUNTERSTORE_HPP
+
+#include "connectionpool.hpp"
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+class SqlStatement;
+
+/*!
+ * @brief The CounterStoreOptions struct holds the limits of a CounterStore.
+ */
+struct CounterStoreOptions final
+{
+    std::size_t                 stripes         {};         ///<Cells of a counter, zero is the number of cores up to 16. Rounded up to a power of two.
+    std::chrono::milliseconds   flushInterval   {1000};     ///<Deltas are written by the background thread this often.
+    std::chrono::milliseconds   maxStaleness    {5000};     ///<Totals are read from the table again after this, so changes of other processes show up.
+    std::size_t                 batchSize       {256};      ///<Rows of one multi-row statement.
+    std::size_t                 idleFlushes     {300};      ///<Counters that were not used for this many flushes are dropped from memory.
+};
+
+/*!
+ * @brief The CounterStoreStats struct is a snapshot of the counters of a CounterStore.
+ */
+struct CounterStoreStats final
+{
+    std::size_t counters    {};     ///<Counters in memory.
+    u64         loads       {};     ///<Totals that were read from the tables.
+    u64         flushed     {};     ///<Deltas that were written.
+    u64         statements  {};     ///<Statements that were run by flush and refresh.
+    u64         evicted     {};     ///<Counters that were dropped for being idle.
+};
+
+/*!
+ * @brief The CounterStore class counts likes, ratings, reviews and the like in memory and writes the sums to their tables behind the requests.
+ * Every counter is a column of a row, such as ("likes", id, "total"). An add goes to an atomic cell of the calling thread,
+ * so threads that count the same hot row do not share a cache line and the database sees no row lock per click.
+ * Every thread keeps the counters that it used last, a hot add takes no lock at all.
+ * flush sums the cells and writes each counter once, as "column = column + delta" of a multi-row upsert sorted by id.
+ * A read is the total of the table plus the deltas that are not written yet. Totals are read again after maxStaleness,
+ * so counts of other processes are seen that late at most. A crash loses the deltas of one flushInterval at most.
+ * @example
+ * CounterStore counters(pool);
+ * counters.start();
+ * counters.add("likes", postId, "total");
+ * counters.add("rating", postId, "score", stars);
+ * counters.add("rating", postId, "votes");
+ * auto likes = counters.value("likes", postId, "total");
+ */
+class CounterStore final
+{
+public:
+    /*!
+     * @param pool to run the statements on, it's not owned by the store.
+     */
+    explicit CounterStore(ConnectionPool& pool, const CounterStoreOptions& options = {});
+    CounterStore(const CounterStore& rhsStore) = delete;
+    CounterStore& operator=(const CounterStore& rhsStore) = delete;
+
+    /*!
+     * @brief The destructor stops the background thread and flushes the last deltas.
+     */
+    ~CounterStore();
+
+    /*!
+     * @brief add function changes a counter, it does not wait for the database.
+     * @param table is the name of the table without prefix, for example "likes".
+     * @param id of the row.
+     * @param column of the row, it should be an integer column.
+     * @param delta may be negative, for example for an unlike.
+     */
+    void add(std::string_view table, u64 id, std::string_view column, llong delta = 1);
+
+    /*!
+     * @brief value function gets a counter, the first read of a counter reads its total from the table.
+     * @returns total of the table plus the deltas that are not written yet.
+     */
+    __tegra_no_discard llong value(std::string_view table, u64 id, std::string_view column);
+
+    /*!
+     * @brief flush function writes the deltas of all counters, rows that could not be written are kept for the next flush.
+     * @returns number of counters that were written.
+     */
+    std::size_t flush();
+
+    /*!
+     * @brief refresh function reads the totals that are older than maxStaleness again.
+     */
+    void refresh();
+
+    /*!
+     * @brief start function runs flush and refresh on a background thread every flushInterval.
+     */
+    void start();
+
+    /*!
+     * @brief stop function stops the background thread, deltas stay until the next flush.
+     */
+    void stop();
+
+    __tegra_no_discard CounterStoreStats stats() const;
+    __tegra_no_discard const CounterStoreOptions& options() const __tegra_noexcept;
+
+private:
+    using Stamp = std::chrono::milliseconds::rep;
+
+    //! One cache line per cell, so threads on different cores do not invalidate each other.
+    struct alignas(64) Cell final
+    {
+        std::atomic<llong> delta {};
+    };
+
+    struct Counter final
+    {
+        std::string                 table       {};     ///<Full name of the table.
+        std::string                 column      {};
+        u64                         id          {};
+        Ref<const SqlStatement>     select      {};     ///<Reads the total, shared by the counters of a column.
+        std::unique_ptr<Cell[]>     cells       {};
+        std::atomic<llong>          pending     {};     ///<Summed from the cells, not written yet.
+        std::atomic<llong>          base        {};     ///<Total of the table plus the written deltas.
+        std::atomic<Stamp>          loaded      {};     ///<When base was read, zero never.
+        std::atomic<u32>            moves       {};     ///<Odd while flush moves a delta between cells, pending and base.
+        std::atomic<bool>           used        {};
+        std::atomic<bool>           evicted     {};     ///<Dropped from the map, an add that still reached it moves its delta to the new counter.
+        std::size_t                 idle        {};     ///<Flushes since the last use.
+        std::mutex                  mutex       {};     ///<Orders a load of base with the flush that adds to it.
+    };
+
+    struct Shard final
+    {
+        mutable std::shared_mutex                                       mutex       {};
+        std::unordered_map<std::string, Ref<Counter>>                   counters    {};
+    };
+
+    /*!
+     * @brief counterOf function gets a counter from the cache of the calling thread or from the map, it's created if it's new.
+     * @returns the counter, the cache of the thread keeps it alive until the next call of the thread.
+     */
+    __tegra_no_discard Counter& counterOf(std::string_view table, u64 id, std::string_view column);
+
+    /*!
+     * @brief selectOf function gets the statement that reads the totals of a column, it's composed once per column.
+     */
+    __tegra_no_discard Ref<const SqlStatement> selectOf(const std::string& table, const std::string& column);
+
+    __tegra_no_discard static std::size_t stripeOfThread() __tegra_noexcept;
+    __tegra_no_discard llong live(const Counter& counter, std::memory_order order = std::memory_order_acquire) const __tegra_noexcept;
+
+    /*!
+     * @brief drain function moves the deltas of the cells into pending, readers retry while it runs.
+     */
+    void drain(Counter& counter) const __tegra_noexcept;
+    void load(Counter& counter);
+    void load(const std::vector<Counter*>& counters);
+    void upsert(const std::vector<std::pair<Counter*, llong>>& deltas);
+    void run();
+
+    ConnectionPool&                 m_pool;
+    CounterStoreOptions             m_options;
+    u64                             m_id            {};     ///<Tells the caches of the threads which store they belong to.
+    std::size_t                     m_stripeMask    {};
+    std::vector<Scope<Shard>>       m_shards        {};
+    std::atomic<u64>                m_epoch         {};     ///<Odd while flush writes, a load that saw it change is not kept.
+    mutable std::mutex              m_flushMutex    {};
+    std::atomic<u64>                m_loads         {};
+    u64                             m_flushed       {};
+    std::atomic<u64>                m_statements    {};
+    u64                             m_evicted       {};
+    std::mutex                      m_selectMutex   {};
+    std::unordered_map<std::string, Ref<const SqlStatement>> m_selects {};  ///<Keyed by table and column.
+    std::mutex                      m_threadMutex   {};
+    std::condition_variable         m_wake          {};
+    std::thread                     m_worker        {};
+    bool                            m_stop          {};
+};
+
+TEGRA_NAMESPACE_END
+
+#endif  // TEGRA_COUNTERSTORE_HPP
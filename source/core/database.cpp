@@ -1,10 +1,65 @@
 #include "database.hpp"
+#include "connectionpool.hpp"
+#include "bulkloader.hpp"
+#include "schemabuilder.hpp"
+#include "backup.hpp"
+#include "mixedcache.hpp"
+#include "hilo.hpp"
+#include "migration.hpp"
+#include "router.hpp"
+#include "querycache.hpp"
+#include "memorystore.hpp"
+#include "sessionstore.hpp"
+#include "counterstore.hpp"
+#include "searchindex.hpp"
+#include "tableregistry.hpp"
+#include "sqlquery.hpp"
+#include "core.hpp"
+#include "logger.hpp"
+#include "translator/translator.hpp"
+#include "translator/language.hpp"
 
 TEGRA_USING_NAMESPACE Tegra;
 TEGRA_USING_NAMESPACE Tegra::CMS;
+TEGRA_USING_NAMESPACE Tegra::eLogger;
 
 TEGRA_NAMESPACE_BEGIN(Tegra::Database)
 
+TEGRA_ANONYMOUS_NAMESPACE_BEGIN
+
+//! Column sets of updateRow that get a statement of their own.
+constexpr std::size_t UpdateStatements = 256;
+
+/*!
+ * @brief translatedLanguages function gets the languages of the translation files as values of the language column, like "english".
+ * @returns the names in the order of their codes, empty if there are no translations.
+ */
+VectorString translatedLanguages()
+{
+    const std::filesystem::path directory = Multilangual::LanguagePath::getExecutablePath() + Translation::Translator::translations;
+    const std::filesystem::path contents = std::filesystem::path(CONFIG::TRANSLATION_FILE).filename();
+    Translation::LanguageFile files;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        if (entry.path().extension() != ".json" || entry.path().filename() == contents) continue;
+        files.push_back(entry.path().stem().string());
+    }
+    VectorString names;
+    Translation::Translator translator;
+    translator.setFile(files);
+    if (files.empty() || !translator.init()) {
+        return names;
+    }
+    for (const auto& code : translator.listByCode()) {
+        std::string name = translator.name(code);
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (!name.empty() && std::find(names.begin(), names.end(), name) == names.end()) names.push_back(std::move(name));
+    }
+    return names;
+}
+
+TEGRA_NAMESPACE_END
+
 Manager::Manager(const StructManager& structManager)
 {
     m_structManager = new StructManager(structManager);
@@ -14,6 +69,16 @@ Manager::Manager(const StructManager& structManager)
 
 Manager::~Manager()
 {
+    m_sessions.reset();
+    m_counters.reset();
+    m_search.reset();
+    m_caches.clear();
+    m_queryCache.reset();
+    m_memory.reset();
+    m_ids.reset();
+    m_router.reset();
+    m_pool.reset();
+    m_retired.clear();
     __tegra_safe_delete(m_structManager);
 }
 
@@ -27,9 +92,9 @@ Database::DriverTypes Manager::types()
     return m_structManager->types;
 }
 
-std::string getRdbmsType()
+std::string Manager::getRdbmsType()
 {
-  //ToDo...
+    return std::string(ConnectionConfig::rdbmsOf(types()));
 }
 
 DatabaseList Manager::db() const
@@ -97,12 +162,81 @@ void Manager::removeDatabase()
 
 void Manager::backupDatabase(Database::DriverTypes type, const DatabaseList& db, const std::string& path, const std::string& u)
 {
+    const std::filesystem::path root = !path.empty() ? std::filesystem::path(path) : std::filesystem::path(this->path().value_or("backup"));
+    TableList names;
+    for (const auto& table : tables().empty() ? Constants::defaultTables : tables()) {
+        names.emplace_back(TableRegistry::table(table, TableType::MixedStruct));
+    }
+    const auto run = [&names](ConnectionPool& pool, const std::filesystem::path& directory) {
+        const auto report = BackupEngine(pool).backup(names, directory);
+        if(DeveloperMode::IsEnable) {
+            u64 rows = 0;
+            for (const auto& table : report.tables) rows += table.rows;
+            Log(std::to_string(rows) + " rows of " + std::to_string(report.tables.size()) + " tables saved into ["
+                + directory.string() + "] in " + std::to_string(report.elapsed.count() / 1000) + "ms.", LoggerType::Info);
+        }
+    };
+    if (db.empty()) {
+        run(pool(), root);
+        return;
+    }
+    for (const auto& name : db) {
+        ConnectionConfig config = pool().config();
+        if (type != DriverTypes::Default) config.driver = type;
+        if (!u.empty()) config.user = u;
+        config.dbname = name;
+        ConnectionPool databasePool(config);
+        run(databasePool, root / name);
+    }
+}
 
+void Manager::restoreDatabase(const std::string& path)
+{
+    //! Rows go in the order of the foreign keys of config/system-tables.json.
+    SchemaBuilder schema(pool());
+    schema.addFromFile(std::string(CONFIG::CMS_TABLES_FILE), ConnectionConfig::rdbmsOf(pool().config().driver));
+    const auto report = BackupEngine(pool()).restore(path, {}, schema.levels());
+    if(DeveloperMode::IsEnable) {
+        u64 rows = 0;
+        for (const auto& table : report.tables) rows += table.rows;
+        Log(std::to_string(rows) + " rows of " + std::to_string(report.tables.size()) + " tables restored from ["
+            + path + "] in " + std::to_string(report.elapsed.count() / 1000) + "ms.", LoggerType::Info);
+    }
+    written({});
 }
 
 void Manager::createTables(Database::DriverTypes type)
 {
+    SchemaBuilder builder(pool());
+    builder.addFromFile(std::string(CONFIG::CMS_TABLES_FILE), ConnectionConfig::rdbmsOf(type));
+    const auto report = builder.create();
+    if(DeveloperMode::IsEnable) {
+        for (const auto& table : report.tables) {
+            Log("Table [" + table.table + "] created in " + std::to_string(table.elapsed.count()) + "us.", LoggerType::Info);
+        }
+        Log(std::to_string(report.tables.size()) + " tables created in " + std::to_string(report.elapsed.count() / 1000)
+            + "ms over " + std::to_string(report.connections) + " connections.", LoggerType::Info);
+    }
+}
 
+void Manager::migrateTables(Database::DriverTypes type)
+{
+    MigrationEngine engine(pool());
+    engine.addFromFile(std::string(CONFIG::CMS_TABLES_FILE), ConnectionConfig::rdbmsOf(type));
+    const auto plan = engine.plan();
+    if(DeveloperMode::IsEnable) {
+        for (const auto& warning : plan.warnings) {
+            Log(warning, LoggerType::Warning);
+        }
+    }
+    const auto report = engine.apply(plan);
+    if(DeveloperMode::IsEnable) {
+        Log(std::to_string(plan.steps.size()) + " schema changes in " + std::to_string(report.statements) + " statements, "
+            + std::to_string(report.backfilled) + " rows filled in " + std::to_string(report.chunks) + " chunks, "
+            + std::to_string(report.elapsed.count() / 1000) + "ms.", LoggerType::Info);
+    }
+    //! Rows of the cached tables may have new columns now.
+    written({});
 }
 
 void Manager::removeTables(Database::DriverTypes type)
@@ -112,7 +246,18 @@ void Manager::removeTables(Database::DriverTypes type)
 
 void Manager::insertTables(Database::DriverTypes type)
 {
-
+    const auto seeds = BulkLoader::readSeeds(std::string(CONFIG::CMS_TABLES_FILE), ConnectionConfig::rdbmsOf(type));
+    auto connection = pool().acquire();
+    BulkLoader loader(*connection);
+    for (const auto& seed : seeds) {
+        const auto report = loader.load(seed);
+        if(DeveloperMode::IsEnable) {
+            Log("Table [" + report.table + "] loaded " + std::to_string(report.rows) + " rows in "
+                + std::to_string(report.statements) + " statements, "
+                + std::to_string(static_cast<u64>(report.rowsPerSecond())) + " rows/sec.", LoggerType::Info);
+        }
+    }
+    written({});
 }
 
 void Manager::resetAllTables(Database::DriverTypes type)
@@ -126,6 +271,343 @@ void Manager::resetTable(Database::DriverTypes type, const std::string& tableNam
 
 }
 
+ConnectionPool& Manager::pool()
+{
+    std::lock_guard lock(m_poolMutex);
+    if (m_pool == nullptr) {
+        const auto clients = ConnectionConfig::fromFile();
+        if (clients.empty()) {
+            throw Exception(Exception::Reason::Core, "There is no database client inside the config file.");
+        }
+        const auto wanted = types() == DriverTypes::Default ? DriverTypes::PostgreSQL : types();
+        const auto found = std::find_if(clients.begin(), clients.end(), [wanted](const ConnectionConfig& c) {
+            return c.driver == wanted && c.role == ClientRole::Primary;
+        });
+        ConnectionConfig config = found != clients.end() ? *found : clients.front();
+        if (const auto user = username()) config.user = *user;
+        if (const auto pass = password()) config.password = *pass;
+        m_pool = CreateScope<ConnectionPool>(config);
+    }
+    return *m_pool;
+}
+
+void Manager::connect(const ConnectionConfig& config)
+{
+    //! Caches, the allocator and the router belong to the old pool, they are retired with it and destroyed once it's idle.
+    Scope<ConnectionPool> next = CreateScope<ConnectionPool>(config);
+    //! Declared before the lock, so the dropped pools and their workers are stopped after it's released.
+    std::vector<Retired> dropped;
+    std::scoped_lock lock(m_cacheMutex, m_poolMutex);
+    //! A retired pool without leased connections and waiters is not used by anyone anymore.
+    for (auto it = m_retired.begin(); it != m_retired.end();) {
+        if (it->pool->waiting() == 0 && it->pool->idle() == it->pool->size()) {
+            dropped.push_back(std::move(*it));
+            it = m_retired.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    if (m_pool != nullptr) {
+        Retired retired;
+        retired.pool       = std::move(m_pool);
+        retired.ids        = std::move(m_ids);
+        retired.router     = std::move(m_router);
+        retired.queryCache = std::move(m_queryCache);
+        retired.caches     = std::move(m_caches);
+        retired.sessions   = std::move(m_sessions);
+        retired.counters   = std::move(m_counters);
+        retired.search     = std::move(m_search);
+        m_retired.push_back(std::move(retired));
+        m_caches.clear();
+    }
+    m_pool = std::move(next);
+}
+
+HiLoAllocator& Manager::ids()
+{
+    ConnectionPool& connections = pool();
+    std::lock_guard lock(m_poolMutex);
+    if (m_ids == nullptr) {
+        m_ids = CreateScope<HiLoAllocator>(connections);
+    }
+    return *m_ids;
+}
+
+QueryRouter& Manager::router()
+{
+    ConnectionPool& connections = pool();
+    std::lock_guard lock(m_poolMutex);
+    if (m_router == nullptr) {
+        std::vector<ConnectionConfig> replicas;
+        for (const auto& client : ConnectionConfig::fromFile()) {
+            if (client.role == ClientRole::Replica && client.driver == connections.config().driver) {
+                replicas.push_back(client);
+            }
+        }
+        m_router = CreateScope<QueryRouter>(connections, replicas);
+    }
+    return *m_router;
+}
+
+MixedCache& Manager::cache(std::string_view table)
+{
+    //! memory() takes the cache lock as well.
+    MemoryStore* store = inMemory() ? &memory() : nullptr;
+    std::lock_guard lock(m_cacheMutex);
+    const std::string_view key = TableRegistry::table(table, TableType::KeyStruct);
+    auto found = m_caches.find(key);
+    if (found == m_caches.end()) {
+        Scope<MixedCache> created = store != nullptr ? CreateScope<MixedCache>(*store, table) : CreateScope<MixedCache>(pool(), table);
+        found = m_caches.emplace(std::string(key), std::move(created)).first;
+    }
+    return *found->second;
+}
+
+bool Manager::inMemory() const __tegra_noexcept
+{
+    return m_structManager->storage == StorageType::Cache;
+}
+
+ResultView Manager::select(std::string_view sql, const SqlParams& params, const ConsistencyToken* token)
+{
+    if (inMemory()) {
+        return ResultView::from(memory().execute(sql, params));
+    }
+    ConsistencyToken current = consistency(token);
+    return router().execute(sql, params, &current);
+}
+
+ConsistencyToken Manager::consistency(const ConsistencyToken* token) const __tegra_noexcept
+{
+    ConsistencyToken current = ConsistencyToken::from(m_primaryUntil.load(std::memory_order_acquire));
+    if (token != nullptr) {
+        current.primaryUntil = std::max(current.primaryUntil, token->primaryUntil);
+    }
+    return current;
+}
+
+void Manager::wrote(const ConsistencyToken& written, ConsistencyToken* token) __tegra_noexcept
+{
+    u64 current = m_primaryUntil.load(std::memory_order_relaxed);
+    while (current < written.value() && !m_primaryUntil.compare_exchange_weak(current, written.value(), std::memory_order_acq_rel)) {
+    }
+    if (token != nullptr) {
+        token->primaryUntil = std::max(token->primaryUntil, written.primaryUntil);
+    }
+}
+
+QueryCache& Manager::queryCache()
+{
+    std::lock_guard lock(m_cacheMutex);
+    if (m_queryCache == nullptr) {
+        ConnectionPool& connections = pool();
+        QueryCacheOptions options;
+        options.maxBytes      = connections.config().queryCacheSize;
+        options.ttl           = connections.config().queryCacheTtl;
+        options.persistentTtl = connections.config().queryCacheL2Ttl;
+        m_queryCache = CreateScope<QueryCache>(connections, options);
+    }
+    return *m_queryCache;
+}
+
+MemoryStore& Manager::memory()
+{
+    std::lock_guard lock(m_cacheMutex);
+    if (m_memory == nullptr) {
+        MemoryStoreOptions options;
+        options.snapshot = CONFIG::CMS_MEMORY_SNAPSHOT_FILE;
+        m_memory = CreateScope<MemoryStore>(options);
+        m_memory->addFromFile(std::string(CONFIG::CMS_TABLES_FILE));
+    }
+    return *m_memory;
+}
+
+SessionStore& Manager::sessions()
+{
+    std::lock_guard lock(m_cacheMutex);
+    if (m_sessions == nullptr) {
+        ConnectionPool& connections = pool();
+        SessionStoreOptions options;
+        options.ttl           = connections.config().sessionTtl;
+        options.flushInterval = connections.config().sessionFlushInterval;
+        m_sessions = CreateScope<SessionStore>(connections, options);
+        m_sessions->start();
+    }
+    return *m_sessions;
+}
+
+CounterStore& Manager::counters()
+{
+    std::lock_guard lock(m_cacheMutex);
+    if (m_counters == nullptr) {
+        m_counters = CreateScope<CounterStore>(pool());
+        m_counters->start();
+    }
+    return *m_counters;
+}
+
+SearchIndex& Manager::search()
+{
+    std::lock_guard lock(m_cacheMutex);
+    if (m_search == nullptr) {
+        SearchIndexOptions options;
+        options.directory = CONFIG::CMS_SEARCH_INDEX_DIRECTORY;
+        m_search = CreateScope<SearchIndex>(pool(), options);
+        m_search->start();
+        if (m_search->languages().empty()) {
+            //! No segment of an earlier run, the first searches find nothing until the build is done.
+            m_search->buildLater(translatedLanguages());
+        }
+    }
+    return *m_search;
+}
+
+ResultView Manager::selectCached(std::string_view sql, const SqlParams& params, std::chrono::milliseconds ttl)
+{
+    return queryCache().select(sql, params, ttl);
+}
+
+u64 Manager::execute(std::string_view sql, const SqlParams& params, ConsistencyToken* token)
+{
+    if (inMemory()) {
+        const u64 affected = memory().execute(sql, params).affectedRows;
+        written(QueryCache::tablesOf(sql));
+        return affected;
+    }
+    ConsistencyToken current;
+    const u64 affected = router().execute(sql, params, &current).affectedRows;
+    wrote(current, token);
+    written(QueryCache::tablesOf(sql));
+    return affected;
+}
+
+void Manager::written(const VectorString& tables)
+{
+    const auto touched = [&tables](std::string_view name) {
+        return std::any_of(tables.begin(), tables.end(), [name](const std::string& table) {
+            return table.size() == name.size() && std::equal(table.begin(), table.end(), name.begin(), [](char a, char b) {
+                       return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+                   });
+        });
+    };
+    QueryCache* queries = nullptr;
+    SearchIndex* search = nullptr;
+    {
+        std::lock_guard lock(m_cacheMutex);
+        for (auto& [table, cache] : m_caches) {
+            if (tables.empty() || touched(cache->keyTable()) || touched(cache->valueTable())) cache->invalidate();
+        }
+        queries = m_queryCache.get();
+        search = m_search.get();
+    }
+    //! The "cache" table is cleared and the search index is queued outside of the lock.
+    if (search != nullptr) search->written(tables);
+    if (queries == nullptr) return;
+    if (tables.empty()) queries->invalidate();
+    for (const auto& table : tables) queries->invalidate(table);
+}
+
+u64 Manager::updateRow(std::string_view table, u64 id, const MapString& values, std::string_view language, ConsistencyToken* token)
+{
+    if (values.empty()) return 0;
+    const std::string_view name = TableRegistry::table(table, TableType::MixedStruct);
+    //! The table, the columns and the language filter pick the statement, the values are bound.
+    std::string shape(name);
+    SqlParams params;
+    params.reserve(values.size() + 2);
+    for (const auto& [column, value] : values) {
+        //! Column names are written into the statement.
+        if (!TableRegistry::identifier(column)) {
+            throw Exception(Exception::Reason::Core, "The column [" + column + "] is not a plain identifier.");
+        }
+        shape.append(",").append(column);
+        params.emplace_back(value);
+    }
+    params.emplace_back(std::to_string(id));
+    if (!language.empty()) {
+        shape.append(";language");
+        params.emplace_back(std::string(language));
+    }
+    if (inMemory()) {
+        MemoryFilter where {{"id", std::to_string(id)}};
+        if (!language.empty()) where.emplace_back("language", std::string(language));
+        const u64 affected = memory().table(name).update(where, values);
+        touch(table, id);
+        return affected;
+    }
+
+    const SqlStatement* statement = nullptr;
+    {
+        std::shared_lock lock(m_updateMutex);
+        if (const auto found = m_updates.find(shape); found != m_updates.end()) statement = found->second.get();
+    }
+    std::string sql;
+    if (statement == nullptr) {
+        sql = std::string(UPDATE) + " " + std::string(name) + " SET ";
+        for (auto it = values.begin(); it != values.end(); ++it) {
+            sql.append(it == values.begin() ? "" : ", ").append(it->first).append(" = ?");
+        }
+        sql.append(" WHERE id = ?");
+        if (!language.empty()) sql.append(" AND language = ?");
+        //! Every statement keeps a slot of each connection, column sets beyond the limit run by their text.
+        std::unique_lock lock(m_updateMutex);
+        if (m_updates.size() < UpdateStatements || m_updates.contains(shape)) {
+            auto& slot = m_updates[shape];
+            if (slot == nullptr) slot = CreateScope<SqlStatement>(sql);
+            statement = slot.get();
+        }
+    }
+    ConsistencyToken current;
+    QueryRouter& writer = router();
+    const u64 affected = (statement != nullptr ? writer.execute(statement->key(), params, &current) : writer.execute(sql, params, &current)).affectedRows;
+    wrote(current, token);
+    touch(table, id);
+    return affected;
+}
+
+u64 Manager::deleteRow(std::string_view table, u64 id, std::string_view language, ConsistencyToken* token)
+{
+    if (inMemory()) {
+        MemoryFilter where {{"id", std::to_string(id)}};
+        if (!language.empty()) where.emplace_back("language", std::string(language));
+        const u64 affected = memory().table(table).erase(where);
+        touch(table, id);
+        return affected;
+    }
+    std::string sql = "DELETE FROM " + std::string(TableRegistry::table(table, TableType::MixedStruct)) + " WHERE id = ?";
+    SqlParams params {std::to_string(id)};
+    if (!language.empty()) {
+        sql.append(" AND language = ?");
+        params.emplace_back(std::string(language));
+    }
+    ConsistencyToken current;
+    const u64 affected = router().execute(sql, params, &current).affectedRows;
+    wrote(current, token);
+    touch(table, id);
+    return affected;
+}
+
+void Manager::touch(std::string_view table, u64 id)
+{
+    QueryCache* queries = nullptr;
+    SearchIndex* search = nullptr;
+    {
+        std::lock_guard lock(m_cacheMutex);
+        const auto found = m_caches.find(TableRegistry::table(table, TableType::KeyStruct));
+        if (found != m_caches.end()) {
+            found->second->invalidate(id);
+        }
+        queries = m_queryCache.get();
+        search = m_search.get();
+    }
+    if (queries != nullptr) {
+        queries->invalidate(TableRegistry::table(table, TableType::MixedStruct));
+    }
+    if (search != nullptr) {
+        search->schedule(table, id);
+    }
+}
+
 const TableList& Manager::tables() const
 {
     return m_structManager->tables;
@@ -136,4 +618,45 @@ void Manager::setTables(const TableList& newTables)
     m_structManager->tables = newTables;
 }
 
+SqlHelper::SqlHelper(Connection& connection) : m_connection(connection)
+{
+}
+
+u64 SqlHelper::insert(std::string_view table, const MapString& values, std::string_view idColumn)
+{
+    const std::string_view name = TableRegistry::table(table, TableType::MixedStruct);
+    //! Column names are written into the statement.
+    if (!TableRegistry::identifier(idColumn)) {
+        throw Exception(Exception::Reason::Core, "The column [" + std::string(idColumn) + "] is not a plain identifier.");
+    }
+    std::string sql = "INSERT INTO " + std::string(name) + " (";
+    std::string placeholders;
+    SqlParams params;
+    for (const auto& [column, value] : values) {
+        if (!TableRegistry::identifier(column)) {
+            throw Exception(Exception::Reason::Core, "The column [" + column + "] is not a plain identifier.");
+        }
+        if (!params.empty()) {
+            sql.push_back(',');
+            placeholders.push_back(',');
+        }
+        sql.append(column);
+        placeholders.push_back('?');
+        params.emplace_back(value);
+    }
+    sql.append(") VALUES (").append(placeholders).append(")");
+    if (values.empty() && m_connection.driver() != DriverTypes::MySQL) {
+        sql = "INSERT INTO " + std::string(name) + " DEFAULT VALUES";
+    }
+    const u64 id = m_connection.insert(sql, params, idColumn);
+    m_lastIds.insert_or_assign(std::string(table), id);
+    return id;
+}
+
+u64 SqlHelper::lastInsertedId(const std::string& table) __tegra_noexcept
+{
+    const auto found = m_lastIds.find(table);
+    return found != m_lastIds.end() ? found->second : 0;
+}
+
 TEGRA_NAMESPACE_END
@@ -30,6 +30,10 @@ TEGRA_USING_NAMESPACE Tegra;
 TEGRA_USING_NAMESPACE Tegra::CMS;
 TEGRA_USING_NAMESPACE Tegra::Types;
 
+TEGRA_NAMESPACE_BEGIN(Tegra::CMS)
+enum class StorageType : u8;
+TEGRA_NAMESPACE_END
+
 TEGRA_NAMESPACE_BEGIN(Tegra::Database)
 
 
@@ -87,7 +91,7 @@ struct Constants final
     };
 
     __tegra_inline_static_const Types::VectorString drivers {
-        "mysql", "postgresql"
+        "mysql", "postgresql", "sqlite3"
     };
 
 };
@@ -118,6 +122,7 @@ enum class TableType : u8
 struct TEGRA_RDBMS final {
     static constexpr std::string_view   MySQL       = "mysql";
     static constexpr std::string_view   PostgreSQL  = "postgresql";
+    static constexpr std::string_view   SQLite      = "sqlite3";
 
 };
 
@@ -176,12 +181,33 @@ enum class DriverTypes : u8
     Default     = 0x0, ///<The driver that is selected by default.
     MySQL       = 0x1, ///<Mysql driver.
     PostgreSQL  = 0x2, ///<Postgresql driver.
-    Unknown     = 0x3  ///<If no driver is detected!
+    Unknown     = 0x3, ///<If no driver is detected!
+    SQLite      = 0x4  ///<Sqlite3 driver, a local database that needs no server.
 };
 
+//! A value of a column or a parameter in text form, std::nullopt is NULL.
+using SqlValue  = std::optional<std::string>;
+using SqlParams = std::vector<SqlValue>;
+using SqlRow    = std::vector<SqlValue>;
+
 using DatabaseList = std::vector<std::string>;
 using TableList    = std::vector<std::string>;
 
+class Connection;
+class ConnectionPool;
+class ResultView;
+class MixedCache;
+class HiLoAllocator;
+class QueryRouter;
+class QueryCache;
+class MemoryStore;
+class SessionStore;
+class CounterStore;
+class SearchIndex;
+class SqlStatement;
+struct ConsistencyToken;
+struct ConnectionConfig;
+
 struct StructManager
 {
     std::string     username    {};
@@ -191,6 +217,7 @@ struct StructManager
     TableList       tables      {};
     DatabaseList    database    {};
     Database::DriverTypes types {};
+    CMS::StorageType storage    {};     ///<Storage type of the boot parameters, StorageType::Cache serves the tables from memory().
 };
 
 class Manager
@@ -220,18 +247,35 @@ public:
 
     /*!
      * @brief backupDatabase function will create a full back up of an existing SQL database.
+     * Tables are streamed in parallel into compressed chunk files and a manifest.json, see BackupEngine.
      * @param type is database type such as MySQL or PostgreSQL.
-     * @param db is list of database name that you want to create.
+     * @param db is list of database name that you want to create, each one goes to its own sub directory.
      * @param path is a location for save the backup file.
+     * @param u is the user of the databases, empty means the user of the pool.
      */
     void backupDatabase(Database::DriverTypes type, const DatabaseList& db, const std::string& path, const std::string& u);
 
+    /*!
+     * @brief restoreDatabase function will load a back up that is made by backupDatabase into the tables of the pool.
+     * Tables are loaded in the dependency order of config/system-tables.json, each one in its own transaction.
+     * @param path is the directory of the backup.
+     */
+    void restoreDatabase(const std::string& path);
+
     /*!
      * @brief createTables function will create new table on your database.
+     * Tables of config/system-tables.json are created in dependency order, independent ones in parallel over the pool.
      * @param type is database type such as MySQL or PostgreSQL.
      */
     void createTables(Database::DriverTypes type);
 
+    /*!
+     * @brief migrateTables function upgrades the live tables to config/system-tables.json without dropping data.
+     * Missing tables and columns are added, columns are filled in throttled chunks and constrained at the end.
+     * @param type is database type such as MySQL or PostgreSQL.
+     */
+    void migrateTables(Database::DriverTypes type);
+
     /*!
      * @brief removeTables function will remove new table on your database.
      * @param type is database type such as MySQL or PostgreSQL.
@@ -240,6 +284,7 @@ public:
 
     /*!
      * @brief insertTables function will inserts new data inside the table.
+     * Seed rows of config/system-tables.json are loaded in batches, one transaction per table.
      * @param type is database type such as MySQL or PostgreSQL.
      */
     void insertTables(Database::DriverTypes type);
@@ -335,16 +380,221 @@ public:
      */
     void setPath(const std::string& path);
 
+    /*!
+     * @brief pool function gets the connection pool of the manager, it is created on first use.
+     * The client of config.json that matches the driver type is used, or the first one.
+     * Username and password of the manager override the values of the file.
+     * @returns the pool, it throws if there is no client to connect to.
+     */
+    ConnectionPool& pool();
+
+    /*!
+     * @brief connect function replaces the pool with a pool of the given client.
+     * The old pool and the stores, caches and routers built on it are retired, not destroyed:
+     * leases that were handed out stay valid. A retired pool is destroyed by a later connect
+     * once none of its connections is leased and no thread waits for one, together with what was built on it.
+     * References from queryCache, cache, ids, router, sessions, counters and search belong to the retired pool after connect
+     * and may dangle after any later connect, get them again instead of keeping them across a connect.
+     * @param config of the client.
+     */
+    void connect(const ConnectionConfig& config);
+
+    /*!
+     * @brief select function runs a query through the router and returns the rows without copying every cell.
+     * Reads go to a replica unless a write through the manager (or of the session) is younger than "sticky_window".
+     * With StorageType::Cache they are answered by memory().
+     * @param sql is a single statement with '?' placeholders.
+     * @param params are bound to the placeholders in order.
+     * @param token of the session, it may be nullptr.
+     * @returns the rows, cells are read by index or by a column index that is looked up once.
+     */
+    ResultView select(std::string_view sql, const SqlParams& params = {}, const ConsistencyToken* token = nullptr);
+
+    /*!
+     * @brief selectCached function runs a read through the query cache, a repeated read with the same parameters is answered from memory.
+     * Writes through the manager drop the results of the tables that they touch.
+     * @param sql is a single statement with '?' placeholders.
+     * @param params are bound to the placeholders in order.
+     * @param ttl of the result, zero means "query_cache_ttl" of the client.
+     * @returns the rows, they may be as old as the ttl if the tables were written by another process.
+     */
+    ResultView selectCached(std::string_view sql, const SqlParams& params = {}, std::chrono::milliseconds ttl = {});
+
+    /*!
+     * @brief execute function runs a write on the primary and drops the cached results and joined rows of the tables that it touches.
+     * With StorageType::Cache it runs on memory(), see MemoryStore::execute for the statements it understands.
+     * A write of a search source queues a build of the search index, its rows are not known.
+     * @param sql is a single statement with '?' placeholders.
+     * @param params are bound to the placeholders in order.
+     * @param token of the session, it's refreshed together with the token of the manager, it may be nullptr.
+     * @returns number of affected rows.
+     */
+    u64 execute(std::string_view sql, const SqlParams& params = {}, ConsistencyToken* token = nullptr);
+
+    /*!
+     * @brief queryCache function gets the query result cache of the pool, it is created on first use.
+     * @returns the cache, its limits are "query_cache_size", "query_cache_ttl" and "query_cache_l2_ttl" of the client.
+     */
+    QueryCache& queryCache();
+
+    /*!
+     * @brief cache function gets the joined cache of a key/value table pair, it is created on first use.
+     * @param table is the key table without prefix, for example "config".
+     * @returns the cache, rows are loaded per language on first read.
+     */
+    MixedCache& cache(std::string_view table);
+
+    /*!
+     * @brief updateRow function updates columns of one row and marks the row as stale inside the joined cache.
+     * @param table is a key or value table without prefix, for example "config_l".
+     * @param id of the row.
+     * @param values are column names and their new values, it throws if a name is not a plain identifier.
+     * @param language limits the update of a value table to one language, empty means all languages.
+     * @param token of the session, it may be nullptr.
+     * @returns number of affected rows.
+     */
+    u64 updateRow(std::string_view table, u64 id, const MapString& values, std::string_view language = {}, ConsistencyToken* token = nullptr);
+
+    /*!
+     * @brief deleteRow function deletes one row and marks it as stale inside the joined cache.
+     * @param table is a key or value table without prefix.
+     * @param id of the row.
+     * @param language limits the delete of a value table to one language, empty means all languages.
+     * @param token of the session, it may be nullptr.
+     * @returns number of affected rows.
+     */
+    u64 deleteRow(std::string_view table, u64 id, std::string_view language = {}, ConsistencyToken* token = nullptr);
+
+    /*!
+     * @brief touch function marks a row as stale after a write that did not go through the manager.
+     * Cached query results of the table are dropped as well.
+     * @param table is a key or value table without prefix.
+     * @param id of the row.
+     */
+    void touch(std::string_view table, u64 id);
+
+    /*!
+     * @brief ids function gets the hi-lo id allocator of the pool, it is created on first use.
+     * @returns the allocator, ids can be given to linked key and value rows before they are inserted.
+     */
+    HiLoAllocator& ids();
+
+    /*!
+     * @brief router function gets the read/write router of the pool, it is created on first use.
+     * @returns the router, reads go to the "db_clients" with "role": "replica" of the same rdbms.
+     */
+    QueryRouter& router();
+
+    /*!
+     * @brief memory function gets the embedded store of the default tables for StorageType::Cache, it is created on first use.
+     * No database server is needed, the store is restored from CONFIG::CMS_MEMORY_SNAPSHOT_FILE.
+     * @returns the store, the tables of CONFIG::CMS_TABLES_FILE that are missing are created with their seed rows.
+     */
+    MemoryStore& memory();
+
+    /*!
+     * @brief sessions function gets the session store of the pool, it is created and started on first use.
+     * @returns the store, its limits are "session_ttl" and "session_flush_interval" of the client.
+     */
+    SessionStore& sessions();
+
+    /*!
+     * @brief counters function gets the counters of likes, ratings and reviews of the pool, it is created and started on first use.
+     * @returns the store, clicks are written to the tables in batches instead of one UPDATE each.
+     */
+    CounterStore& counters();
+
+    /*!
+     * @brief search function gets the full-text index of static pages and resources of the pool, it is created on first use.
+     * The segments of CONFIG::CMS_SEARCH_INDEX_DIRECTORY are opened as they are, build indexes the languages again.
+     * Without segments the languages of the translations are built on the background thread.
+     * @returns the index, rows that change through the manager are indexed again on its background thread.
+     */
+    SearchIndex& search();
+
 private:
+    /*!
+     * @brief written function drops the cached results and joined rows of tables after a write.
+     * @param tables are full names of the tables, empty means all tables.
+     */
+    void written(const VectorString& tables);
+
+    /*!
+     * @brief inMemory function tells whether the tables are served by memory() instead of the pool.
+     */
+    __tegra_no_discard bool inMemory() const __tegra_noexcept;
+
+    /*!
+     * @brief consistency function gets the token of a read, the later one of the manager and the session.
+     */
+    __tegra_no_discard ConsistencyToken consistency(const ConsistencyToken* token) const __tegra_noexcept;
+
+    /*!
+     * @brief wrote function keeps the token of a write for the reads of the manager and hands it to the session.
+     */
+    void wrote(const ConsistencyToken& written, ConsistencyToken* token) __tegra_noexcept;
+
+    /*!
+     * @brief The Retired struct keeps what an earlier connect built on its pool, the pool is declared first so it's destroyed last.
+     */
+    struct Retired final
+    {
+        Scope<ConnectionPool> pool;
+        Scope<HiLoAllocator> ids;
+        Scope<QueryRouter> router;
+        Scope<QueryCache> queryCache;
+        std::map<std::string, Scope<MixedCache>, std::less<>> caches;
+        Scope<SessionStore> sessions;
+        Scope<CounterStore> counters;
+        Scope<SearchIndex> search;
+    };
+
     StructManager* m_structManager;
+    Scope<ConnectionPool> m_pool {};
+    std::mutex m_poolMutex {};
+    Scope<HiLoAllocator> m_ids;
+    Scope<QueryRouter> m_router;
+    Scope<QueryCache> m_queryCache;
+    Scope<MemoryStore> m_memory;
+    Scope<SessionStore> m_sessions;
+    Scope<CounterStore> m_counters;
+    Scope<SearchIndex> m_search;
+    std::map<std::string, Scope<MixedCache>, std::less<>> m_caches;
+    std::mutex m_cacheMutex {};
+    std::vector<Retired> m_retired;
+    std::unordered_map<std::string, Scope<SqlStatement>> m_updates; ///<Statements of updateRow by table and columns.
+    std::shared_mutex m_updateMutex {};
+    std::atomic<u64> m_primaryUntil {}; ///<ConsistencyToken of the writes through the manager.
 };
 
 /*!
  * \brief The SqlHelper struct is useful for extra sql actions.
+ * Inserts that are made through it return their generated id in the same round trip (RETURNING on PostgreSQL,
+ * the insert id of the same connection on MySQL and SQLite), so no second query is needed.
  */
 struct SqlHelper final
 {
-    unsigned int lastInsertedId(const std::string& table) __tegra_noexcept;
+    explicit SqlHelper(Connection& connection);
+
+    /*!
+     * @brief insert function inserts one row and gets its generated id.
+     * @param table is the table without prefix.
+     * @param values are column names and their values, it throws if a name is not a plain identifier.
+     * @param idColumn is the generated column.
+     * @returns the generated id.
+     */
+    u64 insert(std::string_view table, const MapString& values, std::string_view idColumn = "id");
+
+    /*!
+     * @brief lastInsertedId function gets the id of the last row that this helper inserted into a table.
+     * @param table is the table without prefix.
+     * @returns the id or zero if nothing was inserted, no query is made.
+     */
+    u64 lastInsertedId(const std::string& table) __tegra_noexcept;
+
+private:
+    Connection& m_connection;
+    std::map<std::string, u64, std::less<>> m_lastIds {};
 };
 
 TEGRA_NAMESPACE_END
@@ -0,0 +1,83 @@
+/*!
+ * MIT License
+ *
+ * Copyright (c) 2022 Kambiz Asadzadeh
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef TEGRA_ENTITY_HPP
+#define TEGRA_ENTITY_HPP
+
+#include "common.hpp"
+
+TEGRA_USING_NAMESPACE Tegra::Types;
+
+TEGRA_NAMESPACE_BEGIN(Tegra::CMS)
+
+/*!
+ * @brief The EntityDecoder class converts HTML entities to their corresponding characters.
+ * @details It covers the whole HTML5 named character reference set (including the legacy names
+ * without semicolon), decimal and hexadecimal references. The named references are looked up in
+ * a hash table that is built at compile time. The decoder jumps between '&' characters with the
+ * vectorized search of CharKernel and copies the clean runs in bulk.
+ * Content can be fed in chunks, an entity that is split between two chunks is kept until the
+ * next chunk arrives, so large documents never have to be fully buffered.
+ * @example EntityDecoder decoder; decoder.feed(chunk, output); ... decoder.finish(output);
+ */
+class EntityDecoder
+{
+public:
+    EntityDecoder() = default;
+    ~EntityDecoder() = default;
+
+    /*!
+     * @brief feed function decodes a chunk of content.
+     * @param chunk is the next part of the content.
+     * @param output is the buffer that receives the decoded text.
+     */
+    void feed(std::string_view chunk, std::string& output);
+
+    /*!
+     * @brief finish function flushes the pending part of the last chunk.
+     * @param output is the buffer that receives the decoded text.
+     */
+    void finish(std::string& output);
+
+    /*!
+     * @brief decode function decodes a whole content.
+     * @param content is the input string.
+     * @returns output as string.
+     */
+    __tegra_no_discard static std::string decode(std::string_view content);
+
+    /*!
+     * @brief decode function appends the decoded content into the output.
+     * @param content is the input string.
+     * @param output is the buffer that receives the decoded text.
+     */
+    static void decode(std::string_view content, std::string& output);
+
+private:
+    std::string m_pending {};   ///<Tail of the previous chunk that starts with an undecided entity.
+};
+
+TEGRA_NAMESPACE_END
+
+#endif // TEGRA_ENTITY_HPP
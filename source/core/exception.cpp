@@ -0,0 +1,44 @@
+#include "core.hpp"
+
+TEGRA_NAMESPACE_BEGIN(Tegra::CMS)
+
+Exception::Exception(const Reason& reason, const std::string& message)
+{
+    m_exceptionData = new ExceptionData();
+    std::string eMessage{};
+    switch (reason) {
+    case Reason::Core:
+        eMessage=":[Core]:";
+        break;
+    case Reason::Framework:
+        eMessage=":[Framework]:";
+        break;
+    case Reason::IO:
+        eMessage=":[IO]:";
+        break;
+    case Reason::User:
+        eMessage=":[User]:";
+        break;
+    case Reason::System:
+        eMessage=":[System]:";
+        break;
+    case Reason::Other:
+        eMessage=":[Other]:";
+        break;
+    default:
+        break;
+    }
+    m_exceptionData->message = message;
+}
+
+Exception::~Exception()
+{
+    __tegra_safe_delete(m_exceptionData);
+};
+
+const char* Exception::what() const throw()
+{
+    return m_exceptionData->message.c_str();
+}
+
+TEGRA_NAMESPACE_END
@@ -0,0 +1,103 @@
+#include "hilo.hpp"
+#include "tableregistry.hpp"
+#include "core.hpp"
+
+TEGRA_USING_NAMESPACE Tegra::CMS;
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+TEGRA_ANONYMOUS_NAMESPACE_BEGIN
+
+u64 numberOf(const ResultSet& result)
+{
+    if (result.empty() || !result.rows.front().front().has_value()) return 0;
+    return std::strtoull(result.rows.front().front()->c_str(), nullptr, 10);
+}
+
+TEGRA_NAMESPACE_END
+
+u64 IdRange::last() const __tegra_noexcept
+{
+    return first + count - 1;
+}
+
+bool IdRange::empty() const __tegra_noexcept
+{
+    return count == 0;
+}
+
+HiLoAllocator::HiLoAllocator(ConnectionPool& pool, u64 blockSize) : m_pool(pool), m_blockSize(std::max<u64>(blockSize, 1))
+{
+}
+
+u64 HiLoAllocator::blockSize() const __tegra_noexcept
+{
+    return m_blockSize;
+}
+
+u64 HiLoAllocator::next(std::string_view table)
+{
+    return reserve(table, 1).first;
+}
+
+IdRange HiLoAllocator::reserve(std::string_view table, u64 count)
+{
+    if (count == 0) return {};
+    const std::string_view key = TableRegistry::table(table, TableType::KeyStruct);
+    //! A large range gets its own block, the current one is kept for small requests.
+    if (count > m_blockSize) {
+        return fetchBlock(key, count);
+    }
+    Sequence* sequence = nullptr;
+    {
+        std::lock_guard lock(m_mutex);
+        sequence = &m_sequences[key];
+    }
+    std::lock_guard lock(sequence->mutex);
+    IdRange& block = sequence->block;
+    if (block.count < count) {
+        block = fetchBlock(key, m_blockSize);
+    }
+    const IdRange range {block.first, count};
+    block.first += count;
+    block.count -= count;
+    return range;
+}
+
+IdRange HiLoAllocator::fetchBlock(std::string_view table, u64 size)
+{
+    const std::string hilo(TableRegistry::table("hilo", TableType::KeyStruct));
+    auto connection = m_pool.acquire();
+    //! A failed creation leaves the flag unset, the next block tries again.
+    std::call_once(m_created, [&] {
+        connection->run("CREATE TABLE IF NOT EXISTS " + hilo + " (name VARCHAR(100) NOT NULL PRIMARY KEY, next_value BIGINT NOT NULL)");
+    });
+
+    //! The update locks the row until the end of the transaction, so concurrent nodes get disjoint blocks.
+    const SqlParams params {std::to_string(size), std::string(table)};
+    for (int attempt = 0;; ++attempt) {
+        connection->run("BEGIN");
+        try {
+            if (connection->execute("UPDATE " + hilo + " SET next_value = next_value + ? WHERE name = ?", params).affectedRows == 0) {
+                const u64 stored = numberOf(connection->run("SELECT MAX(id) FROM " + std::string(table)));
+                connection->execute("INSERT INTO " + hilo + " (name, next_value) VALUES (?, ?)",
+                                    {std::string(table), std::to_string(stored + 1 + size)});
+            }
+            const u64 next = numberOf(connection->execute("SELECT next_value FROM " + hilo + " WHERE name = ?", {std::string(table)}));
+            connection->run("COMMIT");
+            return {next - size, size};
+        } catch (...) {
+            if (!connection->broken()) {
+                try {
+                    connection->run("ROLLBACK");
+                } catch (...) {
+                    //! The original error is the one that matters.
+                }
+            }
+            //! Two nodes may create the row of a new table at once, the one that lost retries the update.
+            if (attempt > 0 || connection->broken()) throw;
+        }
+    }
+}
+
+TEGRA_NAMESPACE_END
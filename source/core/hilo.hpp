@@ -0,0 +1,100 @@
+/*!
+ * MIT License
+ *
+ * Copyright (c) 2022 Kambiz Asadzadeh
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef TEGRA_HILO_HPP
+#define TEGRA_HILO_HPP
+
+#include "connectionpool.hpp"
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+/*!
+ * @brief The IdRange struct is a block of reserved ids, [first, first + count).
+ */
+struct IdRange final
+{
+    u64 first {};
+    u64 count {};
+
+    __tegra_no_discard u64 last() const __tegra_noexcept;
+    __tegra_no_discard bool empty() const __tegra_noexcept;
+};
+
+/*!
+ * @brief The HiLoAllocator class hands out ids from blocks that are reserved on the server.
+ * A block costs one short transaction on the hilo table and then serves blockSize ids from memory,
+ * so a node can build linked rows (a key row and its value rows) before anything is inserted
+ * and load them together in one batch. Nodes never share a block, so ids stay unique across nodes.
+ * The first block of a table starts after the largest id that is already stored.
+ * Each table has its own lock, a table that waits for the server never blocks the ids of other tables.
+ * Rows of a table that use the allocator should not rely on the identity of the database at the same time.
+ * @example
+ * HiLoAllocator ids(pool);
+ * const u64 id = ids.next("menu");      // use it for menu and menu_l rows
+ */
+class HiLoAllocator final
+{
+public:
+    /*!
+     * @param pool to reserve blocks with.
+     * @param blockSize is the number of ids of one block.
+     */
+    explicit HiLoAllocator(ConnectionPool& pool, u64 blockSize = 100);
+    HiLoAllocator(const HiLoAllocator& rhsAllocator) = delete;
+    HiLoAllocator& operator=(const HiLoAllocator& rhsAllocator) = delete;
+
+    /*!
+     * @brief next function gets a new id of a table.
+     * @param table is the key table without prefix.
+     */
+    __tegra_no_discard u64 next(std::string_view table);
+
+    /*!
+     * @brief reserve function gets a range of consecutive ids of a table.
+     * @param table is the key table without prefix.
+     * @param count is the number of ids, a range that does not fit into the current block gets a block of its own.
+     */
+    __tegra_no_discard IdRange reserve(std::string_view table, u64 count);
+
+    __tegra_no_discard u64 blockSize() const __tegra_noexcept;
+
+private:
+    struct Sequence final
+    {
+        std::mutex  mutex   {};     ///<Held while the block of the table is refilled.
+        IdRange     block   {};
+    };
+
+    IdRange fetchBlock(std::string_view table, u64 size);
+
+    ConnectionPool&                                     m_pool;
+    u64                                                 m_blockSize {};
+    std::mutex                                          m_mutex     {};     ///<Guards the map only, never a round trip.
+    std::unordered_map<std::string_view, Sequence>      m_sequences {};     ///<Keys are interned table names, elements never move.
+    std::once_flag                                      m_created   {};     ///<The hilo table exists.
+};
+
+TEGRA_NAMESPACE_END
+
+#endif  // TEGRA_HILO_HPP
@@ -3,45 +3,104 @@
 
 TEGRA_NAMESPACE_BEGIN(Tegra::CMS)
 
+TEGRA_ANONYMOUS_NAMESPACE_BEGIN
+
+//! Size hint of the fixed markup around the values of a tag.
+constexpr std::size_t MarkupHint = 96;
+
+std::size_t sizeOf(const std::vector<std::string>& list) __tegra_noexcept
+{
+    std::size_t size = 0;
+    for (const auto& item : list) {
+        size += item.size();
+    }
+    return size;
+}
+
+TEGRA_NAMESPACE_END
+
 std::string Html::ParamValue(const std::string& s, slf8 mode,
                              const std::string& ch) __tegra_noexcept_expr(true)
 {
-    std::string str = s;
-    if (mode == 1)
-        str = Engine::htmlEntityDecode(str);
-    if (mode == 2)
-        for (int i = 0; i < str.length(); ++i) {
-            if (str[i] == '<') {
-                str[i] += '&lt;';
-            } else if (str[i] == '>') {
-                str[i] += '&gt;';
+    std::string res;
+    Tegra::Text output(res, s.size());
+    ParamValue(output, s, mode, ch);
+    return res;
+}
+
+void Html::ParamValue(Tegra::Text& output, const std::string& s, slf8 mode,
+                      const std::string& ch) __tegra_noexcept_expr(true)
+{
+    if (mode == 1) {
+        output.append(Engine::htmlEntityDecode(s));
+    } else if (mode == 2) {
+        //! Clean runs are copied at once, only < and > are replaced.
+        std::size_t copied = 0;
+        for (std::size_t i = 0; i < s.size(); ++i) {
+            if (s[i] == '<' || s[i] == '>') {
+                output.append(std::string_view(s).substr(copied, i - copied));
+                output.append(s[i] == '<' ? "&lt;" : "&gt;");
+                copied = i + 1;
             }
         }
-    return str;
+        output.append(std::string_view(s).substr(copied));
+    } else {
+        output.append(s);
+    }
 }
 
 std::string Html::TagParams(const std::vector<std::string>& a) __tegra_noexcept_expr(true)
 {
-    std::string params = "";
+    std::string params;
+    Tegra::Text output(params, sizeOf(a));
+    TagParams(output, a);
+    return params;
+}
+
+void Html::TagParams(Tegra::Text& output, const std::vector<std::string>& a) __tegra_noexcept_expr(true)
+{
     // ToDo... maybe use std::map :)
-    for (int i = 0; i < a.size(); i++) {
-        params += a[i];
+    for (const auto& param : a) {
+        output.append(param);
     }
-
-    return params;
 }
 
 std::string Html::Label(const std::string& value,
                         const std::vector<std::string>& extra) __tegra_noexcept_expr(true)
 {
-    return "<label " + TagParams(extra) + ">" + value + "</label>";
+    std::string res;
+    Tegra::Text output(res);
+    Label(output, value, extra);
+    return res;
+}
+
+void Html::Label(Tegra::Text& output, const std::string& value,
+                 const std::vector<std::string>& extra) __tegra_noexcept_expr(true)
+{
+    output.reserve(output.size() + MarkupHint + value.size() + sizeOf(extra));
+    output.append("<label ");
+    TagParams(output, extra);
+    output.concat(">", value, "</label>");
 }
 
 std::string Html::Text(const std::string& name,
                        const std::string& value,
                        const std::vector<std::string>& extra) __tegra_noexcept_expr(true)
 {
-    return "<p " + TagParams(extra) + "name='" + name + "'>" + value + "</p>";
+    std::string res;
+    Tegra::Text output(res);
+    Text(output, name, value, extra);
+    return res;
+}
+
+void Html::Text(Tegra::Text& output, const std::string& name,
+                const std::string& value,
+                const std::vector<std::string>& extra) __tegra_noexcept_expr(true)
+{
+    output.reserve(output.size() + MarkupHint + name.size() + value.size() + sizeOf(extra));
+    output.append("<p ");
+    TagParams(output, extra);
+    output.concat("name='", name, "'>", value, "</p>");
 }
 
 std::string Html::Input(const std::string& name,
@@ -50,39 +109,93 @@ std::string Html::Input(const std::string& name,
                         const std::string& value,
                         const std::vector<std::string>& extra, slf8 mode = 1) __tegra_noexcept_expr(true)
 {
-    return "<div class=\"form-group\">"
-           "<!-- Label --><label class=\"mb-1\">"+title+"</label>"
-                   "<!-- Form text --><small class=\"form-text text-muted\">"+description+"</small>"
-                         "<!-- Input --><input class=\"form-control\"" + TagParams(extra) + " type='text' value='" +
-           ParamValue(value, mode, "") + "' name='" + name + "'>";
+    std::string res;
+    Tegra::Text output(res);
+    Input(output, name, title, description, value, extra, mode);
+    return res;
+}
+
+void Html::Input(Tegra::Text& output, const std::string& name,
+                 const std::string& title,
+                 const std::string& description,
+                 const std::string& value,
+                 const std::vector<std::string>& extra, slf8 mode = 1) __tegra_noexcept_expr(true)
+{
+    output.reserve(output.size() + MarkupHint * 3 + name.size() + title.size() + description.size() + value.size() + sizeOf(extra));
+    output.concat("<div class=\"form-group\">"
+                  "<!-- Label --><label class=\"mb-1\">", title, "</label>"
+                  "<!-- Form text --><small class=\"form-text text-muted\">", description, "</small>"
+                  "<!-- Input --><input class=\"form-control\"");
+    TagParams(output, extra);
+    output.append(" type='text' value='");
+    ParamValue(output, value, mode, "");
+    output.concat("' name='", name, "'>");
 }
 
 std::string Html::TextArea(const std::string& name,
                            const std::string& value,
                            const std::vector<std::string>& extra, slf8 mode = 1) __tegra_noexcept_expr(true)
 {
-    return "<textarea " + TagParams(extra) +
-           "name=" + name +">" + ParamValue(value, mode, "") +"</textarea>";
+    std::string res;
+    Tegra::Text output(res);
+    TextArea(output, name, value, extra, mode);
+    return res;
+}
+
+void Html::TextArea(Tegra::Text& output, const std::string& name,
+                    const std::string& value,
+                    const std::vector<std::string>& extra, slf8 mode = 1) __tegra_noexcept_expr(true)
+{
+    output.reserve(output.size() + MarkupHint + name.size() + value.size() + sizeOf(extra));
+    output.append("<textarea ");
+    TagParams(output, extra);
+    output.concat("name=", name, ">");
+    ParamValue(output, value, mode, "");
+    output.append("</textarea>");
 }
 
 std::string Html::Check(const std::string& name, bool checked,
                         const std::string& text,
                         const std::vector<std::string>& extra) __tegra_noexcept_expr(true)
 {
-    std::string checkMode = {};
-    if (checked)
-        checkMode = "checked";
-    return "<input " + TagParams(extra) + " type=\"checkbox\" value=1 name=" + name + " " + checkMode + "/>";
+    std::string res;
+    Tegra::Text output(res);
+    Check(output, name, checked, text, extra);
+    return res;
+}
+
+void Html::Check(Tegra::Text& output, const std::string& name, bool checked,
+                 const std::string& text,
+                 const std::vector<std::string>& extra) __tegra_noexcept_expr(true)
+{
+    output.reserve(output.size() + MarkupHint + name.size() + sizeOf(extra));
+    output.append("<input ");
+    TagParams(output, extra);
+    output.concat(" type=\"checkbox\" value=1 name=", name, " ", checked ? "checked" : "", "/>");
 }
 
 std::string Html::Button(const std::string& name,
                          const std::string& value, std::string type,
                          const std::string& text,
                          const std::vector<std::string>& extra) __tegra_noexcept_expr(true)
+{
+    std::string res;
+    Tegra::Text output(res);
+    Button(output, name, value, TEGRA_MOVE(type), text, extra);
+    return res;
+}
+
+void Html::Button(Tegra::Text& output, const std::string& name,
+                  const std::string& value, std::string type,
+                  const std::string& text,
+                  const std::vector<std::string>& extra) __tegra_noexcept_expr(true)
 {
     if (type.empty())
         type = "button";
-    return "<button " + TagParams(extra) + " name=\"" + name + "\" type=" + type + " value=" + value + " > " + std::string(text) + "</button> ";
+    output.reserve(output.size() + MarkupHint + name.size() + value.size() + type.size() + text.size() + sizeOf(extra));
+    output.append("<button ");
+    TagParams(output, extra);
+    output.concat(" name=\"", name, "\" type=", type, " value=", value, " > ", text, "</button> ");
 }
 
 std::string Html::Radio(const std::string& name,
@@ -90,10 +203,21 @@ std::string Html::Radio(const std::string& name,
                         const std::string& text,
                         const std::vector<std::string>& extra) __tegra_noexcept_expr(true)
 {
-    std::string checkMode = {};
-    if (checked)
-        checkMode = "checked";
-    return "<input " + TagParams(extra) + " type=\"radio\" " + checkMode + "/>";
+    std::string res;
+    Tegra::Text output(res);
+    Radio(output, name, value, checked, text, extra);
+    return res;
+}
+
+void Html::Radio(Tegra::Text& output, const std::string& name,
+                 const std::string& value, bool checked,
+                 const std::string& text,
+                 const std::vector<std::string>& extra) __tegra_noexcept_expr(true)
+{
+    output.reserve(output.size() + MarkupHint + sizeOf(extra));
+    output.append("<input ");
+    TagParams(output, extra);
+    output.concat(" type=\"radio\" ", checked ? "checked" : "", "/>");
 }
 
 std::string Html::Option(const std::string& view,
@@ -101,27 +225,46 @@ std::string Html::Option(const std::string& view,
                          const std::string& name,
                          const std::vector<std::string>& extra, slf8 mode) __tegra_noexcept_expr(true)
 {
-    std::string selectedStr {};
-    if (!selected == true) {
-        selectedStr = "";
-    } else {
-        selectedStr = "selected";
-    }
-    return "<option type='text' name=" + name + " " + TagParams(extra) + " value=" + value + " " + selectedStr + ">" + view + "</option>";
+    std::string res;
+    Tegra::Text output(res);
+    Option(output, view, value, selected, name, extra, mode);
+    return res;
+}
+
+void Html::Option(Tegra::Text& output, const std::string& view,
+                  const std::string& value, bool selected,
+                  const std::string& name,
+                  const std::vector<std::string>& extra, slf8 mode) __tegra_noexcept_expr(true)
+{
+    output.reserve(output.size() + MarkupHint + view.size() + value.size() + name.size() + sizeOf(extra));
+    output.concat("<option type='text' name=", name, " ");
+    TagParams(output, extra);
+    output.concat(" value=", value, " ", selected ? "selected" : "", ">", view, "</option>");
 }
 
 std::string Html::Select(const std::string& name,
                          const std::vector<std::string>& options,
                          const std::vector<std::string>& extra) __tegra_noexcept_expr(true)
 {
-    std::string start = "<select type='text' name=" + name + " " + TagParams(extra) + ">";
-    std::string opt {};
-    for (int o = 0; o < options.size(); o++) {
-        opt += options[o];
-    }
-    return start + opt + "</select>";
+    std::string res;
+    Tegra::Text output(res);
+    Select(output, name, options, extra);
+    return res;
 }
 
+void Html::Select(Tegra::Text& output, const std::string& name,
+                  const std::vector<std::string>& options,
+                  const std::vector<std::string>& extra) __tegra_noexcept_expr(true)
+{
+    output.reserve(output.size() + MarkupHint + name.size() + sizeOf(options) + sizeOf(extra));
+    output.concat("<select type='text' name=", name, " ");
+    TagParams(output, extra);
+    output.append(">");
+    for (const auto& option : options) {
+        output.append(option);
+    }
+    output.append("</select>");
+}
 
 std::string Html::Switch(const std::string& name,
                          const std::string& title,
@@ -129,22 +272,35 @@ std::string Html::Switch(const std::string& name,
                          const std::vector<std::string>& options,
                          const std::vector<std::string>& extra) __tegra_noexcept_expr(true)
 {
-    std::string start = "<div class=\"row align-items-center\">"
-                        "<div class=\"col\">"
-                        "<!-- Heading -->"
-                        "<h4 class=\"font-weight-base mb-1\">"+title+"</h4>"
-                                "<!-- Small -->"
-                                "<small class=\"text-muted\">"+description+"</small>"
-                                      "</div>"
-                                      "<div class=\"col-auto\">"
-                                      "<div class=\"form-check form-switch\">"
-                                      "<input class=\"form-check-input\" type='checkbox' name=" + name + " " + TagParams(extra) + ">";
-    std::string opt {};
-    for (int o = 0; o < options.size(); o++)
-    {
-        opt += options[o];
+    std::string res;
+    Tegra::Text output(res);
+    Switch(output, name, title, description, options, extra);
+    return res;
+}
+
+void Html::Switch(Tegra::Text& output, const std::string& name,
+                  const std::string& title,
+                  const std::string& description,
+                  const std::vector<std::string>& options,
+                  const std::vector<std::string>& extra) __tegra_noexcept_expr(true)
+{
+    output.reserve(output.size() + MarkupHint * 4 + name.size() + title.size() + description.size() + sizeOf(options) + sizeOf(extra));
+    output.concat("<div class=\"row align-items-center\">"
+                  "<div class=\"col\">"
+                  "<!-- Heading -->"
+                  "<h4 class=\"font-weight-base mb-1\">", title, "</h4>"
+                  "<!-- Small -->"
+                  "<small class=\"text-muted\">", description, "</small>"
+                  "</div>"
+                  "<div class=\"col-auto\">"
+                  "<div class=\"form-check form-switch\">"
+                  "<input class=\"form-check-input\" type='checkbox' name=", name, " ");
+    TagParams(output, extra);
+    output.append(">");
+    for (const auto& option : options) {
+        output.append(option);
     }
-    return start + opt + "</div></div></div>";
+    output.append("</div></div></div>");
 }
 
 std::string Html::Card(const std::string& name,
@@ -153,34 +309,35 @@ std::string Html::Card(const std::string& name,
                        const std::vector<std::string>& extra,
                        const std::vector<std::string>& item) __tegra_noexcept_expr(true)
 {
-    std::string begin {"<div class=\"card\"><div class=\"card-body\">"};
-
-    std::string header {"<div class=\"card-header\">"
-                       "<!-- Title -->"
-                       "<h4 class=\"card-header-title\">"
-                       +title+
-                       "</h4>"
-                       "<!-- Button -->"
-                       "<button class=\"btn btn-sm btn-white\">"
-                       "Unsubscribe all"
-                       "</button>"
-                       "</div>"};
-
-    std::string content {"<div class=\"card-body\">"};
-
-    std::string listGroupItem {};
+    std::string res;
+    Tegra::Text output(res);
+    Card(output, name, title, options, extra, item);
+    return res;
+}
 
-    for(const auto& i : item) {
-        listGroupItem += "<div class=\"list-group-item\">" + i +"</div>";
+void Html::Card(Tegra::Text& output, const std::string& name,
+                const std::string& title,
+                const std::vector<std::string>& options,
+                const std::vector<std::string>& extra,
+                const std::vector<std::string>& item) __tegra_noexcept_expr(true)
+{
+    constexpr std::string_view listGroupItem {"<div class=\"list-group-item\"></div>"};
+    output.reserve(output.size() + MarkupHint * 4 + title.size() + sizeOf(item) + item.size() * listGroupItem.size());
+    output.concat("<div class=\"card\"><div class=\"card-body\">"
+                  "<div class=\"card-header\">"
+                  "<!-- Title -->"
+                  "<h4 class=\"card-header-title\">", title, "</h4>"
+                  "<!-- Button -->"
+                  "<button class=\"btn btn-sm btn-white\">"
+                  "Unsubscribe all"
+                  "</button>"
+                  "</div>"
+                  "<div class=\"card-body\">"
+                  "<div class=\"list-group list-group-flush my-n3\">");
+    for (const auto& i : item) {
+        output.concat("<div class=\"list-group-item\">", i, "</div>");
     }
-
-    std::string contentItem { "<div class=\"row align-items-center\"></div>"};
-
-    std::string listGroup {"<div class=\"list-group list-group-flush my-n3\">"};
-
-    std::string ending {"</div></div></div>"};
-
-    return begin + header + content + listGroup + listGroupItem + ending;
+    output.append("</div></div></div>");
 }
 
 std::string Html::Table(const std::string& name,
@@ -190,31 +347,39 @@ std::string Html::Table(const std::string& name,
                         const std::vector<std::string>& header,
                         const std::vector<std::string>& item) __tegra_noexcept_expr(true)
 {
-    std::string content{};
-    std::string theader{"<th scope=\"col\">#</th>"};
-    std::string theaderItem{};
-    for(const auto& h : header) {
-        theader+="<th scope=\"col\">"+h+"</th>";
+    std::string res;
+    Tegra::Text output(res);
+    Table(output, name, title, options, extra, header, item);
+    return res;
+}
+
+void Html::Table(Tegra::Text& output, const std::string& name,
+                 const std::string& title,
+                 const VectorString& options,
+                 const std::vector<std::string>& extra,
+                 const std::vector<std::string>& header,
+                 const std::vector<std::string>& item) __tegra_noexcept_expr(true)
+{
+    output.reserve(output.size() + MarkupHint * 4 + sizeOf(header) + header.size() * 24 + sizeOf(item) * 2 + item.size() * 20);
+    output.append("<div class=\"card\"><div class=\"card-body\">"
+                  "<div class=\"table-responsive\" data-list='{\"valueNames\": []}'>"
+                  "<table class=\"table table-sm table-nowrap\">"
+                  "<thead>"
+                  "<tr><th scope=\"col\">#</th>");
+    for (const auto& h : header) {
+        output.concat("<th scope=\"col\">", h, "</th>");
     }
-    for(const auto& i : item) {
-        theaderItem+="<td class=\""+i+"\">"+i+"</td>";
+    output.append("</tr>"
+                  "</thead>"
+                  "<tbody class=\"list\">"
+                  "<tr>"
+                  "<th scope=\"row\">1</th>");
+    for (const auto& i : item) {
+        output.concat("<td class=\"", i, "\">", i, "</td>");
     }
-
-    content = "<div class=\"card\"><div class=\"card-body\">"
-              "<div class=\"table-responsive\" data-list='{\"valueNames\": []}'>"
-              "<table class=\"table table-sm table-nowrap\">"
-              "<thead>"
-              "<tr>"+theader+"</tr>"
-                        "</thead>"
-                        "<tbody class=\"list\">"
-                        "<tr>"
-                        "<th scope=\"row\">1</th>"
-              +theaderItem+
-              "</tr>"
-              "</tbody>"
-              "</table></div></div></div>";
-
-    return content;
+    output.append("</tr>"
+                  "</tbody>"
+                  "</table></div></div></div>");
 }
 
 TEGRA_NAMESPACE_END
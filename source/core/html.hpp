@@ -25,6 +25,7 @@
 #define HTML_HPP
 
 #include "common.hpp"
+#include "text.hpp"
 
 TEGRA_USING_NAMESPACE Tegra::Types;
 
@@ -33,6 +34,7 @@ TEGRA_NAMESPACE_BEGIN(Tegra::CMS)
 /*!
  * \class Html
  * \brief Primitives html library
+ * \details Each generator has an overload that writes into a Tegra::Text sink instead of returning a string.
  */
 class Html
 {
@@ -55,6 +57,8 @@ public:
      */
     __tegra_no_discard static std::string ParamValue(const std::string& s, slf8 mode,
                                                      const std::string& ch) __tegra_noexcept_expr(true);
+    static void ParamValue(Tegra::Text& output, const std::string& s, slf8 mode,
+                           const std::string& ch) __tegra_noexcept_expr(true);
 
     /*!
      * \brief Converting an associative array to tag parameters
@@ -62,6 +66,7 @@ public:
      * parameter value \return string
      */
     __tegra_no_discard static std::string TagParams(const std::vector<std::string>& a) __tegra_noexcept_expr(true);
+    static void TagParams(Tegra::Text& output, const std::vector<std::string>& a) __tegra_noexcept_expr(true);
 
     /*!
      * \brief Easily realign text to components with text alignment classes.
@@ -70,6 +75,8 @@ public:
      */
     __tegra_no_discard static std::string Label(const std::string& value,
                                                 const std::vector<std::string>& extra) __tegra_noexcept_expr(true);
+    static void Label(Tegra::Text& output, const std::string& value,
+                      const std::vector<std::string>& extra) __tegra_noexcept_expr(true);
 
     /*!
      * \brief Easily realign text to components with text alignment classes.
@@ -79,6 +86,9 @@ public:
     __tegra_no_discard static std::string Text(const std::string& name,
                                                const std::string& value,
                                                const std::vector<std::string>& extra) __tegra_noexcept_expr(true);
+    static void Text(Tegra::Text& output, const std::string& name,
+                     const std::string& value,
+                     const std::vector<std::string>& extra) __tegra_noexcept_expr(true);
 
     /*!
      * \brief Generation <input> type defaults to text
@@ -93,6 +103,11 @@ public:
                                                 const std::string& description,
                                                 const std::string& value,
                                                 const std::vector<std::string>& extra, slf8 mode) __tegra_noexcept_expr(true);
+    static void Input(Tegra::Text& output, const std::string& name,
+                      const std::string& title,
+                      const std::string& description,
+                      const std::string& value,
+                      const std::vector<std::string>& extra, slf8 mode) __tegra_noexcept_expr(true);
 
     /*!
      * \brief Generation <textarea> type defaults to rich text
@@ -105,6 +120,9 @@ public:
     __tegra_no_discard static std::string TextArea(const std::string& name,
                                                    const std::string& value,
                                                    const std::vector<std::string>& extra, slf8 mode) __tegra_noexcept_expr(true);
+    static void TextArea(Tegra::Text& output, const std::string& name,
+                         const std::string& value,
+                         const std::vector<std::string>& extra, slf8 mode) __tegra_noexcept_expr(true);
 
     /*!
      * \brief Generation <checkbox> type for select status.
@@ -116,6 +134,9 @@ public:
     __tegra_no_discard static std::string Check(const std::string& name, bool checked,
                                                 const std::string& text,
                                                 const std::vector<std::string>&  extra) __tegra_noexcept_expr(true);
+    static void Check(Tegra::Text& output, const std::string& name, bool checked,
+                      const std::string& text,
+                      const std::vector<std::string>&  extra) __tegra_noexcept_expr(true);
 
     /*!
      * \brief Generation Buttons type.
@@ -129,6 +150,10 @@ public:
                                                  const std::string& value, std::string type,
                                                  const std::string& text,
                                                  const std::vector<std::string>&  extra) __tegra_noexcept_expr(true);
+    static void Button(Tegra::Text& output, const std::string& name,
+                       const std::string& value, std::string type,
+                       const std::string& text,
+                       const std::vector<std::string>&  extra) __tegra_noexcept_expr(true);
 
     /*!
      * \brief Generation of <input type = "radio"/>
@@ -143,6 +168,10 @@ public:
                                                 const std::string& value, bool checked,
                                                 const std::string& text,
                                                 const std::vector<std::string>&  extra) __tegra_noexcept_expr(true);
+    static void Radio(Tegra::Text& output, const std::string& name,
+                      const std::string& value, bool checked,
+                      const std::string& text,
+                      const std::vector<std::string>&  extra) __tegra_noexcept_expr(true);
 
     /*!
      * \brief Generate <option> for Select
@@ -157,6 +186,10 @@ public:
                                                  const std::string& value, bool selected,
                                                  const std::string& name,
                                                  const std::vector<std::string>&  extra, slf8 mode) __tegra_noexcept_expr(true);
+    static void Option(Tegra::Text& output, const std::string& view,
+                       const std::string& value, bool selected,
+                       const std::string& name,
+                       const std::vector<std::string>&  extra, slf8 mode) __tegra_noexcept_expr(true);
 
     /*!
      * \brief Single select <select> generation
@@ -169,6 +202,9 @@ public:
     __tegra_no_discard static std::string Select(const std::string& name,
                                                  const std::vector<std::string>&  options,
                                                  const std::vector<std::string>&  extra) __tegra_noexcept_expr(true);
+    static void Select(Tegra::Text& output, const std::string& name,
+                       const std::vector<std::string>&  options,
+                       const std::vector<std::string>&  extra) __tegra_noexcept_expr(true);
 
 
     __tegra_no_discard static std::string Switch(const std::string& name,
@@ -176,6 +212,11 @@ public:
                                                  const std::string& description,
                                                  const std::vector<std::string>&  options,
                                                  const std::vector<std::string>&  extra) __tegra_noexcept_expr(true);
+    static void Switch(Tegra::Text& output, const std::string& name,
+                       const std::string& title,
+                       const std::string& description,
+                       const std::vector<std::string>&  options,
+                       const std::vector<std::string>&  extra) __tegra_noexcept_expr(true);
 
 
     __tegra_no_discard static std::string Card(const std::string& name,
@@ -183,6 +224,11 @@ public:
                                                const std::vector<std::string>& options,
                                                const std::vector<std::string>& extra,
                                                const std::vector<std::string>& item) __tegra_noexcept_expr(true);
+    static void Card(Tegra::Text& output, const std::string& name,
+                     const std::string& title,
+                     const std::vector<std::string>& options,
+                     const std::vector<std::string>& extra,
+                     const std::vector<std::string>& item) __tegra_noexcept_expr(true);
 
     __tegra_no_discard static std::string Table(const std::string& name,
                                                 const std::string& title,
@@ -190,6 +236,12 @@ public:
                                                 const std::vector<std::string>& extra,
                                                 const std::vector<std::string>& header,
                                                 const std::vector<std::string>& item) __tegra_noexcept_expr(true);
+    static void Table(Tegra::Text& output, const std::string& name,
+                      const std::string& title,
+                      const std::vector<std::string>& options,
+                      const std::vector<std::string>& extra,
+                      const std::vector<std::string>& header,
+                      const std::vector<std::string>& item) __tegra_noexcept_expr(true);
 
 };
 
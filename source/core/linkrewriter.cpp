@@ -0,0 +1,394 @@
+#include "linkrewriter.hpp"
+
+TEGRA_NAMESPACE_BEGIN(Tegra::CMS)
+
+TEGRA_ANONYMOUS_NAMESPACE_BEGIN
+
+//! Attributes that hold a single url in html5.
+const VectorString DefaultAttributes = {"href", "src", "action", "formaction", "poster", "cite", "data", "background"};
+
+//! Elements whose content is raw text and can not contain tags.
+constexpr std::string_view RawTextElements[] = {"script", "style"};
+
+constexpr bool isSpace(char c) __tegra_noexcept
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+constexpr bool isAlpha(char c) __tegra_noexcept
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+constexpr char toLower(char c) __tegra_noexcept
+{
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c | 0x20) : c;
+}
+
+bool equalsIgnoreCase(std::string_view lhs, std::string_view rhs) __tegra_noexcept
+{
+    if (lhs.size() != rhs.size()) return false;
+    for (std::size_t i = 0; i < lhs.size(); ++i) {
+        if (toLower(lhs[i]) != toLower(rhs[i])) return false;
+    }
+    return true;
+}
+
+bool isRawText(std::string_view tag) __tegra_noexcept
+{
+    for (const auto element : RawTextElements) {
+        if (equalsIgnoreCase(tag, element)) return true;
+    }
+    return false;
+}
+
+/*!
+ * @returns position of the closing tag of a raw text element, or the end of the document.
+ */
+std::size_t skipRawText(std::string_view html, std::size_t from, std::string_view tag) __tegra_noexcept
+{
+    for (std::size_t at = html.find("</", from); at != std::string_view::npos; at = html.find("</", at + 2)) {
+        if (equalsIgnoreCase(html.substr(at + 2, tag.size()), tag)) return at;
+    }
+    return html.size();
+}
+
+/*!
+ * @brief Worker threads shared by every batch rewrite of the process, started on the first large batch.
+ */
+class RewritePool final
+{
+public:
+    static RewritePool& shared()
+    {
+        static RewritePool pool;
+        return pool;
+    }
+
+    __tegra_no_discard std::size_t size() const __tegra_noexcept
+    {
+        return m_threads.size();
+    }
+
+    /*!
+     * @brief run function executes the work on the calling thread and on up to helpers workers, then waits for all of them.
+     */
+    void run(std::size_t helpers, const std::function<void()>& work)
+    {
+        std::mutex doneMutex;
+        std::condition_variable doneSignal;
+        std::size_t pending = helpers;
+        {
+            std::lock_guard lock(m_mutex);
+            for (std::size_t i = 0; i < helpers; ++i) {
+                m_tasks.emplace_back([&] {
+                    work();
+                    std::lock_guard doneLock(doneMutex);
+                    if (--pending == 0) doneSignal.notify_one();
+                });
+            }
+        }
+        m_signal.notify_all();
+        work();
+        std::unique_lock lock(doneMutex);
+        doneSignal.wait(lock, [&] { return pending == 0; });
+    }
+
+private:
+    RewritePool()
+    {
+        const std::size_t count = std::max<std::size_t>(std::thread::hardware_concurrency(), 2) - 1;
+        m_threads.reserve(count);
+        for (std::size_t t = 0; t < count; ++t) {
+            m_threads.emplace_back([this] {
+                for (;;) {
+                    std::function<void()> task;
+                    {
+                        std::unique_lock lock(m_mutex);
+                        m_signal.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+                        if (m_tasks.empty()) return;
+                        task = std::move(m_tasks.front());
+                        m_tasks.pop_front();
+                    }
+                    task();
+                }
+            });
+        }
+    }
+
+    ~RewritePool()
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stop = true;
+        }
+        m_signal.notify_all();
+        for (auto& thread : m_threads) thread.join();
+    }
+
+    std::mutex                          m_mutex     {};
+    std::condition_variable             m_signal    {};
+    std::deque<std::function<void()>>   m_tasks     {};
+    std::vector<std::thread>            m_threads   {};
+    bool                                m_stop      {};
+};
+
+TEGRA_NAMESPACE_END
+
+LinkRewriter::LinkRewriter(const MapString& rules, const VectorString& attributes)
+{
+    for (const auto& attribute : attributes.empty() ? DefaultAttributes : attributes) {
+        std::string name;
+        name.reserve(attribute.size());
+        for (const char c : attribute) name.push_back(toLower(c));
+        m_attributes.push_back(std::move(name));
+    }
+
+    //! Alphabet, only bytes that are used inside the prefixes get their own class.
+    m_width = 1;
+    std::size_t totalBytes = 0;
+    for (const auto& [prefix, replacement] : rules) {
+        totalBytes += prefix.size();
+        for (const unsigned char c : prefix) {
+            if (m_byteClass[c] == 0) {
+                m_byteClass[c] = static_cast<u16>(m_width++);
+            }
+        }
+    }
+
+    m_next.assign((totalBytes + 1) * m_width, NoState);
+    m_rule.assign(totalBytes + 1, 0);
+    m_replacements.reserve(rules.size());
+    u32 states = 1;
+    for (const auto& [prefix, replacement] : rules) {
+        if (prefix.empty()) continue;
+        u32 state = 0;
+        for (const unsigned char c : prefix) {
+            auto& next = m_next[state * m_width + m_byteClass[c]];
+            if (next == NoState) {
+                next = states++;
+            }
+            state = next;
+        }
+        m_replacements.push_back(replacement);
+        m_rule[state] = static_cast<u32>(m_replacements.size());
+    }
+    m_next.resize(std::size_t(states) * m_width);
+    m_rule.resize(states);
+}
+
+LinkRewriter::Match LinkRewriter::match(std::string_view value) const __tegra_noexcept
+{
+    Match result {};
+    u32 state = 0;
+    for (std::size_t i = 0; i < value.size(); ++i) {
+        const u16 cls = m_byteClass[static_cast<unsigned char>(value[i])];
+        if (cls == 0) break;
+        state = m_next[state * m_width + cls];
+        if (state == NoState) break;
+        if (m_rule[state] != 0) {
+            result = {i + 1, m_rule[state]};
+        }
+    }
+    return result;
+}
+
+bool LinkRewriter::isLinkAttribute(std::string_view name) const __tegra_noexcept
+{
+    for (const auto& attribute : m_attributes) {
+        if (equalsIgnoreCase(name, attribute)) return true;
+    }
+    return false;
+}
+
+std::string LinkRewriter::rewrite(std::string_view html) const
+{
+    std::string output;
+    rewrite(html, output);
+    return output;
+}
+
+bool LinkRewriter::rewrite(std::string_view html, std::string& output) const
+{
+    output.reserve(output.size() + html.size());
+    if (m_replacements.empty()) {
+        output.append(html);
+        return false;
+    }
+
+    const char* const data = html.data();
+    const std::size_t size = html.size();
+    std::size_t copied = 0;
+    std::size_t i = 0;
+    bool changed = false;
+    while (i < size) {
+        const void* hit = std::memchr(data + i, '<', size - i);
+        if (hit == nullptr) break;
+        i = static_cast<std::size_t>(static_cast<const char*>(hit) - data);
+
+        if (html.compare(i, 4, "<!--") == 0) {
+            const std::size_t end = html.find("-->", i + 4);
+            i = end == std::string_view::npos ? size : end + 3;
+            continue;
+        }
+        //! Closing tags, doctype and processing instructions have no links.
+        if (++i >= size || !isAlpha(data[i])) continue;
+
+        const std::size_t tagStart = i;
+        while (i < size && !isSpace(data[i]) && data[i] != '>' && data[i] != '/') ++i;
+        const std::string_view tag = html.substr(tagStart, i - tagStart);
+
+        //! Attributes: name, name=value, name="value" or name='value'.
+        while (i < size) {
+            while (i < size && (isSpace(data[i]) || data[i] == '/')) ++i;
+            if (i >= size || data[i] == '>') break;
+
+            const std::size_t nameStart = i;
+            while (i < size && !isSpace(data[i]) && data[i] != '=' && data[i] != '>' && data[i] != '/') ++i;
+            if (i == nameStart) {
+                ++i;
+                continue;
+            }
+            const std::string_view name = html.substr(nameStart, i - nameStart);
+
+            std::size_t equal = i;
+            while (equal < size && isSpace(data[equal])) ++equal;
+            if (equal >= size || data[equal] != '=') {
+                i = equal;
+                continue;
+            }
+            i = equal + 1;
+            while (i < size && isSpace(data[i])) ++i;
+
+            std::size_t valueStart = i;
+            std::size_t valueEnd = i;
+            if (i < size && (data[i] == '"' || data[i] == '\'')) {
+                valueStart = i + 1;
+                const std::size_t close = html.find(data[i], valueStart);
+                valueEnd = close == std::string_view::npos ? size : close;
+                i = close == std::string_view::npos ? size : close + 1;
+            } else {
+                while (i < size && !isSpace(data[i]) && data[i] != '>') ++i;
+                valueEnd = i;
+            }
+
+            if (!isLinkAttribute(name)) continue;
+            if (const Match found = match(html.substr(valueStart, valueEnd - valueStart)); found.rule != 0) {
+                output.append(data + copied, valueStart - copied);
+                output.append(m_replacements[found.rule - 1]);
+                copied = valueStart + found.size;
+                changed = true;
+            }
+        }
+        if (i < size) ++i;
+        if (isRawText(tag)) {
+            i = skipRawText(html, i, tag);
+        }
+    }
+    output.append(data + copied, size - copied);
+    return changed;
+}
+
+std::size_t LinkRewriter::rewriteAll(std::vector<std::string>& documents, std::size_t workers) const
+{
+    std::size_t bytes = 0;
+    for (const auto& document : documents) bytes += document.size();
+    if (bytes < ParallelThreshold) {
+        workers = 1;
+    } else if (workers == 0) {
+        workers = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+    }
+    workers = std::min(workers, documents.size());
+
+    std::atomic<std::size_t> nextDocument {0};
+    std::atomic<std::size_t> changed {0};
+    std::exception_ptr failure {};
+    std::mutex failureMutex;
+
+    //! Each worker pulls the next document, so large and small pages are balanced between threads.
+    const auto work = [&]() {
+        std::string output;
+        try {
+            for (std::size_t index = nextDocument++; index < documents.size(); index = nextDocument++) {
+                output.clear();
+                if (rewrite(documents[index], output)) {
+                    documents[index].swap(output);
+                    ++changed;
+                }
+            }
+        } catch (...) {
+            std::lock_guard lock(failureMutex);
+            if (!failure) failure = std::current_exception();
+            nextDocument = documents.size();
+        }
+    };
+
+    if (workers > 1) {
+        auto& pool = RewritePool::shared();
+        pool.run(std::min(workers - 1, pool.size()), work);
+    } else {
+        work();
+    }
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+    return changed;
+}
+
+std::size_t LinkRewriter::ruleCount() const __tegra_noexcept
+{
+    return m_replacements.size();
+}
+
+Ref<const LinkRewriter> LinkRewriter::cached(const MapString& rules)
+{
+    static std::shared_mutex mutex;
+    static std::map<MapString, Ref<const LinkRewriter>> cache;
+    static std::deque<MapString> order;
+
+    {
+        std::shared_lock lock(mutex);
+        if (const auto it = cache.find(rules); it != cache.end()) {
+            return it->second;
+        }
+    }
+
+    //! Built outside of the lock, two racing threads may both build but only one is kept.
+    Ref<const LinkRewriter> rewriter = CreateRef<const LinkRewriter>(rules);
+    std::unique_lock lock(mutex);
+    const auto [it, inserted] = cache.try_emplace(rules, rewriter);
+    Ref<const LinkRewriter> result = it->second;
+    if (inserted) {
+        order.push_back(rules);
+        while (order.size() > CacheCapacity) {
+            cache.erase(order.front());
+            order.pop_front();
+        }
+    }
+    return result;
+}
+
+std::string LinkRewriter::normalize(std::string_view uri)
+{
+    std::string output;
+    output.reserve(uri.size());
+    for (const char c : uri) {
+        const unsigned char byte = static_cast<unsigned char>(c);
+        if (c == ' ' || c == '_' || c == '+' || c == '\t') {
+            //! Separators become a single dash, never at the start of a segment.
+            if (!output.empty() && output.back() != '-' && output.back() != '/') output.push_back('-');
+        } else if (std::strchr("[](){}<>\"'`|\\^", c) != nullptr) {
+            continue;
+        } else if (c == '/' && !output.empty() && output.back() == '-') {
+            output.back() = '/';
+        } else if (c == '-' && !output.empty() && output.back() == '-') {
+            continue;
+        } else if (byte >= 0x20) {
+            output.push_back(c);
+        }
+    }
+    while (!output.empty() && output.back() == '-') output.pop_back();
+    return output;
+}
+
+TEGRA_NAMESPACE_END
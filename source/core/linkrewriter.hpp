@@ -0,0 +1,138 @@
+/*!
+ * MIT License
+ *
+ * Copyright (c) 2022 Kambiz Asadzadeh
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef TEGRA_LINKREWRITER_HPP
+#define TEGRA_LINKREWRITER_HPP
+
+#include "common.hpp"
+
+TEGRA_USING_NAMESPACE Tegra::Types;
+
+TEGRA_NAMESPACE_BEGIN(Tegra::CMS)
+
+/*!
+ * @brief The LinkRewriter class rewrites the links of html documents with a prefix table.
+ * The rules (old prefix -> new prefix) are compiled once into a trie, then a lightweight
+ * tokenizer walks the document in a single forward pass and only looks at the values of the
+ * link attributes (href, src, action ...). Comments and the raw text of script and style
+ * elements are skipped, everything else is copied to the output in bulk.
+ * ======================================================
+ * ----> The longest matching prefix of a value wins.
+ * ----> Only the prefix is replaced, the rest of the value is kept.
+ * ======================================================
+ * @example LinkRewriter::cached({{"/en/", "/fa/"}})->rewrite(page);
+ */
+class LinkRewriter
+{
+public:
+    /*!
+     * @brief Builds the prefix trie of the rules, empty prefixes are ignored.
+     * @param rules as map of old prefix and new prefix.
+     * @param attributes are names of the attributes that hold links, the default set is used if it's empty.
+     */
+    explicit LinkRewriter(const MapString& rules, const VectorString& attributes = {});
+    LinkRewriter(const LinkRewriter& rhsRewriter) = delete;
+    LinkRewriter(LinkRewriter&& rhsRewriter) noexcept = delete;
+    LinkRewriter& operator=(const LinkRewriter& rhsRewriter) = delete;
+    LinkRewriter& operator=(LinkRewriter&& rhsRewriter) noexcept = delete;
+    ~LinkRewriter() = default;
+
+    /*!
+     * @brief rewrite function rewrites all links of a document.
+     * @param html as raw document.
+     * @returns rewritten document as string.
+     */
+    __tegra_no_discard std::string rewrite(std::string_view html) const;
+
+    /*!
+     * @brief rewrite function appends the rewritten document into the output.
+     * @param html as raw document.
+     * @param output is the buffer that receives the result.
+     * @returns true if at least one link was rewritten.
+     */
+    bool rewrite(std::string_view html, std::string& output) const;
+
+    /*!
+     * @brief rewriteAll function rewrites a batch of documents in place.
+     * Batches smaller than ParallelThreshold bytes are rewritten on the calling thread,
+     * larger ones are shared with the workers of a process wide pool that is started once.
+     * @param documents are the documents that will be rewritten.
+     * @param workers is the number of threads, zero means the number of hardware threads.
+     * @returns number of documents that have been changed.
+     */
+    std::size_t rewriteAll(std::vector<std::string>& documents, std::size_t workers = 0) const;
+
+    /*!
+     * @brief ruleCount function gets number of compiled rules.
+     * @returns as number of rules.
+     */
+    __tegra_no_discard std::size_t ruleCount() const __tegra_noexcept;
+
+    /*!
+     * @brief normalize function fixes the symptoms of a link, as in "[page_one+1]" -> "page-one-1".
+     * @param uri is the raw link.
+     * @returns fixed link as string.
+     */
+    __tegra_no_discard static std::string normalize(std::string_view uri);
+
+    /*!
+     * @brief cached function gets the rewriter of the rules from the shared cache or builds it once.
+     * @param rules as map of old prefix and new prefix, the default link attributes are used.
+     * @returns shared pointer of the compiled rewriter.
+     */
+    __tegra_no_discard static Ref<const LinkRewriter> cached(const MapString& rules);
+
+    /*!
+     * @brief The maximum number of rewriters that are kept inside the shared cache.
+     */
+    __tegra_inline_static std::size_t CacheCapacity = 64;
+
+    /*!
+     * @brief Batches below this number of bytes are not worth waking up other threads.
+     */
+    __tegra_inline_static std::size_t ParallelThreshold = 1024 * 1024;
+
+private:
+    static constexpr u32 NoState = std::numeric_limits<u32>::max();
+
+    struct Match final
+    {
+        std::size_t size {};   ///<Size of the matched prefix.
+        u32         rule {};   ///<Rule index + 1, zero if nothing matched.
+    };
+
+    __tegra_no_discard Match match(std::string_view value) const __tegra_noexcept;
+    __tegra_no_discard bool isLinkAttribute(std::string_view name) const __tegra_noexcept;
+
+    std::array<u16, 256>        m_byteClass     {};   ///<Byte to alphabet class, zero is for bytes that are not used by any prefix.
+    std::size_t                 m_width         {};   ///<Number of alphabet classes.
+    std::vector<u32>            m_next          {};   ///<Transitions [state * width + class].
+    std::vector<u32>            m_rule          {};   ///<Rule index + 1 of the prefix that ends in the state.
+    VectorString                m_replacements  {};
+    VectorString                m_attributes    {};   ///<Lower case names of the link attributes.
+};
+
+TEGRA_NAMESPACE_END
+
+#endif // TEGRA_LINKREWRITER_HPP
@@ -0,0 +1,1204 @@
+#include "memorystore.hpp"
+#include "bulkloader.hpp"
+#include "database.hpp"
+#include "seedfile.hpp"
+#include "tableregistry.hpp"
+#include "core.hpp"
+#include "logger.hpp"
+
+TEGRA_USING_NAMESPACE Tegra;
+TEGRA_USING_NAMESPACE Tegra::CMS;
+TEGRA_USING_NAMESPACE Tegra::eLogger;
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+TEGRA_ANONYMOUS_NAMESPACE_BEGIN
+
+//! Length of a NULL field inside a snapshot record.
+constexpr u32 NullField = 0xFFFFFFFFu;
+
+//! Size and checksum in front of every record.
+constexpr std::size_t FrameHeader = 8;
+
+std::string upper(std::string_view text)
+{
+    std::string result(text);
+    std::transform(result.begin(), result.end(), result.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+    return result;
+}
+
+std::string_view trimmed(std::string_view text) __tegra_noexcept
+{
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front()))) text.remove_prefix(1);
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back()))) text.remove_suffix(1);
+    return text;
+}
+
+std::string_view baseName(std::string_view table) __tegra_noexcept
+{
+    const std::string_view prefix = TableRegistry::prefix();
+    if (!prefix.empty() && table.starts_with(prefix)) table.remove_prefix(prefix.size());
+    return table;
+}
+
+std::string fullName(std::string_view table)
+{
+    return std::string(TableRegistry::table(baseName(table), TableType::MixedStruct));
+}
+
+bool isIntegerType(std::string_view type)
+{
+    const std::string word = upper(type.substr(0, type.find_first_of(" (")));
+    return word == "INT" || word == "INTEGER" || word == "SMALLINT" || word == "BIGINT" || word == "TINYINT"
+        || word == "MEDIUMINT" || word == "SERIAL" || word == "BIGSERIAL" || word == "SMALLSERIAL";
+}
+
+std::string timestamp()
+{
+    const auto now = std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now());
+    const auto day = std::chrono::floor<std::chrono::days>(now);
+    const std::chrono::year_month_day date {day};
+    const std::chrono::hh_mm_ss time {now - day};
+    std::array<char, 32> text {};
+    const int size = std::snprintf(text.data(), text.size(), "%04d-%02u-%02u %02d:%02d:%02d", static_cast<int>(date.year()),
+                                   static_cast<unsigned>(date.month()), static_cast<unsigned>(date.day()),
+                                   static_cast<int>(time.hours().count()), static_cast<int>(time.minutes().count()),
+                                   static_cast<int>(time.seconds().count()));
+    return std::string(text.data(), static_cast<std::size_t>(size));
+}
+
+/*!
+ * @brief Evaluates a default or a seed expression: NULL, a string literal, the current time or a literal as it is.
+ */
+SqlValue evaluate(std::string_view expression)
+{
+    expression = trimmed(expression);
+    const std::string word = upper(expression);
+    if (word == "NULL") {
+        return std::nullopt;
+    }
+    if (word == "NOW()" || word == "CURRENT_TIMESTAMP" || word == "CURRENT_TIMESTAMP()" || word == "LOCALTIMESTAMP") {
+        return timestamp();
+    }
+    if (expression.size() >= 2 && expression.front() == '\'' && expression.back() == '\'') {
+        std::string text;
+        for (std::size_t i = 1; i + 1 < expression.size(); ++i) {
+            text.push_back(expression[i]);
+            if (expression[i] == '\'' && expression[i + 1] == '\'') ++i;
+        }
+        return text;
+    }
+    return std::string(expression);
+}
+
+u32 checksum(std::string_view data) __tegra_noexcept
+{
+    u32 hash = 2166136261u;
+    for (const unsigned char c : data) {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void putU32(std::string& out, u32 value)
+{
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+}
+
+bool getU32(std::string_view in, std::size_t& pos, u32& value) __tegra_noexcept
+{
+    if (in.size() - pos < 4) return false;
+    value = 0;
+    for (int i = 0; i < 4; ++i) value |= static_cast<u32>(static_cast<unsigned char>(in[pos + static_cast<std::size_t>(i)])) << (i * 8);
+    pos += 4;
+    return true;
+}
+
+void putField(std::string& out, const SqlValue& value)
+{
+    putU32(out, value.has_value() ? static_cast<u32>(value->size()) : NullField);
+    if (value.has_value()) out.append(*value);
+}
+
+bool getField(std::string_view in, std::size_t& pos, SqlValue& value)
+{
+    u32 size = 0;
+    if (!getU32(in, pos, size)) return false;
+    if (size == NullField) {
+        value.reset();
+        return true;
+    }
+    if (in.size() - pos < size) return false;
+    value = std::string(in.substr(pos, size));
+    pos += size;
+    return true;
+}
+
+/*!
+ * @brief The StatementReader class walks the statements that MemoryStore::execute understands.
+ * Placeholders take the parameters in order, keywords are not case sensitive.
+ */
+class StatementReader final
+{
+public:
+    StatementReader(std::string_view sql, const SqlParams& params) : m_sql(trimmed(sql)), m_params(params)
+    {
+        while (!m_sql.empty() && m_sql.back() == ';') m_sql = trimmed(m_sql.substr(0, m_sql.size() - 1));
+    }
+
+    bool accept(std::string_view keyword)
+    {
+        skip();
+        const std::size_t size = wordSize();
+        if (size == 0 || upper(m_sql.substr(m_pos, size)) != keyword) return false;
+        m_pos += size;
+        return true;
+    }
+
+    bool accept(char symbol)
+    {
+        skip();
+        if (m_pos >= m_sql.size() || m_sql[m_pos] != symbol) return false;
+        ++m_pos;
+        return true;
+    }
+
+    void expect(std::string_view keyword)
+    {
+        if (!accept(keyword)) fail(std::string(keyword) + " was expected");
+    }
+
+    void expect(char symbol)
+    {
+        if (!accept(symbol)) fail(std::string("'") + symbol + "' was expected");
+    }
+
+    std::string identifier()
+    {
+        skip();
+        const std::size_t size = wordSize();
+        if (size == 0) fail("a name was expected");
+        std::string name(m_sql.substr(m_pos, size));
+        m_pos += size;
+        return name;
+    }
+
+    SqlValue value()
+    {
+        if (accept('?')) {
+            if (m_param >= m_params.size()) fail("there are fewer parameters than placeholders");
+            return m_params[m_param++];
+        }
+        if (accept("NULL")) {
+            return std::nullopt;
+        }
+        if (accept('\'')) {
+            std::string text;
+            while (m_pos < m_sql.size()) {
+                const char c = m_sql[m_pos++];
+                if (c != '\'') {
+                    text.push_back(c);
+                } else if (m_pos < m_sql.size() && m_sql[m_pos] == '\'') {
+                    text.push_back(c);
+                    ++m_pos;
+                } else {
+                    return text;
+                }
+            }
+            fail("a string literal is not closed");
+        }
+        const std::size_t start = m_pos;
+        if (m_pos < m_sql.size() && (m_sql[m_pos] == '-' || m_sql[m_pos] == '+')) ++m_pos;
+        while (m_pos < m_sql.size() && (std::isdigit(static_cast<unsigned char>(m_sql[m_pos])) || m_sql[m_pos] == '.')) ++m_pos;
+        if (m_pos == start || !std::isdigit(static_cast<unsigned char>(m_sql[m_pos - 1]))) fail("a value was expected");
+        return std::string(m_sql.substr(start, m_pos - start));
+    }
+
+    /*!
+     * @brief where function reads an optional "WHERE column = value AND column IS NULL ..." clause.
+     */
+    MemoryFilter where()
+    {
+        MemoryFilter filter;
+        if (!accept("WHERE")) return filter;
+        do {
+            std::string column = identifier();
+            if (accept("IS")) {
+                expect("NULL");
+                filter.emplace_back(std::move(column), std::nullopt);
+                continue;
+            }
+            expect('=');
+            SqlValue compared = value();
+            //! "= NULL" matches no row in SQL, a filter would match the NULL ones.
+            if (!compared.has_value()) fail("a comparison with NULL needs IS NULL");
+            filter.emplace_back(std::move(column), std::move(compared));
+        } while (accept("AND"));
+        return filter;
+    }
+
+    void end()
+    {
+        skip();
+        if (m_pos != m_sql.size()) fail("the rest of the statement is not supported");
+        if (m_param != m_params.size()) fail("there are more parameters than placeholders");
+    }
+
+    [[noreturn]] void fail(const std::string& reason) const
+    {
+        throw Exception(Exception::Reason::Core, "The memory store can not run [" + std::string(m_sql) + "] at "
+                        + std::to_string(m_pos) + ", " + reason + ".");
+    }
+
+private:
+    void skip() __tegra_noexcept
+    {
+        while (m_pos < m_sql.size() && std::isspace(static_cast<unsigned char>(m_sql[m_pos]))) ++m_pos;
+    }
+
+    std::size_t wordSize() const __tegra_noexcept
+    {
+        std::size_t end = m_pos;
+        if (end >= m_sql.size() || !(std::isalpha(static_cast<unsigned char>(m_sql[end])) || m_sql[end] == '_')) return 0;
+        while (end < m_sql.size() && (std::isalnum(static_cast<unsigned char>(m_sql[end])) || m_sql[end] == '_')) ++end;
+        return end - m_pos;
+    }
+
+    std::string_view    m_sql       {};
+    const SqlParams&    m_params;
+    std::size_t         m_pos       {};
+    std::size_t         m_param     {};
+};
+
+TEGRA_NAMESPACE_END
+
+MemoryTable::MemoryTable(MemoryStore& store, std::string name, std::string body, bool open)
+    : m_store(store), m_name(std::move(name)), m_body(std::move(body)), m_open(open)
+{
+    m_columns = MigrationEngine::parse(m_body);
+    for (std::size_t c = 0; c < m_columns.size(); ++c) {
+        m_integer.push_back(isIntegerType(m_columns[c].type));
+        if (m_columns[c].primaryKey) m_primaryKey.push_back(c);
+        if (m_columns[c].identity && !m_identity.has_value()) m_identity = c;
+    }
+    if (m_primaryKey.size() > 1) {
+        m_indexes.push_back(Index {m_primaryKey.front(), MemoryIndex::Ordered});
+    }
+}
+
+u64 MemoryTable::insert(const MapString& values)
+{
+    VectorString names;
+    SqlRow cells;
+    for (const auto& [column, value] : values) {
+        names.push_back(column);
+        cells.emplace_back(value);
+    }
+    return insert(names, cells);
+}
+
+u64 MemoryTable::insert(const VectorString& columns, const SqlRow& values)
+{
+    if (columns.size() != values.size()) {
+        throw Exception(Exception::Reason::Core, "The number of columns and values of an insert into [" + m_name + "] differ.");
+    }
+    u64 id = 0;
+    {
+        std::unique_lock lock(m_mutex);
+        SqlRow row = rowOf(columns, values);
+        check(row);
+        if (!m_primaryKey.empty() && m_primary.contains(primaryKeyOf(row))) {
+            throw Exception(Exception::Reason::Core, "Duplicate key inside the table [" + m_name + "].");
+        }
+        if (m_identity.has_value()) {
+            std::from_chars(row[*m_identity]->data(), row[*m_identity]->data() + row[*m_identity]->size(), id);
+        }
+        m_store.append(MemoryStore::Record::Put, m_name, row);
+        identityOf(row);
+        store(std::move(row));
+        m_generation.fetch_add(1, std::memory_order_release);
+    }
+    m_store.written();
+    return id;
+}
+
+std::vector<SqlRow> MemoryTable::select(const MemoryFilter& where) const
+{
+    std::shared_lock lock(m_mutex);
+    std::vector<SqlRow> rows;
+    for (const RowId id : match(conditionsOf(where))) {
+        rows.push_back(rowAt(id));
+    }
+    return rows;
+}
+
+std::optional<SqlRow> MemoryTable::find(const SqlParams& key) const
+{
+    std::shared_lock lock(m_mutex);
+    if (m_primaryKey.empty() || key.size() != m_primaryKey.size()) {
+        throw Exception(Exception::Reason::Core, "The key does not match the primary key of the table [" + m_name + "].");
+    }
+    SqlRow probe(m_columns.size());
+    for (std::size_t k = 0; k < key.size(); ++k) {
+        probe[m_primaryKey[k]] = canonical(m_primaryKey[k], key[k]);
+    }
+    const auto found = m_primary.find(primaryKeyOf(probe));
+    if (found == m_primary.end()) return std::nullopt;
+    return rowAt(found->second);
+}
+
+std::vector<SqlRow> MemoryTable::range(std::string_view column, const SqlValue& from, const SqlValue& to) const
+{
+    std::shared_lock lock(m_mutex);
+    const std::size_t c = columnOf(column);
+    const auto index = std::find_if(m_indexes.begin(), m_indexes.end(), [c](const Index& i) {
+        return i.column == c && i.kind == MemoryIndex::Ordered;
+    });
+    std::vector<SqlRow> rows;
+    if (index != m_indexes.end()) {
+        //! NULL keys are sorted first and are never inside a range.
+        const auto first = from.has_value() ? index->ordered.lower_bound(indexKeyOf(*index, canonical(c, from)))
+                                            : index->ordered.upper_bound(indexKeyOf(*index, std::nullopt));
+        const auto last = to.has_value() ? index->ordered.upper_bound(indexKeyOf(*index, canonical(c, to))) : index->ordered.end();
+        for (auto it = first; it != last && it != index->ordered.end(); ++it) {
+            rows.push_back(rowAt(it->second));
+        }
+        return rows;
+    }
+    const Index probe {c, MemoryIndex::Ordered};
+    const std::string lower = from.has_value() ? indexKeyOf(probe, canonical(c, from)) : std::string();
+    const std::string upperKey = to.has_value() ? indexKeyOf(probe, canonical(c, to)) : std::string();
+    std::vector<std::pair<std::string, RowId>> keys;
+    for (RowId id = 0; id < m_rows.size(); ++id) {
+        if (!m_live[id] || c >= m_rows[id].size() || !m_rows[id][c].has_value()) continue;
+        std::string key = indexKeyOf(probe, m_rows[id][c]);
+        if ((from.has_value() && key < lower) || (to.has_value() && key > upperKey)) continue;
+        keys.emplace_back(std::move(key), id);
+    }
+    std::stable_sort(keys.begin(), keys.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    for (const auto& [key, id] : keys) {
+        rows.push_back(rowAt(id));
+    }
+    return rows;
+}
+
+u64 MemoryTable::update(const MemoryFilter& where, const MapString& values)
+{
+    u64 affected = 0;
+    {
+        std::unique_lock lock(m_mutex);
+        const std::vector<RowId> ids = match(conditionsOf(where));
+        if (ids.empty() || values.empty()) return 0;
+        std::vector<std::pair<std::size_t, SqlValue>> changes;
+        for (const auto& [column, value] : values) {
+            const std::size_t c = m_open && !column.empty() ? addColumn(column, true) : columnOf(column);
+            changes.emplace_back(c, canonical(c, value));
+        }
+
+        //! Every row is checked before the first one is changed.
+        std::vector<SqlRow> olds;
+        std::vector<SqlRow> news;
+        std::unordered_set<std::string> keys;
+        bool rekeyed = false;
+        for (const RowId id : ids) {
+            SqlRow row = rowAt(id);
+            SqlRow next = row;
+            for (const auto& [c, value] : changes) next[c] = value;
+            check(next);
+            if (!m_primaryKey.empty()) {
+                const std::string key = primaryKeyOf(next);
+                if (key != primaryKeyOf(row)) {
+                    rekeyed = true;
+                    const auto found = m_primary.find(key);
+                    if (found != m_primary.end() && std::find(ids.begin(), ids.end(), found->second) == ids.end()) {
+                        throw Exception(Exception::Reason::Core, "Duplicate key inside the table [" + m_name + "].");
+                    }
+                }
+                if (!keys.insert(key).second) {
+                    throw Exception(Exception::Reason::Core, "Duplicate key inside the table [" + m_name + "].");
+                }
+            }
+            olds.push_back(std::move(row));
+            news.push_back(std::move(next));
+        }
+
+        //! Deletes go first so that keys which move between rows are replayed in the right order.
+        if (rekeyed || m_primaryKey.empty()) {
+            for (const auto& row : olds) m_store.append(MemoryStore::Record::Delete, m_name, row);
+        }
+        for (const auto& row : news) m_store.append(MemoryStore::Record::Put, m_name, row);
+        for (const RowId id : ids) unlink(id);
+        for (std::size_t i = 0; i < ids.size(); ++i) {
+            identityOf(news[i]);
+            m_rows[ids[i]] = std::move(news[i]);
+            link(ids[i]);
+        }
+        affected = ids.size();
+        m_generation.fetch_add(1, std::memory_order_release);
+    }
+    m_store.written();
+    return affected;
+}
+
+u64 MemoryTable::erase(const MemoryFilter& where)
+{
+    u64 affected = 0;
+    {
+        std::unique_lock lock(m_mutex);
+        const std::vector<RowId> ids = match(conditionsOf(where));
+        for (const RowId id : ids) {
+            m_store.append(MemoryStore::Record::Delete, m_name, rowAt(id));
+            release(id);
+        }
+        affected = ids.size();
+        if (affected > 0) m_generation.fetch_add(1, std::memory_order_release);
+    }
+    m_store.written();
+    return affected;
+}
+
+void MemoryTable::createIndex(std::string_view column, MemoryIndex kind)
+{
+    std::unique_lock lock(m_mutex);
+    const std::size_t c = columnOf(column);
+    for (const auto& index : m_indexes) {
+        if (index.column == c && index.kind == kind) return;
+    }
+    Index& index = m_indexes.emplace_back(Index {c, kind});
+    for (RowId id = 0; id < m_rows.size(); ++id) {
+        if (!m_live[id]) continue;
+        std::string key = indexKeyOf(index, c < m_rows[id].size() ? m_rows[id][c] : std::nullopt);
+        if (kind == MemoryIndex::Hash) index.hash.emplace(std::move(key), id);
+        else index.ordered.emplace(std::move(key), id);
+    }
+}
+
+const std::string& MemoryTable::name() const __tegra_noexcept
+{
+    return m_name;
+}
+
+VectorString MemoryTable::columns() const
+{
+    std::shared_lock lock(m_mutex);
+    VectorString names;
+    for (const auto& column : m_columns) names.push_back(column.name);
+    return names;
+}
+
+std::optional<std::size_t> MemoryTable::column(std::string_view name) const
+{
+    std::shared_lock lock(m_mutex);
+    for (std::size_t c = 0; c < m_columns.size(); ++c) {
+        if (m_columns[c].name == name) return c;
+    }
+    return std::nullopt;
+}
+
+std::size_t MemoryTable::size() const
+{
+    std::shared_lock lock(m_mutex);
+    return m_rows.size() - m_free.size();
+}
+
+u64 MemoryTable::generation() const __tegra_noexcept
+{
+    return m_generation.load(std::memory_order_acquire);
+}
+
+MemoryTable::Conditions MemoryTable::conditionsOf(const MemoryFilter& where) const
+{
+    Conditions conditions;
+    conditions.reserve(where.size());
+    for (const auto& [column, value] : where) {
+        const std::size_t c = columnOf(column);
+        conditions.emplace_back(c, canonical(c, value));
+    }
+    return conditions;
+}
+
+std::vector<MemoryTable::RowId> MemoryTable::match(const Conditions& conditions) const
+{
+    const auto matches = [this, &conditions](RowId id) {
+        const SqlRow& row = m_rows[id];
+        return std::all_of(conditions.begin(), conditions.end(), [&row](const auto& condition) {
+            const SqlValue& cell = condition.first < row.size() ? row[condition.first] : SqlValue();
+            return cell == condition.second;
+        });
+    };
+    std::vector<RowId> ids;
+
+    //! Full primary key.
+    const bool keyed = !m_primaryKey.empty() && std::all_of(m_primaryKey.begin(), m_primaryKey.end(), [&conditions](std::size_t c) {
+        return std::any_of(conditions.begin(), conditions.end(), [c](const auto& condition) { return condition.first == c; });
+    });
+    if (keyed) {
+        SqlRow probe(m_columns.size());
+        for (const auto& [c, value] : conditions) probe[c] = value;
+        const auto found = m_primary.find(primaryKeyOf(probe));
+        if (found != m_primary.end() && matches(found->second)) ids.push_back(found->second);
+        return ids;
+    }
+
+    //! A secondary index, then every row.
+    for (const auto& [c, value] : conditions) {
+        for (const auto& index : m_indexes) {
+            if (index.column != c) continue;
+            const std::string key = indexKeyOf(index, value);
+            if (index.kind == MemoryIndex::Hash) {
+                const auto [first, last] = index.hash.equal_range(key);
+                for (auto it = first; it != last; ++it) {
+                    if (matches(it->second)) ids.push_back(it->second);
+                }
+            } else {
+                const auto [first, last] = index.ordered.equal_range(key);
+                for (auto it = first; it != last; ++it) {
+                    if (matches(it->second)) ids.push_back(it->second);
+                }
+            }
+            return ids;
+        }
+    }
+    for (RowId id = 0; id < m_rows.size(); ++id) {
+        if (m_live[id] && matches(id)) ids.push_back(id);
+    }
+    return ids;
+}
+
+std::string MemoryTable::primaryKeyOf(const SqlRow& row) const
+{
+    std::string key;
+    for (const std::size_t c : m_primaryKey) {
+        const SqlValue& value = c < row.size() ? row[c] : SqlValue();
+        if (value.has_value()) {
+            key.append(std::to_string(value->size())).append(":").append(*value);
+        } else {
+            key.push_back('-');
+        }
+    }
+    return key;
+}
+
+std::string MemoryTable::indexKeyOf(const Index& index, const SqlValue& value) const
+{
+    //! NULL first, then integers by value (sign bit flipped, big endian), then text.
+    if (!value.has_value()) {
+        return std::string(1, '\0');
+    }
+    long long number = 0;
+    if (m_integer[index.column] && std::from_chars(value->data(), value->data() + value->size(), number).ec == std::errc()) {
+        const u64 bits = static_cast<u64>(number) ^ (u64(1) << 63);
+        std::string key(1, '\1');
+        for (int shift = 56; shift >= 0; shift -= 8) key.push_back(static_cast<char>((bits >> shift) & 0xFF));
+        return key;
+    }
+    return '\2' + *value;
+}
+
+SqlValue MemoryTable::canonical(std::size_t column, SqlValue value) const
+{
+    if (!value.has_value() || !m_integer[column]) {
+        return value;
+    }
+    const std::string_view text = trimmed(*value);
+    long long number = 0;
+    const char* begin = text.data() + (text.starts_with('+') ? 1 : 0);
+    const auto [end, error] = std::from_chars(begin, text.data() + text.size(), number);
+    if (error != std::errc() || end != text.data() + text.size()) {
+        throw Exception(Exception::Reason::Core, "The column [" + m_columns[column].name + "] of [" + m_name + "] takes integers, not [" + *value + "].");
+    }
+    return std::to_string(number);
+}
+
+std::size_t MemoryTable::columnOf(std::string_view name) const
+{
+    for (std::size_t c = 0; c < m_columns.size(); ++c) {
+        if (m_columns[c].name == name) return c;
+    }
+    throw Exception(Exception::Reason::Core, "There is no column [" + std::string(name) + "] inside the table [" + m_name + "].");
+}
+
+SqlRow MemoryTable::rowOf(const VectorString& columns, const SqlRow& values)
+{
+    std::vector<std::size_t> targets;
+    targets.reserve(columns.size());
+    for (const auto& column : columns) {
+        targets.push_back(m_open && !column.empty() ? addColumn(column, true) : columnOf(column));
+    }
+    SqlRow row(m_columns.size());
+    for (std::size_t c = 0; c < m_columns.size(); ++c) {
+        //! "GENERATED BY DEFAULT AS IDENTITY" is not a default value.
+        if (m_columns[c].defaultValue.has_value() && !m_columns[c].identity) row[c] = evaluate(*m_columns[c].defaultValue);
+    }
+    for (std::size_t i = 0; i < targets.size(); ++i) {
+        row[targets[i]] = canonical(targets[i], values[i]);
+    }
+    if (m_identity.has_value() && !row[*m_identity].has_value()) {
+        row[*m_identity] = std::to_string(m_nextId);
+    }
+    return row;
+}
+
+SqlRow MemoryTable::rowAt(RowId id) const
+{
+    SqlRow row = m_rows[id];
+    row.resize(m_columns.size());
+    return row;
+}
+
+std::size_t MemoryTable::addColumn(std::string_view name, bool log)
+{
+    for (std::size_t c = 0; c < m_columns.size(); ++c) {
+        if (m_columns[c].name == name) return c;
+    }
+    if (log) m_store.append(MemoryStore::Record::Column, m_name, {std::string(name)});
+    ColumnDefinition& column = m_columns.emplace_back();
+    column.name = std::string(name);
+    column.type = "TEXT";
+    m_integer.push_back(false);
+    return m_columns.size() - 1;
+}
+
+void MemoryTable::check(const SqlRow& row) const
+{
+    for (std::size_t c = 0; c < m_columns.size(); ++c) {
+        if (m_columns[c].notNull && (c >= row.size() || !row[c].has_value())) {
+            throw Exception(Exception::Reason::Core, "The column [" + m_columns[c].name + "] of [" + m_name + "] can not be NULL.");
+        }
+    }
+}
+
+void MemoryTable::link(RowId id)
+{
+    const SqlRow& row = m_rows[id];
+    if (!m_primaryKey.empty()) {
+        m_primary.insert_or_assign(primaryKeyOf(row), id);
+    }
+    for (auto& index : m_indexes) {
+        std::string key = indexKeyOf(index, index.column < row.size() ? row[index.column] : std::nullopt);
+        if (index.kind == MemoryIndex::Hash) index.hash.emplace(std::move(key), id);
+        else index.ordered.emplace(std::move(key), id);
+    }
+}
+
+void MemoryTable::unlink(RowId id)
+{
+    const SqlRow& row = m_rows[id];
+    if (!m_primaryKey.empty()) {
+        const auto found = m_primary.find(primaryKeyOf(row));
+        if (found != m_primary.end() && found->second == id) m_primary.erase(found);
+    }
+    const auto drop = [id](auto& map, const std::string& key) {
+        const auto [first, last] = map.equal_range(key);
+        for (auto it = first; it != last; ++it) {
+            if (it->second == id) {
+                map.erase(it);
+                return;
+            }
+        }
+    };
+    for (auto& index : m_indexes) {
+        const std::string key = indexKeyOf(index, index.column < row.size() ? row[index.column] : std::nullopt);
+        if (index.kind == MemoryIndex::Hash) drop(index.hash, key);
+        else drop(index.ordered, key);
+    }
+}
+
+MemoryTable::RowId MemoryTable::store(SqlRow row)
+{
+    RowId id = 0;
+    if (!m_free.empty()) {
+        id = m_free.back();
+        m_free.pop_back();
+        m_rows[id] = std::move(row);
+        m_live[id] = true;
+    } else {
+        id = static_cast<RowId>(m_rows.size());
+        m_rows.push_back(std::move(row));
+        m_live.push_back(true);
+    }
+    link(id);
+    return id;
+}
+
+void MemoryTable::release(RowId id)
+{
+    unlink(id);
+    m_rows[id].clear();
+    m_rows[id].shrink_to_fit();
+    m_live[id] = false;
+    m_free.push_back(id);
+}
+
+void MemoryTable::identityOf(const SqlRow& row) __tegra_noexcept
+{
+    if (!m_identity.has_value() || *m_identity >= row.size() || !row[*m_identity].has_value()) return;
+    u64 id = 0;
+    const std::string& text = *row[*m_identity];
+    if (std::from_chars(text.data(), text.data() + text.size(), id).ec == std::errc()) {
+        m_nextId = std::max(m_nextId, id + 1);
+    }
+}
+
+void MemoryTable::put(SqlRow row, bool log)
+{
+    std::unique_lock lock(m_mutex);
+    row.resize(m_columns.size());
+    check(row);
+    if (log) m_store.append(MemoryStore::Record::Put, m_name, row);
+    identityOf(row);
+    const auto found = m_primaryKey.empty() ? m_primary.end() : m_primary.find(primaryKeyOf(row));
+    if (found != m_primary.end()) {
+        const RowId id = found->second;
+        unlink(id);
+        m_rows[id] = std::move(row);
+        link(id);
+    } else {
+        store(std::move(row));
+    }
+    m_generation.fetch_add(1, std::memory_order_release);
+}
+
+void MemoryTable::remove(const SqlRow& image)
+{
+    std::unique_lock lock(m_mutex);
+    if (!m_primaryKey.empty()) {
+        const auto found = m_primary.find(primaryKeyOf(image));
+        if (found != m_primary.end()) release(found->second);
+    } else {
+        for (RowId id = 0; id < m_rows.size(); ++id) {
+            if (m_live[id] && rowAt(id) == image) {
+                release(id);
+                break;
+            }
+        }
+    }
+    m_generation.fetch_add(1, std::memory_order_release);
+}
+
+MemoryStore::MemoryStore(const MemoryStoreOptions& options) : m_options(options)
+{
+    if (m_options.snapshot.empty()) {
+        return;
+    }
+    if (m_options.snapshot.has_parent_path()) {
+        std::filesystem::create_directories(m_options.snapshot.parent_path());
+    }
+    replay();
+    m_file.open(m_options.snapshot, std::ios::binary | std::ios::app);
+    if (!m_file.is_open()) {
+        throw Exception(Exception::Reason::IO, "The snapshot [" + m_options.snapshot.string() + "] can not be opened.");
+    }
+    written();
+}
+
+MemoryStore::~MemoryStore()
+{
+    if (m_file.is_open()) m_file.flush();
+}
+
+MemoryTable& MemoryStore::create(std::string_view table, std::string_view body)
+{
+    return create(fullName(table), std::string(body), false);
+}
+
+MemoryTable& MemoryStore::create(std::string name, std::string body, bool open)
+{
+    std::unique_lock lock(m_tablesMutex);
+    const auto found = m_tables.find(name);
+    if (found != m_tables.end()) {
+        return *found->second;
+    }
+    append(Record::Create, name, {body, open ? SqlValue("1") : SqlValue("")});
+    auto table = CreateScope<MemoryTable>(*this, name, std::move(body), open);
+    return *m_tables.emplace(std::move(name), std::move(table)).first->second;
+}
+
+void MemoryStore::addFromFile(const std::string& path, std::string_view rdbms)
+{
+    VectorString created;
+    for (const auto& entry : SeedFile::section(SeedFile::read(path), "create", rdbms)) {
+        const std::string name = fullName(entry.table);
+        if (find(name) == nullptr) {
+            create(name, entry.content, false);
+            created.push_back(name);
+        }
+    }
+    //! Default tables without a definition get only their key.
+    const std::string_view suffix = CONFIG::CMS_TABLES_VALUE_STRUCT;
+    for (const auto& table : Constants::defaultTables) {
+        const std::string name = fullName(table);
+        if (find(name) != nullptr) continue;
+        const bool value = table.ends_with(suffix);
+        create(name, value ? "(id BIGINT NOT NULL, language VARCHAR(25) NOT NULL, PRIMARY KEY (id, language))"
+                           : "(id BIGINT NOT NULL GENERATED BY DEFAULT AS IDENTITY, PRIMARY KEY (id))", true);
+        created.push_back(name);
+    }
+    //! Seeds go only into tables that are new, the others already have their rows from the snapshot.
+    for (const auto& seed : BulkLoader::readSeeds(path, rdbms)) {
+        if (std::find(created.begin(), created.end(), fullName(seed.table)) != created.end()) load(seed);
+    }
+}
+
+void MemoryStore::load(const SeedTable& seed)
+{
+    MemoryTable& target = table(seed.table);
+    for (const auto& cells : seed.rows) {
+        SqlRow values;
+        values.reserve(cells.size());
+        for (const auto& cell : cells) {
+            values.push_back(cell.expression && cell.value.has_value() ? evaluate(*cell.value) : cell.value);
+        }
+        SqlRow row;
+        {
+            std::unique_lock lock(target.m_mutex);
+            row = target.rowOf(seed.columns, values);
+        }
+        target.put(std::move(row), true);
+    }
+    written();
+}
+
+MemoryTable& MemoryStore::table(std::string_view table)
+{
+    if (MemoryTable* found = find(table)) {
+        return *found;
+    }
+    throw Exception(Exception::Reason::Core, "There is no table [" + std::string(table) + "] inside the memory store.");
+}
+
+MemoryTable* MemoryStore::find(std::string_view table)
+{
+    const std::string name = fullName(table);
+    std::shared_lock lock(m_tablesMutex);
+    const auto found = m_tables.find(name);
+    return found != m_tables.end() ? found->second.get() : nullptr;
+}
+
+VectorString MemoryStore::tables() const
+{
+    std::shared_lock lock(m_tablesMutex);
+    VectorString names;
+    for (const auto& [name, table] : m_tables) names.push_back(name);
+    return names;
+}
+
+Ref<const MixedView> MemoryStore::view(std::string_view table, std::string_view language)
+{
+    MemoryTable& keys = this->table(TableRegistry::table(baseName(table), TableType::KeyStruct));
+    MemoryTable* values = find(TableRegistry::table(baseName(table), TableType::ValueSturct));
+
+    std::lock_guard viewLock(m_viewMutex);
+    View& cached = m_views[keys.name() + '\n' + std::string(language)];
+    const u64 keyGeneration = keys.generation();
+    const u64 valueGeneration = values != nullptr ? values->generation() : 0;
+    if (cached.view != nullptr && cached.keyGeneration == keyGeneration && cached.valueGeneration == valueGeneration) {
+        return cached.view;
+    }
+
+    //! Key table first, tables are always locked in the order of their names.
+    std::shared_lock keyLock(keys.m_mutex);
+    std::shared_lock<std::shared_mutex> valueLock;
+    if (values != nullptr) valueLock = std::shared_lock(values->m_mutex);
+
+    const std::size_t keyId = keys.columnOf("id");
+    VectorString columns {"id"};
+    std::vector<std::size_t> keyColumns;
+    std::vector<std::size_t> valueColumns;
+    for (std::size_t c = 0; c < keys.m_columns.size(); ++c) {
+        if (c == keyId) continue;
+        columns.push_back(keys.m_columns[c].name);
+        keyColumns.push_back(c);
+    }
+    std::optional<std::size_t> valueId;
+    std::optional<std::size_t> valueLanguage;
+    if (values != nullptr) {
+        valueId = values->columnOf("id");
+        valueLanguage = values->columnOf("language");
+        for (std::size_t c = 0; c < values->m_columns.size(); ++c) {
+            const std::string& name = values->m_columns[c].name;
+            if (name == "language" || std::find(columns.begin(), columns.end(), name) != columns.end()) continue;
+            columns.push_back(name);
+            valueColumns.push_back(c);
+        }
+    }
+
+    std::vector<std::pair<u64, SqlRow>> rows;
+    for (MemoryTable::RowId id = 0; id < keys.m_rows.size(); ++id) {
+        if (!keys.m_live[id]) continue;
+        const SqlRow row = keys.rowAt(id);
+        u64 number = 0;
+        if (!row[keyId].has_value() || std::from_chars(row[keyId]->data(), row[keyId]->data() + row[keyId]->size(), number).ec != std::errc()) continue;
+        SqlRow joined {row[keyId]};
+        for (const std::size_t c : keyColumns) joined.push_back(row[c]);
+        if (values != nullptr) {
+            const auto found = values->match({{*valueId, row[keyId]}, {*valueLanguage, SqlValue(std::string(language))}});
+            if (found.empty()) continue;
+            const SqlRow value = values->rowAt(found.front());
+            for (const std::size_t c : valueColumns) joined.push_back(value[c]);
+        }
+        rows.emplace_back(number, std::move(joined));
+    }
+    std::sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    cached = View {CreateRef<const MixedView>(columns, rows), keyGeneration, valueGeneration};
+    return cached.view;
+}
+
+ResultSet MemoryStore::execute(std::string_view sql, const SqlParams& params)
+{
+    StatementReader reader(sql, params);
+    ResultSet result;
+    if (reader.accept("SELECT")) {
+        VectorString columns;
+        if (!reader.accept('*')) {
+            do {
+                columns.push_back(reader.identifier());
+            } while (reader.accept(','));
+        }
+        reader.expect("FROM");
+        MemoryTable& target = table(reader.identifier());
+        const MemoryFilter where = reader.where();
+        reader.end();
+
+        std::vector<std::size_t> picked;
+        for (const auto& column : columns) {
+            const auto index = target.column(column);
+            if (!index.has_value()) reader.fail("there is no column [" + column + "]");
+            picked.push_back(*index);
+        }
+        result.columns = columns.empty() ? target.columns() : std::move(columns);
+        result.rows = target.select(where);
+        if (!picked.empty()) {
+            for (auto& row : result.rows) {
+                SqlRow values;
+                values.reserve(picked.size());
+                for (const std::size_t c : picked) values.push_back(c < row.size() ? std::move(row[c]) : std::nullopt);
+                row = std::move(values);
+            }
+        }
+        return result;
+    }
+    if (reader.accept("INSERT")) {
+        reader.expect("INTO");
+        MemoryTable& target = table(reader.identifier());
+        VectorString columns;
+        reader.expect('(');
+        do {
+            columns.push_back(reader.identifier());
+        } while (reader.accept(','));
+        reader.expect(')');
+        reader.expect("VALUES");
+        reader.expect('(');
+        SqlRow values;
+        for (std::size_t i = 0; i < columns.size(); ++i) {
+            if (i > 0) reader.expect(',');
+            values.push_back(reader.value());
+        }
+        reader.expect(')');
+        reader.end();
+        result.lastInsertId = target.insert(columns, values);
+        result.affectedRows = 1;
+        return result;
+    }
+    if (reader.accept("UPDATE")) {
+        MemoryTable& target = table(reader.identifier());
+        reader.expect("SET");
+        MapString values;
+        do {
+            std::string column = reader.identifier();
+            reader.expect('=');
+            SqlValue value = reader.value();
+            if (!value.has_value()) reader.fail("a column can not be set to NULL");
+            values[std::move(column)] = std::move(*value);
+        } while (reader.accept(','));
+        const MemoryFilter where = reader.where();
+        reader.end();
+        result.affectedRows = target.update(where, values);
+        return result;
+    }
+    if (reader.accept("DELETE")) {
+        reader.expect("FROM");
+        MemoryTable& target = table(reader.identifier());
+        const MemoryFilter where = reader.where();
+        reader.end();
+        result.affectedRows = target.erase(where);
+        return result;
+    }
+    reader.fail("only SELECT, INSERT, UPDATE and DELETE of one table are supported");
+}
+
+void MemoryStore::compact()
+{
+    if (m_options.snapshot.empty()) {
+        return;
+    }
+    //! Writers wait while the file is rewritten, tables are locked in the order of their names like everywhere else.
+    std::shared_lock tablesLock(m_tablesMutex);
+    std::vector<std::shared_lock<std::shared_mutex>> locks;
+    locks.reserve(m_tables.size());
+    for (const auto& [name, table] : m_tables) {
+        locks.emplace_back(table->m_mutex);
+    }
+    std::lock_guard fileLock(m_fileMutex);
+
+    std::filesystem::path temporary = m_options.snapshot;
+    temporary += ".tmp";
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    u64 count = 0;
+    for (const auto& [name, table] : m_tables) {
+        out << encode(Record::Create, name, {table->m_body, table->m_open ? SqlValue("1") : SqlValue("")});
+        ++count;
+        for (std::size_t c = MigrationEngine::parse(table->m_body).size(); c < table->m_columns.size(); ++c) {
+            out << encode(Record::Column, name, {table->m_columns[c].name});
+            ++count;
+        }
+        for (MemoryTable::RowId id = 0; id < table->m_rows.size(); ++id) {
+            if (!table->m_live[id]) continue;
+            out << encode(Record::Put, name, table->rowAt(id));
+            ++count;
+        }
+    }
+    out.flush();
+    if (!out) {
+        throw Exception(Exception::Reason::IO, "The snapshot [" + temporary.string() + "] can not be written.");
+    }
+    out.close();
+    m_file.close();
+    std::error_code error;
+    std::filesystem::rename(temporary, m_options.snapshot, error);
+    //! The old snapshot stays in place when the rename fails, appends go back to it either way.
+    m_file.open(m_options.snapshot, std::ios::binary | std::ios::app);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        throw Exception(Exception::Reason::IO, "The snapshot [" + temporary.string() + "] can not replace [" + m_options.snapshot.string() + "].");
+    }
+    if (!m_file.is_open()) {
+        throw Exception(Exception::Reason::IO, "The snapshot [" + m_options.snapshot.string() + "] can not be reopened after compaction.");
+    }
+    m_records = count;
+    m_compacted = count;
+    if(DeveloperMode::IsEnable) {
+        Log("Memory snapshot [" + m_options.snapshot.string() + "] compacted to " + std::to_string(count) + " records.", LoggerType::Info);
+    }
+}
+
+u64 MemoryStore::records() const
+{
+    std::lock_guard lock(m_fileMutex);
+    return m_records;
+}
+
+void MemoryStore::replay()
+{
+    std::ifstream in(m_options.snapshot, std::ios::binary);
+    if (!in.is_open()) {
+        return;
+    }
+    const std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+
+    m_replaying = true;
+    std::size_t pos = 0;
+    while (data.size() - pos >= FrameHeader) {
+        std::size_t cursor = pos;
+        u32 size = 0;
+        u32 sum = 0;
+        getU32(data, cursor, size);
+        getU32(data, cursor, sum);
+        if (data.size() - cursor < size || checksum(std::string_view(data).substr(cursor, size)) != sum) break;
+        const std::string_view payload = std::string_view(data).substr(cursor, size);
+
+        std::size_t field = 1;
+        SqlValue table;
+        u32 count = 0;
+        SqlRow values;
+        bool valid = !payload.empty() && getField(payload, field, table) && table.has_value() && getU32(payload, field, count);
+        for (u32 i = 0; valid && i < count; ++i) {
+            valid = getField(payload, field, values.emplace_back());
+        }
+        if (!valid) break;
+
+        const auto kind = static_cast<Record>(payload.front());
+        if (kind == Record::Create && values.size() == 2 && values[0].has_value()) {
+            create(*table, *values[0], values[1] == SqlValue("1"));
+        } else if (MemoryTable* target = find(*table)) {
+            if (kind == Record::Put) {
+                target->put(std::move(values), false);
+            } else if (kind == Record::Delete) {
+                target->remove(values);
+            } else if (kind == Record::Column && !values.empty() && values[0].has_value()) {
+                std::unique_lock lock(target->m_mutex);
+                target->addColumn(*values[0], false);
+            }
+        }
+        ++m_records;
+        pos = cursor + size;
+    }
+    m_replaying = false;
+    m_compacted = 0;
+
+    if (pos < data.size()) {
+        //! A record that was cut by a crash, the rows before it are kept.
+        std::filesystem::resize_file(m_options.snapshot, pos);
+        if(DeveloperMode::IsEnable) {
+            Log("Memory snapshot [" + m_options.snapshot.string() + "] had " + std::to_string(data.size() - pos)
+                + " damaged bytes at its end, they were cut off.", LoggerType::Warning);
+        }
+    }
+}
+
+void MemoryStore::append(Record kind, std::string_view table, const SqlRow& values)
+{
+    if (m_replaying || m_options.snapshot.empty()) {
+        return;
+    }
+    const std::string record = encode(kind, table, values);
+    std::lock_guard lock(m_fileMutex);
+    m_file.write(record.data(), static_cast<std::streamsize>(record.size()));
+    if (m_options.syncEveryWrite) m_file.flush();
+    if (!m_file) {
+        throw Exception(Exception::Reason::IO, "The snapshot [" + m_options.snapshot.string() + "] can not be written.");
+    }
+    ++m_records;
+}
+
+void MemoryStore::written()
+{
+    if (m_options.compactAfter == 0 || m_options.snapshot.empty()) {
+        return;
+    }
+    {
+        std::lock_guard lock(m_fileMutex);
+        if (m_records - m_compacted <= m_options.compactAfter) return;
+    }
+    //! The change is applied already, a failed compaction must not look like a failed write.
+    try {
+        compact();
+    } catch (const std::exception& e) {
+        {
+            //! Tried again after the next compactAfter records, not on every write.
+            std::lock_guard lock(m_fileMutex);
+            m_compacted = m_records;
+        }
+        if(DeveloperMode::IsEnable) {
+            Log("Memory snapshot [" + m_options.snapshot.string() + "] could not be compacted: " + std::string(e.what()), LoggerType::Warning);
+        }
+    }
+}
+
+std::string MemoryStore::encode(Record kind, std::string_view table, const SqlRow& values)
+{
+    std::string payload(1, static_cast<char>(kind));
+    putField(payload, std::string(table));
+    putU32(payload, static_cast<u32>(values.size()));
+    for (const auto& value : values) putField(payload, value);
+    std::string record;
+    record.reserve(FrameHeader + payload.size());
+    putU32(record, static_cast<u32>(payload.size()));
+    putU32(record, checksum(payload));
+    record.append(payload);
+    return record;
+}
+
+TEGRA_NAMESPACE_END
@@ -0,0 +1,307 @@
+/*!
+ * MIT License
+ *
+ * Copyright (c) 2022 Kambiz Asadzadeh
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#ifndef TEGRA_MEMORYSTORE_HPP
+#define TEGRA_MEMORYSTORE_HPP
+
+#include "migration.hpp"
+#include "mixedcache.hpp"
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+struct SeedTable;
+class MemoryStore;
+
+//! Equality conditions of a read or a write, std::nullopt matches NULL.
+using MemoryFilter = std::vector<std::pair<std::string, SqlValue>>;
+
+/*!
+ * @brief The MemoryStoreOptions struct holds the snapshot settings of a MemoryStore.
+ */
+struct MemoryStoreOptions final
+{
+    std::filesystem::path   snapshot        {};         ///<Append only file of the changes, empty keeps the store in memory only.
+    bool                    syncEveryWrite  {false};    ///<Flush the file after every change instead of leaving it to the stream buffer.
+    u64                     compactAfter    {100000};   ///<Records appended since the last compaction after which compact runs by itself, zero never.
+};
+
+/*!
+ * @brief The kind of a secondary index of a MemoryTable.
+ */
+enum class MemoryIndex : u8
+{
+    Hash,       ///<Equality lookups.
+    Ordered     ///<Equality and range lookups, integer columns are ordered by value.
+};
+
+/*!
+ * @brief The MemoryTable class is a table of the embedded store, rows are kept in text form like the drivers return them.
+ * The primary key is a hash index, a composite key gets an ordered index on its first column as well
+ * so that a value table can be read by id for all languages.
+ * Tables that are created from a definition check NOT NULL, integer types and duplicate keys,
+ * tables without a definition take new columns on first write.
+ */
+class MemoryTable final
+{
+public:
+    MemoryTable(MemoryStore& store, std::string name, std::string body, bool open);
+    MemoryTable(const MemoryTable& rhsTable) = delete;
+    MemoryTable& operator=(const MemoryTable& rhsTable) = delete;
+
+    /*!
+     * @brief insert function adds a row, missing columns get their defaults.
+     * @returns the id that was generated or given for an identity column, zero if the table has none.
+     */
+    u64 insert(const MapString& values);
+
+    /*!
+     * @brief insert function adds a row of columns and their values in the same order, a NULL value stays NULL.
+     * @returns the id that was generated or given for an identity column, zero if the table has none.
+     */
+    u64 insert(const VectorString& columns, const SqlRow& values);
+
+    /*!
+     * @brief select function gets the rows that match all conditions, in the order of the chosen index.
+     * The primary key is used if it's covered by the filter, then a secondary index, otherwise all rows are scanned.
+     */
+    __tegra_no_discard std::vector<SqlRow> select(const MemoryFilter& where = {}) const;
+
+    /*!
+     * @brief find function gets a row by its full primary key.
+     * @param key are the values of the key columns in the order of the definition.
+     */
+    __tegra_no_discard std::optional<SqlRow> find(const SqlParams& key) const;
+
+    /*!
+     * @brief range function gets the rows whose column is between from and to, both inclusive, in order.
+     * @param from is the lower bound, std::nullopt means no bound.
+     * @param to is the upper bound, std::nullopt means no bound.
+     */
+    __tegra_no_discard std::vector<SqlRow> range(std::string_view column, const SqlValue& from, const SqlValue& to) const;
+
+    /*!
+     * @brief update function changes columns of the rows that match all conditions.
+     * @returns number of affected rows, it throws without a change if a row would break a constraint.
+     */
+    u64 update(const MemoryFilter& where, const MapString& values);
+
+    /*!
+     * @brief erase function deletes the rows that match all conditions.
+     * @returns number of deleted rows.
+     */
+    u64 erase(const MemoryFilter& where);
+
+    /*!
+     * @brief createIndex function adds a secondary index, it's not part of the snapshot.
+     */
+    void createIndex(std::string_view column, MemoryIndex kind = MemoryIndex::Ordered);
+
+    __tegra_no_discard const std::string& name() const __tegra_noexcept;
+    __tegra_no_discard VectorString columns() const;
+    __tegra_no_discard std::optional<std::size_t> column(std::string_view name) const;
+    __tegra_no_discard std::size_t size() const;
+
+    /*!
+     * @brief generation function is bumped by every change, views compare it to know when they are stale.
+     */
+    __tegra_no_discard u64 generation() const __tegra_noexcept;
+
+private:
+    friend class MemoryStore;
+
+    using RowId = u32;
+
+    struct Index final
+    {
+        std::size_t                                     column  {};
+        MemoryIndex                                     kind    {};
+        std::unordered_multimap<std::string, RowId>     hash    {};
+        std::multimap<std::string, RowId>               ordered {};
+    };
+
+    using Conditions = std::vector<std::pair<std::size_t, SqlValue>>;
+
+    __tegra_no_discard Conditions conditionsOf(const MemoryFilter& where) const;
+    __tegra_no_discard std::vector<RowId> match(const Conditions& conditions) const;
+    __tegra_no_discard std::string primaryKeyOf(const SqlRow& row) const;
+    __tegra_no_discard std::string indexKeyOf(const Index& index, const SqlValue& value) const;
+    __tegra_no_discard SqlValue canonical(std::size_t column, SqlValue value) const;
+    __tegra_no_discard std::size_t columnOf(std::string_view name) const;
+    __tegra_no_discard SqlRow rowOf(const VectorString& columns, const SqlRow& values);
+    __tegra_no_discard SqlRow rowAt(RowId id) const;
+
+    std::size_t addColumn(std::string_view name, bool log);
+    void check(const SqlRow& row) const;
+    void link(RowId id);
+    void unlink(RowId id);
+    RowId store(SqlRow row);
+    void release(RowId id);
+    void identityOf(const SqlRow& row) __tegra_noexcept;
+
+    //! Used by the snapshot replay and the seeds, put replaces the row with the same key.
+    void put(SqlRow row, bool log);
+    void remove(const SqlRow& image);
+
+    MemoryStore&                                m_store;
+    std::string                                 m_name          {};
+    std::string                                 m_body          {};     ///<Definition as written, it's part of the snapshot.
+    bool                                        m_open          {};     ///<Columns are added on first write.
+    std::vector<ColumnDefinition>               m_columns       {};
+    std::vector<bool>                           m_integer       {};     ///<Columns of an integer type, by column.
+    std::vector<std::size_t>                    m_primaryKey    {};     ///<Key columns in order.
+    std::optional<std::size_t>                  m_identity      {};
+    u64                                         m_nextId        {1};
+    std::vector<SqlRow>                         m_rows          {};     ///<Short rows read the missing columns as NULL.
+    std::vector<bool>                           m_live          {};
+    std::vector<RowId>                          m_free          {};
+    std::unordered_map<std::string, RowId>      m_primary       {};
+    std::vector<Index>                          m_indexes       {};
+    std::atomic<u64>                            m_generation    {0};
+    mutable std::shared_mutex                   m_mutex         {};
+};
+
+/*!
+ * @brief The MemoryStore class is an embedded storage engine for the default Tegra tables, for StorageType::Cache.
+ * Edge nodes and benchmarks can serve the CMS from it without a database server.
+ * Changes are appended to a snapshot file as checksummed records, the file is replayed on start and
+ * a torn record at its end (a crash during a write) is cut off. compact rewrites the file with the live rows only.
+ * Key tables and their value tables are read like MixedCache does, as MixedView snapshots per language.
+ * @example
+ * MemoryStore store({"storage/memory.snapshot"});
+ * store.addFromFile(std::string(CONFIG::CMS_TABLES_FILE));
+ * store.table("menu_l").update({{"id", "1"}, {"language", "english"}}, {{"title", "Home"}});
+ * auto english = store.view("menu", "english");
+ */
+class MemoryStore final
+{
+public:
+    explicit MemoryStore(const MemoryStoreOptions& options = {});
+    MemoryStore(const MemoryStore& rhsStore) = delete;
+    MemoryStore& operator=(const MemoryStore& rhsStore) = delete;
+    ~MemoryStore();
+
+    /*!
+     * @brief create function adds a table, an existing table is kept as it is.
+     * @param table is the name with or without prefix.
+     * @param body is the column list of the definition, "(...)".
+     */
+    MemoryTable& create(std::string_view table, std::string_view body);
+
+    /*!
+     * @brief addFromFile function creates the tables of system-tables.json that are missing and loads their seed rows.
+     * The default tables that have no definition for the rdbms get an id key (and language for value tables) and take columns on first write.
+     * @param path of the file.
+     * @param rdbms whose definitions are used, the postgresql ones cover the most tables.
+     */
+    void addFromFile(const std::string& path, std::string_view rdbms = TEGRA_RDBMS::PostgreSQL);
+
+    /*!
+     * @brief load function writes seed rows into a table, rows with an existing key replace it.
+     */
+    void load(const SeedTable& seed);
+
+    /*!
+     * @brief table function gets a table by name with or without prefix.
+     * @returns the table, it throws if there is no such table.
+     */
+    __tegra_no_discard MemoryTable& table(std::string_view table);
+    __tegra_no_discard MemoryTable* find(std::string_view table);
+    __tegra_no_discard VectorString tables() const;
+
+    /*!
+     * @brief view function joins a key table with one language of its value table.
+     * @param table is the key table without prefix, for example "config".
+     * @returns the rows sorted by id, the view is built again only after a change of one of the tables.
+     */
+    __tegra_no_discard Ref<const MixedView> view(std::string_view table, std::string_view language);
+
+    /*!
+     * @brief execute function runs a statement of one table so that the Manager can serve StorageType::Cache.
+     * It understands "SELECT * | columns FROM t", "INSERT INTO t (columns) VALUES (...)", "UPDATE t SET c = v, ..."
+     * and "DELETE FROM t", with an optional "WHERE c = v AND c IS NULL ..." clause.
+     * Values are ? placeholders, string literals, numbers or NULL. Anything else throws.
+     * @returns rows of a select, affected rows and the generated id of an insert otherwise.
+     */
+    ResultSet execute(std::string_view sql, const SqlParams& params = {});
+
+    /*!
+     * @brief compact function rewrites the snapshot with the definitions and the live rows.
+     */
+    void compact();
+
+    /*!
+     * @brief records function gets the number of records inside the snapshot.
+     */
+    __tegra_no_discard u64 records() const;
+
+private:
+    friend class MemoryTable;
+
+    enum class Record : u8
+    {
+        Create  = 1,    ///<Name, body and "open".
+        Put     = 2,    ///<Full row, it replaces the row with the same key.
+        Delete  = 3,    ///<Full row image.
+        Column  = 4     ///<New column of an open table.
+    };
+
+    struct View final
+    {
+        Ref<const MixedView>    view            {};
+        u64                     keyGeneration   {};
+        u64                     valueGeneration {};
+    };
+
+    MemoryTable& create(std::string name, std::string body, bool open);
+    void replay();
+
+    /*!
+     * @brief append function writes a record, the table of the record is locked by the caller.
+     */
+    void append(Record kind, std::string_view table, const SqlRow& values);
+
+    /*!
+     * @brief written function compacts the snapshot when it grew too much, no table may be locked by the caller.
+     * It doesn't throw, a failed compaction is logged and the snapshot keeps growing until the next try.
+     */
+    void written();
+
+    static std::string encode(Record kind, std::string_view table, const SqlRow& values);
+
+    MemoryStoreOptions                                      m_options;
+    mutable std::shared_mutex                               m_tablesMutex   {};
+    std::map<std::string, Scope<MemoryTable>, std::less<>>  m_tables        {};
+    mutable std::mutex                                      m_fileMutex     {};
+    std::ofstream                                           m_file          {};
+    u64                                                     m_records       {};
+    u64                                                     m_compacted     {};     ///<Records of the file right after the last compaction.
+    bool                                                    m_replaying     {};
+    std::mutex                                              m_viewMutex     {};
+    std::map<std::string, View, std::less<>>                m_views         {};
+};
+
+TEGRA_NAMESPACE_END
+
+#endif  // TEGRA_MEMORYSTORE_HPP
@@ -0,0 +1,244 @@
+#include "metrics.hpp"
+
+TEGRA_NAMESPACE_BEGIN(Tegra::CMS)
+
+TEGRA_ANONYMOUS_NAMESPACE_BEGIN
+
+using Clock = std::chrono::steady_clock;
+
+const Clock::time_point ProcessStart = Clock::now();
+
+constexpr u64 NoEpoch = std::numeric_limits<u64>::max();
+
+//! Request attribute that holds the start of the request timer.
+constexpr std::string_view TimerAttribute = "tegra.metrics.start";
+
+/*!
+ * @brief Histogram of one time slot, it's written by a single thread only.
+ * The writer uses plain loads and stores (no read-modify-write), readers may see a slot while it's
+ * being reset and then skip it by checking the epoch again.
+ */
+struct Slot final
+{
+    std::atomic<u64>                                        epoch   {NoEpoch};
+    std::atomic<u64>                                        count   {};
+    std::atomic<u64>                                        bytes   {};
+    std::array<std::atomic<u32>, Metrics::BucketCount>      buckets {};
+};
+
+struct Recorder final
+{
+    std::array<Slot, Metrics::SlotCount> slots {};
+};
+
+struct Registry final
+{
+    std::mutex                              mutex       {};
+    std::vector<std::unique_ptr<Recorder>>  recorders   {};
+    std::vector<Recorder*>                  released    {};   ///<Recorders of finished threads, they are reused by new threads.
+    std::atomic<u64>                        lastLatency {};
+    std::atomic<u64>                        lastBytes   {};
+    std::atomic<std::time_t>                lastStarted {};
+};
+
+Registry& registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+//! The recorder of a thread goes back to the registry when the thread ends, its data stays visible.
+struct Lease final
+{
+    Recorder* recorder {};
+
+    Lease()
+    {
+        auto& r = registry();
+        std::lock_guard lock(r.mutex);
+        if (!r.released.empty()) {
+            recorder = r.released.back();
+            r.released.pop_back();
+        } else {
+            recorder = r.recorders.emplace_back(std::make_unique<Recorder>()).get();
+        }
+    }
+
+    ~Lease()
+    {
+        auto& r = registry();
+        std::lock_guard lock(r.mutex);
+        r.released.push_back(recorder);
+    }
+};
+
+Recorder& localRecorder()
+{
+    thread_local Lease lease;
+    return *lease.recorder;
+}
+
+u64 currentEpoch() __tegra_noexcept
+{
+    const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(Clock::now() - ProcessStart).count();
+    return static_cast<u64>(seconds) / Metrics::SlotSeconds;
+}
+
+template <typename T>
+void bump(std::atomic<T>& value, T amount) __tegra_noexcept
+{
+    value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+TEGRA_NAMESPACE_END
+
+void Metrics::record(std::chrono::microseconds latency, u64 bytes) __tegra_noexcept
+{
+    const u64 micros = static_cast<u64>(std::max<std::chrono::microseconds::rep>(latency.count(), 0));
+    const u64 epoch = currentEpoch();
+    Slot& slot = localRecorder().slots[epoch % SlotCount];
+    if (slot.epoch.load(std::memory_order_relaxed) != epoch) {
+        //! The slot belongs to an older round of the ring, it's cleared before it's reused.
+        slot.epoch.store(NoEpoch, std::memory_order_relaxed);
+        //! Pairs with the fence of summary, a reader that sees a cleared cell sees NoEpoch as well.
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.count.store(0, std::memory_order_relaxed);
+        slot.bytes.store(0, std::memory_order_relaxed);
+        for (auto& bucket : slot.buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        slot.epoch.store(epoch, std::memory_order_release);
+    }
+    bump<u32>(slot.buckets[bucketOf(micros)], 1);
+    bump<u64>(slot.count, 1);
+    bump<u64>(slot.bytes, bytes);
+
+    auto& r = registry();
+    r.lastLatency.store(micros, std::memory_order_relaxed);
+    r.lastBytes.store(bytes, std::memory_order_relaxed);
+    r.lastStarted.store(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now() - latency), std::memory_order_relaxed);
+}
+
+MetricsSummary Metrics::summary(std::chrono::seconds window)
+{
+    const u64 wanted = std::clamp<u64>((static_cast<u64>(std::max<std::chrono::seconds::rep>(window.count(), 0)) + SlotSeconds - 1) / SlotSeconds, 1, SlotCount);
+    const u64 epoch = currentEpoch();
+    const u64 oldest = epoch >= wanted - 1 ? epoch - (wanted - 1) : 0;
+
+    MetricsSummary result;
+    std::array<u64, BucketCount> merged {};
+    {
+        auto& r = registry();
+        std::lock_guard lock(r.mutex);
+        for (const auto& recorder : r.recorders) {
+            for (const Slot& slot : recorder->slots) {
+                const u64 slotEpoch = slot.epoch.load(std::memory_order_acquire);
+                if (slotEpoch == NoEpoch || slotEpoch < oldest || slotEpoch > epoch) continue;
+                std::array<u32, BucketCount> counts;
+                for (std::size_t b = 0; b < BucketCount; ++b) {
+                    counts[b] = slot.buckets[b].load(std::memory_order_relaxed);
+                }
+                const u64 count = slot.count.load(std::memory_order_relaxed);
+                const u64 bytes = slot.bytes.load(std::memory_order_relaxed);
+                //! Keeps the relaxed loads above from moving after the second read of the epoch.
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.epoch.load(std::memory_order_relaxed) != slotEpoch) continue;
+                for (std::size_t b = 0; b < BucketCount; ++b) {
+                    merged[b] += counts[b];
+                }
+                result.count += count;
+                result.bytes += bytes;
+            }
+        }
+    }
+
+    result.window = std::chrono::seconds((epoch - oldest + 1) * SlotSeconds);
+    if (result.count == 0) {
+        return result;
+    }
+    result.meanBytes = result.bytes / result.count;
+
+    //! Counts are read without a lock, so the total of the buckets is used for the ranks.
+    const u64 total = std::accumulate(merged.begin(), merged.end(), u64 {0});
+    const auto rankOf = [total](u32 percent) { return std::max<u64>((total * percent + 99) / 100, 1); };
+    const std::array<std::pair<u64, std::chrono::microseconds*>, 3> ranks {{
+        {rankOf(50), &result.p50}, {rankOf(90), &result.p90}, {rankOf(99), &result.p99}
+    }};
+    u64 seen = 0;
+    std::size_t next = 0;
+    for (std::size_t b = 0; b < BucketCount; ++b) {
+        if (merged[b] == 0) continue;
+        seen += merged[b];
+        while (next < ranks.size() && seen >= ranks[next].first) {
+            *ranks[next++].second = std::chrono::microseconds(upperOf(b));
+        }
+        result.max = std::chrono::microseconds(upperOf(b));
+    }
+    return result;
+}
+
+std::chrono::microseconds Metrics::lastLatency() __tegra_noexcept
+{
+    return std::chrono::microseconds(registry().lastLatency.load(std::memory_order_relaxed));
+}
+
+u64 Metrics::lastBytes() __tegra_noexcept
+{
+    return registry().lastBytes.load(std::memory_order_relaxed);
+}
+
+std::time_t Metrics::lastStartedAt() __tegra_noexcept
+{
+    return registry().lastStarted.load(std::memory_order_relaxed);
+}
+
+void Metrics::attach()
+{
+#ifdef ENABLE_DROGON_MODULE
+    static std::once_flag attached;
+    std::call_once(attached, [] {
+        const std::string key(TimerAttribute);
+        Framework::app().registerPreRoutingAdvice([key](const Framework::HttpRequestPtr& request) {
+            request->attributes()->insert(key, Clock::now());
+        });
+        Framework::app().registerPreSendingAdvice([key](const Framework::HttpRequestPtr& request, const Framework::HttpResponsePtr& response) {
+            const auto& attributes = request->attributes();
+            if (!attributes->find(key)) return;
+            const auto start = attributes->get<Clock::time_point>(key);
+            record(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start), response->getBody().size());
+            attributes->erase(key);
+        });
+    });
+#endif
+}
+
+std::chrono::milliseconds Metrics::uptime() __tegra_noexcept
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - ProcessStart);
+}
+
+RequestTimer::RequestTimer() __tegra_noexcept : m_start(Clock::now())
+{
+}
+
+RequestTimer::~RequestTimer()
+{
+    stop();
+}
+
+std::chrono::microseconds RequestTimer::stop(u64 bytes) __tegra_noexcept
+{
+    const auto latency = elapsed();
+    if (!m_stopped) {
+        m_stopped = true;
+        Metrics::record(latency, bytes);
+    }
+    return latency;
+}
+
+std::chrono::microseconds RequestTimer::elapsed() const __tegra_noexcept
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - m_start);
+}
+
+TEGRA_NAMESPACE_END
@@ -0,0 +1,170 @@
+/*!
+ * MIT License
+ *
+ * Copyright (c) 2022 Kambiz Asadzadeh
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef TEGRA_METRICS_HPP
+#define TEGRA_METRICS_HPP
+
+#include "common.hpp"
+
+TEGRA_USING_NAMESPACE Tegra::Types;
+
+TEGRA_NAMESPACE_BEGIN(Tegra::CMS)
+
+/*!
+ * @brief Latency and size figures of the requests that were finished inside a time window.
+ */
+struct MetricsSummary final
+{
+    u64                         count       {};   ///<Number of requests.
+    std::chrono::microseconds   p50         {};
+    std::chrono::microseconds   p90         {};
+    std::chrono::microseconds   p99         {};
+    std::chrono::microseconds   max         {};
+    u64                         bytes       {};   ///<Total size of the responses.
+    u64                         meanBytes   {};   ///<Average size of a response.
+    std::chrono::seconds        window      {};   ///<The window that was really covered.
+};
+
+/*!
+ * @brief The Metrics class collects the latency and the response size of requests.
+ * Every thread records into its own histograms, so recording is lock-free and never contended.
+ * Latencies are kept in log-linear (HDR-style) buckets with a relative error below 1/16.
+ * The histograms are split in time slots, a summary merges the slots of the asked window.
+ * ======================================================
+ * ----> Slots are SlotSeconds long, the longest window is SlotCount * SlotSeconds.
+ * ----> Values above the highest bucket (about 19 hours) are clamped into it.
+ * ======================================================
+ * @example Metrics::summary(std::chrono::seconds(60)).p99;
+ */
+class Metrics
+{
+public:
+    static constexpr u32            SubBucketBits   = 4;
+    static constexpr u32            SubBuckets      = 1u << SubBucketBits;
+    static constexpr u32            MaxValueBits    = 36;
+    static constexpr std::size_t    BucketCount     = (MaxValueBits - SubBucketBits + 1) * SubBuckets;
+    static constexpr std::size_t    SlotCount       = 60;
+    static constexpr u32            SlotSeconds     = 5;
+
+    /*!
+     * @brief record function adds a finished request to the histogram of the calling thread.
+     * @param latency of the request.
+     * @param bytes is the size of the response.
+     */
+    static void record(std::chrono::microseconds latency, u64 bytes) __tegra_noexcept;
+
+    /*!
+     * @brief summary function merges the histograms of all threads.
+     * @param window is the time span that is summarized, it's rounded up to whole slots.
+     * @returns percentiles and sizes.
+     */
+    __tegra_no_discard static MetricsSummary summary(std::chrono::seconds window = std::chrono::seconds(60));
+
+    /*!
+     * @returns latency of the request that was recorded last.
+     */
+    __tegra_no_discard static std::chrono::microseconds lastLatency() __tegra_noexcept;
+
+    /*!
+     * @returns response size of the request that was recorded last.
+     */
+    __tegra_no_discard static u64 lastBytes() __tegra_noexcept;
+
+    /*!
+     * @returns calendar time when the request that was recorded last has been started, zero if none was recorded.
+     */
+    __tegra_no_discard static std::time_t lastStartedAt() __tegra_noexcept;
+
+    /*!
+     * @brief attach function times every request of the web framework and records it, it's done once per process.
+     * The timer starts before the request is routed and stops when the response is about to be sent.
+     */
+    static void attach();
+
+    /*!
+     * @returns time since the process has been started, measured with the monotonic clock.
+     */
+    __tegra_no_discard static std::chrono::milliseconds uptime() __tegra_noexcept;
+
+    /*!
+     * @brief bucketOf function maps a value to its histogram bucket.
+     */
+    __tegra_no_discard static constexpr std::size_t bucketOf(u64 value) __tegra_noexcept
+    {
+        if (value < SubBuckets) return static_cast<std::size_t>(value);
+        const u32 width = static_cast<u32>(std::bit_width(value));
+        if (width > MaxValueBits) return BucketCount - 1;
+        //! The top SubBucketBits + 1 bits of the value, the leading one selects the power of two.
+        const u32 shift = width - SubBucketBits - 1;
+        return static_cast<std::size_t>(shift * SubBuckets + (value >> shift));
+    }
+
+    /*!
+     * @brief upperOf function gets the highest value of a bucket, it's the value reported for percentiles.
+     */
+    __tegra_no_discard static constexpr u64 upperOf(std::size_t bucket) __tegra_noexcept
+    {
+        if (bucket < SubBuckets * 2) return bucket;
+        const u64 shift = bucket / SubBuckets - 1;
+        const u64 mantissa = bucket % SubBuckets + SubBuckets;
+        return ((mantissa + 1) << shift) - 1;
+    }
+};
+
+/*!
+ * @brief The RequestTimer class measures a request with the monotonic clock and records it into Metrics.
+ * @example RequestTimer timer; ... timer.stop(response.size());
+ */
+class RequestTimer
+{
+public:
+    RequestTimer() __tegra_noexcept;
+    RequestTimer(const RequestTimer& rhsTimer) = delete;
+    RequestTimer& operator=(const RequestTimer& rhsTimer) = delete;
+
+    /*!
+     * @brief A timer that was not stopped is recorded with an unknown (zero) size.
+     */
+    ~RequestTimer();
+
+    /*!
+     * @brief stop function records the request, it's recorded once only.
+     * @param bytes is the size of the response.
+     * @returns latency of the request.
+     */
+    std::chrono::microseconds stop(u64 bytes = 0) __tegra_noexcept;
+
+    /*!
+     * @returns time since the timer has been started.
+     */
+    __tegra_no_discard std::chrono::microseconds elapsed() const __tegra_noexcept;
+
+private:
+    std::chrono::steady_clock::time_point   m_start     {};
+    bool                                    m_stopped   {};
+};
+
+TEGRA_NAMESPACE_END
+
+#endif // TEGRA_METRICS_HPP
@@ -0,0 +1,627 @@
+#include "migration.hpp"
+#include "schemabuilder.hpp"
+#include "seedfile.hpp"
+#include "tableregistry.hpp"
+#include "core.hpp"
+#include "logger.hpp"
+
+TEGRA_USING_NAMESPACE Tegra;
+TEGRA_USING_NAMESPACE Tegra::CMS;
+TEGRA_USING_NAMESPACE Tegra::eLogger;
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+TEGRA_ANONYMOUS_NAMESPACE_BEGIN
+
+enum Phase : std::size_t
+{
+    Expand,     ///<Tables, nullable columns, defaults and wider types.
+    Fill,       ///<Backfills.
+    Contract    ///<Constraints.
+};
+
+std::string upper(std::string_view text)
+{
+    std::string result(text);
+    std::transform(result.begin(), result.end(), result.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+    return result;
+}
+
+std::string lower(std::string_view text)
+{
+    std::string result(text);
+    std::transform(result.begin(), result.end(), result.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return result;
+}
+
+std::string_view trimmed(std::string_view text) __tegra_noexcept
+{
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front()))) text.remove_prefix(1);
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back()))) text.remove_suffix(1);
+    return text;
+}
+
+/*!
+ * @returns the end of a quoted part or a parenthesized group that starts at begin.
+ */
+std::size_t skipGroup(std::string_view text, std::size_t begin) __tegra_noexcept
+{
+    const char open = text[begin];
+    if (open == '(') {
+        int depth = 0;
+        for (std::size_t i = begin; i < text.size(); ++i) {
+            if (text[i] == '\'' || text[i] == '"' || text[i] == '`') {
+                i = skipGroup(text, i) - 1;
+            } else if (text[i] == '(') {
+                ++depth;
+            } else if (text[i] == ')' && --depth == 0) {
+                return i + 1;
+            }
+        }
+        return text.size();
+    }
+    for (std::size_t i = begin + 1; i < text.size(); ++i) {
+        if (text[i] == open) {
+            //! A doubled quote is an escaped quote.
+            if (i + 1 < text.size() && text[i + 1] == open) {
+                ++i;
+                continue;
+            }
+            return i + 1;
+        }
+    }
+    return text.size();
+}
+
+/*!
+ * @brief Splits a column list at the commas that are not inside parentheses or quotes.
+ */
+std::vector<std::string_view> splitItems(std::string_view body)
+{
+    std::vector<std::string_view> items;
+    std::size_t start = 0;
+    for (std::size_t i = 0; i < body.size();) {
+        const char c = body[i];
+        if (c == '(' || c == '\'' || c == '"' || c == '`') {
+            i = skipGroup(body, i);
+        } else if (c == ',') {
+            items.push_back(trimmed(body.substr(start, i - start)));
+            start = ++i;
+        } else {
+            ++i;
+        }
+    }
+    items.push_back(trimmed(body.substr(start)));
+    std::erase_if(items, [](std::string_view item) { return item.empty(); });
+    return items;
+}
+
+/*!
+ * @brief Splits a column clause into words, a word keeps its arguments, for example VARCHAR(50) or NOW().
+ */
+std::vector<std::string_view> splitWords(std::string_view item)
+{
+    std::vector<std::string_view> words;
+    std::size_t i = 0;
+    while (i < item.size()) {
+        if (std::isspace(static_cast<unsigned char>(item[i]))) {
+            ++i;
+            continue;
+        }
+        const std::size_t start = i;
+        if (item[i] == '(' || item[i] == '\'' || item[i] == '"' || item[i] == '`') {
+            i = skipGroup(item, i);
+        } else {
+            while (i < item.size() && !std::isspace(static_cast<unsigned char>(item[i])) && item[i] != '(') ++i;
+            if (i < item.size() && item[i] == '(') i = skipGroup(item, i);
+        }
+        //! A cast like ''::character varying stays one word.
+        while (i + 1 < item.size() && item[i] == ':' && item[i + 1] == ':') {
+            i += 2;
+            while (i < item.size() && !std::isspace(static_cast<unsigned char>(item[i]))) ++i;
+        }
+        words.push_back(item.substr(start, i - start));
+    }
+    return words;
+}
+
+std::string unquoted(std::string_view name)
+{
+    if (name.size() >= 2 && (name.front() == '"' || name.front() == '`') && name.back() == name.front()) {
+        name = name.substr(1, name.size() - 2);
+    }
+    return std::string(name);
+}
+
+/*!
+ * @returns names of the columns of a PRIMARY KEY (...) table constraint.
+ */
+VectorString keyColumns(std::string_view item)
+{
+    VectorString columns;
+    const std::size_t open = item.find('(');
+    const std::size_t close = item.rfind(')');
+    if (open == std::string_view::npos || close == std::string_view::npos || close < open) return columns;
+    for (const auto part : splitItems(item.substr(open + 1, close - open - 1))) {
+        columns.push_back(lower(unquoted(trimmed(part))));
+    }
+    return columns;
+}
+
+bool isConstant(std::string_view expression) __tegra_noexcept
+{
+    expression = trimmed(expression);
+    while (expression.size() >= 2 && expression.front() == '(' && expression.back() == ')') {
+        expression = trimmed(expression.substr(1, expression.size() - 2));
+    }
+    if (expression.empty()) return false;
+    if (expression.front() == '\'') return skipGroup(expression, 0) == expression.size();
+    const std::string word = upper(expression);
+    if (word == "NULL" || word == "TRUE" || word == "FALSE") return true;
+    std::size_t i = (expression.front() == '-' || expression.front() == '+') ? 1 : 0;
+    bool digits = false;
+    for (; i < expression.size(); ++i) {
+        if (std::isdigit(static_cast<unsigned char>(expression[i]))) {
+            digits = true;
+        } else if (expression[i] != '.') {
+            return false;
+        }
+    }
+    return digits;
+}
+
+/*!
+ * @brief Normalizes a default of the definitions or of the catalog, casts, quotes and parentheses are removed.
+ * @returns std::nullopt for no default and for DEFAULT NULL, an empty string literal stays an empty string.
+ */
+std::optional<std::string> normalizedDefault(const std::optional<std::string>& expression)
+{
+    if (!expression.has_value()) return std::nullopt;
+    std::string_view value = trimmed(*expression);
+    while (value.size() >= 2 && value.front() == '(' && value.back() == ')' && skipGroup(value, 0) == value.size()) {
+        value = trimmed(value.substr(1, value.size() - 2));
+    }
+    if (!value.empty() && value.front() == '\'') {
+        const std::size_t end = skipGroup(value, 0);
+        return std::string(value.substr(1, end >= 2 ? end - 2 : 0));
+    }
+    if (const auto cast = value.find("::"); cast != std::string_view::npos) {
+        value = trimmed(value.substr(0, cast));
+    }
+    std::string word = lower(value);
+    if (word.empty() || word == "null") return std::nullopt;
+    if (word == "now()" || word == "current_timestamp()") return "current_timestamp";
+    return word;
+}
+
+/*!
+ * @brief Normalizes a type, the synonyms of the servers get one spelling and display widths of integers are dropped.
+ */
+std::string normalizedType(std::string_view type)
+{
+    std::string compact;
+    for (const char c : type) {
+        if (!std::isspace(static_cast<unsigned char>(c))) compact.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
+    }
+    static const std::array<std::pair<std::string_view, std::string_view>, 14> synonyms {{
+        {"charactervarying", "varchar"}, {"character", "char"}, {"integer", "int"}, {"int4", "int"},
+        {"int2", "smallint"}, {"int8", "bigint"}, {"timestampwithtimezone", "timestamptz"},
+        {"timestampwithouttimezone", "timestamp"}, {"boolean", "bool"}, {"doubleprecision", "float8"},
+        {"real", "float4"}, {"decimal", "numeric"}, {"serial", "int"}, {"bigserial", "bigint"}
+    }};
+    const std::size_t open = compact.find('(');
+    std::string base = compact.substr(0, open);
+    std::string arguments = open == std::string::npos ? std::string() : compact.substr(open);
+    std::string suffix;
+    if (const auto close = arguments.find(')'); close != std::string::npos) {
+        suffix = arguments.substr(close + 1);
+        arguments.erase(close + 1);
+    }
+    for (const auto& [from, to] : synonyms) {
+        if (base == from) {
+            base = std::string(to);
+            break;
+        }
+    }
+    if (base == "int" || base == "smallint" || base == "bigint" || base == "tinyint" || base == "mediumint") {
+        arguments.clear();
+    }
+    return base + arguments + suffix;
+}
+
+std::optional<u64> varcharLength(const std::string& normalized)
+{
+    if (!normalized.starts_with("varchar(") || normalized.back() != ')') return std::nullopt;
+    u64 length = 0;
+    const char* begin = normalized.data() + 8;
+    const char* end = normalized.data() + normalized.size() - 1;
+    const auto [last, error] = std::from_chars(begin, end, length);
+    if (error != std::errc() || last != end) return std::nullopt;
+    return length;
+}
+
+std::string quoted(DriverTypes driver, std::string_view name)
+{
+    const char quote = driver == DriverTypes::MySQL ? '`' : '"';
+    return quote + std::string(name) + quote;
+}
+
+/*!
+ * @brief The column clause of a definition for ADD COLUMN or MODIFY COLUMN.
+ */
+std::string columnClause(DriverTypes driver, const ColumnDefinition& column, bool notNull, bool withDefault)
+{
+    std::string clause = quoted(driver, column.name) + " " + column.type;
+    if (notNull) clause.append(" NOT NULL");
+    if (withDefault && column.defaultValue.has_value()) clause.append(" DEFAULT ").append(*column.defaultValue);
+    return clause;
+}
+
+std::string constraintName(std::string_view table, std::string_view column)
+{
+    //! Identifiers of postgresql are cut at 63 bytes.
+    std::string name = std::string(table) + "_" + std::string(column) + "_not_null";
+    if (name.size() > 63) name.erase(0, name.size() - 63);
+    return name;
+}
+
+bool isLockTimeout(std::string_view message)
+{
+    const std::string text = lower(message);
+    return text.find("lock timeout") != std::string::npos || text.find("lock wait timeout") != std::string::npos;
+}
+
+/*!
+ * @brief LockTimeoutScope restores the session lock timeout of the connection when it leaves the scope.
+ * The connection goes back to the pool afterwards, so it must not keep the timeout of a failed migration.
+ */
+struct LockTimeoutScope final
+{
+    Connection& connection;
+
+    ~LockTimeoutScope()
+    {
+        if (connection.broken()) return;
+        try {
+            if (connection.driver() == DriverTypes::PostgreSQL) {
+                connection.run("RESET lock_timeout");
+            } else if (connection.driver() == DriverTypes::MySQL) {
+                connection.run("SET SESSION lock_wait_timeout = DEFAULT");
+            }
+        } catch (const std::exception& e) {
+            if(DeveloperMode::IsEnable) {
+                Log("The migration could not reset the lock timeout: " + std::string(e.what()), LoggerType::Warning);
+            }
+        }
+    }
+};
+
+TEGRA_NAMESPACE_END
+
+bool MigrationPlan::empty() const __tegra_noexcept
+{
+    return steps.empty();
+}
+
+std::size_t MigrationPlan::statements() const __tegra_noexcept
+{
+    std::size_t count = 0;
+    for (const auto& step : steps) count += step.statements.size();
+    return count;
+}
+
+MigrationEngine::MigrationEngine(ConnectionPool& pool, const MigrationOptions& options) : m_pool(pool), m_options(options)
+{
+    m_options.batchRows = std::max<u64>(m_options.batchRows, 1);
+}
+
+void MigrationEngine::add(std::string_view table, std::string_view body)
+{
+    const std::string_view prefix = TableRegistry::prefix();
+    if (!prefix.empty() && table.starts_with(prefix)) table.remove_prefix(prefix.size());
+    TableSchema schema {std::string(TableRegistry::table(table, TableType::MixedStruct)), std::string(body), parse(body)};
+    const auto found = std::find_if(m_tables.begin(), m_tables.end(), [&schema](const TableSchema& t) { return t.table == schema.table; });
+    if (found != m_tables.end()) {
+        *found = std::move(schema);
+    } else {
+        m_tables.push_back(std::move(schema));
+    }
+}
+
+void MigrationEngine::addFromFile(const std::string& path, std::string_view rdbms)
+{
+    for (const auto& entry : SeedFile::section(SeedFile::read(path), "create", rdbms)) {
+        add(entry.table, entry.content);
+    }
+}
+
+std::vector<ColumnDefinition> MigrationEngine::parse(std::string_view body)
+{
+    body = trimmed(body);
+    if (!body.empty() && body.back() == ';') body = trimmed(body.substr(0, body.size() - 1));
+    if (!body.empty() && body.front() == '(' && skipGroup(body, 0) == body.size()) {
+        body = body.substr(1, body.size() - 2);
+    }
+
+    static const std::array<std::string_view, 10> tableConstraints {
+        "PRIMARY", "UNIQUE", "CONSTRAINT", "FOREIGN", "KEY", "INDEX", "CHECK", "FULLTEXT", "SPATIAL", "EXCLUDE"
+    };
+    static const std::array<std::string_view, 14> attributes {
+        "NOT", "NULL", "DEFAULT", "PRIMARY", "UNIQUE", "REFERENCES", "GENERATED", "AUTO_INCREMENT",
+        "AUTOINCREMENT", "CHECK", "COLLATE", "CONSTRAINT", "COMMENT", "ON"
+    };
+    const auto isOneOf = [](const std::string& word, const auto& list) {
+        return std::find(list.begin(), list.end(), word) != list.end();
+    };
+
+    std::vector<ColumnDefinition> columns;
+    VectorString primaryKey;
+    for (const auto item : splitItems(body)) {
+        const auto words = splitWords(item);
+        if (words.empty()) continue;
+        const std::string first = upper(words.front());
+        if (isOneOf(first, tableConstraints)) {
+            if (first == "PRIMARY" || (first == "CONSTRAINT" && upper(item).find("PRIMARY KEY") != std::string::npos)) {
+                primaryKey = keyColumns(item);
+            }
+            continue;
+        }
+        ColumnDefinition& column = columns.emplace_back();
+        column.name = unquoted(words.front());
+        std::size_t w = 1;
+        for (; w < words.size() && !isOneOf(upper(words[w]), attributes); ++w) {
+            if (!column.type.empty()) column.type.push_back(' ');
+            column.type.append(words[w]);
+        }
+        const std::string type = upper(column.type);
+        column.identity = type == "SERIAL" || type == "BIGSERIAL" || type == "SMALLSERIAL";
+        for (; w < words.size(); ++w) {
+            const std::string word = upper(words[w]);
+            if (word == "NOT" && w + 1 < words.size() && upper(words[w + 1]) == "NULL") {
+                column.notNull = true;
+                ++w;
+            } else if (word == "DEFAULT" && w + 1 < words.size()) {
+                column.defaultValue = std::string(words[++w]);
+            } else if (word == "PRIMARY") {
+                column.primaryKey = true;
+            } else if (word == "GENERATED" || word == "AUTO_INCREMENT" || word == "AUTOINCREMENT") {
+                column.identity = true;
+            }
+        }
+    }
+    for (auto& column : columns) {
+        if (std::find(primaryKey.begin(), primaryKey.end(), lower(column.name)) != primaryKey.end()) {
+            column.primaryKey = true;
+        }
+    }
+    return columns;
+}
+
+MigrationPlan MigrationEngine::plan()
+{
+    MigrationPlan plan;
+    auto connection = m_pool.acquire();
+    const DriverTypes driver = connection->driver();
+
+    //! Missing tables are created in the order of their foreign keys.
+    SchemaBuilder missing(m_pool);
+    std::array<std::vector<MigrationStep>, 3> phases;
+    for (const auto& schema : m_tables) {
+        const auto live = connection->describe(schema.table);
+        if (live.empty()) {
+            missing.add(schema.table, schema.body);
+        } else {
+            diff(schema, live, driver, phases, plan.warnings);
+        }
+    }
+    for (const auto& wave : missing.levels()) {
+        for (const auto& table : wave) {
+            const auto& definitions = missing.tables();
+            const auto found = std::find_if(definitions.begin(), definitions.end(), [&table](const TableDefinition& d) { return d.table == table; });
+            plan.steps.push_back({MigrationStep::Kind::CreateTable, table, {}, {found->statement}, {}});
+        }
+    }
+    for (auto& phase : phases) {
+        std::move(phase.begin(), phase.end(), std::back_inserter(plan.steps));
+    }
+    return plan;
+}
+
+void MigrationEngine::diff(const TableSchema& schema, const std::vector<ColumnInfo>& live, DriverTypes driver,
+                           std::array<std::vector<MigrationStep>, 3>& phases, VectorString& warnings) const
+{
+    using Kind = MigrationStep::Kind;
+    const bool sqlite = driver == DriverTypes::SQLite;
+    const bool mysql = driver == DriverTypes::MySQL;
+    const std::string table = schema.table;
+    const std::string alter = "ALTER TABLE " + quoted(driver, table) + " ";
+
+    const auto constrain = [&](const ColumnDefinition& column) {
+        if (sqlite) {
+            warnings.push_back(table + "." + column.name + " should be NOT NULL, sqlite3 can only do it by rebuilding the table.");
+            return;
+        }
+        const std::string name = quoted(driver, column.name);
+        if (mysql) {
+            phases[Contract].push_back({Kind::Constrain, table, column.name,
+                                        {alter + "MODIFY COLUMN " + columnClause(driver, column, true, true) + ", ALGORITHM=INPLACE, LOCK=NONE"}, {}});
+            return;
+        }
+        //! The check is validated without blocking writes, SET NOT NULL then trusts it instead of scanning the table.
+        const std::string check = quoted(driver, constraintName(table, column.name));
+        phases[Contract].push_back({Kind::Constrain, table, column.name, {
+            alter + "ADD CONSTRAINT " + check + " CHECK (" + name + " IS NOT NULL) NOT VALID",
+            alter + "VALIDATE CONSTRAINT " + check,
+            alter + "ALTER COLUMN " + name + " SET NOT NULL",
+            alter + "DROP CONSTRAINT " + check
+        }, {}});
+    };
+
+    for (const auto& column : schema.columns) {
+        const std::string name = quoted(driver, column.name);
+        const auto found = std::find_if(live.begin(), live.end(), [&column](const ColumnInfo& c) { return lower(c.name) == lower(column.name); });
+
+        if (found == live.end()) {
+            if (column.identity) {
+                warnings.push_back(table + "." + column.name + " is a generated column, it's not added to a table with rows.");
+                continue;
+            }
+            if (column.defaultValue.has_value() && isConstant(*column.defaultValue)) {
+                //! A constant default is kept in the catalog, no row is written.
+                phases[Expand].push_back({Kind::AddColumn, table, column.name,
+                                          {alter + "ADD COLUMN " + columnClause(driver, column, column.notNull, true)}, {}});
+                continue;
+            }
+            phases[Expand].push_back({Kind::AddColumn, table, column.name, {alter + "ADD COLUMN " + columnClause(driver, column, false, false)}, {}});
+            if (!column.defaultValue.has_value()) {
+                if (column.notNull) {
+                    warnings.push_back(table + "." + column.name + " is NOT NULL without a default, it stays nullable until it's filled.");
+                }
+                continue;
+            }
+            if (sqlite) {
+                warnings.push_back(table + "." + column.name + " keeps no default, sqlite3 can't change the default of a column.");
+            } else {
+                phases[Expand].push_back({Kind::SetDefault, table, column.name,
+                                          {alter + "ALTER COLUMN " + name + " SET DEFAULT " + *column.defaultValue}, {}});
+            }
+            phases[Fill].push_back({Kind::Backfill, table, column.name, {}, *column.defaultValue});
+            if (column.notNull) constrain(column);
+            continue;
+        }
+
+        if (!sqlite) {
+            const std::string wanted = normalizedType(column.type);
+            const std::string current = normalizedType(found->type);
+            if (wanted != current && !column.identity) {
+                const auto wantedLength = varcharLength(wanted);
+                const auto currentLength = varcharLength(current);
+                if (wantedLength.has_value() && currentLength.has_value() && *wantedLength > *currentLength) {
+                    phases[Expand].push_back({Kind::WidenColumn, table, column.name, {mysql
+                        ? alter + "MODIFY COLUMN " + columnClause(driver, column, !found->nullable, true) + ", ALGORITHM=INPLACE, LOCK=NONE"
+                        : alter + "ALTER COLUMN " + name + " TYPE " + column.type}, {}});
+                } else {
+                    warnings.push_back(table + "." + column.name + " is " + found->type + " and should be " + column.type + ", that needs a manual migration.");
+                }
+            }
+        }
+
+        if (!column.identity && !found->identity && normalizedDefault(column.defaultValue) != normalizedDefault(found->defaultValue)) {
+            if (sqlite) {
+                warnings.push_back(table + "." + column.name + " has another default, sqlite3 can't change the default of a column.");
+            } else {
+                phases[Expand].push_back({Kind::SetDefault, table, column.name, {column.defaultValue.has_value()
+                    ? alter + "ALTER COLUMN " + name + " SET DEFAULT " + *column.defaultValue
+                    : alter + "ALTER COLUMN " + name + " DROP DEFAULT"}, {}});
+            }
+        }
+
+        if (column.notNull && found->nullable && !column.primaryKey) {
+            if (column.defaultValue.has_value()) {
+                phases[Fill].push_back({Kind::Backfill, table, column.name, {}, *column.defaultValue});
+            }
+            constrain(column);
+        } else if (!column.notNull && !found->nullable && !column.primaryKey && !column.identity && !found->identity) {
+            if (sqlite) {
+                warnings.push_back(table + "." + column.name + " should allow NULL, sqlite3 can only do it by rebuilding the table.");
+            } else {
+                phases[Expand].push_back({Kind::DropNotNull, table, column.name, {mysql
+                    ? alter + "MODIFY COLUMN " + columnClause(driver, column, false, true) + ", ALGORITHM=INPLACE, LOCK=NONE"
+                    : alter + "ALTER COLUMN " + name + " DROP NOT NULL"}, {}});
+            }
+        }
+    }
+}
+
+MigrationReport MigrationEngine::apply(const MigrationPlan& plan)
+{
+    const auto start = std::chrono::steady_clock::now();
+    MigrationReport report;
+    if (plan.empty()) return report;
+    auto connection = m_pool.acquire();
+    const DriverTypes driver = connection->driver();
+    const LockTimeoutScope lockTimeout {*connection};
+    if (driver == DriverTypes::PostgreSQL) {
+        connection->run("SET lock_timeout = " + std::to_string(m_options.lockTimeout.count()));
+    } else if (driver == DriverTypes::MySQL) {
+        connection->run("SET SESSION lock_wait_timeout = " + std::to_string(std::max<long long>(m_options.lockTimeout.count() / 1000, 1)));
+    }
+    for (const auto& step : plan.steps) {
+        if (step.kind == MigrationStep::Kind::Backfill) {
+            backfill(*connection, step, report);
+            continue;
+        }
+        for (const auto& statement : step.statements) {
+            runDdl(*connection, statement);
+            ++report.statements;
+        }
+    }
+    report.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    return report;
+}
+
+void MigrationEngine::runDdl(Connection& connection, const std::string& statement)
+{
+    //! A DDL statement that waits for its lock blocks every query behind it, so it gives up early and tries again later.
+    for (std::size_t attempt = 0;; ++attempt) {
+        try {
+            connection.run(statement);
+            return;
+        } catch (const std::exception& e) {
+            if (attempt + 1 >= std::max<std::size_t>(m_options.lockRetries, 1) || !isLockTimeout(e.what())) throw;
+        }
+        std::this_thread::sleep_for(m_options.lockTimeout * (attempt + 1));
+    }
+}
+
+void MigrationEngine::backfill(Connection& connection, const MigrationStep& step, MigrationReport& report)
+{
+    const DriverTypes driver = connection.driver();
+    const std::string table = quoted(driver, step.table);
+    const std::string column = quoted(driver, step.column);
+    const std::string update = "UPDATE " + table + " SET " + column + " = " + step.value + " WHERE " + column + " IS NULL";
+    const VectorString keys = connection.primaryKey(step.table);
+    if (keys.empty()) {
+        report.backfilled += connection.execute(update).affectedRows;
+        ++report.chunks;
+        return;
+    }
+
+    //! Ranges of the first key column, each one is a short statement that locks only its rows.
+    const std::string key = keys.front() == "rowid" ? std::string("rowid") : quoted(driver, keys.front());
+    const std::string limit = " ORDER BY " + key + " LIMIT 1 OFFSET " + std::to_string(m_options.batchRows - 1);
+    const std::string firstBound = "SELECT " + key + " FROM " + table + limit;
+    const std::string nextBound = "SELECT " + key + " FROM " + table + " WHERE " + key + " > ?" + limit;
+    const auto started = std::chrono::steady_clock::now();
+    u64 scanned = 0;
+    std::optional<std::string> low;
+    for (;;) {
+        const ResultSet bound = low.has_value() ? connection.execute(nextBound, {*low}) : connection.execute(firstBound);
+        const std::optional<std::string> high = bound.empty() ? std::nullopt : bound.rows.front().front();
+        std::string sql = update;
+        SqlParams params;
+        if (low.has_value()) {
+            sql.append(" AND " + key + " > ?");
+            params.push_back(*low);
+        }
+        if (high.has_value()) {
+            sql.append(" AND " + key + " <= ?");
+            params.push_back(*high);
+        }
+        report.backfilled += connection.execute(sql, params).affectedRows;
+        ++report.chunks;
+        if (!high.has_value()) break;
+        low = high;
+
+        scanned += m_options.batchRows;
+        if (m_options.maxRowsPerSecond > 0) {
+            const auto due = started + std::chrono::microseconds(scanned * 1000000 / m_options.maxRowsPerSecond);
+            std::this_thread::sleep_until(due);
+        }
+        if (m_options.pause.count() > 0) {
+            std::this_thread::sleep_for(m_options.pause);
+        }
+    }
+}
+
+TEGRA_NAMESPACE_END
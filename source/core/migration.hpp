@@ -0,0 +1,190 @@
+/*!
+ * MIT License
+ *
+ * Copyright (c) 2022 Kambiz Asadzadeh
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#ifndef TEGRA_MIGRATION_HPP
+#define TEGRA_MIGRATION_HPP
+
+#include "connectionpool.hpp"
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+/*!
+ * @brief The ColumnDefinition struct is a column as it's written inside a definition of system-tables.json.
+ */
+struct ColumnDefinition final
+{
+    std::string                 name            {};
+    std::string                 type            {};     ///<Type with its arguments, for example "VARCHAR(50)".
+    bool                        notNull         {};
+    std::optional<std::string>  defaultValue    {};     ///<Default expression as written.
+    bool                        identity        {};     ///<Generated by the server, it's never filled by a migration.
+    bool                        primaryKey      {};     ///<Part of the primary key, inline or as a table constraint.
+};
+
+/*!
+ * @brief The TableSchema struct is the parsed column list of a table definition.
+ */
+struct TableSchema final
+{
+    std::string                     table       {};     ///<Full name of the table with prefix.
+    std::string                     body        {};     ///<Column list as written, "(...)".
+    std::vector<ColumnDefinition>   columns     {};
+};
+
+/*!
+ * @brief The MigrationStep struct is one change of a migration plan.
+ */
+struct MigrationStep final
+{
+    enum class Kind : u8
+    {
+        CreateTable,    ///<The table is missing.
+        AddColumn,      ///<New column, nullable or with a constant default so that no row is rewritten.
+        SetDefault,     ///<Default of new rows, existing rows are untouched.
+        WidenColumn,    ///<A longer VARCHAR, a change of the catalog only.
+        Backfill,       ///<Fills NULL values of existing rows in key ranges.
+        Constrain,      ///<NOT NULL after the backfill, validated without blocking writes where the server can.
+        DropNotNull     ///<The definition allows NULL now.
+    };
+
+    Kind            kind        {};
+    std::string     table       {};
+    std::string     column      {};
+    VectorString    statements  {};     ///<DDL of the step, run in order, empty for a backfill.
+    std::string     value       {};     ///<Expression that a backfill writes.
+};
+
+/*!
+ * @brief The MigrationPlan struct is the ordered set of changes between the definitions and the live catalog.
+ * Steps are ordered for an online upgrade: tables and nullable columns first, then backfills, then constraints.
+ */
+struct MigrationPlan final
+{
+    std::vector<MigrationStep>  steps       {};
+    VectorString                warnings    {};     ///<Differences that need a manual migration, nothing is done for them.
+
+    __tegra_no_discard bool empty() const __tegra_noexcept;
+    __tegra_no_discard std::size_t statements() const __tegra_noexcept;
+};
+
+/*!
+ * @brief The MigrationOptions struct controls how hard a migration may press on a live server.
+ */
+struct MigrationOptions final
+{
+    u64                         batchRows           {5000};     ///<Rows of one backfill chunk, each chunk is its own short transaction.
+    u64                         maxRowsPerSecond    {0};        ///<Backfill throttle, zero means unlimited.
+    std::chrono::milliseconds   pause               {0};        ///<Extra pause after each chunk.
+    std::chrono::milliseconds   lockTimeout         {5000};     ///<Longest wait of a DDL statement for its lock.
+    std::size_t                 lockRetries         {3};        ///<Tries of a DDL statement that timed out on its lock.
+};
+
+/*!
+ * @brief The MigrationReport struct is the outcome of an applied plan.
+ */
+struct MigrationReport final
+{
+    std::size_t                 statements  {};     ///<DDL statements that ran.
+    u64                         backfilled  {};     ///<Rows that got a value.
+    u64                         chunks      {};     ///<Backfill statements.
+    std::chrono::microseconds   elapsed     {};
+};
+
+/*!
+ * @brief The MigrationEngine class upgrades a live schema to the definitions of system-tables.json without a reset.
+ * It reads the catalog of the server, compares it with the definitions and emits the smallest set of changes.
+ * A column is never added in a way that rewrites the table: a constant default is added as is (a change of the
+ * catalog on every rdbms), any other default is added as a nullable column, filled in throttled key ranges and
+ * constrained at the end. Columns and tables that are not defined anymore are kept, changes of types other than a
+ * wider VARCHAR are reported as warnings.
+ * @example
+ * MigrationEngine engine(pool);
+ * engine.addFromFile(std::string(CONFIG::CMS_TABLES_FILE), "postgresql");
+ * const auto plan = engine.plan();
+ * const auto report = engine.apply(plan);
+ */
+class MigrationEngine final
+{
+public:
+    explicit MigrationEngine(ConnectionPool& pool, const MigrationOptions& options = {});
+    MigrationEngine(const MigrationEngine& rhsEngine) = delete;
+    MigrationEngine& operator=(const MigrationEngine& rhsEngine) = delete;
+
+    /*!
+     * @brief add function adds the definition of a table.
+     * @param table is the name of table without prefix.
+     * @param body is the column list, "(...)" as written under "create" in system-tables.json.
+     */
+    void add(std::string_view table, std::string_view body);
+
+    /*!
+     * @brief addFromFile function adds the tables of the "create" section of system-tables.json.
+     * @param path of the file.
+     * @param rdbms is "postgresql", "mysql" or "sqlite3".
+     */
+    void addFromFile(const std::string& path, std::string_view rdbms);
+
+    /*!
+     * @brief plan function compares the definitions with the live catalog, nothing is changed.
+     */
+    __tegra_no_discard MigrationPlan plan();
+
+    /*!
+     * @brief apply function runs a plan, DDL statements wait at most lockTimeout for their locks.
+     * @returns counters of the run, it throws on the first failing statement.
+     */
+    MigrationReport apply(const MigrationPlan& plan);
+
+    /*!
+     * @brief parse function splits a column list into columns, table constraints are skipped.
+     * @param body is "(...)" with or without the parentheses and a trailing ';'.
+     */
+    __tegra_no_discard static std::vector<ColumnDefinition> parse(std::string_view body);
+
+private:
+    /*!
+     * @brief diff function adds the steps of one existing table to the phases of a plan.
+     */
+    void diff(const TableSchema& schema, const std::vector<ColumnInfo>& live, DriverTypes driver,
+              std::array<std::vector<MigrationStep>, 3>& phases, VectorString& warnings) const;
+
+    /*!
+     * @brief backfill function fills a column in key ranges, each range is one short statement.
+     */
+    void backfill(Connection& connection, const MigrationStep& step, MigrationReport& report);
+
+    /*!
+     * @brief runDdl function runs a DDL statement and tries again while it times out on its lock.
+     */
+    void runDdl(Connection& connection, const std::string& statement);
+
+    ConnectionPool&             m_pool;
+    MigrationOptions            m_options   {};
+    std::vector<TableSchema>    m_tables    {};
+};
+
+TEGRA_NAMESPACE_END
+
+#endif  // TEGRA_MIGRATION_HPP
@@ -0,0 +1,316 @@
+#include "mixedcache.hpp"
+#include "memorystore.hpp"
+#include "tableregistry.hpp"
+#include "core.hpp"
+
+TEGRA_USING_NAMESPACE Tegra::CMS;
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+TEGRA_ANONYMOUS_NAMESPACE_BEGIN
+
+//! Ids of one stale refresh, they are bound as parameters of one statement, it's a power of two like every id list.
+constexpr std::size_t MaxStaleIds = 512;
+
+u64 idOf(const SqlValue& value)
+{
+    u64 id = 0;
+    if (!value.has_value() || std::from_chars(value->data(), value->data() + value->size(), id).ec != std::errc()) {
+        throw Exception(Exception::Reason::Core, "The joined cache needs numeric ids.");
+    }
+    return id;
+}
+
+TEGRA_NAMESPACE_END
+
+MixedRow::MixedRow(const MixedView& view, std::size_t index) __tegra_noexcept : m_view(&view), m_index(index)
+{
+}
+
+u64 MixedRow::id() const __tegra_noexcept
+{
+    return m_view->ids()[m_index];
+}
+
+bool MixedRow::isNull(std::string_view column) const __tegra_noexcept
+{
+    const auto index = m_view->column(column);
+    return !index.has_value() || m_view->isNull(m_index, *index);
+}
+
+std::string_view MixedRow::value(std::string_view column, std::string_view fallback) const __tegra_noexcept
+{
+    const auto index = m_view->column(column);
+    return index.has_value() && !m_view->isNull(m_index, *index) ? m_view->text(m_index, *index) : fallback;
+}
+
+MixedView::MixedView(const VectorString& columns, const std::vector<std::pair<u64, SqlRow>>& rows)
+{
+    m_ids.reserve(rows.size());
+    m_columns.resize(columns.size());
+    for (std::size_t c = 0; c < columns.size(); ++c) {
+        Column& column = m_columns[c];
+        column.name = columns[c];
+        column.offsets.reserve(rows.size() + 1);
+        column.nulls.reserve(rows.size());
+        std::size_t bytes = 0;
+        for (const auto& [id, row] : rows) bytes += row[c].has_value() ? row[c]->size() : 0;
+        column.data.reserve(bytes);
+    }
+    for (const auto& [id, row] : rows) {
+        m_ids.push_back(id);
+        for (std::size_t c = 0; c < m_columns.size(); ++c) {
+            Column& column = m_columns[c];
+            column.offsets.push_back(static_cast<u32>(column.data.size()));
+            column.nulls.push_back(!row[c].has_value());
+            if (row[c].has_value()) column.data.append(*row[c]);
+        }
+    }
+    for (auto& column : m_columns) {
+        column.offsets.push_back(static_cast<u32>(column.data.size()));
+    }
+}
+
+std::size_t MixedView::size() const __tegra_noexcept
+{
+    return m_ids.size();
+}
+
+bool MixedView::empty() const __tegra_noexcept
+{
+    return m_ids.empty();
+}
+
+const std::vector<u64>& MixedView::ids() const __tegra_noexcept
+{
+    return m_ids;
+}
+
+VectorString MixedView::columns() const
+{
+    VectorString names;
+    names.reserve(m_columns.size());
+    for (const auto& column : m_columns) names.push_back(column.name);
+    return names;
+}
+
+std::optional<std::size_t> MixedView::column(std::string_view name) const __tegra_noexcept
+{
+    for (std::size_t c = 0; c < m_columns.size(); ++c) {
+        if (m_columns[c].name == name) return c;
+    }
+    return std::nullopt;
+}
+
+std::optional<MixedRow> MixedView::find(u64 id) const __tegra_noexcept
+{
+    const auto found = std::lower_bound(m_ids.begin(), m_ids.end(), id);
+    if (found == m_ids.end() || *found != id) return std::nullopt;
+    return MixedRow(*this, static_cast<std::size_t>(found - m_ids.begin()));
+}
+
+MixedRow MixedView::at(std::size_t index) const __tegra_noexcept
+{
+    return MixedRow(*this, index);
+}
+
+std::string_view MixedView::text(std::size_t row, std::size_t column) const __tegra_noexcept
+{
+    const Column& c = m_columns[column];
+    return std::string_view(c.data).substr(c.offsets[row], c.offsets[row + 1] - c.offsets[row]);
+}
+
+bool MixedView::isNull(std::size_t row, std::size_t column) const __tegra_noexcept
+{
+    return m_columns[column].nulls[row];
+}
+
+SqlRow MixedView::row(std::size_t index) const
+{
+    SqlRow values;
+    values.reserve(m_columns.size());
+    for (std::size_t c = 0; c < m_columns.size(); ++c) {
+        if (isNull(index, c)) values.emplace_back();
+        else values.emplace_back(std::string(text(index, c)));
+    }
+    return values;
+}
+
+MixedCache::MixedCache(ConnectionPool& pool, std::string_view table)
+    : m_pool(&pool),
+      m_keyTable(TableRegistry::table(table, TableType::KeyStruct)),
+      m_valueTable(TableRegistry::table(table, TableType::ValueSturct))
+{
+}
+
+MixedCache::MixedCache(MemoryStore& store, std::string_view table)
+    : m_memory(&store),
+      m_keyTable(TableRegistry::table(table, TableType::KeyStruct)),
+      m_valueTable(TableRegistry::table(table, TableType::ValueSturct))
+{
+}
+
+std::string_view MixedCache::keyTable() const __tegra_noexcept
+{
+    return m_keyTable;
+}
+
+std::string_view MixedCache::valueTable() const __tegra_noexcept
+{
+    return m_valueTable;
+}
+
+const StatementKey& MixedCache::select(std::size_t ids)
+{
+    //! Id lists are padded to a power of two, a table needs a handful of statements whatever the number of stale ids.
+    const std::size_t count = ids == 0 ? 0 : std::bit_ceil(ids);
+    const std::size_t index = static_cast<std::size_t>(std::bit_width(count));
+    if (index >= m_selects.size()) {
+        m_selects.resize(index + 1);
+    }
+    auto& statement = m_selects[index];
+    if (statement == nullptr) {
+        std::string sql = "SELECT " + m_selectList + " FROM " + std::string(m_keyTable) + " k JOIN "
+                        + std::string(m_valueTable) + " v ON v.id = k.id WHERE v.language = ?";
+        if (count > 0) {
+            sql.append(" AND k.id IN (?");
+            for (std::size_t i = 1; i < count; ++i) sql.append(",?");
+            sql.push_back(')');
+        }
+        sql.append(" ORDER BY k.id");
+        statement = CreateScope<SqlStatement>(std::move(sql));
+    }
+    return statement->key();
+}
+
+std::vector<std::pair<u64, SqlRow>> MixedCache::fetch(std::string_view language, const std::vector<u64>& ids)
+{
+    auto connection = m_pool->acquire();
+    if (m_selectList.empty()) {
+        //! Key columns first (id is one of them), then the value columns but id, language and names that are taken.
+        const VectorString keyColumns = connection->run("SELECT * FROM " + std::string(m_keyTable) + " LIMIT 0").columns;
+        const VectorString valueColumns = connection->run("SELECT * FROM " + std::string(m_valueTable) + " LIMIT 0").columns;
+        VectorString columns {"id"};
+        std::string list = "k.id";
+        for (const auto& column : keyColumns) {
+            if (column == "id") continue;
+            columns.push_back(column);
+            list.append(",k.").append(column);
+        }
+        for (const auto& column : valueColumns) {
+            if (column == "language" || std::find(columns.begin(), columns.end(), column) != columns.end()) continue;
+            columns.push_back(column);
+            list.append(",v.").append(column);
+        }
+        m_columns = std::move(columns);
+        m_selectList = std::move(list);
+    }
+
+    std::vector<std::pair<u64, SqlRow>> rows;
+    const auto append = [&rows](ResultSet result) {
+        for (auto& row : result.rows) {
+            const u64 id = idOf(row.front());
+            rows.emplace_back(id, std::move(row));
+        }
+    };
+    if (ids.empty()) {
+        append(connection->execute(select(0), {std::string(language)}));
+        return rows;
+    }
+    for (std::size_t i = 0; i < ids.size(); i += MaxStaleIds) {
+        const std::size_t count = std::min(MaxStaleIds, ids.size() - i);
+        SqlParams params {std::string(language)};
+        for (std::size_t k = 0; k < count; ++k) params.emplace_back(std::to_string(ids[i + k]));
+        //! The padding repeats the last id, IN ignores the duplicates.
+        params.resize(1 + std::bit_ceil(count), params.back());
+        append(connection->execute(select(count), params));
+    }
+    return rows;
+}
+
+Ref<const MixedView> MixedCache::view(std::string_view language)
+{
+    if (m_memory != nullptr) {
+        return m_memory->view(m_keyTable, language);
+    }
+    {
+        std::shared_lock lock(m_mutex);
+        const auto found = m_languages.find(language);
+        if (found != m_languages.end() && found->second.stale.empty()) {
+            return found->second.view;
+        }
+    }
+
+    std::lock_guard load(m_loadMutex);
+    Ref<const MixedView> current;
+    std::vector<u64> stale;
+    std::vector<u64> staleGenerations;
+    u64 generation = 0;
+    {
+        std::shared_lock lock(m_mutex);
+        generation = m_generation;
+        const auto found = m_languages.find(language);
+        if (found != m_languages.end()) {
+            //! Another thread may have refreshed it while this one waited.
+            if (found->second.stale.empty()) return found->second.view;
+            current = found->second.view;
+            for (const auto& [id, invalidated] : found->second.stale) {
+                stale.push_back(id);
+                staleGenerations.push_back(invalidated);
+            }
+        }
+    }
+
+    auto rows = fetch(language, stale);
+    if (current != nullptr) {
+        //! Fresh rows of the stale ids replace the old ones, ids that are gone are dropped.
+        for (std::size_t i = 0; i < current->size(); ++i) {
+            if (!std::binary_search(stale.begin(), stale.end(), current->ids()[i])) {
+                rows.emplace_back(current->ids()[i], current->row(i));
+            }
+        }
+        std::sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    }
+    Ref<const MixedView> next = CreateRef<const MixedView>(m_columns, rows);
+
+    std::unique_lock lock(m_mutex);
+    const auto found = m_languages.find(language);
+    if (current == nullptr ? m_generation != generation : found == m_languages.end()) {
+        //! Invalidated while the rows were read, the caller gets them but they are not kept.
+        return next;
+    }
+    Language& entry = found != m_languages.end() ? found->second : m_languages[std::string(language)];
+    //! Ids that were invalidated again during the fetch stay stale, their generation moved on.
+    for (std::size_t i = 0; i < stale.size(); ++i) {
+        const auto marked = entry.stale.find(stale[i]);
+        if (marked != entry.stale.end() && marked->second == staleGenerations[i]) entry.stale.erase(marked);
+    }
+    entry.view = next;
+    return next;
+}
+
+std::optional<std::pair<Ref<const MixedView>, MixedRow>> MixedCache::find(u64 id, std::string_view language)
+{
+    Ref<const MixedView> snapshot = view(language);
+    const auto row = snapshot->find(id);
+    if (!row.has_value()) return std::nullopt;
+    return std::make_pair(std::move(snapshot), *row);
+}
+
+void MixedCache::invalidate(u64 id)
+{
+    std::unique_lock lock(m_mutex);
+    ++m_generation;
+    for (auto& [language, entry] : m_languages) {
+        entry.stale[id] = m_generation;
+    }
+}
+
+void MixedCache::invalidate()
+{
+    std::unique_lock lock(m_mutex);
+    ++m_generation;
+    m_languages.clear();
+}
+
+TEGRA_NAMESPACE_END
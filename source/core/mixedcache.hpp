@@ -0,0 +1,209 @@
+/*!
+ * MIT License
+ *
+ * Copyright (c) 2022 Kambiz Asadzadeh
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef TEGRA_MIXEDCACHE_HPP
+#define TEGRA_MIXEDCACHE_HPP
+
+#include "connectionpool.hpp"
+#include "sqlquery.hpp"
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+class MixedView;
+class MemoryStore;
+
+/*!
+ * @brief The MixedRow class is a handle of one row inside a MixedView, it's valid while the view is alive.
+ */
+class MixedRow final
+{
+public:
+    MixedRow(const MixedView& view, std::size_t index) __tegra_noexcept;
+
+    __tegra_no_discard u64 id() const __tegra_noexcept;
+    __tegra_no_discard bool isNull(std::string_view column) const __tegra_noexcept;
+
+    /*!
+     * @brief get function reads a column as std::string_view, std::string, bool, an integral or a floating point type.
+     * @returns the value or std::nullopt if the column is unknown, NULL or can not be converted.
+     */
+    template<typename T>
+    __tegra_no_discard std::optional<T> get(std::string_view column) const;
+
+    /*!
+     * @brief value function reads a column as text with a fallback.
+     */
+    __tegra_no_discard std::string_view value(std::string_view column, std::string_view fallback = {}) const __tegra_noexcept;
+
+private:
+    const MixedView*    m_view  {};
+    std::size_t         m_index {};
+};
+
+/*!
+ * @brief The MixedView class is an immutable snapshot of a key table joined with one language of its value table.
+ * Rows are sorted by id and every column is stored as one contiguous text buffer with offsets (structure of arrays),
+ * so a lookup is a binary search over the ids and a read is a string_view into the buffer.
+ */
+class MixedView final
+{
+public:
+    struct Column final
+    {
+        std::string             name    {};
+        std::string             data    {};     ///<Values of all rows, back to back.
+        std::vector<u32>        offsets {};     ///<Start of each row inside data, plus the end.
+        std::vector<bool>       nulls   {};
+    };
+
+    /*!
+     * @param columns are the names of the columns, the first one must be the id.
+     * @param rows are sorted by id, NULL ids are not allowed.
+     */
+    MixedView(const VectorString& columns, const std::vector<std::pair<u64, SqlRow>>& rows);
+
+    __tegra_no_discard std::size_t size() const __tegra_noexcept;
+    __tegra_no_discard bool empty() const __tegra_noexcept;
+    __tegra_no_discard const std::vector<u64>& ids() const __tegra_noexcept;
+    __tegra_no_discard VectorString columns() const;
+
+    /*!
+     * @brief column function gets the index of a column.
+     */
+    __tegra_no_discard std::optional<std::size_t> column(std::string_view name) const __tegra_noexcept;
+
+    /*!
+     * @brief find function gets a row by id.
+     */
+    __tegra_no_discard std::optional<MixedRow> find(u64 id) const __tegra_noexcept;
+
+    __tegra_no_discard MixedRow at(std::size_t index) const __tegra_noexcept;
+
+    /*!
+     * @brief text function reads a cell, NULL reads as an empty string.
+     */
+    __tegra_no_discard std::string_view text(std::size_t row, std::size_t column) const __tegra_noexcept;
+    __tegra_no_discard bool isNull(std::size_t row, std::size_t column) const __tegra_noexcept;
+
+    /*!
+     * @brief row function copies a row back to the driver form.
+     */
+    __tegra_no_discard SqlRow row(std::size_t index) const;
+
+private:
+    std::vector<u64>    m_ids       {};
+    std::vector<Column> m_columns   {};
+};
+
+/*!
+ * @brief The MixedCache class keeps the joined rows of a key table and its value table (TableType::MixedStruct) in memory.
+ * Each language is loaded with one query on first use, later reads never go to the server.
+ * Writes mark single ids as stale, the next read of that language fetches only those rows again
+ * and publishes a new view, readers that still hold the old view are not disturbed.
+ * @example
+ * MixedCache config(pool, "config");
+ * auto english = config.view("english");
+ * if (auto row = english->find(13)) auto title = row->get<std::string_view>("title");
+ */
+class MixedCache final
+{
+public:
+    /*!
+     * @param pool to read the rows from.
+     * @param table is the key table without prefix, for example "config".
+     */
+    MixedCache(ConnectionPool& pool, std::string_view table);
+
+    /*!
+     * @param store to read the rows from, its views are kept up to date by the store itself.
+     * @param table is the key table without prefix, for example "config".
+     */
+    MixedCache(MemoryStore& store, std::string_view table);
+    MixedCache(const MixedCache& rhsCache) = delete;
+    MixedCache& operator=(const MixedCache& rhsCache) = delete;
+
+    /*!
+     * @brief view function gets the current view of a language.
+     * @returns snapshot of the rows, it throws if the tables can not be read.
+     */
+    __tegra_no_discard Ref<const MixedView> view(std::string_view language);
+
+    /*!
+     * @brief find function gets a row of a language, it's a shortcut for view(language)->find(id).
+     * @returns the view that owns the row together with the row.
+     */
+    __tegra_no_discard std::optional<std::pair<Ref<const MixedView>, MixedRow>> find(u64 id, std::string_view language);
+
+    /*!
+     * @brief invalidate function marks one id as stale in all loaded languages.
+     */
+    void invalidate(u64 id);
+
+    /*!
+     * @brief invalidate function drops all loaded languages.
+     */
+    void invalidate();
+
+    __tegra_no_discard std::string_view keyTable() const __tegra_noexcept;
+    __tegra_no_discard std::string_view valueTable() const __tegra_noexcept;
+
+private:
+    struct Language final
+    {
+        Ref<const MixedView>    view    {};
+        std::map<u64, u64>      stale   {};     ///<Id to the generation of its last invalidation.
+    };
+
+    /*!
+     * @brief select function gets the statement that reads a language, it's composed on first use.
+     * @param ids is the number of stale ids to read, zero reads the whole language.
+     * @returns key of the statement, it binds the language and the ids rounded up to a power of two.
+     */
+    const StatementKey& select(std::size_t ids);
+    std::vector<std::pair<u64, SqlRow>> fetch(std::string_view language, const std::vector<u64>& ids);
+
+    ConnectionPool*                                     m_pool          {};
+    MemoryStore*                                        m_memory        {};     ///<Set for StorageType::Cache, the pool is not used then.
+    std::string_view                                    m_keyTable      {};
+    std::string_view                                    m_valueTable    {};
+    VectorString                                        m_columns       {};     ///<Output columns, id first.
+    std::string                                         m_selectList    {};
+    std::vector<Scope<SqlStatement>>                    m_selects       {};     ///<Per power of two of the stale ids, index 0 reads all rows.
+    std::mutex                                          m_loadMutex     {};     ///<One load at a time, readers are not blocked.
+    mutable std::shared_mutex                           m_mutex         {};
+    std::map<std::string, Language, std::less<>>        m_languages     {};
+    u64                                                 m_generation    {};     ///<Bumped by every invalidation.
+};
+
+template<typename T>
+std::optional<T> MixedRow::get(std::string_view column) const
+{
+    const auto index = m_view->column(column);
+    if (!index.has_value() || m_view->isNull(m_index, *index)) return std::nullopt;
+    return fromColumnText<T>(m_view->text(m_index, *index));
+}
+
+TEGRA_NAMESPACE_END
+
+#endif  // TEGRA_MIXEDCACHE_HPP
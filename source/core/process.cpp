@@ -0,0 +1,324 @@
+#include "process.hpp"
+#include "core.hpp"
+#include "logger.hpp"
+
+#if defined(PLATFORM_WINDOWS)
+#include <cstdio>
+#else
+#include <spawn.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+extern char** environ;
+#endif
+
+TEGRA_USING_NAMESPACE Tegra::eLogger;
+
+TEGRA_NAMESPACE_BEGIN(Tegra::CMS)
+
+TEGRA_ANONYMOUS_NAMESPACE_BEGIN
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::size_t ReadBufferSize = 64 * 1024;
+
+void appendOutput(ProcessResult& result, const char* data, std::size_t size, const ProcessOptions& options)
+{
+    const std::size_t room = options.maxOutput - std::min(options.maxOutput, result.output.size());
+    if (size > room) {
+        result.truncated = true;
+        size = room;
+    }
+    result.output.append(data, size);
+}
+
+#if !defined(PLATFORM_WINDOWS)
+
+//! Milliseconds until the deadline for poll, -1 if there is no deadline.
+int remainingOf(const std::optional<Clock::time_point>& deadline)
+{
+    if (!deadline.has_value()) return -1;
+    const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(*deadline - Clock::now()).count();
+    return static_cast<int>(std::clamp<long long>(left, 0, std::numeric_limits<int>::max()));
+}
+
+int exitCodeOf(int status)
+{
+    if (WIFEXITED(status)) return WEXITSTATUS(status);
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return -1;
+}
+
+/*!
+ * @brief waitExit function waits for the child until the deadline.
+ * On Linux a pidfd is polled so the wait keeps the timeout, elsewhere (or on kernels without pidfd_open)
+ * the wait blocks, the child has already closed its output at this point.
+ * @returns true if the child has exited, its status is stored in status.
+ */
+bool waitExit(pid_t pid, const std::optional<Clock::time_point>& deadline, int& status)
+{
+#if defined(__linux__) && defined(SYS_pidfd_open)
+    if (deadline.has_value()) {
+        const int pidfd = static_cast<int>(::syscall(SYS_pidfd_open, pid, 0));
+        if (pidfd >= 0) {
+            int ready = 0;
+            do {
+                pollfd descriptor {pidfd, POLLIN, 0};
+                ready = ::poll(&descriptor, 1, remainingOf(deadline));
+            } while (ready < 0 && errno == EINTR);
+            ::close(pidfd);
+            if (ready == 0) return false;
+        }
+    }
+#else
+    (void)deadline;
+#endif
+    pid_t waited = 0;
+    do {
+        waited = ::waitpid(pid, &status, 0);
+    } while (waited < 0 && errno == EINTR);
+    return waited == pid;
+}
+
+void executePosix(const VectorString& arguments, const ProcessOptions& options, ProcessResult& result)
+{
+    int pipes[2];
+#if defined(__linux__)
+    if (::pipe2(pipes, O_CLOEXEC) != 0) {
+        result.output = std::strerror(errno);
+        return;
+    }
+#else
+    //! No pipe2 on macOS, a child spawned by another thread in between may inherit the ends.
+    if (::pipe(pipes) != 0) {
+        result.output = std::strerror(errno);
+        return;
+    }
+    ::fcntl(pipes[0], F_SETFD, FD_CLOEXEC);
+    ::fcntl(pipes[1], F_SETFD, FD_CLOEXEC);
+#endif
+    ::fcntl(pipes[0], F_SETFL, ::fcntl(pipes[0], F_GETFL) | O_NONBLOCK);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, pipes[1], STDOUT_FILENO);
+    if (options.mergeErrors) {
+        posix_spawn_file_actions_adddup2(&actions, pipes[1], STDERR_FILENO);
+    }
+
+    //! The child leads its own group, so a timeout kills a whole shell pipeline.
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attributes, 0);
+
+    std::vector<char*> argv;
+    argv.reserve(arguments.size() + 1);
+    for (const auto& argument : arguments) {
+        argv.push_back(const_cast<char*>(argument.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    pid_t pid = 0;
+    const int spawned = ::posix_spawnp(&pid, argv.front(), &actions, &attributes, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attributes);
+    ::close(pipes[1]);
+    if (spawned != 0) {
+        ::close(pipes[0]);
+        result.output = std::strerror(spawned);
+        result.exitCode = 127;
+        return;
+    }
+
+    std::optional<Clock::time_point> deadline;
+    if (options.timeout.count() > 0) {
+        deadline = Clock::now() + options.timeout;
+    }
+
+    std::vector<char> buffer(ReadBufferSize);
+    bool open = true;
+    while (open) {
+        pollfd descriptor {pipes[0], POLLIN, 0};
+        const int ready = ::poll(&descriptor, 1, remainingOf(deadline));
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready <= 0) {
+            result.timedOut = ready == 0;
+            break;
+        }
+        //! Drain everything that is available before polling again.
+        while (true) {
+            const ssize_t count = ::read(pipes[0], buffer.data(), buffer.size());
+            if (count > 0) {
+                appendOutput(result, buffer.data(), static_cast<std::size_t>(count), options);
+                continue;
+            }
+            if (count < 0 && errno == EINTR) continue;
+            if (count == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) open = false;
+            break;
+        }
+    }
+    ::close(pipes[0]);
+
+    //! The output is closed, but the child may still be alive until the deadline.
+    int status = 0;
+    bool exited = false;
+    if (!result.timedOut) {
+        exited = waitExit(pid, deadline, status);
+        result.timedOut = !exited;
+    }
+    if (result.timedOut) {
+        ::kill(-pid, SIGKILL);
+        exited = ::waitpid(pid, &status, 0) == pid;
+    }
+    result.exitCode = exited ? exitCodeOf(status) : -1;
+}
+
+#else
+
+void executeWindows(const VectorString& arguments, const ProcessOptions& options, ProcessResult& result)
+{
+    //! There is no posix_spawn, the timeout is not enforced but the caller is still not blocked.
+    std::string commandLine;
+    for (const auto& argument : arguments) {
+        if (!commandLine.empty()) commandLine.push_back(' ');
+        commandLine.append(argument);
+    }
+    if (options.mergeErrors) commandLine.append(" 2>&1");
+    FILE* stream = _popen(commandLine.c_str(), "r");
+    if (stream == nullptr) return;
+    std::vector<char> buffer(ReadBufferSize);
+    while (const std::size_t count = std::fread(buffer.data(), 1, buffer.size(), stream)) {
+        appendOutput(result, buffer.data(), count, options);
+    }
+    result.exitCode = _pclose(stream);
+}
+
+#endif
+
+TEGRA_NAMESPACE_END
+
+bool ProcessResult::succeeded() const __tegra_noexcept
+{
+    return exitCode == 0 && !timedOut;
+}
+
+ProcessExecutor::ProcessExecutor(std::size_t maxConcurrent)
+{
+    const std::size_t workers = std::max<std::size_t>(maxConcurrent, 1);
+    m_workers.reserve(workers);
+    for (std::size_t i = 0; i < workers; ++i) {
+        m_workers.emplace_back(&ProcessExecutor::work, this);
+    }
+}
+
+ProcessExecutor::~ProcessExecutor()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_stop = true;
+    }
+    m_ready.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+std::future<ProcessResult> ProcessExecutor::run(VectorString arguments, ProcessOptions options)
+{
+    auto promise = CreateRef<std::promise<ProcessResult>>();
+    auto future = promise->get_future();
+    run(std::move(arguments), [promise](ProcessResult&& result) { promise->set_value(std::move(result)); }, options);
+    return future;
+}
+
+void ProcessExecutor::run(VectorString arguments, Callback callback, ProcessOptions options)
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_jobs.push_back({std::move(arguments), options, std::move(callback)});
+    }
+    m_ready.notify_one();
+}
+
+std::future<ProcessResult> ProcessExecutor::shell(const std::string& command, ProcessOptions options)
+{
+    auto promise = CreateRef<std::promise<ProcessResult>>();
+    auto future = promise->get_future();
+    shell(command, [promise](ProcessResult&& result) { promise->set_value(std::move(result)); }, options);
+    return future;
+}
+
+void ProcessExecutor::shell(const std::string& command, Callback callback, ProcessOptions options)
+{
+#if defined(PLATFORM_WINDOWS)
+    run({command}, std::move(callback), options);
+#else
+    run({"/bin/sh", "-c", command}, std::move(callback), options);
+#endif
+}
+
+ProcessResult ProcessExecutor::execute(const VectorString& arguments, const ProcessOptions& options)
+{
+    ProcessResult result;
+    if (arguments.empty()) {
+        return result;
+    }
+    const auto start = Clock::now();
+#if defined(PLATFORM_WINDOWS)
+    executeWindows(arguments, options, result);
+#else
+    executePosix(arguments, options, result);
+#endif
+    result.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start);
+    return result;
+}
+
+std::size_t ProcessExecutor::pending() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_jobs.size() + m_running;
+}
+
+ProcessExecutor& ProcessExecutor::shared()
+{
+    static ProcessExecutor executor;
+    return executor;
+}
+
+void ProcessExecutor::work()
+{
+    while (true) {
+        Job job;
+        {
+            std::unique_lock lock(m_mutex);
+            m_ready.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+            if (m_jobs.empty()) return;
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            ++m_running;
+        }
+        ProcessResult result = execute(job.arguments, job.options);
+        try {
+            job.done(std::move(result));
+        } catch (const std::exception& e) {
+            if(DeveloperMode::IsEnable) {
+                Log(FROM_TEGRA_STRING(e.what()), eLogger::LoggerType::Critical);
+            }
+        } catch (...) {
+            if(DeveloperMode::IsEnable) {
+                Log("Unknown exception in the callback of a child process.", eLogger::LoggerType::Critical);
+            }
+        }
+        std::lock_guard lock(m_mutex);
+        --m_running;
+    }
+}
+
+TEGRA_NAMESPACE_END
@@ -0,0 +1,158 @@
+/*!
+ * MIT License
+ *
+ * Copyright (c) 2022 Kambiz Asadzadeh
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef TEGRA_PROCESS_HPP
+#define TEGRA_PROCESS_HPP
+
+#include "common.hpp"
+
+TEGRA_USING_NAMESPACE Tegra::Types;
+
+TEGRA_NAMESPACE_BEGIN(Tegra::CMS)
+
+/*!
+ * @brief Options of a child process.
+ */
+struct ProcessOptions final
+{
+    std::chrono::milliseconds   timeout     {5000};             ///<The child is killed after this time, zero means no limit.
+    std::size_t                 maxOutput   {4 * 1024 * 1024};  ///<Output after this size is read but dropped.
+    bool                        mergeErrors {true};             ///<Standard error is written into the output as well.
+};
+
+/*!
+ * @brief Result of a child process.
+ */
+struct ProcessResult final
+{
+    std::string                 output      {};     ///<Standard output of the child.
+    int                         exitCode    {-1};   ///<Exit code, 128 + signal number if the child was killed.
+    bool                        timedOut    {};     ///<True if the child was killed by the timeout.
+    bool                        truncated   {};     ///<True if the output was longer than the limit.
+    std::chrono::milliseconds   elapsed     {};     ///<Wall time of the child.
+
+    /*!
+     * @returns true if the child has exited with zero before the timeout.
+     */
+    __tegra_no_discard bool succeeded() const __tegra_noexcept;
+};
+
+/*!
+ * @brief The ProcessExecutor class runs child processes on a small pool of workers.
+ * Children are started with posix_spawn (no fork of the whole server), their output is read from
+ * a non-blocking pipe with poll, so every call has a hard timeout. The number of workers caps the
+ * number of children that run at the same time, other calls wait in a queue.
+ * The caller gets a future or a callback and is never blocked by a slow child.
+ * @example auto result = ProcessExecutor::shared().run({"uname", "-n"}); ... result.get().output;
+ */
+class ProcessExecutor
+{
+public:
+    using Callback = std::function<void(ProcessResult&&)>;
+
+    /*!
+     * @param maxConcurrent is the maximum number of children that run at the same time.
+     */
+    explicit ProcessExecutor(std::size_t maxConcurrent = 4);
+    ProcessExecutor(const ProcessExecutor& rhsExecutor) = delete;
+    ProcessExecutor(ProcessExecutor&& rhsExecutor) noexcept = delete;
+    ProcessExecutor& operator=(const ProcessExecutor& rhsExecutor) = delete;
+    ProcessExecutor& operator=(ProcessExecutor&& rhsExecutor) noexcept = delete;
+
+    /*!
+     * @brief The queued calls are finished before the workers stop.
+     */
+    ~ProcessExecutor();
+
+    /*!
+     * @brief run function queues a program.
+     * @param arguments are the program (searched in PATH) and its arguments, no shell is involved.
+     * @param options of the child.
+     * @returns future of the result.
+     */
+    __tegra_no_discard std::future<ProcessResult> run(VectorString arguments, ProcessOptions options = {});
+
+    /*!
+     * @brief run function queues a program and calls back on a worker thread when it's finished.
+     * @param arguments are the program (searched in PATH) and its arguments, no shell is involved.
+     * @param callback receives the result, it should not block.
+     * @param options of the child.
+     */
+    void run(VectorString arguments, Callback callback, ProcessOptions options = {});
+
+    /*!
+     * @brief shell function queues a command line that is executed by /bin/sh.
+     * @param command is the command line, for example pipes are allowed.
+     * @param options of the child.
+     * @returns future of the result.
+     */
+    __tegra_no_discard std::future<ProcessResult> shell(const std::string& command, ProcessOptions options = {});
+
+    /*!
+     * @brief shell function queues a command line that is executed by /bin/sh and calls back when it's finished.
+     * @param command is the command line, for example pipes are allowed.
+     * @param callback receives the result, it should not block.
+     * @param options of the child.
+     */
+    void shell(const std::string& command, Callback callback, ProcessOptions options = {});
+
+    /*!
+     * @brief execute function runs a program on the calling thread.
+     * @param arguments are the program (searched in PATH) and its arguments.
+     * @param options of the child.
+     * @returns result of the child.
+     */
+    __tegra_no_discard static ProcessResult execute(const VectorString& arguments, const ProcessOptions& options = {});
+
+    /*!
+     * @brief pending function gets number of calls that are queued or running.
+     */
+    __tegra_no_discard std::size_t pending() const;
+
+    /*!
+     * @brief shared function gets the executor of the system.
+     */
+    __tegra_no_discard static ProcessExecutor& shared();
+
+private:
+    struct Job final
+    {
+        VectorString    arguments   {};
+        ProcessOptions  options     {};
+        Callback        done        {};
+    };
+
+    void work();
+
+    mutable std::mutex          m_mutex     {};
+    std::condition_variable     m_ready     {};
+    std::deque<Job>             m_jobs      {};
+    std::vector<std::thread>    m_workers   {};
+    std::size_t                 m_running   {};
+    bool                        m_stop      {};
+};
+
+TEGRA_NAMESPACE_END
+
+#endif // TEGRA_PROCESS_HPP
@@ -0,0 +1,589 @@
+#include "querycache.hpp"
+#include "router.hpp"
+#include "tableregistry.hpp"
+#include "core.hpp"
+#include "logger.hpp"
+
+TEGRA_USING_NAMESPACE Tegra;
+TEGRA_USING_NAMESPACE Tegra::CMS;
+TEGRA_USING_NAMESPACE Tegra::eLogger;
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+TEGRA_ANONYMOUS_NAMESPACE_BEGIN
+
+//! Results that are bigger than this part of maxBytes are not kept, one of them would flush the whole cache.
+constexpr std::size_t MaxEntryShare = 8;
+
+//! Expired rows of the "cache" table are deleted after this many saves.
+constexpr u64 PurgeInterval = 256;
+
+//! Milliseconds since epoch, the expires column of the "cache" table.
+using Stamp = std::chrono::milliseconds::rep;
+
+struct Token final
+{
+    std::string_view    text    {};
+    bool                name    {};     ///<A word or a quoted identifier.
+    bool                quoted  {};
+};
+
+/*!
+ * @brief Calls visit for every word, quoted identifier and '.', ',', '(', ')' of a statement, strings and comments are skipped.
+ */
+template<typename Visit>
+void forEachToken(std::string_view sql, const Visit& visit)
+{
+    std::size_t i = 0;
+    while (i < sql.size()) {
+        const char c = sql[i];
+        if (c == '\'') {
+            const std::size_t end = sql.find(c, i + 1);
+            i = end == std::string_view::npos ? sql.size() : end + 1;
+        } else if (c == '"' || c == '`') {
+            const std::size_t end = std::min(sql.find(c, i + 1), sql.size());
+            visit(Token {sql.substr(i + 1, end - i - 1), true, true});
+            i = end == sql.size() ? end : end + 1;
+        } else if (c == '-' && i + 1 < sql.size() && sql[i + 1] == '-') {
+            const std::size_t end = sql.find('\n', i);
+            i = end == std::string_view::npos ? sql.size() : end + 1;
+        } else if (c == '/' && i + 1 < sql.size() && sql[i + 1] == '*') {
+            const std::size_t end = sql.find("*/", i + 2);
+            i = end == std::string_view::npos ? sql.size() : end + 2;
+        } else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            const std::size_t start = i;
+            while (i < sql.size() && (std::isalnum(static_cast<unsigned char>(sql[i])) || sql[i] == '_' || sql[i] == '$')) ++i;
+            visit(Token {sql.substr(start, i - start), true, false});
+        } else {
+            if (c == '.' || c == ',' || c == '(' || c == ')') visit(Token {sql.substr(i, 1), false, false});
+            ++i;
+        }
+    }
+}
+
+bool equalsWord(std::string_view word, std::string_view keyword) __tegra_noexcept
+{
+    return word.size() == keyword.size()
+        && std::equal(word.begin(), word.end(), keyword.begin(), [](char a, char b) {
+               return std::toupper(static_cast<unsigned char>(a)) == b;
+           });
+}
+
+bool isAnyOf(std::string_view word, std::initializer_list<std::string_view> keywords) __tegra_noexcept
+{
+    return std::any_of(keywords.begin(), keywords.end(), [word](std::string_view keyword) { return equalsWord(word, keyword); });
+}
+
+std::string lowered(std::string_view text)
+{
+    std::string result(text);
+    std::transform(result.begin(), result.end(), result.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return result;
+}
+
+/*!
+ * @brief Builds the key of a statement, parameters are length prefixed so that no two lists give the same key.
+ */
+std::string keyOf(std::string_view sql, const SqlParams& params)
+{
+    std::string key = QueryCache::normalize(sql);
+    for (const auto& param : params) {
+        key.push_back('\n');
+        if (param.has_value()) {
+            key.append(std::to_string(param->size())).append(":").append(*param);
+        } else {
+            key.push_back('-');
+        }
+    }
+    return key;
+}
+
+/*!
+ * @brief FNV-1a of a key as hex, it's the primary key of the "cache" table.
+ */
+std::string nameOf(std::string_view key)
+{
+    u64 hash = 14695981039346656037ULL;
+    for (const unsigned char c : key) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    std::array<char, 16> hex {};
+    for (std::size_t i = 0; i < hex.size(); ++i) {
+        hex[hex.size() - 1 - i] = "0123456789abcdef"[(hash >> (i * 4)) & 0xF];
+    }
+    return std::string(hex.data(), hex.size());
+}
+
+std::size_t bytesOf(const std::string& key, const ResultView& result) __tegra_noexcept
+{
+    std::size_t bytes = key.size() + 128;
+    for (const auto& column : result.columns()) bytes += column.size() + sizeof(std::string);
+    for (std::size_t row = 0; row < result.size(); ++row) {
+        for (std::size_t column = 0; column < result.columns().size(); ++column) {
+            bytes += result.text(row, column).size() + sizeof(ResultView::Cell);
+        }
+    }
+    return bytes;
+}
+
+/*!
+ * @brief Writes a result as length prefixed fields, "-" is NULL: columns, rows, the names, then the cells row by row.
+ */
+std::string encode(const ResultView& result)
+{
+    std::string text;
+    const auto field = [&text](std::string_view value) {
+        text.append(std::to_string(value.size())).append(":").append(value);
+    };
+    field(std::to_string(result.columns().size()));
+    field(std::to_string(result.size()));
+    for (const auto& column : result.columns()) field(column);
+    for (std::size_t row = 0; row < result.size(); ++row) {
+        for (std::size_t column = 0; column < result.columns().size(); ++column) {
+            if (result.isNull(row, column)) text.push_back('-');
+            else field(result.text(row, column));
+        }
+    }
+    return text;
+}
+
+/*!
+ * @brief Reads a result of encode, the cells point into the text that is kept by the view.
+ * @returns std::nullopt if the text is damaged.
+ */
+std::optional<ResultView> decode(std::string value)
+{
+    const auto owner = CreateRef<const std::string>(std::move(value));
+    const std::string_view text {*owner};
+    std::size_t pos = 0;
+    const auto field = [&text, &pos]() -> std::optional<ResultView::Cell> {
+        if (pos < text.size() && text[pos] == '-') {
+            ++pos;
+            return ResultView::Cell {};
+        }
+        std::size_t size = 0;
+        const auto [end, error] = std::from_chars(text.data() + pos, text.data() + text.size(), size);
+        pos = static_cast<std::size_t>(end - text.data());
+        if (error != std::errc() || pos >= text.size() || text[pos] != ':' || size > text.size() - pos - 1) return std::nullopt;
+        const ResultView::Cell cell {text.data() + pos + 1, size};
+        pos += size + 1;
+        return cell;
+    };
+    const auto number = [&field]() -> std::optional<std::size_t> {
+        const auto cell = field();
+        std::size_t value = 0;
+        if (!cell.has_value() || cell->data == nullptr
+            || std::from_chars(cell->data, cell->data + cell->size, value).ec != std::errc()) return std::nullopt;
+        return value;
+    };
+    const auto columns = number();
+    const auto rows = number();
+    if (!columns.has_value() || !rows.has_value() || *columns == 0 || *rows > text.size()) return std::nullopt;
+    VectorString names;
+    names.reserve(*columns);
+    for (std::size_t i = 0; i < *columns; ++i) {
+        const auto name = field();
+        if (!name.has_value() || name->data == nullptr) return std::nullopt;
+        names.emplace_back(name->data, name->size);
+    }
+    std::vector<ResultView::Cell> cells;
+    cells.reserve(*columns * *rows);
+    for (std::size_t i = 0; i < *columns * *rows; ++i) {
+        const auto cell = field();
+        if (!cell.has_value()) return std::nullopt;
+        cells.push_back(*cell);
+    }
+    if (pos != text.size()) return std::nullopt;
+    return ResultView(std::move(names), std::move(cells), owner);
+}
+
+Stamp nowMilliseconds() __tegra_noexcept
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void warn(std::string_view what, const std::exception& e)
+{
+    if(DeveloperMode::IsEnable) {
+        Log("The cache table could not " + std::string(what) + ": " + std::string(e.what()), LoggerType::Warning);
+    }
+}
+
+TEGRA_NAMESPACE_END
+
+double QueryCacheStats::hitRatio() const __tegra_noexcept
+{
+    const u64 reads = hits + persistentHits + misses;
+    return reads == 0 ? 0.0 : static_cast<double>(hits + persistentHits) / static_cast<double>(reads);
+}
+
+QueryCache::QueryCache(ConnectionPool& pool, const QueryCacheOptions& options) : m_pool(pool), m_options(options)
+{
+}
+
+ResultView QueryCache::select(std::string_view sql, const SqlParams& params, std::chrono::milliseconds ttl)
+{
+    if (!QueryRouter::isReadOnly(sql)) {
+        ResultView result = m_pool.select(sql, params);
+        const VectorString tables = tablesOf(sql);
+        if (tables.empty()) invalidate();
+        for (const auto& table : tables) invalidate(table);
+        return result;
+    }
+    if (m_options.maxBytes == 0) {
+        return m_pool.select(sql, params);
+    }
+
+    std::string key = keyOf(sql, params);
+    const VectorString tags = tablesOf(sql);
+    u64 epoch = 0;
+    std::vector<u64> generations;
+    generations.reserve(tags.size());
+    {
+        std::lock_guard lock(m_mutex);
+        if (const Entry* entry = find(key)) {
+            ++m_stats.hits;
+            return entry->result;
+        }
+        epoch = m_epoch;
+        for (const auto& tag : tags) {
+            const auto found = m_tags.find(tag);
+            generations.push_back(found != m_tags.end() ? found->second.generation : 0);
+        }
+    }
+
+    const auto lifetime = ttl.count() > 0 ? ttl : m_options.ttl;
+    const bool persistent = m_options.persistentTtl.count() > 0;
+    if (persistent) {
+        if (auto loaded = load(key)) {
+            {
+                std::lock_guard lock(m_mutex);
+                ++m_stats.persistentHits;
+            }
+            ResultView result = loaded->first;
+            store(std::move(key), result, tags, epoch, generations, std::chrono::steady_clock::now() + std::min(lifetime, loaded->second));
+            return result;
+        }
+    }
+    ResultView result = m_pool.select(sql, params);
+    {
+        std::lock_guard lock(m_mutex);
+        ++m_stats.misses;
+    }
+    //! A result that raced with a write is not shared with the other processes either.
+    const std::string saved = persistent ? key : std::string();
+    if (store(std::move(key), result, tags, epoch, generations, std::chrono::steady_clock::now() + lifetime) && persistent) {
+        save(saved, result, tags, std::min(lifetime, m_options.persistentTtl));
+        //! A write that bumps a generation after this check runs its forget after the row was written,
+        //! one that bumped it during the save may have run its forget before, so the row is deleted here.
+        bool moved = false;
+        {
+            std::lock_guard lock(m_mutex);
+            moved = !unchanged(epoch, tags, generations);
+        }
+        if (moved) discard(saved);
+    }
+    return result;
+}
+
+u64 QueryCache::execute(std::string_view sql, const SqlParams& params)
+{
+    const u64 affected = m_pool.execute(sql, params).affectedRows;
+    const VectorString tables = tablesOf(sql);
+    if (tables.empty()) invalidate();
+    for (const auto& table : tables) invalidate(table);
+    return affected;
+}
+
+void QueryCache::invalidate(std::string_view table)
+{
+    const std::string tag = lowered(table);
+    {
+        std::lock_guard lock(m_mutex);
+        Tag& entries = m_tags[tag];
+        ++entries.generation;
+        //! erase changes the key set of the tag, so the keys are taken first.
+        const std::vector<std::string_view> keys(entries.keys.begin(), entries.keys.end());
+        for (const auto key : keys) {
+            if (const auto found = m_index.find(key); found != m_index.end()) {
+                erase(found->second);
+                ++m_stats.invalidations;
+            }
+        }
+    }
+    if (m_options.persistentTtl.count() > 0) forget(tag);
+}
+
+void QueryCache::invalidate()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        ++m_epoch;
+        m_stats.invalidations += m_lru.size();
+        m_index.clear();
+        m_lru.clear();
+        m_tags.clear();
+        m_stats.bytes = 0;
+    }
+    if (m_options.persistentTtl.count() > 0) forget({});
+}
+
+QueryCacheStats QueryCache::stats() const
+{
+    std::lock_guard lock(m_mutex);
+    QueryCacheStats stats = m_stats;
+    stats.entries = m_lru.size();
+    return stats;
+}
+
+const QueryCacheOptions& QueryCache::options() const __tegra_noexcept
+{
+    return m_options;
+}
+
+std::string QueryCache::normalize(std::string_view sql)
+{
+    std::string text;
+    text.reserve(sql.size());
+    bool space = false;
+    std::size_t i = 0;
+    while (i < sql.size()) {
+        const char c = sql[i];
+        if (c == '\'' || c == '"' || c == '`') {
+            const std::size_t end = std::min(sql.find(c, i + 1), sql.size() - 1);
+            if (space && !text.empty()) text.push_back(' ');
+            space = false;
+            text.append(sql.substr(i, end - i + 1));
+            i = end + 1;
+        } else if ((c == '-' && i + 1 < sql.size() && sql[i + 1] == '-') || (c == '/' && i + 1 < sql.size() && sql[i + 1] == '*')) {
+            const bool line = c == '-';
+            const std::size_t end = sql.find(line ? "\n" : "*/", i + 2);
+            i = end == std::string_view::npos ? sql.size() : end + (line ? 1 : 2);
+            space = true;
+        } else if (std::isspace(static_cast<unsigned char>(c))) {
+            space = true;
+            ++i;
+        } else {
+            if (space && !text.empty()) text.push_back(' ');
+            space = false;
+            text.push_back(c);
+            ++i;
+        }
+    }
+    while (!text.empty() && (text.back() == ';' || text.back() == ' ')) text.pop_back();
+    return text;
+}
+
+VectorString QueryCache::tablesOf(std::string_view sql)
+{
+    VectorString tables;
+    const auto add = [&tables](std::string name) {
+        if (!name.empty() && std::find(tables.begin(), tables.end(), name) == tables.end()) tables.push_back(std::move(name));
+    };
+    std::string name;
+    bool inName = false;
+    bool afterDot = false;
+    bool expect = false;
+    //! Whether a FROM list is open, per parenthesis depth, a derived table must not end the list around it.
+    std::vector<bool> fromLists {false};
+    forEachToken(sql, [&](const Token& token) {
+        if (inName) {
+            if (token.text == "." && !token.quoted) {
+                afterDot = true;
+                return;
+            }
+            //! Schema qualified names keep only the table.
+            if (afterDot && token.name) {
+                name = lowered(token.text);
+                afterDot = false;
+                return;
+            }
+            add(std::move(name));
+            name.clear();
+            inName = false;
+            afterDot = false;
+        }
+        if (expect) {
+            if (token.name && !token.quoted && isAnyOf(token.text, {"ONLY", "IF", "NOT", "EXISTS", "LATERAL", "TABLE", "IGNORE", "LOW_PRIORITY"})) {
+                return;
+            }
+            expect = false;
+            if (token.quoted || (token.name && !isAnyOf(token.text, {"SELECT", "SET", "WHERE", "VALUES", "DEFAULT", "WITH"}))) {
+                name = lowered(token.text);
+                inName = true;
+                return;
+            }
+        }
+        if (!token.name) {
+            if (token.text == "(") {
+                fromLists.push_back(false);
+            } else if (token.text == ")") {
+                if (fromLists.size() > 1) fromLists.pop_back();
+            } else if (token.text == "," && fromLists.back()) {
+                expect = true;
+            }
+            return;
+        }
+        if (token.quoted) return;
+        if (equalsWord(token.text, FROM)) {
+            expect = true;
+            fromLists.back() = true;
+        } else if (isAnyOf(token.text, {"JOIN", "INTO", "UPDATE", "TABLE", "TRUNCATE"})) {
+            expect = true;
+        } else if (fromLists.back() && equalsWord(token.text, "USING")) {
+            //! "DELETE FROM t USING u, v" lists tables, "JOIN u USING (id)" is followed by a parenthesis.
+            expect = true;
+        } else if (fromLists.back() && isAnyOf(token.text, {"WHERE", "GROUP", "ORDER", "HAVING", "LIMIT", "UNION",
+                                                            "INTERSECT", "EXCEPT", "WINDOW", "RETURNING", "SET", "SELECT"})) {
+            //! ON keeps the list open, "a JOIN b ON a.id = b.id, c" goes on with c.
+            fromLists.back() = false;
+        }
+    });
+    if (inName) add(std::move(name));
+    return tables;
+}
+
+const QueryCache::Entry* QueryCache::find(std::string_view key)
+{
+    const auto found = m_index.find(key);
+    if (found == m_index.end()) {
+        return nullptr;
+    }
+    if (found->second->expires <= std::chrono::steady_clock::now()) {
+        erase(found->second);
+        ++m_stats.evictions;
+        return nullptr;
+    }
+    m_lru.splice(m_lru.begin(), m_lru, found->second);
+    return &m_lru.front();
+}
+
+bool QueryCache::unchanged(u64 epoch, const VectorString& tags, const std::vector<u64>& generations) const
+{
+    if (epoch != m_epoch) {
+        return false;
+    }
+    for (std::size_t i = 0; i < tags.size(); ++i) {
+        const auto found = m_tags.find(tags[i]);
+        if ((found != m_tags.end() ? found->second.generation : 0) != generations[i]) return false;
+    }
+    return true;
+}
+
+bool QueryCache::store(std::string key, const ResultView& result, const VectorString& tags, u64 epoch,
+                       const std::vector<u64>& generations, std::chrono::steady_clock::time_point expires)
+{
+    const std::size_t bytes = bytesOf(key, result);
+    std::lock_guard lock(m_mutex);
+    if (!unchanged(epoch, tags, generations)) {
+        return false;
+    }
+    if (bytes > m_options.maxBytes / MaxEntryShare) {
+        return true;
+    }
+    if (const auto found = m_index.find(key); found != m_index.end()) {
+        erase(found->second);
+    }
+    m_lru.push_front(Entry {std::move(key), result, tags, expires, bytes});
+    const std::string_view stored {m_lru.front().key};
+    m_index.emplace(stored, m_lru.begin());
+    for (const auto& tag : tags) {
+        m_tags[tag].keys.insert(stored);
+    }
+    m_stats.bytes += bytes;
+    ++m_stats.stores;
+    while (m_stats.bytes > m_options.maxBytes && !m_lru.empty()) {
+        erase(std::prev(m_lru.end()));
+        ++m_stats.evictions;
+    }
+    return true;
+}
+
+void QueryCache::erase(EntryList::iterator entry)
+{
+    const std::string_view key {entry->key};
+    for (const auto& tag : entry->tags) {
+        if (const auto found = m_tags.find(tag); found != m_tags.end()) found->second.keys.erase(key);
+    }
+    m_index.erase(key);
+    m_stats.bytes -= entry->bytes;
+    m_lru.erase(entry);
+}
+
+std::optional<std::pair<ResultView, std::chrono::milliseconds>> QueryCache::load(const std::string& key)
+{
+    const std::string table(TableRegistry::table(TEGRA_TABLES::CACHE, TableType::KeyStruct));
+    try {
+        const ResultView rows = m_pool.select("SELECT query, value, expires FROM " + table + " WHERE name = ?", {nameOf(key)});
+        if (rows.empty() || rows.text(0, 0) != key) {
+            return std::nullopt;
+        }
+        const auto expires = rows.get<Stamp>(0, 2);
+        const Stamp now = nowMilliseconds();
+        if (!expires.has_value() || *expires <= now) {
+            return std::nullopt;
+        }
+        auto result = decode(std::string(rows.text(0, 1)));
+        if (!result.has_value()) {
+            return std::nullopt;
+        }
+        return std::make_pair(std::move(*result), std::chrono::milliseconds(*expires - now));
+    } catch (const std::exception& e) {
+        warn("be read", e);
+        return std::nullopt;
+    }
+}
+
+void QueryCache::save(const std::string& key, const ResultView& result, const VectorString& tags, std::chrono::milliseconds ttl)
+{
+    std::string value = encode(result);
+    //! Text columns do not take NUL bytes.
+    if (key.find('\0') != std::string::npos || value.find('\0') != std::string::npos) {
+        return;
+    }
+    std::string tagList = ",";
+    for (const auto& tag : tags) tagList.append(tag).push_back(',');
+    const std::string table(TableRegistry::table(TEGRA_TABLES::CACHE, TableType::KeyStruct));
+    std::string sql = "INSERT INTO " + table + " (name, query, tags, value, expires) VALUES (?, ?, ?, ?, ?)";
+    if (m_pool.config().driver == DriverTypes::MySQL) {
+        sql.append(" ON DUPLICATE KEY UPDATE query = VALUES(query), tags = VALUES(tags), value = VALUES(value), expires = VALUES(expires)");
+    } else {
+        sql.append(" ON CONFLICT (name) DO UPDATE SET query = excluded.query, tags = excluded.tags, value = excluded.value, expires = excluded.expires");
+    }
+    const Stamp now = nowMilliseconds();
+    try {
+        m_pool.execute(sql, {nameOf(key), key, std::move(tagList), std::move(value), std::to_string(now + ttl.count())});
+        if (m_saves.fetch_add(1, std::memory_order_relaxed) % PurgeInterval == PurgeInterval - 1) {
+            m_pool.execute("DELETE FROM " + table + " WHERE expires < ?", {std::to_string(now)});
+        }
+    } catch (const std::exception& e) {
+        warn("be written", e);
+    }
+}
+
+void QueryCache::discard(const std::string& key)
+{
+    const std::string name(TableRegistry::table(TEGRA_TABLES::CACHE, TableType::KeyStruct));
+    try {
+        m_pool.execute("DELETE FROM " + name + " WHERE name = ? AND query = ?", {nameOf(key), key});
+    } catch (const std::exception& e) {
+        warn("be cleared", e);
+    }
+}
+
+void QueryCache::forget(std::string_view table)
+{
+    const std::string name(TableRegistry::table(TEGRA_TABLES::CACHE, TableType::KeyStruct));
+    try {
+        if (table.empty()) {
+            m_pool.execute("DELETE FROM " + name);
+        } else {
+            m_pool.execute("DELETE FROM " + name + " WHERE tags LIKE ?", {"%," + std::string(table) + ",%"});
+        }
+    } catch (const std::exception& e) {
+        warn("be cleared", e);
+    }
+}
+
+TEGRA_NAMESPACE_END
@@ -0,0 +1,203 @@
+/*!
+ * MIT License
+ *
+ * Copyright (c) 2022 Kambiz Asadzadeh
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#ifndef TEGRA_QUERYCACHE_HPP
+#define TEGRA_QUERYCACHE_HPP
+
+#include "connectionpool.hpp"
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+/*!
+ * @brief The QueryCacheOptions struct holds the limits of a QueryCache.
+ */
+struct QueryCacheOptions final
+{
+    std::size_t                 maxBytes        {64 * 1024 * 1024};    ///<Memory of all entries, zero turns the cache off.
+    std::chrono::milliseconds   ttl             {60000};                ///<Lifetime of an entry if the query gives none.
+    std::chrono::milliseconds   persistentTtl   {};                     ///<Lifetime of an entry inside the "cache" table, zero keeps entries in memory only.
+};
+
+/*!
+ * @brief The QueryCacheStats struct is a snapshot of the counters of a QueryCache.
+ */
+struct QueryCacheStats final
+{
+    u64         hits            {};     ///<Reads that were answered from memory.
+    u64         persistentHits  {};     ///<Reads that were answered from the "cache" table.
+    u64         misses          {};     ///<Reads that went to the server.
+    u64         stores          {};     ///<Results that were kept.
+    u64         evictions       {};     ///<Entries that were dropped for memory or age.
+    u64         invalidations   {};     ///<Entries that were dropped by a write.
+    std::size_t entries         {};
+    std::size_t bytes           {};
+
+    /*!
+     * @returns hits of both tiers over all reads, zero if nothing was read.
+     */
+    __tegra_no_discard double hitRatio() const __tegra_noexcept;
+};
+
+/*!
+ * @brief The QueryCache class keeps results of read only statements in memory, keyed by the normalized sql and its parameters.
+ * Every entry is tagged with the tables that the statement reads, a write of a table drops all entries with its tag.
+ * Entries live until their ttl ends or they are the least recently used ones once maxBytes is reached,
+ * results bigger than an eighth of maxBytes are not kept.
+ * A read that raced with a write of one of its tables is returned but not kept.
+ * With a persistentTtl the "cache" table is a second tier that is shared by all processes of the database,
+ * writes of other processes are not seen by this process until the ttl of its own entries ends.
+ * @example
+ * QueryCache cache(pool);
+ * auto menu = cache.select("SELECT * FROM teg_menu m JOIN teg_menu_l l ON l.id = m.id WHERE l.language = ?", {"english"});
+ * cache.execute("UPDATE teg_menu_l SET title = ? WHERE id = ?", {"Home", "1"});   // Drops the entry above.
+ */
+class QueryCache final
+{
+public:
+    /*!
+     * @param pool to run the statements on, it's not owned by the cache.
+     * @param options are the limits of the cache.
+     */
+    QueryCache(ConnectionPool& pool, const QueryCacheOptions& options = {});
+    QueryCache(const QueryCache& rhsCache) = delete;
+    QueryCache& operator=(const QueryCache& rhsCache) = delete;
+
+    /*!
+     * @brief select function answers a read only statement from the cache or runs it and keeps the result.
+     * Other statements are run as they are and invalidate the tables that they write.
+     * @param ttl of the entry, zero means the ttl of the options.
+     */
+    ResultView select(std::string_view sql, const SqlParams& params = {}, std::chrono::milliseconds ttl = {});
+
+    /*!
+     * @brief execute function runs a write and drops the entries of the tables that it touches.
+     * A statement whose tables can not be found drops all entries.
+     * @returns number of affected rows.
+     */
+    u64 execute(std::string_view sql, const SqlParams& params = {});
+
+    /*!
+     * @brief invalidate function drops the entries that read a table.
+     * @param table is the full name of the table, with its prefix.
+     */
+    void invalidate(std::string_view table);
+
+    /*!
+     * @brief invalidate function drops all entries.
+     */
+    void invalidate();
+
+    __tegra_no_discard QueryCacheStats stats() const;
+    __tegra_no_discard const QueryCacheOptions& options() const __tegra_noexcept;
+
+    /*!
+     * @brief normalize function removes comments, a trailing semicolon and repeated white space outside of strings.
+     * @returns the statement that is used as the key.
+     */
+    __tegra_no_discard static std::string normalize(std::string_view sql);
+
+    /*!
+     * @brief tablesOf function finds the tables that follow FROM, JOIN, INTO, UPDATE, TABLE, TRUNCATE and the commas of a FROM list.
+     * Tables of subqueries and CTEs are included, a FROM list goes on after a derived table in parentheses.
+     * @returns lower case names without quotes and schema, each one once.
+     */
+    __tegra_no_discard static VectorString tablesOf(std::string_view sql);
+
+private:
+    struct Entry final
+    {
+        std::string                             key     {};
+        ResultView                              result  {};
+        VectorString                            tags    {};
+        std::chrono::steady_clock::time_point   expires {};
+        std::size_t                             bytes   {};
+    };
+
+    struct Tag final
+    {
+        u64                                     generation  {};     ///<Bumped by every write of the table.
+        std::unordered_set<std::string_view>    keys        {};     ///<Entries that read the table.
+    };
+
+    using EntryList = std::list<Entry>;
+
+    /*!
+     * @brief find function gets a live entry and marks it as recently used, m_mutex must be held.
+     */
+    __tegra_no_discard const Entry* find(std::string_view key);
+
+    /*!
+     * @brief unchanged function checks that none of the tables was written since the epoch and the generations were taken, m_mutex must be held.
+     */
+    __tegra_no_discard bool unchanged(u64 epoch, const VectorString& tags, const std::vector<u64>& generations) const;
+
+    /*!
+     * @brief store function keeps a result if none of its tables was written since generations were taken.
+     * @returns false if the result raced with a write.
+     */
+    bool store(std::string key, const ResultView& result, const VectorString& tags, u64 epoch,
+               const std::vector<u64>& generations, std::chrono::steady_clock::time_point expires);
+
+    /*!
+     * @brief erase function drops an entry, m_mutex must be held.
+     */
+    void erase(EntryList::iterator entry);
+
+    /*!
+     * @brief load function reads an entry of the "cache" table.
+     * @returns the result and its remaining lifetime, std::nullopt if there is no live entry.
+     */
+    __tegra_no_discard std::optional<std::pair<ResultView, std::chrono::milliseconds>> load(const std::string& key);
+
+    /*!
+     * @brief save function writes an entry into the "cache" table.
+     * @param ttl is the lifetime of the row, it's never longer than the ttl of the query.
+     */
+    void save(const std::string& key, const ResultView& result, const VectorString& tags, std::chrono::milliseconds ttl);
+
+    /*!
+     * @brief forget function deletes entries of the "cache" table, all of them if table is empty.
+     */
+    void forget(std::string_view table);
+
+    /*!
+     * @brief discard function deletes the entry of one key from the "cache" table.
+     */
+    void discard(const std::string& key);
+
+    ConnectionPool&                                     m_pool;
+    QueryCacheOptions                                   m_options;
+    mutable std::mutex                                  m_mutex     {};
+    EntryList                                           m_lru       {};     ///<Most recently used first.
+    std::unordered_map<std::string_view, EntryList::iterator> m_index {};   ///<Keys point into the entries of m_lru.
+    std::unordered_map<std::string, Tag>                m_tags      {};
+    u64                                                 m_epoch     {};     ///<Bumped when all entries are dropped.
+    QueryCacheStats                                     m_stats     {};
+    std::atomic<u64>                                    m_saves     {0};
+};
+
+TEGRA_NAMESPACE_END
+
+#endif  // TEGRA_QUERYCACHE_HPP
@@ -0,0 +1,197 @@
+#include "replacer.hpp"
+
+TEGRA_NAMESPACE_BEGIN(Tegra::CMS)
+
+Replacer::Replacer(const MapString& map)
+{
+    //! Alphabet, only bytes that are used inside the keys get their own class.
+    m_width = 1;
+    std::size_t totalKeyBytes = 0;
+    for (const auto& [key, value] : map) {
+        if (key.empty()) continue;
+        totalKeyBytes += key.size();
+        for (const unsigned char c : key) {
+            if (m_byteClass[c] == 0) {
+                m_byteClass[c] = static_cast<u16>(m_width++);
+            }
+        }
+    }
+
+    //! Trie of the keys.
+    m_delta.assign((totalKeyBytes + 1) * m_width, NoState);
+    m_output.assign(totalKeyBytes + 1, 0);
+    m_keys.reserve(map.size());
+    u32 states = 1;
+    for (const auto& [key, value] : map) {
+        if (key.empty()) continue;
+        u32 state = 0;
+        for (const unsigned char c : key) {
+            auto& next = m_delta[state * m_width + m_byteClass[c]];
+            if (next == NoState) {
+                next = states++;
+            }
+            state = next;
+        }
+        m_firstByte[static_cast<unsigned char>(key.front())] = true;
+        m_keys.push_back(key);
+        m_output[state] = static_cast<u32>(m_keys.size());
+    }
+    m_delta.resize(std::size_t(states) * m_width);
+    m_output.resize(states);
+
+    //! Failure links are folded into a full DFA in breadth-first order.
+    std::vector<u32> fail(states, 0);
+    std::vector<u32> queue;
+    queue.reserve(states);
+    for (std::size_t c = 0; c < m_width; ++c) {
+        auto& next = m_delta[c];
+        if (next == NoState) {
+            next = 0;
+        } else {
+            fail[next] = 0;
+            queue.push_back(next);
+        }
+    }
+    for (std::size_t head = 0; head < queue.size(); ++head) {
+        const u32 state = queue[head];
+        //! The own key is always the longest one, otherwise inherit the longest suffix key.
+        if (m_output[state] == 0) {
+            m_output[state] = m_output[fail[state]];
+        }
+        for (std::size_t c = 0; c < m_width; ++c) {
+            auto& next = m_delta[state * m_width + c];
+            const u32 fallback = m_delta[fail[state] * m_width + c];
+            if (next == NoState) {
+                next = fallback;
+            } else {
+                fail[next] = fallback;
+                queue.push_back(next);
+            }
+        }
+    }
+
+    int firstBytes = 0;
+    for (std::size_t b = 0; b < m_firstByte.size(); ++b) {
+        if (m_firstByte[b]) {
+            ++firstBytes;
+            m_singleFirst = static_cast<int>(b);
+        }
+    }
+    if (firstBytes != 1) {
+        m_singleFirst = -1;
+    }
+}
+
+std::string Replacer::replace(std::string_view content, const MapString& values) const
+{
+    std::string output;
+    replace(content, values, output);
+    return output;
+}
+
+void Replacer::replace(std::string_view content, const MapString& values, std::string& output) const
+{
+    output.reserve(output.size() + content.size());
+    if (m_keys.empty()) {
+        output.append(content);
+        return;
+    }
+
+    const char* const data = content.data();
+    const std::size_t size = content.size();
+    std::size_t copied = 0;
+    std::size_t i = 0;
+    u32 state = 0;
+    while (i < size) {
+        //! While in the root state, jump straight to the next byte that can start a key.
+        if (state == 0) {
+            if (m_singleFirst >= 0) {
+                const void* hit = std::memchr(data + i, m_singleFirst, size - i);
+                if (hit == nullptr) break;
+                i = static_cast<std::size_t>(static_cast<const char*>(hit) - data);
+            } else {
+                while (i < size && !m_firstByte[static_cast<unsigned char>(data[i])]) ++i;
+                if (i == size) break;
+            }
+        }
+        state = m_delta[state * m_width + m_byteClass[static_cast<unsigned char>(data[i])]];
+        ++i;
+        if (const u32 out = m_output[state]; out != 0) {
+            const auto& key = m_keys[out - 1];
+            const auto value = values.find(key);
+            if (value == values.end()) continue;
+            output.append(data + copied, i - key.size() - copied);
+            output.append(value->second);
+            copied = i;
+            state = 0;
+        }
+    }
+    output.append(data + copied, size - copied);
+}
+
+std::size_t Replacer::patternCount() const __tegra_noexcept
+{
+    return m_keys.size();
+}
+
+bool Replacer::sameKeys(const MapString& map) const __tegra_noexcept
+{
+    auto key = m_keys.begin();
+    for (const auto& entry : map) {
+        if (entry.first.empty()) continue;
+        if (key == m_keys.end() || *key != entry.first) return false;
+        ++key;
+    }
+    return key == m_keys.end();
+}
+
+u64 Replacer::fingerprint(const MapString& map) __tegra_noexcept
+{
+    //! FNV-1a over the keys, sizes are mixed in so that ("ab","c") and ("a","bc") differ.
+    u64 hash = 14695981039346656037ULL;
+    const auto mix = [&hash](std::string_view s) {
+        for (const unsigned char c : s) {
+            hash ^= c;
+            hash *= 1099511628211ULL;
+        }
+        hash ^= s.size();
+        hash *= 1099511628211ULL;
+    };
+    for (const auto& entry : map) {
+        mix(entry.first);
+    }
+    return hash ^ map.size();
+}
+
+Ref<const Replacer> Replacer::cached(const MapString& map)
+{
+    static std::shared_mutex mutex;
+    static std::unordered_map<u64, Ref<const Replacer>> cache;
+    static std::deque<u64> order;
+
+    const u64 version = fingerprint(map);
+    {
+        std::shared_lock lock(mutex);
+        if (const auto it = cache.find(version); it != cache.end() && it->second->sameKeys(map)) {
+            return it->second;
+        }
+    }
+
+    //! Built outside of the lock, two racing threads may both build but only one is kept.
+    Ref<const Replacer> replacer = CreateRef<const Replacer>(map);
+    std::unique_lock lock(mutex);
+    const auto [it, inserted] = cache.try_emplace(version, replacer);
+    if (inserted) {
+        order.push_back(version);
+        while (order.size() > CacheCapacity) {
+            cache.erase(order.front());
+            order.pop_front();
+        }
+    } else if (!it->second->sameKeys(map)) {
+        //! A hash collision with other keys, the newer map takes the slot.
+        it->second = replacer;
+    }
+    return it->second;
+}
+
+TEGRA_NAMESPACE_END
@@ -0,0 +1,124 @@
+/*!
+ * MIT License
+ *
+ * Copyright (c) 2022 Kambiz Asadzadeh
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef TEGRA_REPLACER_HPP
+#define TEGRA_REPLACER_HPP
+
+#include "common.hpp"
+
+TEGRA_USING_NAMESPACE Tegra::Types;
+
+TEGRA_NAMESPACE_BEGIN(Tegra::CMS)
+
+/*!
+ * @brief The Replacer class is a multi-pattern replacement engine built from a map of placeholders.
+ * The keys of the map are compiled once into an Aho-Corasick automaton (a full DFA over the
+ * byte classes that really occur in the keys), so a page is scanned exactly once whatever the
+ * number of keys is, and the output is written into a new buffer instead of shifting the page in place.
+ * Only the keys are compiled, the value of each match is looked up inside the map given to replace,
+ * so maps with the same keys and per-request values share one automaton.
+ * ======================================================
+ * ----> Matches are not overlapping and the replaced values are never scanned again.
+ * ----> When several keys end at the same position the longest one wins.
+ * ----> A key that ends earlier wins over a key that would end later.
+ * ======================================================
+ * @example Replacer::cached(map)->replace(content, map);
+ */
+class Replacer
+{
+public:
+    /*!
+     * @brief Builds the automaton from the keys of the map, empty keys are ignored.
+     * @param map as data for replacing.
+     */
+    explicit Replacer(const MapString& map);
+    Replacer(const Replacer& rhsReplacer) = delete;
+    Replacer(Replacer&& rhsReplacer) noexcept = delete;
+    Replacer& operator=(const Replacer& rhsReplacer) = delete;
+    Replacer& operator=(Replacer&& rhsReplacer) noexcept = delete;
+    ~Replacer() = default;
+
+    /*!
+     * @brief replace function will replaces all occurrences of the keys inside the content.
+     * @param content as raw content.
+     * @param values as map that gives the value of each key, keys that are missing in it are left untouched.
+     * @returns content as string.
+     */
+    __tegra_no_discard std::string replace(std::string_view content, const MapString& values) const;
+
+    /*!
+     * @brief replace function will appends the replaced content into the output.
+     * @param content as raw content.
+     * @param values as map that gives the value of each key, keys that are missing in it are left untouched.
+     * @param output is the buffer that receives the result.
+     */
+    void replace(std::string_view content, const MapString& values, std::string& output) const;
+
+    /*!
+     * @brief patternCount function gets number of compiled keys.
+     * @returns as number of keys.
+     */
+    __tegra_no_discard std::size_t patternCount() const __tegra_noexcept;
+
+    /*!
+     * @brief sameKeys function checks whether the automaton was built from exactly the keys of the map.
+     * @param map as data for replacing.
+     * @returns true if the keys are the same.
+     */
+    __tegra_no_discard bool sameKeys(const MapString& map) const __tegra_noexcept;
+
+    /*!
+     * @brief fingerprint function calculates the version of a map based on its keys.
+     * @param map as data for replacing.
+     * @returns 64 bit hash of the keys.
+     */
+    __tegra_no_discard static u64 fingerprint(const MapString& map) __tegra_noexcept;
+
+    /*!
+     * @brief cached function gets the automaton of the keys from the shared cache or builds it once.
+     * @param map as data for replacing.
+     * @returns shared pointer of the compiled replacer.
+     */
+    __tegra_no_discard static Ref<const Replacer> cached(const MapString& map);
+
+    /*!
+     * @brief The maximum number of automatons that are kept inside the shared cache.
+     */
+    __tegra_inline_static std::size_t CacheCapacity = 64;
+
+private:
+    static constexpr u32 NoState = std::numeric_limits<u32>::max();
+
+    std::array<u16, 256>    m_byteClass     {};   ///<Byte to alphabet class, zero is for bytes that are not used by any key.
+    std::array<bool, 256>   m_firstByte     {};   ///<Bytes that can start a key.
+    std::size_t             m_width         {};   ///<Number of alphabet classes.
+    std::vector<u32>        m_delta         {};   ///<Transitions [state * width + class].
+    std::vector<u32>        m_output        {};   ///<Pattern index + 1 of the longest key that ends in the state.
+    std::vector<std::string> m_keys         {};   ///<Keys in the order of the map, pattern index is the position.
+    int                     m_singleFirst   {-1}; ///<The only byte that starts the keys, -1 if there are more.
+};
+
+TEGRA_NAMESPACE_END
+
+#endif // TEGRA_REPLACER_HPP
@@ -0,0 +1,256 @@
+#include "router.hpp"
+#include "core.hpp"
+#include "logger.hpp"
+
+TEGRA_USING_NAMESPACE Tegra;
+TEGRA_USING_NAMESPACE Tegra::CMS;
+TEGRA_USING_NAMESPACE Tegra::eLogger;
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+TEGRA_ANONYMOUS_NAMESPACE_BEGIN
+
+bool equalsWord(std::string_view word, std::string_view keyword) __tegra_noexcept
+{
+    return word.size() == keyword.size()
+        && std::equal(word.begin(), word.end(), keyword.begin(), [](char a, char b) {
+               return std::toupper(static_cast<unsigned char>(a)) == b;
+           });
+}
+
+/*!
+ * @brief Calls visit for every word of a statement, strings, quoted identifiers and comments are skipped.
+ * Stops as soon as visit returns false.
+ */
+template<typename Visit>
+void forEachWord(std::string_view sql, const Visit& visit)
+{
+    std::size_t i = 0;
+    while (i < sql.size()) {
+        const char c = sql[i];
+        if (c == '\'' || c == '"' || c == '`') {
+            const std::size_t end = sql.find(c, i + 1);
+            i = end == std::string_view::npos ? sql.size() : end + 1;
+        } else if (c == '-' && i + 1 < sql.size() && sql[i + 1] == '-') {
+            const std::size_t end = sql.find('\n', i);
+            i = end == std::string_view::npos ? sql.size() : end + 1;
+        } else if (c == '/' && i + 1 < sql.size() && sql[i + 1] == '*') {
+            const std::size_t end = sql.find("*/", i + 2);
+            i = end == std::string_view::npos ? sql.size() : end + 2;
+        } else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            const std::size_t start = i;
+            while (i < sql.size() && (std::isalnum(static_cast<unsigned char>(sql[i])) || sql[i] == '_')) ++i;
+            if (!visit(sql.substr(start, i - start))) return;
+        } else {
+            ++i;
+        }
+    }
+}
+
+TEGRA_NAMESPACE_END
+
+bool ConsistencyToken::pinned() const __tegra_noexcept
+{
+    return std::chrono::system_clock::now() < primaryUntil;
+}
+
+u64 ConsistencyToken::value() const __tegra_noexcept
+{
+    const auto since = std::chrono::duration_cast<std::chrono::milliseconds>(primaryUntil.time_since_epoch()).count();
+    return since > 0 ? static_cast<u64>(since) : 0;
+}
+
+ConsistencyToken ConsistencyToken::from(u64 value) __tegra_noexcept
+{
+    return {std::chrono::system_clock::time_point(std::chrono::milliseconds(value))};
+}
+
+QueryRouter::QueryRouter(ConnectionPool& primary, const std::vector<ConnectionConfig>& replicas) : m_primary(primary)
+{
+    m_replicas.reserve(replicas.size());
+    for (const auto& config : replicas) {
+        m_replicas.push_back(CreateScope<ConnectionPool>(config));
+    }
+    m_downUntil = std::make_unique<std::atomic<Ticks>[]>(replicas.size());
+}
+
+QueryRouter::~QueryRouter()
+{
+    {
+        std::lock_guard lock(m_jobMutex);
+        m_stop = true;
+    }
+    m_jobReady.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+template<typename Job>
+auto QueryRouter::read(const ConsistencyToken* token, const Job& job) -> decltype(job(std::declval<Connection&>()))
+{
+    const auto index = replica(token);
+    if (!index.has_value()) {
+        return job(*m_primary.acquire());
+    }
+    //! A read is safe to repeat, a replica that is down must not fail the page.
+    PooledConnection connection;
+    try {
+        connection = m_replicas[*index]->acquire();
+    } catch (const std::exception& e) {
+        down(*index, e);
+        return job(*m_primary.acquire());
+    }
+    try {
+        return job(*connection);
+    } catch (const std::exception& e) {
+        //! A syntax error or a constraint fails on the primary as well, only a lost link takes the replica out.
+        if (!connection->broken()) throw;
+        connection.release();
+        down(*index, e);
+    }
+    return job(*m_primary.acquire());
+}
+
+ResultView QueryRouter::execute(std::string_view sql, const SqlParams& params, ConsistencyToken* token)
+{
+    if (isReadOnly(sql)) {
+        return read(token, [&](Connection& connection) { return connection.select(sql, params); });
+    }
+    ResultView result = m_primary.select(sql, params);
+    wrote(token);
+    return result;
+}
+
+ResultView QueryRouter::execute(const StatementKey& key, const SqlParams& params, ConsistencyToken* token)
+{
+    if (isReadOnly(key.text)) {
+        return read(token, [&](Connection& connection) { return connection.select(key, params); });
+    }
+    ResultView result = m_primary.select(key, params);
+    wrote(token);
+    return result;
+}
+
+std::vector<ResultView> QueryRouter::pipeline(const std::vector<QueryRequest>& queries, ConsistencyToken* token)
+{
+    const bool readOnly = std::all_of(queries.begin(), queries.end(), [](const QueryRequest& query) { return isReadOnly(query.sql); });
+    if (readOnly) {
+        return read(token, [&](Connection& connection) { return connection.pipeline(queries); });
+    }
+    std::vector<ResultView> results = m_primary.acquire()->pipeline(queries);
+    wrote(token);
+    return results;
+}
+
+std::future<ResultView> QueryRouter::async(std::string sql, SqlParams params, ConsistencyToken token)
+{
+    if (!isReadOnly(sql)) {
+        throw Exception(Exception::Reason::Core, "Only read only statements can run asynchronously: " + sql);
+    }
+    auto task = CreateRef<std::packaged_task<ResultView()>>([this, sql = std::move(sql), params = std::move(params), token] {
+        return read(&token, [&](Connection& connection) { return connection.select(sql, params); });
+    });
+    std::future<ResultView> result = task->get_future();
+    {
+        std::lock_guard lock(m_jobMutex);
+        if (m_workers.empty()) {
+            std::size_t workers = 0;
+            for (const auto& replica : m_replicas) {
+                workers += replica->config().connections;
+            }
+            workers = std::max<std::size_t>(workers != 0 ? workers : m_primary.config().connections, 1);
+            m_workers.reserve(workers);
+            for (std::size_t i = 0; i < workers; ++i) {
+                m_workers.emplace_back(&QueryRouter::work, this);
+            }
+        }
+        m_jobs.emplace_back([task] { (*task)(); });
+    }
+    m_jobReady.notify_one();
+    return result;
+}
+
+bool QueryRouter::isReadOnly(std::string_view sql) __tegra_noexcept
+{
+    bool first = true;
+    bool readOnly = false;
+    forEachWord(sql, [&](std::string_view word) {
+        if (first) {
+            first = false;
+            readOnly = equalsWord(word, SELECT) || equalsWord(word, "WITH") || equalsWord(word, "SHOW")
+                    || equalsWord(word, "VALUES") || equalsWord(word, "EXPLAIN");
+            return readOnly;
+        }
+        //! Writes inside a WITH, SELECT ... INTO, row locks and sequences need the primary.
+        for (const std::string_view keyword : {std::string_view(INSERT), std::string_view(UPDATE), std::string_view(DELETE),
+                                               std::string_view(MERGE), std::string_view("INTO"), std::string_view("SHARE"),
+                                               std::string_view("LOCK"), std::string_view("NEXTVAL"), std::string_view("SETVAL")}) {
+            if (equalsWord(word, keyword)) {
+                readOnly = false;
+                return false;
+            }
+        }
+        return true;
+    });
+    return readOnly;
+}
+
+ConnectionPool& QueryRouter::primary() const __tegra_noexcept
+{
+    return m_primary;
+}
+
+std::size_t QueryRouter::replicas() const __tegra_noexcept
+{
+    return m_replicas.size();
+}
+
+std::optional<std::size_t> QueryRouter::replica(const ConsistencyToken* token) __tegra_noexcept
+{
+    if (m_replicas.empty() || (token != nullptr && token->pinned())) {
+        return std::nullopt;
+    }
+    const auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+    const std::size_t first = m_next.fetch_add(1, std::memory_order_relaxed);
+    for (std::size_t i = 0; i < m_replicas.size(); ++i) {
+        const std::size_t index = (first + i) % m_replicas.size();
+        if (m_downUntil[index].load(std::memory_order_relaxed) <= now) return index;
+    }
+    return std::nullopt;
+}
+
+void QueryRouter::down(std::size_t index, const std::exception& error)
+{
+    ConnectionPool& pool = *m_replicas[index];
+    const auto retry = std::chrono::steady_clock::now() + pool.config().healthCheckInterval;
+    m_downUntil[index].store(retry.time_since_epoch().count(), std::memory_order_relaxed);
+    if(DeveloperMode::IsEnable) {
+        Log("Replica [" + pool.config().name + "] failed, reads go to the primary for a while: " + std::string(error.what()), LoggerType::Warning);
+    }
+}
+
+void QueryRouter::wrote(ConsistencyToken* token) const __tegra_noexcept
+{
+    if (token != nullptr && !m_replicas.empty()) {
+        token->primaryUntil = std::chrono::system_clock::now() + m_primary.config().stickyWindow;
+    }
+}
+
+void QueryRouter::work()
+{
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock lock(m_jobMutex);
+            m_jobReady.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+            if (m_jobs.empty()) return;
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+        //! Errors are stored in the future of the read.
+        job();
+    }
+}
+
+TEGRA_NAMESPACE_END
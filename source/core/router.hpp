@@ -0,0 +1,149 @@
+/*!
+ * MIT License
+ *
+ * Copyright (c) 2022 Kambiz Asadzadeh
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#ifndef TEGRA_ROUTER_HPP
+#define TEGRA_ROUTER_HPP
+
+#include "connectionpool.hpp"
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+/*!
+ * @brief The ConsistencyToken struct keeps the reads of a session on the primary for a while after a write,
+ * so users always see their own changes even if the replicas are behind.
+ * It's a plain time stamp, it can be stored inside the session between requests.
+ */
+struct ConsistencyToken final
+{
+    std::chrono::system_clock::time_point primaryUntil {};  ///<Reads go to the primary until this time.
+
+    /*!
+     * @returns true if the reads of the session must go to the primary now.
+     */
+    __tegra_no_discard bool pinned() const __tegra_noexcept;
+
+    /*!
+     * @returns the token as milliseconds since epoch, for the session storage.
+     */
+    __tegra_no_discard u64 value() const __tegra_noexcept;
+
+    /*!
+     * @brief from function restores a token from its value.
+     */
+    __tegra_no_discard static ConsistencyToken from(u64 value) __tegra_noexcept;
+};
+
+/*!
+ * @brief The QueryRouter class sends read only statements to the replicas and everything else to the primary.
+ * Replicas are "db_clients" with "role": "replica", they are used round robin and a read that fails on a replica
+ * is run again on the primary, the replica is then skipped for its "healthCheckInterval". After a write, the token of the session pins its reads to the primary for the
+ * "sticky_window" of the primary client.
+ * Independent reads of a page can be pipelined on one connection (one round trip) or run concurrently as futures.
+ * @example
+ * ConsistencyToken token = ConsistencyToken::from(session.get<u64>("db_token"));
+ * auto pages = router.pipeline({{"SELECT ... menu ...", {"en"}}, {"SELECT ... config ...", {}}}, &token);
+ * router.execute("UPDATE teg_members SET name = ? WHERE id = ?", {name, id}, &token);
+ */
+class QueryRouter final
+{
+public:
+    /*!
+     * @param primary is the pool of the primary client, it's not owned by the router.
+     * @param replicas are configs of the replica clients.
+     */
+    QueryRouter(ConnectionPool& primary, const std::vector<ConnectionConfig>& replicas);
+    QueryRouter(const QueryRouter& rhsRouter) = delete;
+    QueryRouter& operator=(const QueryRouter& rhsRouter) = delete;
+
+    /*!
+     * @brief The queued asynchronous reads are finished before the workers stop.
+     */
+    ~QueryRouter();
+
+    /*!
+     * @brief execute function runs a statement on the client of its kind.
+     * @param token of the session, it's refreshed by a write and read by a read, it may be nullptr.
+     */
+    ResultView execute(std::string_view sql, const SqlParams& params = {}, ConsistencyToken* token = nullptr);
+    ResultView execute(const StatementKey& key, const SqlParams& params = {}, ConsistencyToken* token = nullptr);
+
+    /*!
+     * @brief pipeline function runs independent statements on one connection in one round trip.
+     * All statements go to a replica if every one of them is read only, otherwise to the primary.
+     * @returns results in the order of queries.
+     */
+    std::vector<ResultView> pipeline(const std::vector<QueryRequest>& queries, ConsistencyToken* token = nullptr);
+
+    /*!
+     * @brief async function runs a read only statement on a worker of the router.
+     * There are as many workers as connections of the replicas (of the primary without replicas), other reads wait in a queue.
+     * Writes are not accepted here, they would refresh the token after the caller went on.
+     * @param token of the session, it's copied.
+     */
+    __tegra_no_discard std::future<ResultView> async(std::string sql, SqlParams params = {}, ConsistencyToken token = {});
+
+    /*!
+     * @brief isReadOnly function tells if a statement only reads, it's a keyword check and is strict on purpose.
+     * A statement is read only if it starts with SELECT, WITH, SHOW, VALUES or EXPLAIN
+     * and has no INSERT, UPDATE, DELETE, MERGE, INTO, SHARE, LOCK, NEXTVAL or SETVAL outside of strings.
+     */
+    __tegra_no_discard static bool isReadOnly(std::string_view sql) __tegra_noexcept;
+
+    __tegra_no_discard ConnectionPool& primary() const __tegra_noexcept;
+    __tegra_no_discard std::size_t replicas() const __tegra_noexcept;
+
+private:
+    /*!
+     * @brief replica function picks the next healthy replica, nullptr if reads must go to the primary.
+     */
+    __tegra_no_discard std::optional<std::size_t> replica(const ConsistencyToken* token) __tegra_noexcept;
+
+    /*!
+     * @brief read function runs a job on a connection of a replica and falls back to the primary if the replica fails.
+     * Only a replica that can't be reached or whose link broke is taken out, errors of the statement are thrown as they are.
+     */
+    template<typename Job>
+    auto read(const ConsistencyToken* token, const Job& job) -> decltype(job(std::declval<Connection&>()));
+
+    void down(std::size_t index, const std::exception& error);
+    void wrote(ConsistencyToken* token) const __tegra_noexcept;
+    void work();
+
+    using Ticks = std::chrono::steady_clock::rep;
+
+    ConnectionPool&                     m_primary;
+    std::vector<Scope<ConnectionPool>>  m_replicas  {};
+    Scope<std::atomic<Ticks>[]>         m_downUntil {};     ///<Time until a failed replica is used again, by replica.
+    std::atomic<std::size_t>            m_next      {0};
+    std::mutex                          m_jobMutex  {};
+    std::condition_variable             m_jobReady  {};
+    std::deque<std::function<void()>>   m_jobs      {};
+    std::vector<std::thread>            m_workers   {};     ///<Started by the first asynchronous read.
+    bool                                m_stop      {};
+};
+
+TEGRA_NAMESPACE_END
+
+#endif  // TEGRA_ROUTER_HPP
@@ -0,0 +1,216 @@
+#include "schemabuilder.hpp"
+#include "seedfile.hpp"
+#include "tableregistry.hpp"
+#include "core.hpp"
+
+TEGRA_USING_NAMESPACE Tegra::CMS;
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+TEGRA_ANONYMOUS_NAMESPACE_BEGIN
+
+/*!
+ * @returns the full name of a table that is written with or without prefix.
+ */
+std::string_view fullName(std::string_view table)
+{
+    const std::string_view prefix = TableRegistry::prefix();
+    if (!prefix.empty() && table.starts_with(prefix)) table.remove_prefix(prefix.size());
+    return TableRegistry::table(table, TableType::MixedStruct);
+}
+
+bool isIdentifier(char c) __tegra_noexcept
+{
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '$';
+}
+
+TEGRA_NAMESPACE_END
+
+SchemaBuilder::SchemaBuilder(ConnectionPool& pool) : m_pool(pool)
+{
+}
+
+void SchemaBuilder::add(std::string_view table, std::string_view body)
+{
+    TableDefinition definition;
+    definition.table = std::string(fullName(table));
+    definition.statement = "CREATE TABLE IF NOT EXISTS " + definition.table + " " + std::string(body);
+    //! A value table needs its key table, for example config_l follows config.
+    const std::string_view key = TableRegistry::table(table, TableType::KeyStruct);
+    if (key != definition.table) {
+        definition.dependencies.emplace_back(key);
+    }
+    for (const auto& reference : referencesOf(body)) {
+        const std::string_view name = fullName(reference);
+        if (name != definition.table && std::find(definition.dependencies.begin(), definition.dependencies.end(), name) == definition.dependencies.end()) {
+            definition.dependencies.emplace_back(name);
+        }
+    }
+    add(std::move(definition));
+}
+
+void SchemaBuilder::add(TableDefinition definition)
+{
+    const auto found = std::find_if(m_tables.begin(), m_tables.end(), [&definition](const TableDefinition& t) { return t.table == definition.table; });
+    if (found != m_tables.end()) {
+        *found = std::move(definition);
+    } else {
+        m_tables.push_back(std::move(definition));
+    }
+}
+
+void SchemaBuilder::addFromFile(const std::string& path, std::string_view rdbms)
+{
+    for (const auto& entry : SeedFile::section(SeedFile::read(path), "create", rdbms)) {
+        add(entry.table, entry.content);
+    }
+}
+
+const std::vector<TableDefinition>& SchemaBuilder::tables() const __tegra_noexcept
+{
+    return m_tables;
+}
+
+VectorString SchemaBuilder::referencesOf(std::string_view body)
+{
+    VectorString references;
+    constexpr std::string_view keyword = "REFERENCES";
+    for (std::size_t i = 0; i + keyword.size() <= body.size(); ++i) {
+        const bool match = std::equal(keyword.begin(), keyword.end(), body.begin() + static_cast<std::ptrdiff_t>(i), [](char k, char c) {
+            return k == std::toupper(static_cast<unsigned char>(c));
+        });
+        if (!match || (i > 0 && isIdentifier(body[i - 1])) || (i + keyword.size() < body.size() && isIdentifier(body[i + keyword.size()]))) {
+            continue;
+        }
+        std::size_t pos = i + keyword.size();
+        while (pos < body.size() && std::isspace(static_cast<unsigned char>(body[pos]))) ++pos;
+        std::string name;
+        while (pos < body.size() && (isIdentifier(body[pos]) || body[pos] == '`' || body[pos] == '"' || body[pos] == '.')) {
+            if (body[pos] != '`' && body[pos] != '"') name.push_back(body[pos]);
+            ++pos;
+        }
+        //! Schema qualified names keep only the table.
+        if (const auto dot = name.rfind('.'); dot != std::string::npos) name.erase(0, dot + 1);
+        if (!name.empty()) references.push_back(std::move(name));
+        i = pos;
+    }
+    return references;
+}
+
+SchemaBuilder::Graph SchemaBuilder::graph() const
+{
+    Graph graph;
+    graph.pending.assign(m_tables.size(), 0);
+    graph.dependents.resize(m_tables.size());
+    std::unordered_map<std::string_view, std::size_t> index;
+    for (std::size_t i = 0; i < m_tables.size(); ++i) {
+        index.emplace(m_tables[i].table, i);
+    }
+    for (std::size_t i = 0; i < m_tables.size(); ++i) {
+        for (const auto& dependency : m_tables[i].dependencies) {
+            const auto found = index.find(dependency);
+            if (found == index.end()) continue;
+            ++graph.pending[i];
+            graph.dependents[found->second].push_back(i);
+        }
+    }
+    return graph;
+}
+
+std::vector<VectorString> SchemaBuilder::levels() const
+{
+    Graph g = graph();
+    std::vector<VectorString> waves;
+    std::vector<std::size_t> current;
+    for (std::size_t i = 0; i < m_tables.size(); ++i) {
+        if (g.pending[i] == 0) current.push_back(i);
+    }
+    std::size_t done = 0;
+    while (!current.empty()) {
+        VectorString& wave = waves.emplace_back();
+        std::vector<std::size_t> next;
+        for (const auto i : current) {
+            wave.push_back(m_tables[i].table);
+            for (const auto d : g.dependents[i]) {
+                if (--g.pending[d] == 0) next.push_back(d);
+            }
+        }
+        done += current.size();
+        current = std::move(next);
+    }
+    if (done != m_tables.size()) {
+        throw Exception(Exception::Reason::Core, "The foreign keys of the tables have a cycle.");
+    }
+    return waves;
+}
+
+SchemaReport SchemaBuilder::create(std::size_t parallelism)
+{
+    //! Cycles are rejected before anything is created.
+    __tegra_maybe_unused const auto waves = levels();
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto since = [&start] {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    };
+    SchemaReport report;
+    if (m_tables.empty()) return report;
+    const std::size_t connections = m_pool.config().connections;
+    const std::size_t workers = std::min({parallelism == 0 ? connections : parallelism, connections, m_tables.size()});
+    report.connections = workers;
+
+    Graph g = graph();
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::size_t> ready;
+    for (std::size_t i = 0; i < m_tables.size(); ++i) {
+        if (g.pending[i] == 0) ready.push_back(i);
+    }
+    std::size_t finished = 0;
+    std::exception_ptr error;
+
+    //! Each worker keeps one connection and takes the next table whose dependencies are created.
+    const auto work = [&] {
+        try {
+            auto connection = m_pool.acquire();
+            std::unique_lock lock(mutex);
+            for (;;) {
+                changed.wait(lock, [&] { return !ready.empty() || finished == m_tables.size() || error != nullptr; });
+                if (ready.empty() || error != nullptr) break;
+                const std::size_t table = ready.front();
+                ready.pop_front();
+                lock.unlock();
+                const auto begin = since();
+                connection->run(m_tables[table].statement);
+                const auto end = since();
+                lock.lock();
+                report.tables.push_back({m_tables[table].table, begin, end - begin});
+                ++finished;
+                for (const auto d : g.dependents[table]) {
+                    if (--g.pending[d] == 0) ready.push_back(d);
+                }
+                changed.notify_all();
+            }
+        } catch (...) {
+            std::lock_guard lock(mutex);
+            if (error == nullptr) error = std::current_exception();
+            changed.notify_all();
+        }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (std::size_t w = 1; w < workers; ++w) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    if (error != nullptr) {
+        std::rethrow_exception(error);
+    }
+    report.elapsed = since();
+    return report;
+}
+
+TEGRA_NAMESPACE_END
@@ -0,0 +1,127 @@
+/*!
+ * MIT License
+ *
+ * Copyright (c) 2022 Kambiz Asadzadeh
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef TEGRA_SCHEMABUILDER_HPP
+#define TEGRA_SCHEMABUILDER_HPP
+
+#include "connectionpool.hpp"
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+/*!
+ * @brief The TableDefinition struct is the DDL of one table and the tables it needs first.
+ */
+struct TableDefinition final
+{
+    std::string     table           {};     ///<Full name of the table with prefix.
+    std::string     statement       {};     ///<Complete CREATE TABLE statement.
+    VectorString    dependencies    {};     ///<Full names of the tables that must exist before.
+};
+
+/*!
+ * @brief The SchemaReport struct is the timing of a schema creation.
+ */
+struct SchemaReport final
+{
+    struct Entry final
+    {
+        std::string                 table   {};
+        std::chrono::microseconds   started {};     ///<Offset from the start of the creation.
+        std::chrono::microseconds   elapsed {};
+    };
+
+    std::vector<Entry>          tables      {};     ///<In the order of completion.
+    std::chrono::microseconds   elapsed     {};
+    std::size_t                 connections {};     ///<Connections that ran statements in parallel.
+};
+
+/*!
+ * @brief The SchemaBuilder class creates tables in dependency order over several pooled connections.
+ * A value table (with the value suffix) follows its key table and every REFERENCES clause adds an edge,
+ * tables with no pending dependency run concurrently, each one on its own connection.
+ * References to tables that are not part of the builder are expected to exist already.
+ */
+class SchemaBuilder final
+{
+public:
+    explicit SchemaBuilder(ConnectionPool& pool);
+    SchemaBuilder(const SchemaBuilder& rhsBuilder) = delete;
+    SchemaBuilder& operator=(const SchemaBuilder& rhsBuilder) = delete;
+
+    /*!
+     * @brief add function adds a table.
+     * @param table is the name of table without prefix.
+     * @param body is the column list, "(...)" as written under "create" in system-tables.json.
+     */
+    void add(std::string_view table, std::string_view body);
+
+    /*!
+     * @brief add function adds a table with a complete definition.
+     */
+    void add(TableDefinition definition);
+
+    /*!
+     * @brief addFromFile function adds the tables of the "create" section of system-tables.json.
+     * @param path of the file.
+     * @param rdbms is "postgresql", "mysql" or "sqlite3".
+     */
+    void addFromFile(const std::string& path, std::string_view rdbms);
+
+    /*!
+     * @brief levels function groups the tables into waves that may run at the same time.
+     * @returns waves in order, it throws if the dependencies have a cycle.
+     */
+    __tegra_no_discard std::vector<VectorString> levels() const;
+
+    /*!
+     * @brief create function runs all statements.
+     * @param parallelism is the number of connections to use, zero means the size of the pool, it is never more than the pool.
+     * @returns timing of the tables, it throws the first error after the running statements ended.
+     */
+    SchemaReport create(std::size_t parallelism = 0);
+
+    __tegra_no_discard const std::vector<TableDefinition>& tables() const __tegra_noexcept;
+
+    /*!
+     * @brief referencesOf function finds the tables of the REFERENCES clauses of a definition.
+     * @returns names as written, without quotes.
+     */
+    __tegra_no_discard static VectorString referencesOf(std::string_view body);
+
+private:
+    struct Graph final
+    {
+        std::vector<std::size_t>                pending     {};     ///<Unfinished dependencies per table.
+        std::vector<std::vector<std::size_t>>   dependents  {};
+    };
+
+    Graph graph() const;
+
+    ConnectionPool&                 m_pool;
+    std::vector<TableDefinition>    m_tables    {};
+};
+
+TEGRA_NAMESPACE_END
+
+#endif  // TEGRA_SCHEMABUILDER_HPP
@@ -0,0 +1,1229 @@
+#include "searchindex.hpp"
+#include "tableregistry.hpp"
+#include "core.hpp"
+#include "logger.hpp"
+
+#if defined(PLATFORM_WINDOWS)
+#include <cstdio>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+TEGRA_USING_NAMESPACE Tegra;
+TEGRA_USING_NAMESPACE Tegra::CMS;
+TEGRA_USING_NAMESPACE Tegra::eLogger;
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+TEGRA_ANONYMOUS_NAMESPACE_BEGIN
+
+constexpr char        SegmentMagic[8]   = {'T', 'E', 'G', 'I', 'D', 'X', '0', '1'};
+constexpr u32         SegmentVersion    = 1;
+constexpr std::string_view SegmentExtension = ".seg";
+
+//! Longer terms are mostly encoded data or URLs, they are not indexed.
+constexpr std::size_t MaxTermSize = 64;
+
+//! Marks a document of the old segment that is not part of the merged one.
+constexpr u32 Dropped = std::numeric_limits<u32>::max();
+
+/*!
+ * @brief Layout of a segment, all numbers are in the byte order of the host.
+ * header | documents | terms | sources | names | postings
+ * Terms are sorted by name, their postings are (document delta, frequency) pairs as varints.
+ */
+struct SegmentHeader final
+{
+    char    magic[8]        {};
+    u32     version         {};
+    u32     sources         {};
+    u32     documents       {};
+    u32     terms           {};
+    u64     totalLength     {};
+    u64     documentsOffset {};
+    u64     termsOffset     {};
+    u64     sourcesOffset   {};
+    u64     namesOffset     {};
+    u64     postingsOffset  {};
+};
+
+struct SegmentDocument final
+{
+    u64     id      {};
+    u32     length  {};
+    u16     source  {};
+    u16     unused  {};
+};
+
+struct SegmentTerm final
+{
+    u64     postings    {};     ///<Offset inside the postings.
+    u32     bytes       {};
+    u32     frequency   {};     ///<Number of documents.
+    u32     name        {};     ///<Offset inside the names.
+    u32     size        {};
+};
+
+struct SegmentName final
+{
+    u32     name    {};
+    u32     size    {};
+};
+
+static_assert(sizeof(SegmentHeader) == 72 && sizeof(SegmentDocument) == 16 && sizeof(SegmentTerm) == 24 && sizeof(SegmentName) == 8);
+
+template<typename T>
+T readAt(const char* data, u64 offset) __tegra_noexcept
+{
+    T value;
+    std::memcpy(&value, data + offset, sizeof(T));
+    return value;
+}
+
+template<typename T>
+void append(std::string& out, const T& value)
+{
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void putVarint(std::string& out, u32 value)
+{
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+bool getVarint(const char*& data, const char* end, u32& value) __tegra_noexcept
+{
+    value = 0;
+    for (u32 shift = 0; shift < 35 && data < end; shift += 7) {
+        const auto byte = static_cast<unsigned char>(*data++);
+        value |= static_cast<u32>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+/*!
+ * @brief forEachPosting function decodes a posting list, it stops at a broken varint.
+ */
+template<typename Function>
+void forEachPosting(std::string_view bytes, Function&& function)
+{
+    const char* data = bytes.data();
+    const char* const end = data + bytes.size();
+    u32 document = 0;
+    u32 delta = 0;
+    u32 frequency = 0;
+    while (data < end && getVarint(data, end, delta) && getVarint(data, end, frequency)) {
+        document += delta;
+        function(document, frequency);
+    }
+}
+
+/*!
+ * @returns the size of a code point by its first byte, cut at the end of the text.
+ */
+std::size_t codePointSize(std::string_view text, std::size_t i) __tegra_noexcept
+{
+    const auto lead = static_cast<unsigned char>(text[i]);
+    const std::size_t size = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+    return std::min(size, text.size() - i);
+}
+
+bool isSeparator(std::string_view cp) __tegra_noexcept
+{
+    const auto byte = [&cp](std::size_t i) { return static_cast<unsigned char>(cp[i]); };
+    if (cp.size() == 2) {
+        //! No-break space, guillemets, Arabic comma, semicolon, question mark, percent and full stop.
+        return (byte(0) == 0xC2 && (byte(1) == 0xA0 || byte(1) == 0xAB || byte(1) == 0xBB))
+            || (byte(0) == 0xD8 && (byte(1) == 0x8C || byte(1) == 0x9B || byte(1) == 0x9F))
+            || (byte(0) == 0xD9 && byte(1) >= 0xAA && byte(1) <= 0xAD)
+            || (byte(0) == 0xDB && byte(1) == 0x94);
+    }
+    if (cp.size() == 3) {
+        //! General punctuation (spaces, zero width non-joiner, dashes, quotes), ideographic space and BOM.
+        return (byte(0) == 0xE2 && byte(1) == 0x80)
+            || (byte(0) == 0xE3 && byte(1) == 0x80 && byte(2) == 0x80)
+            || (byte(0) == 0xEF && byte(1) == 0xBB && byte(2) == 0xBF);
+    }
+    return false;
+}
+
+/*!
+ * @brief forEachTerm function is the tokenizer of documents and queries.
+ */
+template<typename Function>
+void forEachTerm(std::string_view text, Function&& function)
+{
+    std::string term;
+    term.reserve(MaxTermSize);
+    const auto flush = [&] {
+        if (!term.empty() && term.size() <= MaxTermSize) function(std::string_view(term));
+        term.clear();
+    };
+    std::size_t i = 0;
+    while (i < text.size()) {
+        const auto c = static_cast<unsigned char>(text[i]);
+        if (c < 0x80) {
+            if (std::isalnum(c)) {
+                term.push_back(static_cast<char>(std::tolower(c)));
+                ++i;
+                continue;
+            }
+            flush();
+            const char next = i + 1 < text.size() ? text[i + 1] : '\0';
+            if (c == '<' && (std::isalpha(static_cast<unsigned char>(next)) || next == '/' || next == '!')) {
+                const std::size_t end = text.find('>', i);
+                i = end == std::string_view::npos ? text.size() : end + 1;
+                continue;
+            }
+            if (c == '&') {
+                //! Entities like &amp; and &#1575; are skipped as a whole.
+                std::size_t end = i + 1;
+                while (end < text.size() && end - i <= 10 && (std::isalnum(static_cast<unsigned char>(text[end])) || text[end] == '#')) ++end;
+                if (end < text.size() && text[end] == ';' && end > i + 1) {
+                    i = end + 1;
+                    continue;
+                }
+            }
+            ++i;
+            continue;
+        }
+        const std::string_view cp = text.substr(i, codePointSize(text, i));
+        i += cp.size();
+        if (isSeparator(cp)) {
+            flush();
+        } else if (cp == "\xD9\x8A") {
+            term.append("\xDB\x8C");    //! Arabic yeh as Persian yeh.
+        } else if (cp == "\xD9\x83") {
+            term.append("\xDA\xA9");    //! Arabic kaf as keheh.
+        } else if (cp.size() == 2 && static_cast<unsigned char>(cp[0]) == 0xD9
+                   && (static_cast<unsigned char>(cp[1]) == 0x80
+                       || (static_cast<unsigned char>(cp[1]) >= 0x8B && static_cast<unsigned char>(cp[1]) <= 0x92))) {
+            //! Tatweel and harakat do not change a word.
+        } else {
+            term.append(cp);
+        }
+    }
+    flush();
+}
+
+/*!
+ * @brief countTerms function adds the terms of a text to counts.
+ * @returns the number of terms of the text.
+ */
+u32 countTerms(std::string_view text, std::unordered_map<std::string, u32>& counts)
+{
+    u32 length = 0;
+    forEachTerm(text, [&](std::string_view term) {
+        ++counts[std::string(term)];
+        ++length;
+    });
+    return length;
+}
+
+/*!
+ * @brief File names keep letters, digits, '-' and '_' of a language, other bytes are written as %XX.
+ */
+std::string encodeName(std::string_view language)
+{
+    static constexpr char Hex[] = "0123456789ABCDEF";
+    std::string name;
+    for (const unsigned char c : language) {
+        if (std::isalnum(c) || c == '-' || c == '_') {
+            name.push_back(static_cast<char>(c));
+        } else {
+            name.push_back('%');
+            name.push_back(Hex[c >> 4]);
+            name.push_back(Hex[c & 0x0F]);
+        }
+    }
+    return name;
+}
+
+std::string decodeName(std::string_view name)
+{
+    std::string language;
+    for (std::size_t i = 0; i < name.size(); ++i) {
+        unsigned value = 0;
+        if (name[i] == '%' && i + 2 < name.size()
+            && std::from_chars(name.data() + i + 1, name.data() + i + 3, value, 16).ptr == name.data() + i + 3) {
+            language.push_back(static_cast<char>(value));
+            i += 2;
+        } else {
+            language.push_back(name[i]);
+        }
+    }
+    return language;
+}
+
+/*!
+ * @brief Table and column names are written into the statements, so only plain identifiers are taken.
+ */
+void checkIdentifier(std::string_view name)
+{
+    if (!TableRegistry::identifier(name)) {
+        throw Exception(Exception::Reason::Core, "The search source [" + std::string(name) + "] is not a plain identifier.");
+    }
+}
+
+void warn(std::string_view what, const std::exception& e)
+{
+    if(DeveloperMode::IsEnable) {
+        Log("The search index could not " + std::string(what) + ": " + std::string(e.what()), LoggerType::Warning);
+    }
+}
+
+/*!
+ * @brief writeFile function writes a file and flushes it to the disk, so a rename that follows never points at missing data.
+ */
+void writeFile(const std::filesystem::path& path, std::string_view data)
+{
+#if defined(PLATFORM_WINDOWS)
+    std::FILE* file = ::_wfopen(path.c_str(), L"wb");
+    bool written = file != nullptr && std::fwrite(data.data(), 1, data.size(), file) == data.size()
+                   && std::fflush(file) == 0 && ::_commit(::_fileno(file)) == 0;
+    if (file != nullptr && std::fclose(file) != 0) written = false;
+#else
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    bool written = fd >= 0;
+    for (std::size_t offset = 0; written && offset < data.size();) {
+        const ssize_t size = ::write(fd, data.data() + offset, data.size() - offset);
+        if (size < 0 && errno == EINTR) continue;
+        written = size > 0;
+        offset += written ? static_cast<std::size_t>(size) : 0;
+    }
+    written = written && ::fsync(fd) == 0;
+    if (fd >= 0 && ::close(fd) != 0) written = false;
+#endif
+    if (!written) {
+        throw Exception(Exception::Reason::IO, "The search segment [" + path.string() + "] can not be written.");
+    }
+}
+
+/*!
+ * @brief syncDirectory function flushes the entries of a directory, so a rename in it survives a crash.
+ */
+void syncDirectory([[maybe_unused]] const std::filesystem::path& directory) __tegra_noexcept
+{
+#if !defined(PLATFORM_WINDOWS)
+    const int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+#endif
+}
+
+/*!
+ * @brief The SegmentWriter class collects documents and postings and lays them out as a segment.
+ * Postings of a term have to be added in the order of their documents.
+ */
+class SegmentWriter final
+{
+public:
+    explicit SegmentWriter(const std::vector<SearchSource>& sources)
+    {
+        for (const auto& source : sources) {
+            m_sources.push_back(source.table);
+        }
+    }
+
+    u32 document(u16 source, u64 id, u32 length)
+    {
+        m_documents.push_back({id, length, source, 0});
+        m_totalLength += length;
+        return static_cast<u32>(m_documents.size() - 1);
+    }
+
+    void posting(std::string_view term, u32 document, u32 frequency)
+    {
+        auto& list = m_postings[std::string(term)];
+        putVarint(list.bytes, document - list.last);
+        putVarint(list.bytes, frequency);
+        list.last = document;
+        ++list.frequency;
+    }
+
+    std::string finish() const
+    {
+        std::vector<const std::pair<const std::string, List>*> terms;
+        terms.reserve(m_postings.size());
+        for (const auto& entry : m_postings) {
+            terms.push_back(&entry);
+        }
+        std::sort(terms.begin(), terms.end(), [](const auto* lhs, const auto* rhs) { return lhs->first < rhs->first; });
+
+        std::string names;
+        std::string postings;
+        std::vector<SegmentTerm> entries;
+        entries.reserve(terms.size());
+        for (const auto* term : terms) {
+            entries.push_back({postings.size(), static_cast<u32>(term->second.bytes.size()), term->second.frequency,
+                               static_cast<u32>(names.size()), static_cast<u32>(term->first.size())});
+            names.append(term->first);
+            postings.append(term->second.bytes);
+        }
+        std::vector<SegmentName> sources;
+        for (const auto& source : m_sources) {
+            sources.push_back({static_cast<u32>(names.size()), static_cast<u32>(source.size())});
+            names.append(source);
+        }
+
+        SegmentHeader header;
+        std::memcpy(header.magic, SegmentMagic, sizeof(SegmentMagic));
+        header.version          = SegmentVersion;
+        header.sources          = static_cast<u32>(sources.size());
+        header.documents        = static_cast<u32>(m_documents.size());
+        header.terms            = static_cast<u32>(entries.size());
+        header.totalLength      = m_totalLength;
+        header.documentsOffset  = sizeof(SegmentHeader);
+        header.termsOffset      = header.documentsOffset + m_documents.size() * sizeof(SegmentDocument);
+        header.sourcesOffset    = header.termsOffset + entries.size() * sizeof(SegmentTerm);
+        header.namesOffset      = header.sourcesOffset + sources.size() * sizeof(SegmentName);
+        header.postingsOffset   = header.namesOffset + names.size();
+
+        std::string out;
+        out.reserve(header.postingsOffset + postings.size());
+        append(out, header);
+        for (const auto& document : m_documents) append(out, document);
+        for (const auto& entry : entries) append(out, entry);
+        for (const auto& source : sources) append(out, source);
+        out.append(names);
+        out.append(postings);
+        return out;
+    }
+
+private:
+    struct List final
+    {
+        std::string bytes       {};
+        u32         last        {};
+        u32         frequency   {};
+    };
+
+    VectorString                            m_sources       {};
+    std::vector<SegmentDocument>            m_documents     {};
+    std::unordered_map<std::string, List>   m_postings      {};
+    u64                                     m_totalLength   {};
+};
+
+TEGRA_NAMESPACE_END
+
+/*!
+ * @brief The SearchSegment class is a read only view of a segment, mapped from its file or kept in a buffer.
+ */
+class SearchSegment final
+{
+public:
+    struct Term final
+    {
+        u32                 frequency   {};
+        std::string_view    postings    {};
+    };
+
+    SearchSegment(const SearchSegment& rhsSegment) = delete;
+    SearchSegment& operator=(const SearchSegment& rhsSegment) = delete;
+
+    ~SearchSegment()
+    {
+#if !defined(PLATFORM_WINDOWS)
+        if (m_map != nullptr) {
+            ::munmap(m_map, m_size);
+        }
+#endif
+    }
+
+    /*!
+     * @returns the segment or nullptr if the file is not a valid segment.
+     */
+    static Ref<const SearchSegment> map(const std::filesystem::path& path)
+    {
+        Ref<SearchSegment> segment(new SearchSegment());
+#if defined(PLATFORM_WINDOWS)
+        std::ifstream in(path, std::ios::binary);
+        segment->m_buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        segment->m_data = segment->m_buffer.data();
+        segment->m_size = segment->m_buffer.size();
+#else
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return nullptr;
+        }
+        struct stat info {};
+        if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* map = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+            if (map != MAP_FAILED) {
+                segment->m_map  = map;
+                segment->m_data = static_cast<const char*>(map);
+                segment->m_size = static_cast<std::size_t>(info.st_size);
+            }
+        }
+        ::close(fd);
+#endif
+        return segment->valid() ? segment : nullptr;
+    }
+
+    static Ref<const SearchSegment> load(std::string data)
+    {
+        Ref<SearchSegment> segment(new SearchSegment());
+        segment->m_buffer = std::move(data);
+        segment->m_data = segment->m_buffer.data();
+        segment->m_size = segment->m_buffer.size();
+        return segment->valid() ? segment : nullptr;
+    }
+
+    __tegra_no_discard u32 documents() const __tegra_noexcept { return m_header.documents; }
+    __tegra_no_discard u32 terms() const __tegra_noexcept { return m_header.terms; }
+    __tegra_no_discard u16 sources() const __tegra_noexcept { return static_cast<u16>(m_header.sources); }
+    __tegra_no_discard u64 totalLength() const __tegra_noexcept { return m_header.totalLength; }
+
+    __tegra_no_discard SegmentDocument document(u32 index) const __tegra_noexcept
+    {
+        return readAt<SegmentDocument>(m_data, m_header.documentsOffset + u64(index) * sizeof(SegmentDocument));
+    }
+
+    __tegra_no_discard std::string_view source(u16 index) const __tegra_noexcept
+    {
+        const auto name = readAt<SegmentName>(m_data, m_header.sourcesOffset + u64(index) * sizeof(SegmentName));
+        return {m_data + m_header.namesOffset + name.name, name.size};
+    }
+
+    /*!
+     * @brief term function gets the name and the postings of a term by its position in the sorted order.
+     */
+    __tegra_no_discard std::string_view term(u32 index, Term& term) const __tegra_noexcept
+    {
+        const auto entry = readAt<SegmentTerm>(m_data, m_header.termsOffset + u64(index) * sizeof(SegmentTerm));
+        term.frequency = entry.frequency;
+        term.postings  = {m_data + m_header.postingsOffset + entry.postings, entry.bytes};
+        return {m_data + m_header.namesOffset + entry.name, entry.size};
+    }
+
+    __tegra_no_discard std::optional<Term> find(std::string_view name) const __tegra_noexcept
+    {
+        u32 low = 0;
+        u32 high = m_header.terms;
+        Term found;
+        while (low < high) {
+            const u32 middle = low + (high - low) / 2;
+            const int order = term(middle, found).compare(name);
+            if (order == 0) return found;
+            if (order < 0) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        return std::nullopt;
+    }
+
+private:
+    SearchSegment() = default;
+
+    /*!
+     * @brief valid function checks the bounds of every section and entry once, reads do not check them again.
+     */
+    __tegra_no_discard bool valid()
+    {
+        if (m_data == nullptr || m_size < sizeof(SegmentHeader)) return false;
+        m_header = readAt<SegmentHeader>(m_data, 0);
+        const auto& h = m_header;
+        if (std::memcmp(h.magic, SegmentMagic, sizeof(SegmentMagic)) != 0 || h.version != SegmentVersion
+            || h.sources > std::numeric_limits<u16>::max()
+            || h.documentsOffset != sizeof(SegmentHeader)
+            || h.termsOffset != h.documentsOffset + u64(h.documents) * sizeof(SegmentDocument)
+            || h.sourcesOffset != h.termsOffset + u64(h.terms) * sizeof(SegmentTerm)
+            || h.namesOffset != h.sourcesOffset + u64(h.sources) * sizeof(SegmentName)
+            || h.postingsOffset < h.namesOffset || h.postingsOffset > m_size) {
+            return false;
+        }
+        const u64 names = h.postingsOffset - h.namesOffset;
+        const u64 postings = m_size - h.postingsOffset;
+        for (u32 i = 0; i < h.terms; ++i) {
+            const auto entry = readAt<SegmentTerm>(m_data, h.termsOffset + u64(i) * sizeof(SegmentTerm));
+            //! Both offsets are 64-bit, so the end is checked without adding them.
+            if (u64(entry.name) + entry.size > names || entry.postings > postings || entry.bytes > postings - entry.postings) return false;
+        }
+        for (u32 i = 0; i < h.sources; ++i) {
+            const auto name = readAt<SegmentName>(m_data, h.sourcesOffset + u64(i) * sizeof(SegmentName));
+            if (u64(name.name) + name.size > names) return false;
+        }
+        for (u32 i = 0; i < h.documents; ++i) {
+            if (document(i).source >= h.sources) return false;
+        }
+        return true;
+    }
+
+    const char*     m_data      {};
+    std::size_t     m_size      {};
+    void*           m_map       {};
+    std::string     m_buffer    {};
+    SegmentHeader   m_header    {};
+};
+
+SearchIndex::SearchIndex(ConnectionPool& pool, const SearchIndexOptions& options) : m_pool(pool), m_options(options)
+{
+    for (const auto& source : m_options.sources) {
+        checkIdentifier(source.table);
+        for (const auto& column : source.columns) {
+            checkIdentifier(column);
+        }
+        m_tables.emplace_back(TableRegistry::table(source.table, TableType::ValueSturct));
+        std::string sql = "SELECT language";
+        for (const auto& column : source.columns) {
+            sql.append(", ").append(column);
+        }
+        sql.append(" FROM ").append(m_tables.back()).append(" WHERE id = ?");
+        m_reads.emplace_back(CreateScope<SqlStatement>(std::move(sql)));
+    }
+    if (m_options.sources.size() > std::numeric_limits<u16>::max()) {
+        throw Exception(Exception::Reason::Core, "Too many search sources.");
+    }
+
+    //! Segments of an earlier run are opened as they are, build or commit writes them again.
+    std::error_code error;
+    if (m_options.directory.empty() || !std::filesystem::is_directory(m_options.directory, error)) {
+        return;
+    }
+    for (const auto& entry : std::filesystem::directory_iterator(m_options.directory, error)) {
+        if (!entry.is_regular_file() || entry.path().extension() != SegmentExtension) continue;
+        Ref<const SearchSegment> segment = SearchSegment::map(entry.path());
+        if (segment == nullptr) {
+            if(DeveloperMode::IsEnable) {
+                Log("Search segment [" + entry.path().string() + "] is not valid and was skipped.", LoggerType::Warning);
+            }
+            continue;
+        }
+        Language& target = language(decodeName(entry.path().stem().string()));
+        std::unique_lock lock(target.mutex);
+        reset(target, std::move(segment));
+    }
+}
+
+SearchIndex::~SearchIndex()
+{
+    stop();
+}
+
+void SearchIndex::build(const VectorString& languages)
+{
+    VectorString names = languages;
+    if (names.empty()) {
+        std::set<std::string> found;
+        for (std::size_t s = 0; s < m_tables.size(); ++s) {
+            try {
+                const ResultView rows = m_pool.select("SELECT DISTINCT language FROM " + m_tables[s]);
+                for (std::size_t r = 0; r < rows.size(); ++r) {
+                    found.emplace(rows.text(r, 0));
+                }
+            } catch (const std::exception& e) {
+                warn("read the languages of [" + m_tables[s] + "]", e);
+            }
+        }
+        names.assign(found.begin(), found.end());
+    }
+
+    //! Languages share nothing, each one is read, tokenized and written on its own thread.
+    std::vector<std::future<void>> builds;
+    builds.reserve(names.size());
+    for (const auto& name : names) {
+        builds.push_back(std::async(std::launch::async, [this, name] { buildLanguage(name); }));
+    }
+    std::exception_ptr failure;
+    for (auto& build : builds) {
+        try {
+            build.get();
+        } catch (...) {
+            if (failure == nullptr) failure = std::current_exception();
+        }
+    }
+    if (failure != nullptr) {
+        std::rethrow_exception(failure);
+    }
+}
+
+void SearchIndex::buildLater(const VectorString& languages)
+{
+    {
+        std::lock_guard lock(m_threadMutex);
+        if (m_running) {
+            if (!m_build) {
+                m_builds.insert(languages.begin(), languages.end());
+            } else if (languages.empty()) {
+                m_builds.clear();
+            } else if (!m_builds.empty()) {
+                m_builds.insert(languages.begin(), languages.end());
+            }
+            m_build = true;
+            m_wake.notify_one();
+            return;
+        }
+    }
+    build(languages);
+}
+
+std::vector<SearchHit> SearchIndex::search(std::string_view language, std::string_view query, std::size_t limit) const
+{
+    std::vector<SearchHit> hits;
+    const Language* target = find(language);
+    if (target == nullptr || limit == 0) {
+        return hits;
+    }
+    std::set<std::string, std::less<>> terms;
+    forEachTerm(query, [&terms](std::string_view term) { terms.emplace(term); });
+    if (terms.empty()) {
+        return hits;
+    }
+
+    std::shared_lock lock(target->mutex);
+    const SearchSegment* segment = target->segment.get();
+    const u64 baseDocuments = segment != nullptr ? segment->documents() - target->hidden.size() : 0;
+    const u64 baseLength = segment != nullptr ? segment->totalLength() - target->hiddenLength : 0;
+    const double count = static_cast<double>(baseDocuments + target->current.size());
+    if (count == 0) {
+        return hits;
+    }
+    const double averageLength = std::max(1.0, static_cast<double>(baseLength + target->length) / count);
+    const double k1 = m_options.k1;
+    const double b = m_options.b;
+    const auto weight = [&](double idf, u32 frequency, u32 length) {
+        const double tf = static_cast<double>(frequency);
+        return idf * tf * (k1 + 1.0) / (tf + k1 * (1.0 - b + b * static_cast<double>(length) / averageLength));
+    };
+
+    //! Documents of the delta are kept above 2^32 so that they don't collide with documents of the segment.
+    constexpr u64 DeltaBit = u64(1) << 32;
+    std::unordered_map<u64, double> scores;
+    for (const auto& term : terms) {
+        const std::optional<SearchSegment::Term> base = segment != nullptr ? segment->find(term) : std::nullopt;
+        const auto delta = target->postings.find(term);
+        u64 frequency = base ? base->frequency : 0;
+        if (delta != target->postings.end()) {
+            for (const auto& [document, tf] : delta->second) {
+                frequency += target->documents[document].live ? 1 : 0;
+            }
+        }
+        if (frequency == 0) continue;
+        const double df = std::min(static_cast<double>(frequency), count);
+        const double idf = std::log(1.0 + (count - df + 0.5) / (df + 0.5));
+        if (base) {
+            forEachPosting(base->postings, [&](u32 document, u32 tf) {
+                if (document >= segment->documents() || target->hidden.contains(document)) return;
+                scores[document] += weight(idf, tf, segment->document(document).length);
+            });
+        }
+        if (delta != target->postings.end()) {
+            for (const auto& [document, tf] : delta->second) {
+                const Document& row = target->documents[document];
+                if (row.live) scores[DeltaBit | document] += weight(idf, tf, row.length);
+            }
+        }
+    }
+
+    std::vector<std::pair<double, u64>> ranked;
+    ranked.reserve(scores.size());
+    for (const auto& [document, score] : scores) {
+        ranked.emplace_back(score, document);
+    }
+    const std::size_t size = std::min(limit, ranked.size());
+    std::partial_sort(ranked.begin(), ranked.begin() + static_cast<std::ptrdiff_t>(size), ranked.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.first != rhs.first ? lhs.first > rhs.first : lhs.second < rhs.second;
+    });
+    hits.reserve(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        const auto [score, document] = ranked[i];
+        if ((document & DeltaBit) != 0) {
+            const Document& row = target->documents[static_cast<u32>(document)];
+            hits.push_back({m_options.sources[row.source].table, row.id, score});
+        } else {
+            const SegmentDocument row = segment->document(static_cast<u32>(document));
+            hits.push_back({std::string(segment->source(row.source)), row.id, score});
+        }
+    }
+    return hits;
+}
+
+void SearchIndex::update(std::string_view table, u64 id)
+{
+    if (sourcesOf(table).empty()) {
+        return;
+    }
+    read(table, id);
+    changed();
+}
+
+void SearchIndex::schedule(std::string_view table, u64 id)
+{
+    if (sourcesOf(table).empty()) {
+        return;
+    }
+    {
+        std::lock_guard lock(m_threadMutex);
+        if (m_running) {
+            m_queue.emplace(std::string(table), id);
+            m_wake.notify_one();
+            return;
+        }
+    }
+    update(table, id);
+}
+
+void SearchIndex::written(const VectorString& tables)
+{
+    const bool indexed = tables.empty() || std::any_of(tables.begin(), tables.end(), [this](const std::string& table) {
+        return std::any_of(m_tables.begin(), m_tables.end(), [&table](const std::string& source) {
+            return source.size() == table.size() && std::equal(source.begin(), source.end(), table.begin(), [](char a, char b) {
+                       return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+                   });
+        });
+    });
+    if (!indexed) {
+        return;
+    }
+    //! The rows are not known, the indexed languages are built again, a bulk change reads the languages of the sources as well.
+    buildLater(tables.empty() ? VectorString() : languages());
+}
+
+void SearchIndex::remove(std::string_view table, u64 id, std::string_view language)
+{
+    for (const u16 source : sourcesOf(table)) {
+        for (const auto& name : languages()) {
+            if (!language.empty() && name != language) continue;
+            Language& target = this->language(name);
+            std::unique_lock lock(target.mutex);
+            hide(target, keyOf(source, id));
+        }
+    }
+    changed();
+}
+
+void SearchIndex::commit()
+{
+    for (const auto& name : languages()) {
+        merge(name, language(name), true);
+    }
+}
+
+void SearchIndex::start()
+{
+    std::lock_guard lock(m_threadMutex);
+    if (m_worker.joinable()) {
+        return;
+    }
+    m_stop = false;
+    m_running = true;
+    m_worker = std::thread(&SearchIndex::run, this);
+}
+
+void SearchIndex::stop()
+{
+    {
+        std::lock_guard lock(m_threadMutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+}
+
+bool SearchIndex::indexes(std::string_view table) const
+{
+    return !sourcesOf(table).empty();
+}
+
+VectorString SearchIndex::languages() const
+{
+    std::shared_lock lock(m_mutex);
+    VectorString names;
+    names.reserve(m_languages.size());
+    for (const auto& [name, target] : m_languages) {
+        names.push_back(name);
+    }
+    return names;
+}
+
+std::size_t SearchIndex::documents(std::string_view language) const
+{
+    const Language* target = find(language);
+    if (target == nullptr) {
+        return 0;
+    }
+    std::shared_lock lock(target->mutex);
+    const std::size_t base = target->segment != nullptr ? target->segment->documents() - target->hidden.size() : 0;
+    return base + target->current.size();
+}
+
+VectorString SearchIndex::tokenize(std::string_view text)
+{
+    VectorString terms;
+    forEachTerm(text, [&terms](std::string_view term) { terms.emplace_back(term); });
+    return terms;
+}
+
+std::vector<u16> SearchIndex::sourcesOf(std::string_view table) const
+{
+    std::vector<u16> sources;
+    const std::string_view full = TableRegistry::table(table, TableType::ValueSturct);
+    for (std::size_t s = 0; s < m_tables.size(); ++s) {
+        if (m_tables[s] == full) sources.push_back(static_cast<u16>(s));
+    }
+    return sources;
+}
+
+const SearchIndex::Language* SearchIndex::find(std::string_view language) const
+{
+    std::shared_lock lock(m_mutex);
+    const auto found = m_languages.find(language);
+    return found != m_languages.end() ? found->second.get() : nullptr;
+}
+
+SearchIndex::Language& SearchIndex::language(std::string_view language)
+{
+    {
+        std::shared_lock lock(m_mutex);
+        if (const auto found = m_languages.find(language); found != m_languages.end()) {
+            return *found->second;
+        }
+    }
+    //! Languages are never erased, so a reference stays valid without the lock.
+    std::unique_lock lock(m_mutex);
+    auto& target = m_languages[std::string(language)];
+    if (target == nullptr) {
+        target = CreateScope<Language>();
+    }
+    return *target;
+}
+
+void SearchIndex::read(std::string_view table, u64 id)
+{
+    for (const u16 source : sourcesOf(table)) {
+        const ResultView rows = m_pool.select(m_reads[source]->key(), {std::to_string(id)});
+
+        std::set<std::string, std::less<>> seen;
+        for (std::size_t r = 0; r < rows.size(); ++r) {
+            const std::string name(rows.text(r, 0));
+            Document document {source, id};
+            std::unordered_map<std::string, u32> counts;
+            for (std::size_t c = 1; c < rows.columns().size(); ++c) {
+                document.length += countTerms(rows.text(r, c), counts);
+            }
+            document.terms.assign(counts.begin(), counts.end());
+            Language& target = language(name);
+            std::unique_lock lock(target.mutex);
+            add(target, std::move(document));
+            seen.insert(name);
+        }
+        for (const auto& name : languages()) {
+            if (seen.contains(name)) continue;
+            Language& target = language(name);
+            std::unique_lock lock(target.mutex);
+            hide(target, keyOf(source, id));
+        }
+    }
+}
+
+void SearchIndex::changed()
+{
+    {
+        std::lock_guard lock(m_threadMutex);
+        if (m_running) {
+            m_merge = true;
+            m_wake.notify_one();
+            return;
+        }
+    }
+    mergeChanged(false);
+}
+
+void SearchIndex::run()
+{
+    //! Rows are read and merged here, so a write through the manager waits for neither.
+    std::unique_lock lock(m_threadMutex);
+    for (;;) {
+        m_wake.wait(lock, [this] { return m_stop || m_merge || m_build || !m_queue.empty(); });
+        if (m_stop && m_queue.empty()) {
+            m_running = false;
+            return;
+        }
+        const auto rows = std::move(m_queue);
+        m_queue.clear();
+        m_merge = false;
+        const bool rebuild = std::exchange(m_build, false);
+        const VectorString names(m_builds.begin(), m_builds.end());
+        m_builds.clear();
+        lock.unlock();
+        if (rebuild) {
+            //! The rows of the build are read after the write, a failed one keeps the old segments.
+            try {
+                build(names);
+            } catch (const std::exception& e) {
+                warn("build the languages", e);
+            }
+        }
+        for (const auto& [table, id] : rows) {
+            //! The write is done already, a failed read only leaves the old text in the index until the next build.
+            try {
+                read(table, id);
+            } catch (const std::exception& e) {
+                warn("read [" + table + "] again", e);
+            }
+        }
+        try {
+            mergeChanged(true);
+        } catch (const std::exception& e) {
+            warn("merge the changes", e);
+        }
+        lock.lock();
+    }
+}
+
+void SearchIndex::buildLanguage(const std::string& name)
+{
+    Language& target = language(name);
+    std::lock_guard writer(target.writer);
+    {
+        std::unique_lock lock(target.mutex);
+        target.building = true;
+        target.touched.clear();
+    }
+
+    SegmentWriter segment(m_options.sources);
+    std::size_t failed = 0;
+    for (std::size_t s = 0; s < m_options.sources.size(); ++s) {
+        std::string sql = "SELECT id";
+        for (const auto& column : m_options.sources[s].columns) {
+            sql.append(", ").append(column);
+        }
+        sql.append(" FROM ").append(m_tables[s]).append(" WHERE language = ? ORDER BY id");
+        try {
+            const ResultView rows = m_pool.select(sql, {name});
+            std::unordered_map<std::string, u32> counts;
+            for (std::size_t r = 0; r < rows.size(); ++r) {
+                counts.clear();
+                u32 length = 0;
+                for (std::size_t c = 1; c < rows.columns().size(); ++c) {
+                    length += countTerms(rows.text(r, c), counts);
+                }
+                const u32 document = segment.document(static_cast<u16>(s), rows.get<u64>(r, 0).value_or(0), length);
+                for (const auto& [term, frequency] : counts) {
+                    segment.posting(term, document, frequency);
+                }
+            }
+        } catch (const std::exception& e) {
+            //! A missing table is skipped, but if no source can be read the old segment is kept.
+            warn("read [" + m_tables[s] + "] for [" + name + "]", e);
+            ++failed;
+        }
+    }
+    if (failed == m_options.sources.size()) {
+        std::unique_lock lock(target.mutex);
+        target.building = false;
+        target.touched.clear();
+        return;
+    }
+    publish(name, target, segment.finish());
+    if(DeveloperMode::IsEnable) {
+        Log("Search index of [" + name + "] was built with " + std::to_string(documents(name)) + " documents.", LoggerType::Info);
+    }
+}
+
+void SearchIndex::merge(const std::string& name, Language& target, bool wait)
+{
+    std::unique_lock writer(target.writer, std::defer_lock);
+    if (wait) {
+        writer.lock();
+    } else if (!writer.try_lock()) {
+        return;
+    }
+
+    Ref<const SearchSegment> segment;
+    std::unordered_set<u32> hidden;
+    std::vector<Document> documents;
+    {
+        std::unique_lock lock(target.mutex);
+        if (target.changes == 0) {
+            return;
+        }
+        segment = target.segment;
+        hidden = target.hidden;
+        for (const auto& document : target.documents) {
+            if (document.live) documents.push_back(document);
+        }
+        target.building = true;
+        target.touched.clear();
+    }
+
+    //! Documents keep their order, so the postings of every term stay sorted: segment first, then the delta.
+    SegmentWriter merged(m_options.sources);
+    if (segment != nullptr) {
+        //! Documents of sources that are no longer configured are dropped.
+        std::vector<std::optional<u16>> sources(segment->sources());
+        for (u16 s = 0; s < segment->sources(); ++s) {
+            for (std::size_t own = 0; own < m_options.sources.size(); ++own) {
+                if (m_options.sources[own].table == segment->source(s)) sources[s] = static_cast<u16>(own);
+            }
+        }
+        std::vector<u32> remap(segment->documents(), Dropped);
+        for (u32 i = 0; i < segment->documents(); ++i) {
+            const SegmentDocument document = segment->document(i);
+            if (hidden.contains(i) || !sources[document.source]) continue;
+            remap[i] = merged.document(*sources[document.source], document.id, document.length);
+        }
+        SearchSegment::Term term;
+        for (u32 t = 0; t < segment->terms(); ++t) {
+            const std::string_view termName = segment->term(t, term);
+            forEachPosting(term.postings, [&](u32 document, u32 frequency) {
+                if (document < remap.size() && remap[document] != Dropped) merged.posting(termName, remap[document], frequency);
+            });
+        }
+    }
+    std::vector<u32> ids;
+    ids.reserve(documents.size());
+    for (const auto& document : documents) {
+        ids.push_back(merged.document(document.source, document.id, document.length));
+    }
+    for (std::size_t d = 0; d < documents.size(); ++d) {
+        for (const auto& [term, frequency] : documents[d].terms) {
+            merged.posting(term, ids[d], frequency);
+        }
+    }
+    publish(name, target, merged.finish());
+}
+
+void SearchIndex::mergeChanged(bool wait)
+{
+    if (m_options.mergeAfter == 0) {
+        return;
+    }
+    for (const auto& name : languages()) {
+        Language& target = language(name);
+        {
+            std::shared_lock lock(target.mutex);
+            if (target.changes < m_options.mergeAfter) continue;
+        }
+        merge(name, target, wait);
+    }
+}
+
+void SearchIndex::publish(const std::string& name, Language& target, std::string data)
+{
+    Ref<const SearchSegment> segment;
+    try {
+        if (m_options.directory.empty()) {
+            segment = SearchSegment::load(std::move(data));
+        } else {
+            //! Written next to the old file and renamed, readers of the old mapping keep it until they are done.
+            std::filesystem::create_directories(m_options.directory);
+            const std::filesystem::path path = m_options.directory / (encodeName(name) + std::string(SegmentExtension));
+            std::filesystem::path temporary = path;
+            temporary += ".tmp";
+            writeFile(temporary, data);
+            std::filesystem::rename(temporary, path);
+            syncDirectory(m_options.directory);
+            segment = SearchSegment::map(path);
+        }
+        if (segment == nullptr) {
+            throw Exception(Exception::Reason::IO, "The search segment of [" + name + "] can not be opened.");
+        }
+    } catch (...) {
+        std::unique_lock lock(target.mutex);
+        target.building = false;
+        target.touched.clear();
+        throw;
+    }
+
+    std::unique_lock lock(target.mutex);
+    //! Rows that changed while the segment was written are applied again on top of it.
+    std::vector<Document> pending;
+    std::vector<u64> removed;
+    for (const u64 key : target.touched) {
+        if (const auto found = target.current.find(key); found != target.current.end()) {
+            pending.push_back(std::move(target.documents[found->second]));
+        } else {
+            removed.push_back(key);
+        }
+    }
+    reset(target, std::move(segment));
+    for (const u64 key : removed) {
+        hide(target, key);
+    }
+    for (auto& document : pending) {
+        add(target, std::move(document));
+    }
+}
+
+void SearchIndex::reset(Language& target, Ref<const SearchSegment> segment)
+{
+    target.segment = std::move(segment);
+    target.base.clear();
+    target.hidden.clear();
+    target.hiddenLength = 0;
+    target.documents.clear();
+    target.current.clear();
+    target.postings.clear();
+    target.length = 0;
+    target.changes = 0;
+    target.building = false;
+    target.touched.clear();
+    if (target.segment == nullptr) {
+        return;
+    }
+    std::vector<std::optional<u16>> sources(target.segment->sources());
+    for (u16 s = 0; s < target.segment->sources(); ++s) {
+        for (std::size_t own = 0; own < m_options.sources.size(); ++own) {
+            if (m_options.sources[own].table == target.segment->source(s)) sources[s] = static_cast<u16>(own);
+        }
+    }
+    target.base.reserve(target.segment->documents());
+    for (u32 i = 0; i < target.segment->documents(); ++i) {
+        const SegmentDocument document = target.segment->document(i);
+        if (sources[document.source]) target.base[keyOf(*sources[document.source], document.id)] = i;
+    }
+}
+
+void SearchIndex::add(Language& target, Document document)
+{
+    hide(target, keyOf(document.source, document.id));
+    const u32 index = static_cast<u32>(target.documents.size());
+    for (const auto& [term, frequency] : document.terms) {
+        target.postings[term].emplace_back(index, frequency);
+    }
+    target.length += document.length;
+    target.current[keyOf(document.source, document.id)] = index;
+    target.documents.push_back(std::move(document));
+}
+
+void SearchIndex::hide(Language& target, u64 key)
+{
+    if (const auto found = target.base.find(key); found != target.base.end() && target.hidden.insert(found->second).second) {
+        target.hiddenLength += target.segment->document(found->second).length;
+    }
+    if (const auto found = target.current.find(key); found != target.current.end()) {
+        Document& document = target.documents[found->second];
+        document.live = false;
+        document.terms.clear();
+        target.length -= document.length;
+        target.current.erase(found);
+    }
+    if (target.building) {
+        target.touched.insert(key);
+    }
+    ++target.changes;
+}
+
+u64 SearchIndex::keyOf(u16 source, u64 id) __tegra_noexcept
+{
+    //! Ids are below 2^48 in practice, the source goes into the top bits.
+    return (u64(source) << 48) ^ id;
+}
+
+TEGRA_NAMESPACE_END
@@ -0,0 +1,250 @@
+/*!
+ * MIT License
+ *
+ * Copyright (c) 2022 Kambiz Asadzadeh
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+
+#ifndef TEGRA_SEARCHINDEX_HPP
+#define TEGRA_SEARCHINDEX_HPP
+
+#include "connectionpool.hpp"
+#include "sqlquery.hpp"
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+class SearchSegment;
+
+/*!
+ * @brief The SearchSource struct is a value table whose text columns are indexed.
+ */
+struct SearchSource final
+{
+    std::string     table   {};     ///<Value table without prefix, it needs the id and language columns.
+    VectorString    columns {};     ///<Text columns of a row, they are indexed as one document.
+};
+
+/*!
+ * @brief The SearchIndexOptions struct holds the sources and the ranking of a SearchIndex.
+ */
+struct SearchIndexOptions final
+{
+    std::filesystem::path       directory   {};         ///<One segment file per language, empty keeps the index in memory only.
+    std::vector<SearchSource>   sources     {{"static_l", {"title", "document_title", "meta_descr", "text"}},
+                                             {"resource_l", {"title", "text"}}};
+    double                      k1          {1.2};      ///<BM25 saturation of the term frequency.
+    double                      b           {0.75};     ///<BM25 normalization by the document length.
+    std::size_t                 mergeAfter  {1000};     ///<Changed documents of a language after which its segment is written again, zero only by commit.
+};
+
+/*!
+ * @brief The SearchHit struct is a document of a search result.
+ */
+struct SearchHit final
+{
+    std::string table   {};     ///<Source table without prefix.
+    u64         id      {};
+    double      score   {};
+};
+
+/*!
+ * @brief The SearchIndex class is an in-process inverted index of the text of static pages and resources, one per language.
+ * Every language has an immutable segment file with the terms in sorted order and their posting lists
+ * as delta and varint coded (document, frequency) pairs, the file is mapped into memory and read in place.
+ * Rows that change through the manager go into a small in-memory delta and hide their old document,
+ * the delta is merged into a new segment after mergeAfter changes or by commit.
+ * The manager only schedules its rows, the background thread reads them again and runs the merges.
+ * Results are ranked by BM25, the document frequencies include hidden documents until the next merge.
+ * @example
+ * SearchIndex index(pool, {"storage/search"});
+ * index.start();
+ * index.build({"english", "persian"});
+ * for (const auto& hit : index.search("english", "release notes")) {
+ *     render(hit.table, hit.id);
+ * }
+ */
+class SearchIndex final
+{
+public:
+    SearchIndex(ConnectionPool& pool, const SearchIndexOptions& options = {});
+    SearchIndex(const SearchIndex& rhsIndex) = delete;
+    SearchIndex& operator=(const SearchIndex& rhsIndex) = delete;
+
+    /*!
+     * @brief The destructor stops the background thread.
+     */
+    ~SearchIndex();
+
+    /*!
+     * @brief build function indexes the sources again, each language is built on its own thread.
+     * @param languages are values of the language column, the language names like "english". Empty means all languages of the sources.
+     */
+    void build(const VectorString& languages = {});
+
+    /*!
+     * @brief buildLater function queues a build for the background thread, builds that did not start yet run as one.
+     * Without the background thread the languages are built at once.
+     * @param languages like build, empty means all languages of the sources.
+     */
+    void buildLater(const VectorString& languages = {});
+
+    /*!
+     * @brief search function finds the documents that contain any term of the query.
+     * @param language of the documents, a value of the language column like "english".
+     * @param query is tokenized like the documents.
+     * @param limit is the number of hits, the best ones first.
+     */
+    __tegra_no_discard std::vector<SearchHit> search(std::string_view language, std::string_view query, std::size_t limit = 10) const;
+
+    /*!
+     * @brief update function reads a row again for all of its languages, languages that no longer have the row drop it.
+     * @param table is a key or value table without prefix, other tables are ignored.
+     * @param id of the row.
+     */
+    void update(std::string_view table, u64 id);
+
+    /*!
+     * @brief schedule function queues a row for update on the background thread, a row that is queued twice is read once.
+     * Without the background thread the row is updated at once.
+     */
+    void schedule(std::string_view table, u64 id);
+
+    /*!
+     * @brief written function queues a build of the indexed languages after a write whose rows are not known, like a raw statement.
+     * @param tables are full names of the written tables, tables that are not sources are ignored. Empty means all tables.
+     */
+    void written(const VectorString& tables);
+
+    /*!
+     * @brief remove function drops a row from the index without reading it.
+     * @param language limits the remove to one language, empty means all languages.
+     */
+    void remove(std::string_view table, u64 id, std::string_view language = {});
+
+    /*!
+     * @brief commit function merges the changes of every language into its segment.
+     */
+    void commit();
+
+    /*!
+     * @brief start function runs the scheduled updates and the merges on a background thread.
+     * Without it, update and remove merge a language inline once it has mergeAfter changes.
+     */
+    void start();
+
+    /*!
+     * @brief stop function stops the background thread after the rows that are queued already.
+     */
+    void stop();
+
+    /*!
+     * @brief indexes function checks if changes of a table are indexed.
+     * @param table is a key or value table without prefix.
+     */
+    __tegra_no_discard bool indexes(std::string_view table) const;
+
+    __tegra_no_discard VectorString languages() const;
+
+    /*!
+     * @brief documents function gets the number of documents of a language that are found by a search.
+     */
+    __tegra_no_discard std::size_t documents(std::string_view language) const;
+
+    /*!
+     * @brief tokenize function splits a text into lower case terms.
+     * HTML tags and entities are skipped, bytes of UTF-8 letters are kept as they are
+     * and the Unicode spaces, the zero width non-joiner and Arabic punctuation split terms.
+     */
+    __tegra_no_discard static VectorString tokenize(std::string_view text);
+
+private:
+    /*!
+     * @brief The Document struct is a row that changed since the segment was written.
+     */
+    struct Document final
+    {
+        u16                                         source  {};
+        u64                                         id      {};
+        u32                                         length  {};
+        bool                                        live    {true};
+        std::vector<std::pair<std::string, u32>>    terms   {};     ///<Term and its frequency, cleared once the row changes again.
+    };
+
+    /*!
+     * @brief The Language struct is the segment and the delta of one language.
+     */
+    struct Language final
+    {
+        Ref<const SearchSegment>                                            segment         {};
+        std::unordered_map<u64, u32>                                        base            {};     ///<Key of a row to its document of the segment.
+        std::unordered_set<u32>                                             hidden          {};     ///<Documents of the segment that changed or were removed.
+        u64                                                                 hiddenLength    {};
+        std::vector<Document>                                               documents       {};
+        std::unordered_map<u64, u32>                                        current         {};     ///<Key of a row to its live document of the delta.
+        std::unordered_map<std::string, std::vector<std::pair<u32, u32>>>   postings        {};     ///<Term to documents of the delta and their frequencies.
+        u64                                                                 length          {};     ///<Terms of the live documents of the delta.
+        std::size_t                                                         changes         {};
+        bool                                                                building        {};     ///<A new segment is written, changes are recorded in touched.
+        std::unordered_set<u64>                                             touched         {};
+        mutable std::shared_mutex                                           mutex           {};
+        std::mutex                                                          writer          {};     ///<One build or merge at a time.
+    };
+
+    __tegra_no_discard std::vector<u16> sourcesOf(std::string_view table) const;
+    __tegra_no_discard const Language* find(std::string_view language) const;
+    Language& language(std::string_view language);
+
+    void read(std::string_view table, u64 id);
+    void changed();
+    void run();
+    void buildLanguage(const std::string& name);
+    void merge(const std::string& name, Language& target, bool wait);
+    void mergeChanged(bool wait);
+    void publish(const std::string& name, Language& target, std::string data);
+
+    //! The following functions are called with the lock of the language.
+    void reset(Language& target, Ref<const SearchSegment> segment);
+    void add(Language& target, Document document);
+    void hide(Language& target, u64 key);
+
+    static u64 keyOf(u16 source, u64 id) __tegra_noexcept;
+
+    ConnectionPool&                                         m_pool;
+    SearchIndexOptions                                      m_options       {};
+    VectorString                                            m_tables        {};     ///<Full names of the sources, by source.
+    std::vector<Scope<SqlStatement>>                        m_reads         {};     ///<Reads the rows of one id, by source.
+    std::map<std::string, Scope<Language>, std::less<>>     m_languages     {};
+    mutable std::shared_mutex                               m_mutex         {};
+    std::mutex                                              m_threadMutex   {};
+    std::condition_variable                                 m_wake          {};
+    std::thread                                             m_worker        {};
+    std::set<std::pair<std::string, u64>>                   m_queue         {};     ///<Scheduled rows by table and id.
+    bool                                                    m_merge         {};     ///<Languages have changes that are due for a merge.
+    bool                                                    m_build         {};     ///<A build is queued.
+    std::set<std::string, std::less<>>                      m_builds        {};     ///<Languages of the queued build, empty means all.
+    bool                                                    m_running       {};     ///<The background thread takes scheduled rows.
+    bool                                                    m_stop          {};
+};
+
+TEGRA_NAMESPACE_END
+
+#endif  // TEGRA_SEARCHINDEX_HPP
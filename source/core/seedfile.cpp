@@ -0,0 +1,285 @@
+#include "seedfile.hpp"
+#include "tableregistry.hpp"
+#include "core.hpp"
+
+TEGRA_USING_NAMESPACE Tegra::CMS;
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+TEGRA_ANONYMOUS_NAMESPACE_BEGIN
+
+/*!
+ * @brief The SeedParser class reads the json dialect of system-tables.json.
+ */
+class SeedParser final
+{
+public:
+    explicit SeedParser(std::string_view source) : m_source(source)
+    {
+    }
+
+    SeedNode parse()
+    {
+        SeedNode root = value();
+        skip();
+        if (m_pos != m_source.size()) error("unexpected content after the root value");
+        return root;
+    }
+
+private:
+    [[noreturn]] void error(std::string_view message) const
+    {
+        const auto line = std::count(m_source.begin(), m_source.begin() + static_cast<std::ptrdiff_t>(std::min(m_pos, m_source.size())), '\n') + 1;
+        throw Exception(Exception::Reason::IO, "Seed file, line " + std::to_string(line) + ": " + std::string(message));
+    }
+
+    void skip() __tegra_noexcept
+    {
+        while (m_pos < m_source.size()) {
+            const char c = m_source[m_pos];
+            if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+                ++m_pos;
+            } else if (m_source.compare(m_pos, 2, "//") == 0) {
+                const auto end = m_source.find('\n', m_pos);
+                m_pos = end == std::string_view::npos ? m_source.size() : end + 1;
+            } else if (m_source.compare(m_pos, 2, "/*") == 0) {
+                const auto end = m_source.find("*/", m_pos + 2);
+                m_pos = end == std::string_view::npos ? m_source.size() : end + 2;
+            } else {
+                break;
+            }
+        }
+    }
+
+    char peek()
+    {
+        skip();
+        if (m_pos == m_source.size()) error("unexpected end of file");
+        return m_source[m_pos];
+    }
+
+    SeedNode value()
+    {
+        const char c = peek();
+        SeedNode node;
+        if (c == '{') {
+            node.kind = SeedNode::Kind::Object;
+            ++m_pos;
+            while (peek() != '}') {
+                if (peek() != '"') error("expected a key");
+                std::string key = text();
+                if (peek() != ':') error("expected ':'");
+                ++m_pos;
+                node.members.emplace_back(std::move(key), value());
+                separator('}');
+            }
+            ++m_pos;
+        } else if (c == '[') {
+            node.kind = SeedNode::Kind::Array;
+            ++m_pos;
+            while (peek() != ']') {
+                node.items.push_back(value());
+                separator(']');
+            }
+            ++m_pos;
+        } else if (c == '"') {
+            node.kind = SeedNode::Kind::Text;
+            node.text = text();
+        } else {
+            node.kind = SeedNode::Kind::Scalar;
+            const auto start = m_pos;
+            while (m_pos < m_source.size() && std::string_view(",]} \t\r\n/").find(m_source[m_pos]) == std::string_view::npos) ++m_pos;
+            if (m_pos == start) error("unexpected character");
+            node.text = std::string(m_source.substr(start, m_pos - start));
+        }
+        return node;
+    }
+
+    //! Trailing commas are allowed.
+    void separator(char close)
+    {
+        const char c = peek();
+        if (c == ',') {
+            ++m_pos;
+        } else if (c != close) {
+            error(std::string("expected ',' or '") + close + "'");
+        }
+    }
+
+    //! Adjacent strings are joined, line breaks inside a string are kept.
+    std::string text()
+    {
+        std::string output;
+        do {
+            ++m_pos;
+            for (;;) {
+                if (m_pos >= m_source.size()) error("unterminated string");
+                const char c = m_source[m_pos++];
+                if (c == '"') break;
+                if (c != '\\') {
+                    output.push_back(c);
+                    continue;
+                }
+                if (m_pos >= m_source.size()) error("unterminated string");
+                const char e = m_source[m_pos++];
+                switch (e) {
+                case 'n': output.push_back('\n'); break;
+                case 't': output.push_back('\t'); break;
+                case 'r': output.push_back('\r'); break;
+                case 'b': output.push_back('\b'); break;
+                case 'f': output.push_back('\f'); break;
+                case 'u': unicode(output); break;
+                default:  output.push_back(e);
+                }
+            }
+        } while (peek() == '"');
+        return output;
+    }
+
+    void unicode(std::string& output)
+    {
+        const auto hex = [this]() -> u32 {
+            if (m_pos + 4 > m_source.size()) error("bad \\u escape");
+            u32 code = 0;
+            for (int i = 0; i < 4; ++i) {
+                const char h = m_source[m_pos++];
+                code <<= 4;
+                if (h >= '0' && h <= '9') code |= static_cast<u32>(h - '0');
+                else if (h >= 'a' && h <= 'f') code |= static_cast<u32>(h - 'a' + 10);
+                else if (h >= 'A' && h <= 'F') code |= static_cast<u32>(h - 'A' + 10);
+                else error("bad \\u escape");
+            }
+            return code;
+        };
+        u32 code = hex();
+        if (code >= 0xD800 && code <= 0xDBFF && m_source.compare(m_pos, 2, "\\u") == 0) {
+            m_pos += 2;
+            code = 0x10000 + ((code - 0xD800) << 10) + (hex() - 0xDC00);
+        }
+        if (code < 0x80) {
+            output.push_back(static_cast<char>(code));
+        } else if (code < 0x800) {
+            output.push_back(static_cast<char>(0xC0 | (code >> 6)));
+            output.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        } else if (code < 0x10000) {
+            output.push_back(static_cast<char>(0xE0 | (code >> 12)));
+            output.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            output.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        } else {
+            output.push_back(static_cast<char>(0xF0 | (code >> 18)));
+            output.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+            output.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            output.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+    }
+
+    std::string_view    m_source    {};
+    std::size_t         m_pos       {};
+};
+
+/*!
+ * @brief replaceWord function replaces every case insensitive match of a phrase, runs of spaces inside the text match any space.
+ */
+void replaceWord(std::string& text, std::string_view phrase, std::string_view replacement)
+{
+    const auto space = [](char c) { return std::isspace(static_cast<unsigned char>(c)) != 0; };
+    std::size_t at = 0;
+    while (at < text.size()) {
+        std::size_t i = at;
+        std::size_t k = 0;
+        while (k < phrase.size() && i < text.size()) {
+            if (phrase[k] == ' ' && space(text[i])) {
+                while (i < text.size() && space(text[i])) ++i;
+                ++k;
+            } else if (std::toupper(static_cast<unsigned char>(text[i])) == phrase[k]) {
+                ++i;
+                ++k;
+            } else {
+                break;
+            }
+        }
+        if (k != phrase.size()) {
+            ++at;
+            continue;
+        }
+        text.replace(at, i - at, replacement);
+        at += replacement.size();
+    }
+}
+
+/*!
+ * @brief sqliteDefinition function rewrites the postgresql constructs of a definition that sqlite3 does not understand.
+ * An INTEGER primary key is the rowid in sqlite3 and numbers new rows by itself, so the identity clause is dropped.
+ */
+std::string sqliteDefinition(std::string content)
+{
+    replaceWord(content, " GENERATED BY DEFAULT AS IDENTITY", "");
+    replaceWord(content, " GENERATED ALWAYS AS IDENTITY", "");
+    replaceWord(content, "DEFAULT NOW()", "DEFAULT CURRENT_TIMESTAMP");
+    return content;
+}
+
+TEGRA_NAMESPACE_END
+
+const SeedNode* SeedNode::find(std::string_view key) const __tegra_noexcept
+{
+    for (const auto& [name, node] : members) {
+        if (name == key) return &node;
+    }
+    return nullptr;
+}
+
+SeedNode SeedFile::parse(std::string_view source)
+{
+    return SeedParser(source).parse();
+}
+
+SeedNode SeedFile::read(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw Exception(Exception::Reason::IO, "Can not open the seed file [" + path + "].");
+    }
+    const std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return parse(source);
+}
+
+std::vector<SeedEntry> SeedFile::section(const SeedNode& root, std::string_view section, std::string_view rdbms)
+{
+    std::vector<SeedEntry> entries;
+    const SeedNode* tables = root.find("tables");
+    if (tables == nullptr) return entries;
+    //! sqlite3 reads the postgresql entries, their definitions are rewritten where the syntax differs.
+    const bool sqlite = rdbms == TEGRA_RDBMS::SQLite;
+    const std::string_view wanted = sqlite ? TEGRA_RDBMS::PostgreSQL : rdbms;
+    const bool rewrite = sqlite && section == "create";
+    const std::string prefix(TableRegistry::prefix());
+    const auto add = [&entries, &prefix, rewrite](std::string_view name, std::string content) {
+        if (rewrite) content = sqliteDefinition(std::move(content));
+        for (std::size_t at = content.find("{{table_prefix}}"); at != std::string::npos; at = content.find("{{table_prefix}}", at)) {
+            content.replace(at, 16, prefix);
+            at += prefix.size();
+        }
+        entries.push_back({std::string(name), std::move(content)});
+    };
+    for (const auto& group : tables->items) {
+        const SeedNode* list = group.find(section);
+        if (list == nullptr) continue;
+        for (const auto& driver : list->items) {
+            const SeedNode* name = driver.find("name");
+            const SeedNode* data = driver.find("data");
+            if (name == nullptr || data == nullptr || name->text != wanted) continue;
+            for (const auto& item : data->items) {
+                const SeedNode* table = item.find("name");
+                const SeedNode* content = item.find("content");
+                if (table != nullptr && content != nullptr) add(table->text, content->text);
+            }
+            for (const auto& [table, content] : data->members) {
+                add(table, content.text);
+            }
+        }
+    }
+    return entries;
+}
+
+TEGRA_NAMESPACE_END
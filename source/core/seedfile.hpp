@@ -0,0 +1,95 @@
+/*!
+ * MIT License
+ *
+ * Copyright (c) 2022 Kambiz Asadzadeh
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef TEGRA_SEEDFILE_HPP
+#define TEGRA_SEEDFILE_HPP
+
+#include "common.hpp"
+
+TEGRA_USING_NAMESPACE Tegra::Types;
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+/*!
+ * @brief The SeedNode struct is a value of config/system-tables.json.
+ */
+struct SeedNode final
+{
+    enum class Kind : u8 { Scalar, Text, Array, Object };
+
+    Kind                                            kind    {};
+    std::string                                     text    {};     ///<Text of strings and scalars.
+    std::vector<SeedNode>                           items   {};
+    std::vector<std::pair<std::string, SeedNode>>   members {};     ///<Members of an object in the order of the file.
+
+    /*!
+     * @returns the member with the key or nullptr.
+     */
+    __tegra_no_discard const SeedNode* find(std::string_view key) const __tegra_noexcept;
+};
+
+/*!
+ * @brief The SeedEntry struct is one table of a section, such as "create" or "insert".
+ */
+struct SeedEntry final
+{
+    std::string table   {};     ///<Name of the table without prefix.
+    std::string content {};     ///<Sql text, {{table_prefix}} is already replaced.
+};
+
+/*!
+ * @brief The SeedFile class reads config/system-tables.json.
+ * The file is read leniently: comments, trailing commas, line breaks inside strings and
+ * adjacent strings (which are joined) are accepted.
+ */
+class SeedFile final
+{
+public:
+    /*!
+     * @brief parse function parses the text of a seed file.
+     * @returns the root value, it throws with the line number on syntax errors.
+     */
+    __tegra_no_discard static SeedNode parse(std::string_view source);
+
+    /*!
+     * @brief read function reads and parses a seed file.
+     * @param path of the file.
+     */
+    __tegra_no_discard static SeedNode read(const std::string& path);
+
+    /*!
+     * @brief section function gets the tables of a section for a rdbms.
+     * The postgresql entries are lists of {name, content} objects, the mysql ones map names to content.
+     * @param root is the parsed file.
+     * @param section is for example "create" or "insert".
+     * @param rdbms is "postgresql", "mysql" or "sqlite3", sqlite3 uses the postgresql entries
+     * and gets its "create" definitions without identity clauses and with CURRENT_TIMESTAMP for NOW().
+     * @returns tables in the order of the file.
+     */
+    __tegra_no_discard static std::vector<SeedEntry> section(const SeedNode& root, std::string_view section, std::string_view rdbms);
+};
+
+TEGRA_NAMESPACE_END
+
+#endif  // TEGRA_SEEDFILE_HPP
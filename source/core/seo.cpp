@@ -1,6 +1,7 @@
 #include "common.hpp"
 #include "core/core.hpp"
 #include "core/seo.hpp"
+#include "core/text.hpp"
 
 TEGRA_USING_NAMESPACE Tegra;
 TEGRA_USING_NAMESPACE Tegra::CMS;
@@ -27,32 +28,45 @@ std::vector<std::string> MetaTag::tags() const
 
 void MetaTag::registerTags(const MetaType& type, const MapString& item)
 {
-    std::stringstream stream;
+    //! Each tag is built into its own string with one allocation.
+    m_metaStruct->tags.reserve(m_metaStruct->tags.size() + item.size());
     switch (type) {
     case MetaType::Name:
         for(const auto& i : item) {
-            stream << "<meta name=" << '"' << i.first << '"' << ' ' << "content=" << '"' << i.second << '"' << "/>" << __tegra_newline;
-            m_metaStruct->tags.push_back(stream.str());
-            stream.str("");
+            std::string tag;
+            Text(tag).concat("<meta name=\"", i.first, "\" content=\"", i.second, "\"/>", __tegra_newline);
+            m_metaStruct->tags.push_back(TEGRA_MOVE(tag));
         }
         break;
     case MetaType::Property:
         for(const auto& i : item) {
-            stream << "<meta property=" << '"' << i.first << '"' << ' ' << "content=" << '"' << i.second << '"' << "/>" << __tegra_newline;
-            m_metaStruct->tags.push_back(stream.str());
-            stream.str("");
+            std::string tag;
+            Text(tag).concat("<meta property=\"", i.first, "\" content=\"", i.second, "\"/>", __tegra_newline);
+            m_metaStruct->tags.push_back(TEGRA_MOVE(tag));
         }
         break;
     case MetaType::Extra:
         for(const auto& i : item) {
-            stream << "<meta " << i.first << "=" << '"' << i.second << '"' << "/>" << __tegra_newline;
-            m_metaStruct->tags.push_back(stream.str());
-            stream.str("");
+            std::string tag;
+            Text(tag).concat("<meta ", i.first, "=\"", i.second, "\"/>", __tegra_newline);
+            m_metaStruct->tags.push_back(TEGRA_MOVE(tag));
         }
         break;
     }
 }
 
+void MetaTag::tags(Text& output) const
+{
+    std::size_t size = output.size();
+    for (const auto& tag : m_metaStruct->tags) {
+        size += tag.size();
+    }
+    output.reserve(size);
+    for (const auto& tag : m_metaStruct->tags) {
+        output.append(tag);
+    }
+}
+
 StaticMeta::StaticMeta()
 {
     m_staticStruct = new StaticStruct();
@@ -25,6 +25,7 @@
 #define SEO_HPP
 
 #include "common.hpp"
+#include "text.hpp"
 
 TEGRA_USING_NAMESPACE Tegra::Types;
 
@@ -66,6 +67,12 @@ public:
    */
   std::vector<std::string> tags() const;
 
+  /*!
+   * @brief tags will writes all meta tags into the output.
+   * @param output is the sink that receives the tags.
+   */
+  void tags(Text& output) const;
+
   /*!
    * @brief registerTags will sets meta data into list.
    * @param type gets meta types as [Name, Property].
@@ -0,0 +1,402 @@
+#include "sessionstore.hpp"
+#include "database.hpp"
+#include "tableregistry.hpp"
+#include "sqlquery.hpp"
+#include "core.hpp"
+#include "logger.hpp"
+
+TEGRA_USING_NAMESPACE Tegra;
+TEGRA_USING_NAMESPACE Tegra::CMS;
+TEGRA_USING_NAMESPACE Tegra::eLogger;
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+TEGRA_ANONYMOUS_NAMESPACE_BEGIN
+
+//! Rows of "members_session" whose expiry passed are deleted after this many flushes.
+constexpr u64 PurgeInterval = 60;
+
+//! Columns of one row of an upsert, sqlite takes 32766 parameters per statement.
+constexpr std::size_t SessionColumns = 5;
+constexpr std::size_t MaxParameters = 32766;
+
+std::chrono::milliseconds::rep nowMilliseconds() __tegra_noexcept
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void warn(std::string_view what, const std::exception& e)
+{
+    if(DeveloperMode::IsEnable) {
+        Log("The sessions could not " + std::string(what) + ": " + std::string(e.what()), LoggerType::Warning);
+    }
+}
+
+std::string placeholders(std::size_t count, std::size_t columns)
+{
+    std::string row = "(";
+    for (std::size_t c = 0; c < columns; ++c) row.append(c == 0 ? "?" : ", ?");
+    row.push_back(')');
+    std::string list;
+    list.reserve(count * (row.size() + 2));
+    for (std::size_t i = 0; i < count; ++i) {
+        if (i != 0) list.append(", ");
+        list.append(row);
+    }
+    return list;
+}
+
+TEGRA_NAMESPACE_END
+
+SessionStore::SessionStore(ConnectionPool& pool, const SessionStoreOptions& options) : m_pool(pool), m_options(options)
+{
+    m_options.shards     = std::bit_ceil(std::max<std::size_t>(m_options.shards, 1));
+    m_options.batchSize  = std::clamp<std::size_t>(m_options.batchSize, 1, MaxParameters / SessionColumns);
+    m_options.wheelSlots = std::max<std::size_t>(m_options.wheelSlots, 1);
+    if (m_options.tick.count() <= 0) {
+        m_options.tick = std::chrono::milliseconds(1000);
+    }
+    m_shardMask = m_options.shards - 1;
+    m_table = std::string(TableRegistry::table(TEGRA_TABLES::MEMBERS_SESSION, TableType::KeyStruct));
+
+    const Stamp tick = tickOf(nowMilliseconds());
+    m_shards.reserve(m_options.shards);
+    for (std::size_t i = 0; i < m_options.shards; ++i) {
+        auto& shard = m_shards.emplace_back(CreateScope<Shard>());
+        shard->wheel.resize(m_options.wheelSlots);
+        shard->tick = tick;
+    }
+}
+
+SessionStore::~SessionStore()
+{
+    stop();
+    flush();
+}
+
+std::optional<Session> SessionStore::get(std::string_view token)
+{
+    const Stamp now = nowMilliseconds();
+    const std::string key(token);
+    Shard& shard = shardOf(token);
+    {
+        std::lock_guard lock(shard.mutex);
+        if (const auto found = shard.sessions.find(key); found != shard.sessions.end()) {
+            Session& session = found->second.session;
+            if (session.expires <= now) {
+                ++shard.misses;
+                return std::nullopt;
+            }
+            ++shard.hits;
+            session.expires = now + m_options.ttl.count();
+            changed(shard, found->first);
+            return session;
+        }
+        if (shard.removed.contains(key)) {
+            ++shard.misses;
+            return std::nullopt;
+        }
+    }
+
+    //! The table is read outside of the lock, a remove or put that raced with the read wins.
+    auto loaded = load(token);
+    std::lock_guard lock(shard.mutex);
+    if (!loaded.has_value() || loaded->expires <= now || shard.removed.contains(key)) {
+        ++shard.misses;
+        return std::nullopt;
+    }
+    ++shard.loads;
+    const auto [found, inserted] = shard.sessions.try_emplace(key, Entry {std::move(*loaded)});
+    if (inserted) {
+        schedule(shard, found->first, found->second);
+    }
+    found->second.session.expires = std::max(found->second.session.expires, now + m_options.ttl.count());
+    changed(shard, found->first);
+    return found->second.session;
+}
+
+void SessionStore::put(Session session)
+{
+    if (session.expires == 0) {
+        session.expires = nowMilliseconds() + m_options.ttl.count();
+    }
+    Shard& shard = shardOf(session.token);
+    std::lock_guard lock(shard.mutex);
+    shard.removed.erase(session.token);
+    const auto [found, inserted] = shard.sessions.try_emplace(session.token);
+    Entry& entry = found->second;
+    entry.session = std::move(session);
+    //! A later expiry is found by the wheel when the old slot comes, an earlier one needs its own slot.
+    if (inserted || tickOf(entry.session.expires) < entry.scheduled) {
+        schedule(shard, found->first, entry);
+    }
+    changed(shard, found->first);
+}
+
+bool SessionStore::update(std::string_view token, std::string data)
+{
+    if (!get(token).has_value()) {
+        return false;
+    }
+    Shard& shard = shardOf(token);
+    std::lock_guard lock(shard.mutex);
+    const auto found = shard.sessions.find(std::string(token));
+    if (found == shard.sessions.end()) {
+        return false;
+    }
+    found->second.session.data = std::move(data);
+    changed(shard, found->first);
+    return true;
+}
+
+void SessionStore::remove(std::string_view token)
+{
+    const std::string key(token);
+    Shard& shard = shardOf(token);
+    std::lock_guard lock(shard.mutex);
+    shard.sessions.erase(key);
+    shard.dirty.erase(key);
+    shard.removed.insert(key);
+    ++shard.writes;
+}
+
+std::size_t SessionStore::flush()
+{
+    std::lock_guard flushLock(m_flushMutex);
+    std::vector<Session> rows;
+    VectorString tokens;
+    for (const auto& shard : m_shards) {
+        std::lock_guard lock(shard->mutex);
+        for (const auto& token : shard->dirty) {
+            if (const auto found = shard->sessions.find(token); found != shard->sessions.end()) {
+                rows.push_back(found->second.session);
+            }
+        }
+        shard->dirty.clear();
+        tokens.insert(tokens.end(), shard->removed.begin(), shard->removed.end());
+    }
+
+    std::size_t done = 0;
+    //! Removed sessions keep their mark until their rows are gone, so a read can not load them again meanwhile.
+    for (std::size_t i = 0; i < tokens.size(); i += m_options.batchSize) {
+        const VectorString batch(tokens.begin() + static_cast<std::ptrdiff_t>(i),
+                                 tokens.begin() + static_cast<std::ptrdiff_t>(std::min(i + m_options.batchSize, tokens.size())));
+        try {
+            erase(batch);
+        } catch (const std::exception& e) {
+            warn("be deleted", e);
+            continue;
+        }
+        done += batch.size();
+        for (const auto& token : batch) {
+            Shard& shard = shardOf(token);
+            std::lock_guard lock(shard.mutex);
+            shard.removed.erase(token);
+        }
+    }
+    for (std::size_t i = 0; i < rows.size(); i += m_options.batchSize) {
+        const std::vector<Session> batch(rows.begin() + static_cast<std::ptrdiff_t>(i),
+                                         rows.begin() + static_cast<std::ptrdiff_t>(std::min(i + m_options.batchSize, rows.size())));
+        try {
+            upsert(batch);
+            done += batch.size();
+        } catch (const std::exception& e) {
+            warn("be written", e);
+            //! Kept for the next flush unless they were removed or dropped meanwhile.
+            for (const auto& session : batch) {
+                Shard& shard = shardOf(session.token);
+                std::lock_guard lock(shard.mutex);
+                if (shard.sessions.contains(session.token)) shard.dirty.insert(session.token);
+            }
+        }
+    }
+    if (++m_flushes % PurgeInterval == 0) {
+        purge(nowMilliseconds());
+    }
+    m_flushed += done;
+    return done;
+}
+
+std::size_t SessionStore::expire()
+{
+    const Stamp now = nowMilliseconds();
+    const Stamp current = tickOf(now);
+    const Stamp slots = static_cast<Stamp>(m_options.wheelSlots);
+    std::size_t dropped = 0;
+    for (const auto& shard : m_shards) {
+        std::lock_guard lock(shard->mutex);
+        //! After a long pause every slot is visited once, not once per missed tick.
+        for (Stamp tick = std::max(shard->tick, current - slots + 1); tick <= current; ++tick) {
+            auto& slot = shard->wheel[static_cast<std::size_t>(tick % slots)];
+            std::vector<std::string> due;
+            due.swap(slot);
+            for (auto& token : due) {
+                const auto found = shard->sessions.find(token);
+                if (found == shard->sessions.end()) continue;
+                Entry& entry = found->second;
+                //! A copy that was left behind when the session got an earlier slot.
+                if (entry.scheduled % slots != tick % slots) continue;
+                if (entry.scheduled > current) {
+                    slot.push_back(std::move(token));
+                    continue;
+                }
+                if (entry.session.expires <= now) {
+                    shard->dirty.erase(token);
+                    shard->sessions.erase(found);
+                    ++shard->expired;
+                    ++dropped;
+                    continue;
+                }
+                //! Extended since it was scheduled.
+                entry.scheduled = std::max(tickOf(entry.session.expires), current + 1);
+                shard->wheel[static_cast<std::size_t>(entry.scheduled % slots)].push_back(std::move(token));
+            }
+        }
+        shard->tick = std::max(shard->tick, current + 1);
+    }
+    return dropped;
+}
+
+void SessionStore::start()
+{
+    std::lock_guard lock(m_threadMutex);
+    if (m_worker.joinable()) {
+        return;
+    }
+    m_stop = false;
+    m_worker = std::thread(&SessionStore::run, this);
+}
+
+void SessionStore::stop()
+{
+    {
+        std::lock_guard lock(m_threadMutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+}
+
+SessionStoreStats SessionStore::stats() const
+{
+    SessionStoreStats stats;
+    for (const auto& shard : m_shards) {
+        std::lock_guard lock(shard->mutex);
+        stats.hits     += shard->hits;
+        stats.loads    += shard->loads;
+        stats.misses   += shard->misses;
+        stats.writes   += shard->writes;
+        stats.expired  += shard->expired;
+        stats.sessions += shard->sessions.size();
+        stats.pending  += shard->dirty.size() + shard->removed.size();
+    }
+    std::lock_guard lock(m_flushMutex);
+    stats.flushed    = m_flushed;
+    stats.statements = m_statements;
+    return stats;
+}
+
+const SessionStoreOptions& SessionStore::options() const __tegra_noexcept
+{
+    return m_options;
+}
+
+SessionStore::Shard& SessionStore::shardOf(std::string_view token) const __tegra_noexcept
+{
+    //! The maps of the shards hash the same tokens, so the shard is taken from the high bits of a mixed hash.
+    const u64 hash = static_cast<u64>(std::hash<std::string_view> {}(token)) * 0x9E3779B97F4A7C15ULL;
+    return *m_shards[static_cast<std::size_t>(hash >> 32) & m_shardMask];
+}
+
+SessionStore::Stamp SessionStore::tickOf(Stamp stamp) const __tegra_noexcept
+{
+    return stamp / m_options.tick.count();
+}
+
+void SessionStore::schedule(Shard& shard, const std::string& token, Entry& entry)
+{
+    entry.scheduled = std::max(tickOf(entry.session.expires), shard.tick);
+    shard.wheel[static_cast<std::size_t>(entry.scheduled % static_cast<Stamp>(m_options.wheelSlots))].push_back(token);
+}
+
+void SessionStore::changed(Shard& shard, const std::string& token)
+{
+    shard.dirty.insert(token);
+    ++shard.writes;
+}
+
+std::optional<Session> SessionStore::load(std::string_view token)
+{
+    //! Every request of an unknown token runs it, the text is built by the compiler.
+    constexpr auto Load = SqlText(SELECT) + "member_id, device, data, expires" + SqlText(FROM) + SqlTable<TableId::MembersSession>
+                        + SqlText(WHERE) + "token = ?";
+    const ResultView rows = m_pool.select(sqlKey<Load>(m_pool.config().driver), {std::string(token)});
+    if (rows.empty()) {
+        return std::nullopt;
+    }
+    Session session;
+    session.token   = std::string(token);
+    session.member  = rows.get<u64>(0, 0).value_or(0);
+    session.device  = std::string(rows.text(0, 1));
+    session.data    = std::string(rows.text(0, 2));
+    session.expires = rows.get<Stamp>(0, 3).value_or(0);
+    return session;
+}
+
+void SessionStore::upsert(const std::vector<Session>& sessions)
+{
+    std::string sql = "INSERT INTO " + m_table + " (token, member_id, device, data, expires) VALUES " + placeholders(sessions.size(), SessionColumns);
+    if (m_pool.config().driver == DriverTypes::MySQL) {
+        sql.append(" ON DUPLICATE KEY UPDATE member_id = VALUES(member_id), device = VALUES(device), data = VALUES(data), expires = VALUES(expires)");
+    } else {
+        sql.append(" ON CONFLICT (token) DO UPDATE SET member_id = excluded.member_id, device = excluded.device, data = excluded.data, expires = excluded.expires");
+    }
+    SqlParams params;
+    params.reserve(sessions.size() * SessionColumns);
+    for (const auto& session : sessions) {
+        params.emplace_back(session.token);
+        params.emplace_back(std::to_string(session.member));
+        params.emplace_back(session.device);
+        params.emplace_back(session.data);
+        params.emplace_back(std::to_string(session.expires));
+    }
+    m_pool.execute(sql, params);
+    ++m_statements;
+}
+
+void SessionStore::erase(const VectorString& tokens)
+{
+    SqlParams params(tokens.begin(), tokens.end());
+    m_pool.execute("DELETE FROM " + m_table + " WHERE token IN " + placeholders(1, tokens.size()), params);
+    ++m_statements;
+}
+
+void SessionStore::purge(Stamp now)
+{
+    try {
+        m_pool.execute("DELETE FROM " + m_table + " WHERE expires < ?", {std::to_string(now)});
+        ++m_statements;
+    } catch (const std::exception& e) {
+        warn("be purged", e);
+    }
+}
+
+void SessionStore::run()
+{
+    std::unique_lock lock(m_threadMutex);
+    while (!m_stop) {
+        m_wake.wait_for(lock, m_options.flushInterval, [this] { return m_stop; });
+        lock.unlock();
+        try {
+            expire();
+            flush();
+        } catch (const std::exception& e) {
+            warn("be flushed", e);
+        }
+        lock.lock();
+    }
+}
+
+TEGRA_NAMESPACE_END
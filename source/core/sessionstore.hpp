@@ -0,0 +1,202 @@
+/*!
+ * MIT License
+ *
+ * Copyright (c) 2022 Kambiz Asadzadeh
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#ifndef TEGRA_SESSIONSTORE_HPP
+#define TEGRA_SESSIONSTORE_HPP
+
+#include "connectionpool.hpp"
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+/*!
+ * @brief The SessionStoreOptions struct holds the limits of a SessionStore.
+ */
+struct SessionStoreOptions final
+{
+    std::size_t                 shards          {16};       ///<Locks of the store, rounded up to a power of two.
+    std::chrono::milliseconds   ttl             {1800000};  ///<Idle lifetime of a session, every read extends it.
+    std::chrono::milliseconds   flushInterval   {1000};     ///<Changes are written by the background thread this often.
+    std::size_t                 batchSize       {256};      ///<Rows of one multi-row statement.
+    std::chrono::milliseconds   tick            {1000};     ///<Resolution of the expiry wheel.
+    std::size_t                 wheelSlots      {512};      ///<Slots of the expiry wheel, later expiries go round again.
+};
+
+/*!
+ * @brief The Session struct is one row of "members_session".
+ */
+struct Session final
+{
+    std::string                     token   {};     ///<Key of the session, it's sent by the client.
+    u64                             member  {};     ///<Id of the member, zero for a guest.
+    std::string                     device  {};     ///<Fingerprint of the device, see "members_known_devices".
+    std::string                     data    {};     ///<Payload of the application.
+    std::chrono::milliseconds::rep  expires {};     ///<Milliseconds since epoch.
+};
+
+/*!
+ * @brief The SessionStoreStats struct is a snapshot of the counters of a SessionStore.
+ */
+struct SessionStoreStats final
+{
+    u64         hits        {};     ///<Reads that were answered from memory.
+    u64         loads       {};     ///<Reads that went to the table.
+    u64         misses      {};     ///<Reads of unknown or expired sessions.
+    u64         writes      {};     ///<Changes of sessions, including the extension by a read.
+    u64         flushed     {};     ///<Rows that were written or deleted by flush.
+    u64         statements  {};     ///<Statements that were run by flush.
+    u64         expired     {};     ///<Sessions that were dropped by the expiry wheel.
+    std::size_t sessions    {};     ///<Sessions in memory.
+    std::size_t pending     {};     ///<Changed sessions that wait for the next flush.
+};
+
+/*!
+ * @brief The SessionStore class keeps the sessions of the members in memory and writes them to "members_session" behind the requests.
+ * Sessions are spread over shards by the hash of their token, each shard has its own lock, map and expiry wheel.
+ * A read extends the session and marks it as changed, all changes of a session until the next flush are one row of one batch,
+ * so a request costs no statement of its own. A read of a session that is not in memory loads it from the table.
+ * Sessions whose expiry passed are dropped from memory by the wheel, their rows are deleted by flush later.
+ * A crash loses at most the changes of one flushInterval, the extension of an expiry in most cases.
+ * @example
+ * SessionStore sessions(pool);
+ * sessions.start();
+ * sessions.put({token, memberId, device, "{}"});
+ * if (auto session = sessions.get(cookie)) { ... }
+ */
+class SessionStore final
+{
+public:
+    /*!
+     * @param pool to run the statements on, it's not owned by the store.
+     */
+    explicit SessionStore(ConnectionPool& pool, const SessionStoreOptions& options = {});
+    SessionStore(const SessionStore& rhsStore) = delete;
+    SessionStore& operator=(const SessionStore& rhsStore) = delete;
+
+    /*!
+     * @brief The destructor stops the background thread and flushes the last changes.
+     */
+    ~SessionStore();
+
+    /*!
+     * @brief get function gets a live session and extends it by the ttl.
+     * @returns the session, std::nullopt if it's unknown or expired.
+     */
+    __tegra_no_discard std::optional<Session> get(std::string_view token);
+
+    /*!
+     * @brief put function adds or replaces a session.
+     * @param session is stored as it is, a zero expires is set to now plus the ttl.
+     */
+    void put(Session session);
+
+    /*!
+     * @brief update function replaces the payload of a live session and extends it.
+     * @returns false if the session is unknown or expired.
+     */
+    bool update(std::string_view token, std::string data);
+
+    /*!
+     * @brief remove function drops a session, for example by a logout.
+     */
+    void remove(std::string_view token);
+
+    /*!
+     * @brief flush function writes all changed sessions and deletes the removed ones, in batches.
+     * Rows that could not be written are kept for the next flush.
+     * @returns number of rows that were written or deleted.
+     */
+    std::size_t flush();
+
+    /*!
+     * @brief expire function moves the expiry wheel to now and drops the sessions whose expiry passed.
+     * @returns number of dropped sessions.
+     */
+    std::size_t expire();
+
+    /*!
+     * @brief start function runs expire and flush on a background thread every flushInterval.
+     */
+    void start();
+
+    /*!
+     * @brief stop function stops the background thread, changes stay until the next flush.
+     */
+    void stop();
+
+    __tegra_no_discard SessionStoreStats stats() const;
+    __tegra_no_discard const SessionStoreOptions& options() const __tegra_noexcept;
+
+private:
+    using Stamp = std::chrono::milliseconds::rep;
+
+    struct Entry final
+    {
+        Session session     {};
+        Stamp   scheduled   {};     ///<Tick of the wheel slot that holds the token.
+    };
+
+    struct Shard final
+    {
+        mutable std::mutex                              mutex       {};
+        std::unordered_map<std::string, Entry>          sessions    {};
+        std::unordered_set<std::string>                 dirty       {};     ///<Changed since the last flush.
+        std::unordered_set<std::string>                 removed     {};     ///<Deleted until their rows are deleted too.
+        std::vector<std::vector<std::string>>           wheel       {};
+        Stamp                                           tick        {};     ///<Next tick to be expired.
+        u64                                             hits        {};
+        u64                                             loads       {};
+        u64                                             misses      {};
+        u64                                             writes      {};
+        u64                                             expired     {};
+    };
+
+    __tegra_no_discard Shard& shardOf(std::string_view token) const __tegra_noexcept;
+    __tegra_no_discard Stamp tickOf(Stamp stamp) const __tegra_noexcept;
+    void schedule(Shard& shard, const std::string& token, Entry& entry);
+    void changed(Shard& shard, const std::string& token);
+    __tegra_no_discard std::optional<Session> load(std::string_view token);
+    void upsert(const std::vector<Session>& sessions);
+    void erase(const VectorString& tokens);
+    void purge(Stamp now);
+    void run();
+
+    ConnectionPool&                 m_pool;
+    SessionStoreOptions             m_options;
+    std::vector<Scope<Shard>>       m_shards        {};
+    std::size_t                     m_shardMask     {};
+    std::string                     m_table         {};
+    mutable std::mutex              m_flushMutex    {};
+    u64                             m_flushed       {};
+    u64                             m_statements    {};
+    u64                             m_flushes       {};
+    std::mutex                      m_threadMutex   {};
+    std::condition_variable         m_wake          {};
+    std::thread                     m_worker        {};
+    bool                            m_stop          {};
+};
+
+TEGRA_NAMESPACE_END
+
+#endif  // TEGRA_SESSIONSTORE_HPP
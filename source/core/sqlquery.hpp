@@ -0,0 +1,245 @@
+/*!
+ * MIT License
+ *
+ * Copyright (c) 2022 Kambiz Asadzadeh
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#ifndef TEGRA_SQLQUERY_HPP
+#define TEGRA_SQLQUERY_HPP
+
+#include "connection.hpp"
+#include "tableregistry.hpp"
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+/*!
+ * @brief The SqlText struct is a piece of sql that is composed by the compiler.
+ * Pieces are joined with operator+ and one space, so the DDL/DML macros of database.hpp can be used as they are.
+ * A table of the registry is written as a marker that SqlQuery replaces with its name.
+ * @example SqlText(SELECT) + "id, value" + SqlText(FROM) + SqlTable<TableId::ConfigL>
+ */
+template <std::size_t N>
+struct SqlText final
+{
+    //! The marker byte of a table, followed by the table id plus one.
+    static constexpr char TableMarker = '\x1A';
+
+    char data[N] {};
+
+    constexpr SqlText() = default;
+
+    constexpr SqlText(const char (&text)[N])
+    {
+        std::copy_n(text, N, data);
+    }
+
+    __tegra_no_discard constexpr std::size_t size() const __tegra_noexcept
+    {
+        return N - 1;
+    }
+
+    __tegra_no_discard constexpr std::string_view view() const __tegra_noexcept
+    {
+        return {data, N - 1};
+    }
+};
+
+template <std::size_t N, std::size_t M>
+constexpr SqlText<N + M> operator+(const SqlText<N>& lhs, const SqlText<M>& rhs)
+{
+    SqlText<N + M> result;
+    std::copy_n(lhs.data, N - 1, result.data);
+    result.data[N - 1] = ' ';
+    std::copy_n(rhs.data, M, result.data + N);
+    return result;
+}
+
+template <std::size_t N, std::size_t M>
+constexpr SqlText<N + M> operator+(const SqlText<N>& lhs, const char (&rhs)[M])
+{
+    return lhs + SqlText<M>(rhs);
+}
+
+/*!
+ * @brief SqlTable is the marker of a system table, it becomes the prefixed name of the table.
+ */
+template <TableId Id>
+    requires (std::size_t(Id) < std::size_t(TableId::Count))
+constexpr SqlText<3> SqlTable {{SqlText<3>::TableMarker, static_cast<char>(std::size_t(Id) + 1), '\0'}};
+
+/*!
+ * @brief The SqlQuery class is a statement that is composed at compile time.
+ * The text is built by the compiler with the default table names and the placeholders of the driver,
+ * and the key gives the statement a fixed slot in every connection, so a hot query costs no formatting,
+ * no hashing and no parsing at runtime. With a configured prefix the text is built once per connection instead.
+ * @example
+ * using ConfigValue = SqlQuery<DriverTypes::PostgreSQL,
+ *                              SqlText(SELECT) + "value" + SqlText(FROM) + SqlTable<TableId::ConfigL>
+ *                              + SqlText(WHERE) + "name = ?" + SqlText(AND) + "language = ?">;
+ * static_assert(ConfigValue::text == "SELECT value FROM teg_config_l WHERE name = $1 AND language = $2");
+ * connection.execute(ConfigValue::key(), {name, language});
+ */
+template <DriverTypes Driver, SqlText Text>
+    requires (Driver != DriverTypes::Unknown)
+class SqlQuery final
+{
+    /*!
+     * @brief Walks a composed text and calls emit for every piece of the final sql.
+     * '?' outside of quoted strings and identifiers are numbered as $1, $2 ... for PostgreSQL.
+     * @returns the number of placeholders.
+     */
+    template <typename Names, typename Emit>
+    static constexpr std::size_t expand(const Names& names, const Emit& emit)
+    {
+        const std::string_view text = Text.view();
+        std::size_t number = 0;
+        char quote = 0;
+        for (std::size_t i = 0; i < text.size(); ++i) {
+            const char c = text[i];
+            if (quote != 0) {
+                if (c == quote) quote = 0;
+                emit(std::string_view(&text[i], 1));
+            } else if (c == '\'' || c == '"') {
+                quote = c;
+                emit(std::string_view(&text[i], 1));
+            } else if (c == SqlText<1>::TableMarker && i + 1 < text.size()) {
+                emit(names(static_cast<TableId>(static_cast<unsigned char>(text[++i]) - 1)));
+            } else if (c == '?') {
+                ++number;
+                if constexpr (Driver == DriverTypes::PostgreSQL) {
+                    char digits[24] {};
+                    std::size_t count = 0;
+                    for (std::size_t n = number; n != 0; n /= 10) digits[count++] = static_cast<char>('0' + n % 10);
+                    emit("$");
+                    for (; count > 0; --count) emit(std::string_view(&digits[count - 1], 1));
+                } else {
+                    emit("?");
+                }
+            } else {
+                emit(std::string_view(&text[i], 1));
+            }
+        }
+        return number;
+    }
+
+    static constexpr std::string_view compiledName(TableId id)
+    {
+        return CompiledSystemTables[std::size_t(id)];
+    }
+
+    static constexpr std::size_t length = [] {
+        std::size_t size = 0;
+        expand(compiledName, [&size](std::string_view piece) { size += piece.size(); });
+        return size;
+    }();
+
+    static constexpr auto storage = [] {
+        std::array<char, length + 1> buffer {};
+        std::size_t at = 0;
+        expand(compiledName, [&](std::string_view piece) {
+            for (const char c : piece) buffer[at++] = c;
+        });
+        return buffer;
+    }();
+
+public:
+    //! Final sql with the default table names.
+    static constexpr std::string_view text {storage.data(), length};
+
+    //! Number of placeholders.
+    static constexpr std::size_t parameters = expand(compiledName, [](std::string_view) {});
+
+    /*!
+     * @brief render function builds the sql with the table names that are configured now.
+     */
+    __tegra_no_discard static std::string render()
+    {
+        std::string sql;
+        sql.reserve(length + 32);
+        expand(TableRegistry::name, [&sql](std::string_view piece) { sql.append(piece); });
+        return sql;
+    }
+
+    /*!
+     * @returns the key of the statement, it's the same object for the life of the process.
+     */
+    __tegra_no_discard static const StatementKey& key() __tegra_noexcept
+    {
+        static const StatementKey instance {text, StatementKey::nextSlot(), &render, Driver};
+        return instance;
+    }
+};
+
+/*!
+ * @brief sqlKey function picks the key of a composed statement for a driver that is known at runtime only.
+ * @example m_pool.select(sqlKey<SqlText(SELECT) + "value" + SqlText(FROM) + SqlTable<TableId::Config>>(m_pool.config().driver));
+ */
+template <SqlText Text>
+__tegra_no_discard const StatementKey& sqlKey(DriverTypes driver) __tegra_noexcept
+{
+    switch (driver) {
+    case DriverTypes::PostgreSQL:
+        return SqlQuery<DriverTypes::PostgreSQL, Text>::key();
+    case DriverTypes::MySQL:
+        return SqlQuery<DriverTypes::MySQL, Text>::key();
+    case DriverTypes::SQLite:
+        return SqlQuery<DriverTypes::SQLite, Text>::key();
+    default:
+        return SqlQuery<DriverTypes::Default, Text>::key();
+    }
+}
+
+/*!
+ * @brief The SqlStatement class is a statement whose tables or columns are known at runtime only.
+ * It's composed once by its owner (a cache of a table, a counter column) and then runs through a fixed slot
+ * of every connection like a SqlQuery, so a repeated call costs no formatting and no hashing.
+ * The text is kept as it is, '?' placeholders are numbered by the PostgreSQL driver when it's prepared.
+ * Every statement takes a slot for the life of the process, so statements belong to long-lived owners.
+ */
+class SqlStatement final
+{
+public:
+    explicit SqlStatement(std::string sql)
+        : m_sql(std::move(sql)), m_key {m_sql, StatementKey::nextSlot(), nullptr, DriverTypes::Default}
+    {
+    }
+    SqlStatement(const SqlStatement& rhsStatement) = delete;
+    SqlStatement& operator=(const SqlStatement& rhsStatement) = delete;
+
+    __tegra_no_discard const StatementKey& key() const __tegra_noexcept
+    {
+        return m_key;
+    }
+
+    __tegra_no_discard std::string_view text() const __tegra_noexcept
+    {
+        return m_sql;
+    }
+
+private:
+    const std::string   m_sql;
+    const StatementKey  m_key;
+};
+
+TEGRA_NAMESPACE_END
+
+#endif  // TEGRA_SQLQUERY_HPP
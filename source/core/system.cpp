@@ -16,6 +16,15 @@
 #include <Iphlpapi.h>
 #include <cassert>
 #pragma comment(lib, "iphlpapi.lib")
+#elif defined(PLATFORM_LINUX)
+#include <unistd.h>
+#include <climits>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <linux/if_packet.h>
+#include <sys/utsname.h>
 #endif
 
 TEGRA_USING_NAMESPACE Tegra;
@@ -24,6 +33,132 @@ TEGRA_USING_NAMESPACE Tegra::Types;
 
 TEGRA_NAMESPACE_BEGIN(Tegra::CMS)
 
+TEGRA_ANONYMOUS_NAMESPACE_BEGIN
+
+constexpr std::string_view Unknown = "Unknown";
+
+std::string trimmed(std::string value)
+{
+    const auto first = value.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) return {};
+    const auto last = value.find_last_not_of(" \t\r\n");
+    return value.substr(first, last - first + 1);
+}
+
+std::string orUnknown(std::string value)
+{
+    value = trimmed(std::move(value));
+    return value.empty() ? std::string(Unknown) : value;
+}
+
+#if defined(PLATFORM_LINUX)
+
+//! Most of the information is published by the kernel as small text files.
+std::string readFirstLine(const std::filesystem::path& path)
+{
+    std::ifstream file(path);
+    std::string line;
+    if (file.is_open()) {
+        std::getline(file, line);
+    }
+    return trimmed(std::move(line));
+}
+
+/*!
+ * \returns the address of the first interface that is up and is not a loopback.
+ * Global IPv6 addresses are preferred over the link-local ones.
+ */
+std::string interfaceAddress(int family)
+{
+    ifaddrs* list = nullptr;
+    if (::getifaddrs(&list) != 0) return {};
+    std::string result;
+    std::string linkLocal;
+    for (const ifaddrs* item = list; item != nullptr; item = item->ifa_next) {
+        if (item->ifa_addr == nullptr || item->ifa_addr->sa_family != family) continue;
+        if ((item->ifa_flags & IFF_UP) == 0 || (item->ifa_flags & IFF_LOOPBACK) != 0) continue;
+        char text[INET6_ADDRSTRLEN] = {};
+        if (family == AF_INET) {
+            const auto* address = reinterpret_cast<const sockaddr_in*>(item->ifa_addr);
+            ::inet_ntop(AF_INET, &address->sin_addr, text, sizeof(text));
+            result = text;
+            break;
+        }
+        const auto* address = reinterpret_cast<const sockaddr_in6*>(item->ifa_addr);
+        ::inet_ntop(AF_INET6, &address->sin6_addr, text, sizeof(text));
+        if (IN6_IS_ADDR_LINKLOCAL(&address->sin6_addr)) {
+            if (linkLocal.empty()) linkLocal = text;
+            continue;
+        }
+        result = text;
+        break;
+    }
+    ::freeifaddrs(list);
+    return result.empty() ? linkLocal : result;
+}
+
+//! Block devices that are real disks, sorted by name.
+std::vector<std::filesystem::path> physicalDisks()
+{
+    namespace fs = std::filesystem;
+    std::vector<fs::path> disks;
+    std::error_code error;
+    for (const auto& entry : fs::directory_iterator("/sys/block", error)) {
+        const std::string name = entry.path().filename().string();
+        if (name.starts_with("loop") || name.starts_with("ram") || name.starts_with("zram") || name.starts_with("dm-")) continue;
+        if (!fs::exists(entry.path() / "device", error)) continue;
+        disks.push_back(entry.path());
+    }
+    std::sort(disks.begin(), disks.end());
+    return disks;
+}
+
+//! SATA disks do not publish their serial in sysfs, but udev keeps it in its database.
+std::string udevProperty(const std::filesystem::path& disk, std::string_view key)
+{
+    const std::string device = readFirstLine(disk / "dev");
+    if (device.empty()) return {};
+    std::ifstream file("/run/udev/data/b" + device);
+    for (std::string line; std::getline(file, line);) {
+        if (line.starts_with("E:") && std::string_view(line).substr(2).starts_with(key) && line.size() > key.size() + 3 && line[key.size() + 2] == '=') {
+            return trimmed(line.substr(key.size() + 3));
+        }
+    }
+    return {};
+}
+
+#endif
+
+struct SnapshotHolder final
+{
+    std::mutex                  mutex       {};
+    Ref<const SystemSnapshot>   snapshot    {};
+};
+
+SnapshotHolder& holder()
+{
+    static SnapshotHolder instance;
+    return instance;
+}
+
+TEGRA_NAMESPACE_END
+
+SystemSnapshot::SystemSnapshot() : m_createdAt(std::time(nullptr))
+{
+}
+
+const std::string& SystemSnapshot::value(SystemField field) const
+{
+    const std::size_t index = std::size_t(field);
+    std::call_once(m_collected.at(index), [this, field, index] { m_values[index] = SystemInfo::collect(field); });
+    return m_values[index];
+}
+
+std::time_t SystemSnapshot::createdAt() const __tegra_noexcept
+{
+    return m_createdAt;
+}
+
 SystemInfo::SystemInfo()
 {
 
@@ -34,30 +169,48 @@ SystemInfo::~SystemInfo()
 
 }
 
+Ref<const SystemSnapshot> SystemInfo::snapshot()
+{
+    auto& h = holder();
+    std::lock_guard lock(h.mutex);
+    if (!h.snapshot) {
+        h.snapshot = CreateRef<const SystemSnapshot>();
+    }
+    return h.snapshot;
+}
+
+Ref<const SystemSnapshot> SystemInfo::refresh()
+{
+    auto fresh = CreateRef<const SystemSnapshot>();
+    auto& h = holder();
+    std::lock_guard lock(h.mutex);
+    h.snapshot = fresh;
+    return fresh;
+}
+
+std::string SystemInfo::collect(SystemField field)
+{
+    switch (field) {
+    case SystemField::HostName:                 return collectHostName();
+    case SystemField::OsName:                   return PLATFORM_OS;
+    case SystemField::KernelVersion:            return collectKernelVersion();
+    case SystemField::MacAddress:               return collectMacAddress();
+    case SystemField::IpV4Address:              return collectIpV4Address();
+    case SystemField::IpV6Address:              return collectIpV6Address();
+    case SystemField::MachineUniqueId:          return collectMachineUniqueId();
+    case SystemField::SerialNumber:             return collectSerialNumber();
+    case SystemField::StorageDiskModel:         return collectStorageDiskModel();
+    case SystemField::StorageDiskSerialNumber:  return collectStorageDiskSerialNumber();
+    case SystemField::GpuModel:                 return collectGpuModel();
+    case SystemField::Count:
+    default:
+        return std::string(Unknown);
+    }
+}
+
 std::string SystemInfo::getHostName()
 {
-    std::string result{};
-#ifdef PLATFORM_DESKTOP
-#if defined(PLATFORM_MAC) || defined(PLATFORM_APPLE)
-    result = command("scutil --get LocalHostName");
-    return result;
-#elif defined(PLATFORM_LINUX)
-    result = command("hostnamectl");
-    return result;
-#elif defined(PLATFORM_WINDOWS)
-    result = command("hostnamectl");
-    return result;
-#endif
-#elif defined(PLATFORM_MOBILE)
-#if defined(PLATFORM_IOS) || defined(PLATFORM_IOS_SIMULATOR)
-    result = "Unknown";
-#elif defined(PLATFORM_ANDROID)
-    result = "Unknown";
-#endif
-#else
-    result = "Unknown";
-#endif
-    return result;
+    return snapshot()->value(SystemField::HostName);
 }
 
 std::string SystemInfo::getOsName()
@@ -74,193 +227,204 @@ std::string SystemInfo::macAddressAsByteArray(unsigned char MACData[])
 }
 
 std::string SystemInfo::getMacAddress()
+{
+    return snapshot()->value(SystemField::MacAddress);
+}
+
+std::string SystemInfo::getIpV4Address()
+{
+    return snapshot()->value(SystemField::IpV4Address);
+}
+
+std::string SystemInfo::getIpV6Address()
+{
+    return snapshot()->value(SystemField::IpV6Address);
+}
+
+std::string SystemInfo::getMachineUniqueId()
+{
+    return snapshot()->value(SystemField::MachineUniqueId);
+}
+
+std::string SystemInfo::getStorageDiskModel()
+{
+    return snapshot()->value(SystemField::StorageDiskModel);
+}
+
+std::string SystemInfo::getStorageDiskSerialNumber()
+{
+    return snapshot()->value(SystemField::StorageDiskSerialNumber);
+}
+
+std::string SystemInfo::getGpuModel()
+{
+    return snapshot()->value(SystemField::GpuModel);
+}
+
+std::string SystemInfo::getSerialNumber()
+{
+    return snapshot()->value(SystemField::SerialNumber);
+}
+
+std::string SystemInfo::collectHostName()
 {
     std::string result{};
-#ifdef PLATFORM_DESKTOP
-#if defined(PLATFORM_MAC) || defined(PLATFORM_APPLE)
-    result = command("/sbin/ifconfig en0 | /usr/bin/grep 'ether' | /usr/bin/cut -d' ' -f 2");
-    return result;
-#elif defined(PLATFORM_LINUX)
-    result = command("/sbin/ifconfig en0 | /usr/bin/grep 'ether' | /usr/bin/cut -d' ' -f 2");
-    return result;
+#if defined(PLATFORM_LINUX)
+    char name[HOST_NAME_MAX + 1] = {};
+    if (::gethostname(name, sizeof(name) - 1) == 0) {
+        result = name;
+    }
+#elif defined(PLATFORM_DESKTOP) && (defined(PLATFORM_MAC) || defined(PLATFORM_APPLE))
+    result = command("scutil --get LocalHostName");
 #elif defined(PLATFORM_WINDOWS)
-    IP_ADAPTER_INFO AdapterInfo[16];			// Allocate information for up to 16 NICs
-    DWORD dwBufLen = sizeof(AdapterInfo);		// Save the memory size of buffer
-    [[maybe_unused]] DWORD dwStatus = GetAdaptersInfo( AdapterInfo,	&dwBufLen); // [in] size of receive data buffer
-    assert(dwStatus == ERROR_SUCCESS);			// Verify return value is valid, no buffer overflow
-    PIP_ADAPTER_INFO pAdapterInfo = AdapterInfo;// Contains pointer to current adapter info
-    m_macAddressList.push_front(macAddressAsByteArray(pAdapterInfo->Address));
-    auto indexOfAddress = std::next(m_macAddressList.begin(), index);
-    return *indexOfAddress;
+    result = command("hostname");
 #endif
-#elif defined(PLATFORM_MOBILE)
-#if defined(PLATFORM_IOS) || defined(PLATFORM_IOS_SIMULATOR)
-    result = "Unknown";
-#elif defined(PLATFORM_ANDROID)
-    result = "Unknown";
+    return orUnknown(result);
+}
+
+std::string SystemInfo::collectKernelVersion()
+{
+    std::string result{};
+#if defined(PLATFORM_LINUX)
+    utsname name {};
+    if (::uname(&name) == 0) {
+        result = std::string(name.sysname) + " " + name.release;
+    }
 #endif
-#else
+    return orUnknown(result);
+}
+
+std::string SystemInfo::collectMacAddress()
+{
+    std::string result{};
+#if defined(PLATFORM_LINUX)
+    ifaddrs* list = nullptr;
+    if (::getifaddrs(&list) == 0) {
+        for (const ifaddrs* item = list; item != nullptr; item = item->ifa_next) {
+            if (item->ifa_addr == nullptr || item->ifa_addr->sa_family != AF_PACKET) continue;
+            if ((item->ifa_flags & IFF_LOOPBACK) != 0) continue;
+            const auto* link = reinterpret_cast<const sockaddr_ll*>(item->ifa_addr);
+            unsigned char address[6] = {};
+            std::memcpy(address, link->sll_addr, sizeof(address));
+            if (link->sll_halen != 6 || std::all_of(std::begin(address), std::end(address), [](unsigned char b) { return b == 0; })) continue;
+            result = macAddressAsByteArray(address);
+            break;
+        }
+        ::freeifaddrs(list);
+    }
+#elif defined(PLATFORM_DESKTOP) && (defined(PLATFORM_MAC) || defined(PLATFORM_APPLE))
     result = command("/sbin/ifconfig en0 | /usr/bin/grep 'ether' | /usr/bin/cut -d' ' -f 2");
-    result = "Unknown";
+#elif defined(PLATFORM_WINDOWS)
+    IP_ADAPTER_INFO AdapterInfo[16];			// Allocate information for up to 16 NICs
+    DWORD dwBufLen = sizeof(AdapterInfo);		// Save the memory size of buffer
+    if (GetAdaptersInfo(AdapterInfo, &dwBufLen) == ERROR_SUCCESS) {
+        result = macAddressAsByteArray(AdapterInfo[0].Address);
+    }
 #endif
-    return result;
+    return orUnknown(result);
 }
 
-std::string SystemInfo::getIpV4Address()
+std::string SystemInfo::collectIpV4Address()
 {
-    std::string result = "Unknown";
-#ifdef PLATFORM_DESKTOP
-#if defined (PLATFORM_LINUX)
-    return result;
-#elif defined (PLATFORM_MAC) || defined(PLATFORM_APPLE)
-    result = command("ipconfig getifaddr en0");
+    std::string result{};
+#if defined(PLATFORM_LINUX)
+    result = interfaceAddress(AF_INET);
+#elif defined(PLATFORM_DESKTOP) && (defined(PLATFORM_MAC) || defined(PLATFORM_APPLE))
+    result = trimmed(command("ipconfig getifaddr en0"));
     if(result.empty()) {
         result = command("ipconfig getifaddr en1");
     }
-    return result;
-#elif defined (PLATFORM_WINDOWS)
-    return result;
-#endif
-#elif defined(PLATFORM_MOBILE)
-#if defined(PLATFORM_IOS)
-    return result;
-#elif defined(PLATFORM_ANDROID)
-    return result;
-#endif
-#else
-    return result;
 #endif
+    return orUnknown(result);
 }
 
-std::string SystemInfo::getIpV6Address()
+std::string SystemInfo::collectIpV6Address()
 {
-    std::string result = "Unknown";
-#ifdef PLATFORM_DESKTOP
-#if defined (PLATFORM_LINUX)
-    return result;
-#elif defined (PLATFORM_MAC) || defined(PLATFORM_APPLE)
+    std::string result{};
+#if defined(PLATFORM_LINUX)
+    result = interfaceAddress(AF_INET6);
+#elif defined(PLATFORM_DESKTOP) && (defined(PLATFORM_MAC) || defined(PLATFORM_APPLE))
     result = command("system_profiler SPNetworkDataType | grep -e \"IPv4 Addresses\" | awk -F' *' '{print ""$4}'");
-    return result;
-#elif defined (PLATFORM_WINDOWS)
-    return ls;
-#endif
-#elif defined(PLATFORM_MOBILE)
-#if defined(PLATFORM_IOS)
-    return result;
-#elif defined(PLATFORM_ANDROID)
-    return result;
-#endif
-#else
-    return result;
 #endif
+    return orUnknown(result);
 }
 
-std::string SystemInfo::getMachineUniqueId()
+std::string SystemInfo::collectMachineUniqueId()
 {
-#ifdef PLATFORM_DESKTOP
-#if defined(PLATFORM_MAC)
+    std::string result{};
+#if defined(PLATFORM_LINUX)
+    result = readFirstLine("/etc/machine-id");
+    if (result.empty()) {
+        result = readFirstLine("/var/lib/dbus/machine-id");
+    }
+#elif defined(PLATFORM_MAC)
     char buf[512] = "";
     io_registry_entry_t ioRegistryRoot = IORegistryEntryFromPath(kIOMainPortDefault, "IOService:/");
     CFStringRef uuidCf = (CFStringRef) IORegistryEntryCreateCFProperty( ioRegistryRoot, CFSTR(kIOPlatformUUIDKey), kCFAllocatorDefault, 0);
     IOObjectRelease(ioRegistryRoot);
     CFStringGetCString(uuidCf, buf, sizeof(buf), kCFStringEncodingMacRoman);
     CFRelease(uuidCf);
-    return buf;
-#elif defined(PLATFORM_LINUX)
-    return "Unknown";
-#elif defined(PLATFORM_WINDOWS)
-    return "Unknown";
-#endif
-#elif defined(PLATFORM_FREEBSD)
-    return "Unknown";
-#elif defined(PLATFORM_MOBILE)
-#if defined(PLATFORM_IOS)
-    std::string result = "Unknown";
-    return result;
-#elif defined(PLATFORM_ANDROID)
-    std::string result = "Unknown";
-    return result;
-#endif
-#else
-    std::string result = "Unknown";
-    return result;
+    result = buf;
 #endif
+    return orUnknown(result);
 }
 
-std::string SystemInfo::getStorageDiskModel()
+std::string SystemInfo::collectStorageDiskModel()
 {
-    std::string result = "Unknown";
-#ifdef PLATFORM_DESKTOP
-#if defined (PLATFORM_LINUX)
-    return result;
+    std::string result{};
+#if defined(PLATFORM_LINUX)
+    for (const auto& disk : physicalDisks()) {
+        result = readFirstLine(disk / "device" / "model");
+        if (!result.empty()) break;
+    }
 #elif defined (PLATFORM_MAC)
     result = command("system_profiler SPSerialATADataType | grep -e \"Model\" | awk -F' *' '{print ""$3, ""$4, ""$5}'");
-    return result;
-#elif defined (PLATFORM_WINDOWS)
-    return result;
-#endif
-#elif defined(PLATFORM_MOBILE)
-#if defined(PLATFORM_IOS)
-    return result;
-#elif defined(PLATFORM_ANDROID)
-    return result;
-#endif
-#else
-    return result;
 #endif
+    return orUnknown(result);
 }
 
-std::string SystemInfo::getStorageDiskSerialNumber()
+std::string SystemInfo::collectStorageDiskSerialNumber()
 {
-    std::string result = "Unknown";
-#ifdef PLATFORM_DESKTOP
-#if defined (PLATFORM_LINUX)
-    return ls;
+    std::string result{};
+#if defined(PLATFORM_LINUX)
+    for (const auto& disk : physicalDisks()) {
+        result = readFirstLine(disk / "device" / "serial");
+        if (result.empty()) {
+            result = udevProperty(disk, "ID_SERIAL_SHORT");
+        }
+        if (!result.empty()) break;
+    }
 #elif defined (PLATFORM_MAC)
     result = command("system_profiler SPSerialATADataType | grep -e \"Serial Number\" | awk -F' *' '{print ""$4}'");
-    return result;
-#elif defined (PLATFORM_WINDOWS)
-    return result;
-#endif
-#elif defined(PLATFORM_MOBILE)
-#if defined(PLATFORM_IOS)
-    return result;
-#elif defined(PLATFORM_ANDROID)
-    return result;
-#endif
-#else
-    return result;
 #endif
+    return orUnknown(result);
 }
 
-std::string SystemInfo::getGpuModel()
+std::string SystemInfo::collectGpuModel()
 {
-    std::string result = "Unknown";
-#ifdef PLATFORM_DESKTOP
-#if defined (PLATFORM_LINUX)
-    return result;
-#elif defined (PLATFORM_MAC)
-    return result;
-#elif defined (PLATFORM_WINDOWS)
-    return result;
-#endif
-#elif defined(PLATFORM_MOBILE)
-#if defined(PLATFORM_IOS)
-    return result;
-#elif defined(PLATFORM_ANDROID)
-    return result;
-#endif
-#else
-    return result;
+    std::string result{};
+#if defined(PLATFORM_LINUX)
+    //! The PCI ids of the first display card, the vendor is named for the common ones.
+    const std::string vendor = readFirstLine("/sys/class/drm/card0/device/vendor");
+    const std::string device = readFirstLine("/sys/class/drm/card0/device/device");
+    if (!vendor.empty()) {
+        static const MapString vendors {{"0x10de", "NVIDIA"}, {"0x1002", "AMD"}, {"0x8086", "Intel"}, {"0x1af4", "Virtio"}, {"0x15ad", "VMware"}, {"0x1234", "QEMU"}};
+        const auto it = vendors.find(vendor);
+        result = (it != vendors.end() ? it->second : vendor) + (device.empty() ? "" : " [" + vendor + ":" + device + "]");
+    }
 #endif
+    return orUnknown(result);
 }
 
-std::string SystemInfo::getSerialNumber()
+std::string SystemInfo::collectSerialNumber()
 {
-    std::string result{"unknown"};
-#ifdef PLATFORM_DESKTOP
-#if defined (PLATFORM_LINUX)
-///
+    std::string result{};
+#if defined(PLATFORM_LINUX)
+    //! Readable by root only on most distributions.
+    result = readFirstLine("/sys/class/dmi/id/product_serial");
+    if (result.empty()) {
+        result = readFirstLine("/sys/class/dmi/id/board_serial");
+    }
 #elif defined (PLATFORM_MAC)
     CFStringRef serial;
     char buffer[32] = {0};
@@ -276,20 +440,8 @@ std::string SystemInfo::getSerialNumber()
         }
         IOObjectRelease(platformExpert);
     }
-    //command("system_profiler SPHardwareDataType | awk '/Serial/ {print $4}' | sed 's/^.{7}//g'");
-    return result;
-#elif defined (PLATFORM_WINDOWS)
-
-#endif
-#elif defined(PLATFORM_MOBILE)
-#if defined(PLATFORM_IOS)
-    return result;
-#elif defined(PLATFORM_ANDROID)
-    return result;
-#endif
-#else
-    return result;
 #endif
+    return orUnknown(result);
 }
 
 TEGRA_NAMESPACE_END
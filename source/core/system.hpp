@@ -26,9 +26,61 @@
 
 #include "common.hpp"
 
+TEGRA_USING_NAMESPACE Tegra::Types;
+
 TEGRA_NAMESPACE_BEGIN(Tegra::CMS)
 
 class SystemInfo;
+
+/*!
+ * \brief The SystemField enum names the information of the host that a snapshot holds.
+ */
+enum class SystemField : u8
+{
+    HostName,
+    OsName,
+    KernelVersion,
+    MacAddress,
+    IpV4Address,
+    IpV6Address,
+    MachineUniqueId,
+    SerialNumber,
+    StorageDiskModel,
+    StorageDiskSerialNumber,
+    GpuModel,
+    Count
+};
+
+/*!
+ * \brief The SystemSnapshot class holds the information of the host.
+ * Each field is collected the first time it's asked for and never changes after that,
+ * so a caller that needs the host name does not pay for the disk or the network queries.
+ */
+class SystemSnapshot final
+{
+public:
+    SystemSnapshot();
+
+    /*!
+     * \brief value function gets a field, it's collected on the first call only.
+     * \param field is the requested information.
+     * \returns the value, "Unknown" if the host does not publish it.
+     */
+    __tegra_no_discard const std::string& value(SystemField field) const;
+
+    /*!
+     * \returns the time the snapshot was created.
+     */
+    __tegra_no_discard std::time_t createdAt() const __tegra_noexcept;
+
+private:
+    static constexpr std::size_t FieldCount = std::size_t(SystemField::Count);
+
+    mutable std::array<std::once_flag, FieldCount>  m_collected {};
+    mutable std::array<std::string, FieldCount>     m_values    {};
+    std::time_t                                     m_createdAt {};
+};
+
 /*!
  * \brief The SystemInfo class
  */
@@ -37,6 +89,18 @@ public:
     SystemInfo();
     ~SystemInfo();
 
+    /*!
+     * \brief snapshot function gets the information of the host, each field is collected when it's first asked for.
+     * \returns shared pointer of the snapshot.
+     */
+    static Ref<const SystemSnapshot> snapshot();
+
+    /*!
+     * \brief refresh function replaces the snapshot by an empty one, so every field is collected again.
+     * \returns shared pointer of the new snapshot, the old one stays valid for its holders.
+     */
+    static Ref<const SystemSnapshot> refresh();
+
     /*!
      * \brief getHostName function gets local host name.
      * \returns string of host name.
@@ -102,7 +166,19 @@ public:
     static std::string getGpuModel();
 
 private:
-    std::list<std::string> m_macAddressList{};
+    friend class SystemSnapshot;
+
+    static std::string collect(SystemField field);
+    static std::string collectHostName();
+    static std::string collectKernelVersion();
+    static std::string collectMacAddress();
+    static std::string collectIpV4Address();
+    static std::string collectIpV6Address();
+    static std::string collectMachineUniqueId();
+    static std::string collectSerialNumber();
+    static std::string collectStorageDiskModel();
+    static std::string collectStorageDiskSerialNumber();
+    static std::string collectGpuModel();
 
 };
 
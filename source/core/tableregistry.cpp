@@ -0,0 +1,237 @@
+#include "tableregistry.hpp"
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+TEGRA_ANONYMOUS_NAMESPACE_BEGIN
+
+constexpr std::size_t SystemCount = std::size_t(TableId::Count);
+
+//! Settings of one configure call, never changed after they are published.
+struct Settings final
+{
+    std::string                                 prefix      {};
+    std::string                                 valueSuffix {};
+    std::string                                 unicode     {};
+    std::array<std::string_view, SystemCount>   system      {};   ///<Names of the system tables.
+};
+
+struct Registry final
+{
+    std::shared_mutex                           mutex       {};
+    std::deque<Settings>                        settings    {};   ///<Owner of every published settings, old ones stay alive for the views handed out.
+    std::atomic<const Settings*>                current     {};   ///<Read without lock.
+    std::deque<std::string>                     storage     {};   ///<Owner of the names that are built at runtime, never cleared.
+    std::vector<std::string_view>               bases       {};   ///<Name without prefix by id.
+    std::vector<std::string_view>               names       {};   ///<Name with prefix by id.
+    std::unordered_map<std::string_view, u16>   ids         {};   ///<Id by name without prefix.
+    TableRegistry::Mask                         all         {};
+    TableRegistry::Mask                         values      {};
+
+    Registry()
+    {
+        registerSystem(settings.emplace_back(Settings {std::string(CONFIG::CMS_TABLES_PREFIX),
+                                                       std::string(CONFIG::CMS_TABLES_VALUE_STRUCT),
+                                                       std::string(CONFIG::CMS_TABLES_TABLE_UNICODE)}));
+    }
+
+    //! Names of the system tables, the compiled ones are used as long as the prefix is the default one.
+    void registerSystem(Settings& next)
+    {
+        const bool compiled = next.prefix == CONFIG::CMS_TABLES_PREFIX;
+        for (std::size_t id = 0; id < SystemCount; ++id) {
+            std::string_view name = CompiledSystemTables[id];
+            if (!compiled) {
+                name = storage.emplace_back(next.prefix + std::string(SystemTables[id]));
+            }
+            next.system[id] = name;
+            bases.push_back(SystemTables[id]);
+            names.push_back(name);
+            ids.emplace(SystemTables[id], static_cast<u16>(id));
+            all.set(id);
+            values.set(id, SystemTables[id].ends_with(next.valueSuffix));
+        }
+        current.store(&next, std::memory_order_release);
+    }
+};
+
+Registry& registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+const Settings& settings() __tegra_noexcept
+{
+    return *registry().current.load(std::memory_order_acquire);
+}
+
+//! Base name of the key or value table, without prefix.
+std::string baseName(std::string_view table, TableType tableType, std::string_view suffix)
+{
+    const bool isValue = !suffix.empty() && table.ends_with(suffix);
+    switch (tableType) {
+    case TableType::KeyStruct:
+        return std::string(isValue ? table.substr(0, table.size() - suffix.size()) : table);
+    case TableType::ValueSturct:
+        return isValue ? std::string(table) : std::string(table).append(suffix);
+    case TableType::MixedStruct:
+    default:
+        return std::string(table);
+    }
+}
+
+TEGRA_NAMESPACE_END
+
+void TableRegistry::configure(std::string_view prefix, std::string_view valueSuffix, std::string_view unicode)
+{
+    Registry& r = registry();
+    std::unique_lock lock(r.mutex);
+
+    //! Runtime tables are registered again with the new prefix, so they keep their ids.
+    //! The storage of the old names is kept, views that were handed out before stay valid.
+    const std::vector<std::string> runtime(r.bases.begin() + SystemCount, r.bases.end());
+    r.bases.clear();
+    r.names.clear();
+    r.ids.clear();
+    r.all.reset();
+    r.values.reset();
+    r.registerSystem(r.settings.emplace_back(Settings {std::string(prefix), std::string(valueSuffix), std::string(unicode)}));
+    for (const auto& table : runtime) {
+        insert(table);
+    }
+}
+
+std::string_view TableRegistry::prefix() __tegra_noexcept
+{
+    return settings().prefix;
+}
+
+std::string_view TableRegistry::unicode() __tegra_noexcept
+{
+    return settings().unicode;
+}
+
+std::string_view TableRegistry::name(TableId id)
+{
+    Registry& r = registry();
+    const std::size_t index = std::size_t(id);
+    if (index < SystemCount) {
+        return settings().system[index];
+    }
+    std::shared_lock lock(r.mutex);
+    return index < r.names.size() ? r.names[index] : std::string_view {};
+}
+
+std::optional<TableId> TableRegistry::find(std::string_view table)
+{
+    Registry& r = registry();
+    const std::string_view prefix = settings().prefix;
+    std::shared_lock lock(r.mutex);
+    if (const auto it = r.ids.find(table); it != r.ids.end()) {
+        return static_cast<TableId>(it->second);
+    }
+    if (table.starts_with(prefix)) {
+        if (const auto it = r.ids.find(table.substr(prefix.size())); it != r.ids.end()) {
+            return static_cast<TableId>(it->second);
+        }
+    }
+    return std::nullopt;
+}
+
+TableId TableRegistry::intern(std::string_view table)
+{
+    Registry& r = registry();
+    {
+        std::shared_lock lock(r.mutex);
+        if (const auto it = r.ids.find(table); it != r.ids.end()) {
+            return static_cast<TableId>(it->second);
+        }
+    }
+    std::unique_lock lock(r.mutex);
+    if (const auto it = r.ids.find(table); it != r.ids.end()) {
+        return static_cast<TableId>(it->second);
+    }
+    return insert(table);
+}
+
+TableId TableRegistry::insert(std::string_view table)
+{
+    //! Called with the unique lock held.
+    Registry& r = registry();
+    const std::size_t id = r.bases.size();
+    if (id >= MaxTables) {
+        throw std::length_error("The table registry is full.");
+    }
+    const Settings& current = settings();
+    const std::string_view base = r.storage.emplace_back(table);
+    const std::string_view name = r.storage.emplace_back(current.prefix + std::string(table));
+    r.bases.push_back(base);
+    r.names.push_back(name);
+    r.ids.emplace(base, static_cast<u16>(id));
+    r.all.set(id);
+    r.values.set(id, base.ends_with(current.valueSuffix));
+    return static_cast<TableId>(id);
+}
+
+std::string_view TableRegistry::table(std::string_view table, TableType tableType)
+{
+    return name(intern(baseName(table, tableType, settings().valueSuffix)));
+}
+
+std::string TableRegistry::lookup(std::string_view table, TableType tableType)
+{
+    const Settings& current = settings();
+    std::string base = baseName(table, tableType, current.valueSuffix);
+    {
+        Registry& r = registry();
+        std::shared_lock lock(r.mutex);
+        if (const auto it = r.ids.find(base); it != r.ids.end()) {
+            return std::string(r.names[it->second]);
+        }
+    }
+    return current.prefix + base;
+}
+
+TableRegistry::Mask TableRegistry::mask(TableType tableType)
+{
+    Registry& r = registry();
+    std::shared_lock lock(r.mutex);
+    switch (tableType) {
+    case TableType::KeyStruct:
+        return r.all & ~r.values;
+    case TableType::ValueSturct:
+        return r.values;
+    case TableType::MixedStruct:
+    default:
+        return r.all;
+    }
+}
+
+VectorString TableRegistry::filter(const VectorString& tables, TableType tableType)
+{
+    const Mask selected = mask(tableType);
+    const std::string_view suffix = settings().valueSuffix;
+    VectorString result;
+    result.reserve(tables.size());
+    for (const auto& table : tables) {
+        bool keep = false;
+        if (const auto id = find(table); id.has_value()) {
+            keep = selected.test(std::size_t(*id));
+        } else {
+            //! Unknown tables are classified by their suffix only.
+            const bool isValue = !suffix.empty() && std::string_view(table).ends_with(suffix);
+            keep = tableType == TableType::MixedStruct || isValue == (tableType == TableType::ValueSturct);
+        }
+        if (keep) {
+            result.push_back(table);
+        }
+    }
+    return result;
+}
+
+bool TableRegistry::identifier(std::string_view name) __tegra_noexcept
+{
+    return !name.empty() && std::all_of(name.begin(), name.end(), [](unsigned char c) { return std::isalnum(c) || c == '_'; });
+}
+
+TEGRA_NAMESPACE_END
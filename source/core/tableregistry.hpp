@@ -0,0 +1,303 @@
+/*!
+ * MIT License
+ *
+ * Copyright (c) 2022 Kambiz Asadzadeh
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef TEGRA_TABLEREGISTRY_HPP
+#define TEGRA_TABLEREGISTRY_HPP
+
+#include "database.hpp"
+
+TEGRA_USING_NAMESPACE Tegra::Types;
+
+TEGRA_NAMESPACE_BEGIN(Tegra::Database)
+
+/*!
+ * @brief Small integer ids of the system tables, in the order of TEGRA_TABLES.
+ * Tables that are registered at runtime (modules, plugins) get ids after Count.
+ */
+enum class TableId : u16
+{
+    Config,
+    ConfigL,
+    ApiKey,
+    Resource,
+    ResourceL,
+    Drafts,
+    Templates,
+    TemplatesL,
+    Services,
+    ServicesL,
+    Groups,
+    GroupsL,
+    Menu,
+    MenuL,
+    Modules,
+    ModulesL,
+    Plugins,
+    PluginsL,
+    ConfigGroups,
+    ConfigGroupsL,
+    Tasks,
+    Cache,
+    Provinces,
+    Cities,
+    Tags,
+    Globalization,
+    Translation,
+    Members,
+    MembersAccount,
+    MembersContact,
+    MembersExtra,
+    MembersJob,
+    MembersKnownDevices,
+    MembersSocial,
+    MembersSession,
+    MembersVerification,
+    Questions,
+    Answers,
+    Rating,
+    Review,
+    Transaction,
+    Likes,
+    Count       ///<Number of the system tables.
+};
+
+/*!
+ * @brief StaticJoin concatenates string constants at compile time.
+ * @example StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::CONFIG>::value is "teg_config".
+ */
+template <const std::string_view&... Parts>
+struct StaticJoin final
+{
+    static constexpr auto storage = [] {
+        std::array<char, (Parts.size() + ... + 0) + 1> buffer {};
+        std::size_t at = 0;
+        ((std::copy(Parts.begin(), Parts.end(), buffer.begin() + at), at += Parts.size()), ...);
+        return buffer;
+    }();
+    static constexpr std::string_view value {storage.data(), storage.size() - 1};
+};
+
+/*!
+ * @brief Names of the system tables without prefix, indexed by TableId.
+ */
+constexpr std::array<std::string_view, std::size_t(TableId::Count)> SystemTables {
+    TEGRA_TABLES::CONFIG,
+    TEGRA_TABLES::CONFIG_L,
+    TEGRA_TABLES::APIKEY,
+    TEGRA_TABLES::RESOURCE,
+    TEGRA_TABLES::RESOURCE_L,
+    TEGRA_TABLES::DRAFTS,
+    TEGRA_TABLES::TEMPLATES,
+    TEGRA_TABLES::TEMPLATES_L,
+    TEGRA_TABLES::SERVICES,
+    TEGRA_TABLES::SERVICES_L,
+    TEGRA_TABLES::GROUPS,
+    TEGRA_TABLES::GROUPS_L,
+    TEGRA_TABLES::MENU,
+    TEGRA_TABLES::MENU_L,
+    TEGRA_TABLES::MODULES,
+    TEGRA_TABLES::MODULES_L,
+    TEGRA_TABLES::PLUGINS,
+    TEGRA_TABLES::PLUGINS_L,
+    TEGRA_TABLES::CONFIG_GROUPS,
+    TEGRA_TABLES::CONFIG_GROUPS_L,
+    TEGRA_TABLES::TASKS,
+    TEGRA_TABLES::CACHE,
+    TEGRA_TABLES::PROVINCES,
+    TEGRA_TABLES::CITIES,
+    TEGRA_TABLES::TAGS,
+    TEGRA_TABLES::GLOBALIZATION,
+    TEGRA_TABLES::TRANSLATION,
+    TEGRA_TABLES::MEMBERS,
+    TEGRA_TABLES::MEMBERS_ACCOUNT,
+    TEGRA_TABLES::MEMBERS_CONTACT,
+    TEGRA_TABLES::MEMBERS_EXTRA,
+    TEGRA_TABLES::MEMBERS_JOB,
+    TEGRA_TABLES::MEMBERS_KNOWN_DEVICES,
+    TEGRA_TABLES::MEMBERS_SOCIAL,
+    TEGRA_TABLES::MEMBERS_SESSION,
+    TEGRA_TABLES::MEMBERS_VERIFICATION,
+    TEGRA_TABLES::QUESTIONS,
+    TEGRA_TABLES::ANSWERS,
+    TEGRA_TABLES::RATING,
+    TEGRA_TABLES::REVIEW,
+    TEGRA_TABLES::TRANSACTION,
+    TEGRA_TABLES::LIKES,
+};
+
+/*!
+ * @brief Names of the system tables with the default prefix (CONFIG::CMS_TABLES_PREFIX), joined by the compiler.
+ */
+constexpr std::array<std::string_view, std::size_t(TableId::Count)> CompiledSystemTables {
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::CONFIG>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::CONFIG_L>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::APIKEY>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::RESOURCE>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::RESOURCE_L>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::DRAFTS>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::TEMPLATES>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::TEMPLATES_L>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::SERVICES>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::SERVICES_L>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::GROUPS>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::GROUPS_L>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::MENU>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::MENU_L>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::MODULES>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::MODULES_L>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::PLUGINS>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::PLUGINS_L>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::CONFIG_GROUPS>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::CONFIG_GROUPS_L>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::TASKS>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::CACHE>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::PROVINCES>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::CITIES>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::TAGS>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::GLOBALIZATION>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::TRANSLATION>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::MEMBERS>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::MEMBERS_ACCOUNT>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::MEMBERS_CONTACT>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::MEMBERS_EXTRA>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::MEMBERS_JOB>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::MEMBERS_KNOWN_DEVICES>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::MEMBERS_SOCIAL>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::MEMBERS_SESSION>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::MEMBERS_VERIFICATION>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::QUESTIONS>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::ANSWERS>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::RATING>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::REVIEW>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::TRANSACTION>::value,
+    StaticJoin<CONFIG::CMS_TABLES_PREFIX, TEGRA_TABLES::LIKES>::value,
+};
+
+/*!
+ * @brief The TableRegistry class keeps the final (prefixed) names of the tables.
+ * Every name is built once, at compile time for the default prefix or at boot for a configured one,
+ * and handed out as an interned string_view. Names, prefixes and suffixes of an earlier configure call
+ * are kept alive, so views that were handed out stay valid after the registry is configured again.
+ * Tables that are unknown at compile time are interned on their first use by table() and intern(),
+ * lookup() builds their name without taking a slot.
+ * ======================================================
+ * ----> Key tables have the plain name, for example teg_config.
+ * ----> Value tables have the value suffix, for example teg_config_l.
+ * ======================================================
+ * @example TableRegistry::name(TableId::ConfigL) is "teg_config_l".
+ */
+class TableRegistry
+{
+public:
+    //! Upper bound of the registered tables, it's the size of the filter masks.
+    static constexpr std::size_t MaxTables = 1024;
+
+    using Mask = std::bitset<MaxTables>;
+
+    /*!
+     * @brief configure function rebuilds all names with a new prefix, it should be called once at boot.
+     * Readers see either the old or the new settings, never a mix of both.
+     * @param prefix is the table prefix, for example "teg_".
+     * @param valueSuffix is the suffix of value tables, for example "_l".
+     * @param unicode is the character set of tables.
+     */
+    static void configure(std::string_view prefix,
+                          std::string_view valueSuffix = CONFIG::CMS_TABLES_VALUE_STRUCT,
+                          std::string_view unicode = CONFIG::CMS_TABLES_TABLE_UNICODE);
+
+    /*!
+     * @returns the current table prefix.
+     */
+    __tegra_no_discard static std::string_view prefix() __tegra_noexcept;
+
+    /*!
+     * @returns the current character set of tables.
+     */
+    __tegra_no_discard static std::string_view unicode() __tegra_noexcept;
+
+    /*!
+     * @brief name function gets the prefixed name of a table.
+     * @param id of the table.
+     * @returns interned name, empty if the id is not registered.
+     */
+    __tegra_no_discard static std::string_view name(TableId id);
+
+    /*!
+     * @brief find function gets the id of a table.
+     * @param table is the name of table with or without prefix.
+     * @returns id of the table if it's registered.
+     */
+    __tegra_no_discard static std::optional<TableId> find(std::string_view table);
+
+    /*!
+     * @brief intern function gets the id of a table and registers it if it's new.
+     * @param table is the name of table without prefix.
+     * @returns id of the table.
+     */
+    static TableId intern(std::string_view table);
+
+    /*!
+     * @brief table function gets the prefixed name of the key or value table of a base name.
+     * @param table is the name of table without prefix, with or without the value suffix.
+     * @param tableType is KeyStruct for the key table, ValueSturct for the value table or MixedStruct to keep the name as is.
+     * @returns interned name.
+     */
+    static std::string_view table(std::string_view table, TableType tableType);
+
+    /*!
+     * @brief lookup function gets the prefixed name of the key or value table without registering it.
+     * @param table is the name of table without prefix, with or without the value suffix.
+     * @param tableType is KeyStruct for the key table, ValueSturct for the value table or MixedStruct to keep the name as is.
+     * @returns interned name if the table is registered, otherwise the name is built for this call only.
+     */
+    __tegra_no_discard static std::string lookup(std::string_view table, TableType tableType);
+
+    /*!
+     * @brief mask function gets the set of registered tables of a type.
+     * @param tableType is type of the table.
+     * @returns bitset indexed by TableId.
+     */
+    __tegra_no_discard static Mask mask(TableType tableType);
+
+    /*!
+     * @brief filter function keeps the tables of a type, the order of the list is kept.
+     * @param tables are the names of tables without prefix.
+     * @param tableType is type of the table.
+     * @returns the filtered list.
+     */
+    __tegra_no_discard static VectorString filter(const VectorString& tables, TableType tableType);
+
+    /*!
+     * @brief identifier function checks a table or column name that is written into a statement.
+     * @returns true if the name is made of letters, digits and '_' only.
+     */
+    __tegra_no_discard static bool identifier(std::string_view name) __tegra_noexcept;
+
+private:
+    static TableId insert(std::string_view table);
+};
+
+TEGRA_NAMESPACE_END
+
+#endif // TEGRA_TABLEREGISTRY_HPP
@@ -0,0 +1,79 @@
+#include "text.hpp"
+
+TEGRA_NAMESPACE_BEGIN(Tegra)
+
+Text::Text()
+{
+}
+
+Text::Text(std::size_t hint)
+{
+    m_buffer.reserve(hint);
+}
+
+Text::Text(std::string& target, std::size_t hint) : m_target(&target)
+{
+    reserve(m_target->size() + hint);
+}
+
+Text::Text(std::pmr::memory_resource* arena, std::size_t hint) : m_buffer(arena)
+{
+    m_buffer.reserve(hint);
+}
+
+Text& Text::append(std::string_view content)
+{
+    if (m_target != nullptr) {
+        m_target->append(content);
+    } else {
+        m_buffer.append(content);
+    }
+    return *this;
+}
+
+Text& Text::append(char c)
+{
+    if (m_target != nullptr) {
+        m_target->push_back(c);
+    } else {
+        m_buffer.push_back(c);
+    }
+    return *this;
+}
+
+void Text::reserve(std::size_t capacity)
+{
+    //! Growing geometrically keeps repeated reserves in a loop linear.
+    const auto grow = [capacity](auto& buffer) {
+        if (capacity > buffer.capacity()) {
+            buffer.reserve(std::max(capacity, buffer.capacity() * 2));
+        }
+    };
+    if (m_target != nullptr) {
+        grow(*m_target);
+    } else {
+        grow(m_buffer);
+    }
+}
+
+std::size_t Text::size() const __tegra_noexcept
+{
+    return m_target != nullptr ? m_target->size() : m_buffer.size();
+}
+
+bool Text::empty() const __tegra_noexcept
+{
+    return size() == 0;
+}
+
+std::string_view Text::view() const __tegra_noexcept
+{
+    return m_target != nullptr ? std::string_view(*m_target) : std::string_view(m_buffer);
+}
+
+std::string Text::str() const
+{
+    return std::string(view());
+}
+
+TEGRA_NAMESPACE_END
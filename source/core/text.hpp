@@ -0,0 +1,148 @@
+/*!
+ * MIT License
+ *
+ * Copyright (c) 2022 Kambiz Asadzadeh
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef TEGRA_TEXT_HPP
+#define TEGRA_TEXT_HPP
+
+#include "common.hpp"
+
+TEGRA_USING_NAMESPACE Tegra::Types;
+
+TEGRA_NAMESPACE_BEGIN(Tegra)
+
+/*!
+ * @brief The Text class is a string builder (sink) for rendering markup and other fragments.
+ * @details Text never allocates by itself more than its storage needs:
+ * ======================================================
+ * ----> Text(target) appends into a string that is owned by the caller.
+ * ----> Text(arena) appends into a buffer that is allocated from a memory resource (arena).
+ * ----> Text(hint) owns its buffer and reserves the hint up front.
+ * ======================================================
+ * Functions that render a fragment take a Text& and write into it, so a page can be built
+ * into one buffer instead of a chain of temporary strings.
+ * @example std::string out; Text text(out, 64); text.concat("<p>", value, "</p>");
+ */
+class Text
+{
+public:
+    Text();
+    explicit Text(std::size_t hint);
+    explicit Text(std::string& target, std::size_t hint = 0);
+    explicit Text(std::pmr::memory_resource* arena, std::size_t hint = 0);
+    TEGRA_DISABLE_COPY_MOVE(Text)
+    ~Text() = default;
+
+    /*!
+     * @brief append function will appends content at the end of the buffer.
+     * @param content as string.
+     * @returns reference of the text.
+     */
+    Text& append(std::string_view content);
+
+    /*!
+     * @brief append function will appends a character at the end of the buffer.
+     * @param c as character.
+     * @returns reference of the text.
+     */
+    Text& append(char c);
+
+    /*!
+     * @brief append function will appends a number in decimal format.
+     * @param value as integer number.
+     * @returns reference of the text.
+     */
+    template <typename T, typename = std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, char> && !std::is_same_v<T, bool>>>
+    Text& append(T value)
+    {
+        char buffer[24];
+        const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        return append(std::string_view(buffer, static_cast<std::size_t>(result.ptr - buffer)));
+    }
+
+    /*!
+     * @brief concat function will appends all parts after reserving their total size.
+     * @param parts are strings, string views, literals or characters.
+     * @returns reference of the text.
+     */
+    template <typename... Parts>
+    Text& concat(const Parts&... parts)
+    {
+        reserve(size() + (sizeHint(parts) + ... + 0));
+        (append(parts), ...);
+        return *this;
+    }
+
+    template <typename T>
+    Text& operator<<(const T& value)
+    {
+        return append(value);
+    }
+
+    /*!
+     * @brief reserve function will reserves capacity for the whole buffer.
+     * @param capacity as number of bytes.
+     */
+    void reserve(std::size_t capacity);
+
+    /*!
+     * @brief size function gets size of the buffer.
+     * @returns as number of bytes.
+     */
+    __tegra_no_discard std::size_t size() const __tegra_noexcept;
+
+    /*!
+     * @brief empty function checks the buffer.
+     * @returns true if nothing has been written.
+     */
+    __tegra_no_discard bool empty() const __tegra_noexcept;
+
+    /*!
+     * @brief view function gets the content without copying it.
+     * @returns string view of the buffer, valid until the next append.
+     */
+    __tegra_no_discard std::string_view view() const __tegra_noexcept;
+
+    /*!
+     * @brief str function gets a copy of the content.
+     * @returns as string.
+     */
+    __tegra_no_discard std::string str() const;
+
+    /*!
+     * @brief sizeHint function gets the size of a part for reserving.
+     * @returns as number of bytes.
+     */
+    __tegra_no_discard static constexpr std::size_t sizeHint(char) __tegra_noexcept { return 1; }
+    __tegra_no_discard static constexpr std::size_t sizeHint(std::string_view s) __tegra_noexcept { return s.size(); }
+    template <typename T, typename = std::enable_if_t<std::is_integral_v<T>>>
+    __tegra_no_discard static constexpr std::size_t sizeHint(T) __tegra_noexcept { return 20; }
+
+private:
+    std::string*     m_target {nullptr};  ///<Caller owned storage.
+    std::pmr::string m_buffer {};         ///<Own or arena storage.
+};
+
+TEGRA_NAMESPACE_END
+
+#endif // TEGRA_TEXT_HPP
@@ -281,6 +281,19 @@ LanguageList Translator::listByCode() noexcept
     return m_translatorStruct->language;
 }
 
+std::string Translator::name(const std::string& code) __tegra_noexcept
+{
+    for(const auto& root : *jsonParser) {
+        const auto spec = root.find("language-spec");
+        if(spec == root.end() || !spec->is_object()) continue;
+        const auto found = spec->find("code");
+        if(found == spec->end() || *found != code) continue;
+        const auto title = spec->find("name");
+        return title != spec->end() && title->is_string() ? title->get<std::string>() : std::string();
+    }
+    return {};
+}
+
 LanguageList Translator::listByTitle() noexcept
 {
     auto items = *jsonParser;
@@ -133,6 +133,13 @@ public:
      */
     __tegra_no_discard LanguageList listByCode() __tegra_noexcept;
 
+    /*!
+     * \brief name gets the name of a language by its code.
+     * \param code of the language structure. e.g: en_US, or fa_IR.
+     * \returns name of the language, empty if there is no such code.
+     */
+    __tegra_no_discard std::string name(const std::string& code) __tegra_noexcept;
+
     /*!
      * \brief isRtl
      * \return
@@ -0,0 +1,75 @@
+#include "core/charclass.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+
+TEGRA_USING_NAMESPACE Tegra;
+
+namespace {
+
+int failures = 0;
+
+void expect(std::string_view name, const std::string& actual, std::string_view expected)
+{
+    if (actual != expected) {
+        std::fprintf(stderr, "%.*s: got \"%s\", expected \"%.*s\"\n", static_cast<int>(name.size()), name.data(),
+                     actual.c_str(), static_cast<int>(expected.size()), expected.data());
+        ++failures;
+    }
+}
+
+std::string collapse(std::string content, char replacement = '_')
+{
+    CharKernel::collapseRuns(content, CharClass(" "), replacement);
+    return content;
+}
+
+std::string removeAll(std::string content)
+{
+    CharKernel::removeAll(content, CharClass(" "));
+    return content;
+}
+
+std::string trim(std::string content)
+{
+    CharKernel::trim(content, CharClass::space());
+    return content;
+}
+
+//! Long inputs go through the vector kernels, short ones through the scalar loop.
+std::string repeat(std::string_view part, std::size_t times)
+{
+    std::string out;
+    for (std::size_t i = 0; i < times; ++i) out.append(part);
+    return out;
+}
+
+}  // namespace
+
+int main()
+{
+    expect("collapse runs", collapse("a  b  c"), "a_b_c");
+    expect("collapse leading run", collapse("   a b"), "_a_b");
+    expect("collapse trailing run", collapse("a b   "), "a_b_");
+    expect("collapse single bytes", collapse("a b c d"), "a_b_c_d");
+    expect("collapse without runs", collapse("abcd"), "abcd");
+    expect("collapse only a run", collapse("     "), "_");
+    expect("collapse empty", collapse(""), "");
+    expect("collapse with a member", collapse("a   b", ' '), "a b");
+    expect("collapse long", collapse(repeat("word   ", 40) + "  end  "), repeat("word_", 40) + "end_");
+    expect("collapse long leading", collapse(repeat(" ", 70) + repeat("ab ", 30)), "_" + repeat("ab_", 30));
+
+    expect("remove", removeAll(" a  b c "), "abc");
+    expect("remove long", removeAll(repeat("x y  ", 50)), repeat("xy", 50));
+    expect("remove without members", removeAll("abc"), "abc");
+
+    expect("trim", trim(" \t a b \n"), "a b");
+    expect("trim long", trim(repeat(" ", 100) + "a" + repeat(" ", 100)), "a");
+    expect("trim only spaces", trim("    "), "");
+
+    if (failures != 0) {
+        std::fprintf(stderr, "%d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
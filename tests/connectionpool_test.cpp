@@ -0,0 +1,124 @@
+#include "core/connectionpool.hpp"
+#include "core/core.hpp"
+#include "core/sqlquery.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <thread>
+
+TEGRA_USING_NAMESPACE Tegra;
+TEGRA_USING_NAMESPACE Tegra::CMS;
+TEGRA_USING_NAMESPACE Tegra::Database;
+
+namespace {
+
+int failures = 0;
+
+void expect(std::string_view name, const std::string& actual, std::string_view expected)
+{
+    if (actual != expected) {
+        std::fprintf(stderr, "%.*s: got \"%s\", expected \"%.*s\"\n", static_cast<int>(name.size()), name.data(),
+                     actual.c_str(), static_cast<int>(expected.size()), expected.data());
+        ++failures;
+    }
+}
+
+void expect(std::string_view name, std::size_t actual, std::size_t expected)
+{
+    expect(name, std::to_string(actual), std::to_string(expected));
+}
+
+//! Every connection of the pool opens the same file, an in-memory database would be private to one connection.
+ConnectionConfig sqliteConfig(const std::filesystem::path& file, std::size_t connections)
+{
+    ConnectionConfig config;
+    config.name           = "test";
+    config.driver         = DriverTypes::SQLite;
+    config.filename       = file.string();
+    config.connections    = connections;
+    config.acquireTimeout = std::chrono::milliseconds(100);
+    return config;
+}
+
+} // namespace
+
+int main()
+{
+    const auto file = std::filesystem::temp_directory_path() / ("tegra_pool_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".db");
+    std::filesystem::remove(file);
+
+    {
+        ConnectionPool pool(sqliteConfig(file, 2));
+        expect("lazy open", pool.size(), 0);
+
+        pool.execute("CREATE TABLE items (id INTEGER PRIMARY KEY AUTOINCREMENT, name TEXT NOT NULL);");
+        expect("one connection after the first statement", pool.size(), 1);
+        expect("released after the statement", pool.idle(), 1);
+
+        pool.execute("INSERT INTO items (name) VALUES (?)", {"first"});
+        pool.execute("INSERT INTO items (name) VALUES (?)", {"second"});
+
+        const ResultView rows = pool.select("SELECT name FROM items WHERE id = ?", {"2"});
+        expect("select rows", rows.size(), 1);
+        if (!rows.empty()) {
+            expect("select value", std::string(rows.text(0, 0)), "second");
+        }
+
+        {
+            auto connection = pool.acquire();
+            const u64 id = connection->insert("INSERT INTO items (name) VALUES (?);  \n", {"third"});
+            expect("insert id", id, 3);
+
+            const u64 misses = connection->cacheMisses();
+            connection->execute("SELECT count(*) FROM items WHERE name = ?", {"first"});
+            connection->execute("SELECT count(*) FROM items WHERE name = ?", {"second"});
+            expect("statement prepared once", connection->cacheMisses() - misses, 1);
+            expect("statement reused", connection->cacheHits() >= 1 ? 1 : 0, 1);
+            expect("leased connection is not idle", pool.idle(), 0);
+
+            const SqlStatement byName("SELECT id FROM items WHERE name = ?");
+            const u64 before = connection->cacheMisses();
+            const ResultView first = connection->select(byName.key(), {"first"});
+            const ResultView third = connection->select(byName.key(), {"third"});
+            expect("runtime statement prepared once", connection->cacheMisses() - before, 1);
+            expect("runtime statement value", first.empty() ? std::string() : std::string(first.text(0, 0)), "1");
+            expect("runtime statement reused", third.empty() ? std::string() : std::string(third.text(0, 0)), "3");
+        }
+        expect("lease goes back to the pool", pool.idle(), 1);
+
+        {
+            auto first  = pool.acquire();
+            auto second = pool.acquire();
+            expect("pool grows to its size", pool.size(), 2);
+
+            bool timedOut = false;
+            try {
+                auto third = pool.acquire(std::chrono::milliseconds(50));
+            } catch (const Exception&) {
+                timedOut = true;
+            }
+            expect("exhausted pool times out", timedOut ? 1 : 0, 1);
+
+            std::thread waiter([&pool]() {
+                auto handed = pool.acquire(std::chrono::milliseconds(2000));
+                expect("waiter gets the released connection", handed ? 1 : 0, 1);
+            });
+            while (pool.waiting() == 0) {
+                std::this_thread::yield();
+            }
+            first.release();
+            waiter.join();
+            expect("pool never exceeds its size", pool.size(), 2);
+        }
+        expect("all connections idle", pool.idle(), 2);
+    }
+
+    std::filesystem::remove(file);
+
+    if (failures != 0) {
+        std::fprintf(stderr, "%d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,122 @@
+#include "core/counterstore.hpp"
+#include "core/core.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <thread>
+
+TEGRA_USING_NAMESPACE Tegra;
+TEGRA_USING_NAMESPACE Tegra::CMS;
+TEGRA_USING_NAMESPACE Tegra::Database;
+
+namespace {
+
+int failures = 0;
+
+void expect(std::string_view name, const std::string& actual, std::string_view expected)
+{
+    if (actual != expected) {
+        std::fprintf(stderr, "%.*s: got \"%s\", expected \"%.*s\"\n", static_cast<int>(name.size()), name.data(),
+                     actual.c_str(), static_cast<int>(expected.size()), expected.data());
+        ++failures;
+    }
+}
+
+void expect(std::string_view name, llong actual, llong expected)
+{
+    expect(name, std::to_string(actual), std::to_string(expected));
+}
+
+ConnectionConfig sqliteConfig(const std::filesystem::path& file)
+{
+    ConnectionConfig config;
+    config.name        = "test";
+    config.driver      = DriverTypes::SQLite;
+    config.filename    = file.string();
+    config.connections = 4;
+    return config;
+}
+
+llong stored(ConnectionPool& pool, u64 id)
+{
+    const ResultView rows = pool.select("SELECT total FROM teg_likes WHERE id = ?", {std::to_string(id)});
+    return rows.empty() ? 0 : std::stoll(std::string(rows.text(0, 0)));
+}
+
+constexpr int Threads = 8;
+constexpr int Adds    = 4000;
+
+} // namespace
+
+int main()
+{
+    const auto file = std::filesystem::temp_directory_path() / ("tegra_counters_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".db");
+    std::filesystem::remove(file);
+    {
+        ConnectionPool pool(sqliteConfig(file));
+        pool.execute("CREATE TABLE teg_likes (id INTEGER PRIMARY KEY, total INTEGER NOT NULL DEFAULT 0)");
+        pool.execute("INSERT INTO teg_likes (id, total) VALUES (1, 10)");
+
+        CounterStoreOptions options;
+        options.idleFlushes = 2;
+        CounterStore counters(pool, options);
+        expect("total of the table", counters.value("likes", 1, "total"), 10);
+
+        //! A counter that is left alone while the others are flushed is evicted, its delta is written first.
+        counters.add("likes", 3, "total", 5);
+
+        //! Adders and a flusher run at the same time, no delta may be lost or written twice.
+        std::atomic<int> running {Threads};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < Threads; ++t) {
+            threads.emplace_back([&counters, &running, t] {
+                for (int i = 0; i < Adds; ++i) {
+                    counters.add("likes", 1, "total");
+                    counters.add("likes", 2, "total", t % 2 == 0 ? 2 : -1);
+                }
+                running.fetch_sub(1);
+            });
+        }
+        llong last = 0;
+        bool monotonic = true;
+        while (running.load() > 0) {
+            (void)counters.flush();
+            //! Counter 1 only grows, a read while a flush moves its delta must not go back.
+            const llong now = counters.value("likes", 1, "total");
+            if (now < last) monotonic = false;
+            last = now;
+        }
+        for (auto& thread : threads) thread.join();
+        (void)counters.flush();
+        (void)counters.flush();
+        (void)counters.flush();
+
+        const llong ones = 10 + llong(Threads) * Adds;
+        const llong twos = llong(Threads / 2) * Adds * 2 - llong(Threads / 2) * Adds;
+        expect("reads never go back", monotonic ? 1 : 0, 1);
+        expect("value of counter 1", counters.value("likes", 1, "total"), ones);
+        expect("value of counter 2", counters.value("likes", 2, "total"), twos);
+        expect("row of counter 1", stored(pool, 1), ones);
+        expect("row of counter 2", stored(pool, 2), twos);
+        expect("row of the evicted counter", stored(pool, 3), 5);
+        expect("idle counter was evicted", counters.stats().evicted > 0 ? 1 : 0, 1);
+
+        //! An add after the eviction starts from the table again.
+        counters.add("likes", 3, "total", 2);
+        expect("value after the eviction", counters.value("likes", 3, "total"), 7);
+        (void)counters.flush();
+        expect("row after the eviction", stored(pool, 3), 7);
+
+        //! A second store stands for another process, it reads the written totals.
+        CounterStore other(pool, options);
+        expect("other process", other.value("likes", 1, "total"), ones);
+    }
+    std::filesystem::remove(file);
+
+    if (failures != 0) {
+        std::fprintf(stderr, "%d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,138 @@
+#include "core/memorystore.hpp"
+#include "core/core.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+
+TEGRA_USING_NAMESPACE Tegra;
+TEGRA_USING_NAMESPACE Tegra::CMS;
+TEGRA_USING_NAMESPACE Tegra::Database;
+
+namespace {
+
+int failures = 0;
+
+void expect(std::string_view name, const std::string& actual, std::string_view expected)
+{
+    if (actual != expected) {
+        std::fprintf(stderr, "%.*s: got \"%s\", expected \"%.*s\"\n", static_cast<int>(name.size()), name.data(),
+                     actual.c_str(), static_cast<int>(expected.size()), expected.data());
+        ++failures;
+    }
+}
+
+void expect(std::string_view name, std::size_t actual, std::size_t expected)
+{
+    expect(name, std::to_string(actual), std::to_string(expected));
+}
+
+//! The rows of a select as "a|b;c|d", NULL is written as "-".
+std::string rowsOf(const ResultSet& result)
+{
+    std::string text;
+    for (const auto& row : result.rows) {
+        if (!text.empty()) text.append(";");
+        for (std::size_t c = 0; c < row.size(); ++c) {
+            if (c > 0) text.append("|");
+            text.append(row[c].value_or("-"));
+        }
+    }
+    return text;
+}
+
+//! Runs a statement that has to throw, the store must be unchanged afterwards.
+bool fails(MemoryStore& store, std::string_view sql, const SqlParams& params = {})
+{
+    try {
+        (void)store.execute(sql, params);
+    } catch (const Exception&) {
+        return true;
+    }
+    return false;
+}
+
+constexpr std::string_view Items = "(id INTEGER GENERATED BY DEFAULT AS IDENTITY, name VARCHAR(50) NOT NULL DEFAULT '', note TEXT, PRIMARY KEY (id))";
+
+} // namespace
+
+int main()
+{
+    const auto directory = std::filesystem::temp_directory_path() / ("tegra_memory_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+    const auto snapshot = directory / "memory.snapshot";
+    std::filesystem::remove_all(directory);
+
+    {
+        MemoryStore store({snapshot, false, 0});
+        store.create("items", Items);
+        expect("generated id", store.execute("INSERT INTO teg_items (name) VALUES (?)", {"one"}).lastInsertId, 1);
+        expect("second id", store.execute("INSERT INTO teg_items (name, note) VALUES (?, NULL)", {"two"}).lastInsertId, 2);
+        //! An explicit NULL is not replaced by the default, NOT NULL rejects it.
+        expect("NULL into NOT NULL", fails(store, "INSERT INTO teg_items (name) VALUES (NULL)") ? 1 : 0, 1);
+        expect("NULL parameter into NOT NULL", fails(store, "INSERT INTO teg_items (name) VALUES (?)", {std::nullopt}) ? 1 : 0, 1);
+        expect("duplicate key", fails(store, "INSERT INTO teg_items (id, name) VALUES (1, 'again')") ? 1 : 0, 1);
+        expect("rows after the rejected inserts", store.table("items").size(), 2);
+
+        expect("update", store.execute("UPDATE teg_items SET note = ? WHERE id = ?", {"first", "1"}).affectedRows, 1);
+        expect("select", rowsOf(store.execute("SELECT id, name, note FROM teg_items WHERE note IS NULL")), "2|two|-");
+        expect("insert after the update", store.execute("INSERT INTO teg_items (name) VALUES ('three')").lastInsertId, 3);
+        expect("delete", store.execute("DELETE FROM teg_items WHERE id = ?", {"3"}).affectedRows, 1);
+    }
+
+    {
+        //! The snapshot is replayed, a torn record at its end is cut off.
+        {
+            std::ofstream torn(snapshot, std::ios::binary | std::ios::app);
+            torn << std::string("\x40\x00\x00\x00\x01\x02", 6);
+        }
+        MemoryStore store({snapshot, false, 0});
+        expect("replayed rows", rowsOf(store.execute("SELECT * FROM teg_items")), "1|one|first;2|two|-");
+        expect("identity after the replay", store.execute("INSERT INTO teg_items (name) VALUES ('four')").lastInsertId, 4);
+    }
+
+    {
+        //! Writes past compactAfter rewrite the file with the live rows only.
+        MemoryStore store({snapshot, false, 8});
+        for (int i = 0; i < 40; ++i) {
+            (void)store.execute("UPDATE teg_items SET note = ? WHERE id = ?", {std::to_string(i), "2"});
+        }
+        expect("compacted", store.records() <= 8 + 5 ? 1 : 0, 1);
+
+        //! A compaction that can't write its file doesn't fail the write that triggered it.
+        std::filesystem::path blocked = snapshot;
+        blocked += ".tmp";
+        std::filesystem::create_directories(blocked);
+        std::string failed;
+        for (int i = 0; i < 20; ++i) {
+            try {
+                (void)store.execute("UPDATE teg_items SET note = ? WHERE id = ?", {"blocked", "1"});
+            } catch (const Exception& e) {
+                failed = e.what();
+            }
+        }
+        expect("writes while compaction fails", failed, "");
+        bool thrown = false;
+        try {
+            store.compact();
+        } catch (const Exception&) {
+            thrown = true;
+        }
+        expect("explicit compact throws", thrown ? 1 : 0, 1);
+        std::filesystem::remove_all(blocked);
+        store.compact();
+        expect("compact after the failure", store.records(), 4);
+    }
+
+    {
+        MemoryStore store({snapshot, false, 0});
+        expect("rows after compaction", rowsOf(store.execute("SELECT * FROM teg_items")), "1|one|blocked;2|two|39;4|four|-");
+    }
+
+    std::filesystem::remove_all(directory);
+
+    if (failures != 0) {
+        std::fprintf(stderr, "%d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
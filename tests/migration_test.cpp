@@ -0,0 +1,115 @@
+#include "core/migration.hpp"
+#include "core/core.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+
+TEGRA_USING_NAMESPACE Tegra;
+TEGRA_USING_NAMESPACE Tegra::CMS;
+TEGRA_USING_NAMESPACE Tegra::Database;
+
+namespace {
+
+int failures = 0;
+
+void expect(std::string_view name, const std::string& actual, std::string_view expected)
+{
+    if (actual != expected) {
+        std::fprintf(stderr, "%.*s: got \"%s\", expected \"%.*s\"\n", static_cast<int>(name.size()), name.data(),
+                     actual.c_str(), static_cast<int>(expected.size()), expected.data());
+        ++failures;
+    }
+}
+
+void expect(std::string_view name, std::size_t actual, std::size_t expected)
+{
+    expect(name, std::to_string(actual), std::to_string(expected));
+}
+
+ConnectionConfig sqliteConfig(const std::filesystem::path& file)
+{
+    ConnectionConfig config;
+    config.name        = "test";
+    config.driver      = DriverTypes::SQLite;
+    config.filename    = file.string();
+    config.connections = 2;
+    return config;
+}
+
+//! The steps of a column as "kind,kind", in plan order.
+std::string stepsOf(const MigrationPlan& plan, std::string_view table, std::string_view column)
+{
+    std::string text;
+    for (const auto& step : plan.steps) {
+        if (step.table != table || step.column != column) continue;
+        text.append(text.empty() ? "" : ",").append(std::to_string(static_cast<int>(step.kind)));
+    }
+    return text;
+}
+
+std::size_t warningsOf(const MigrationPlan& plan, std::string_view text)
+{
+    return static_cast<std::size_t>(std::count_if(plan.warnings.begin(), plan.warnings.end(), [text](const std::string& warning) {
+        return warning.find(text) != std::string::npos;
+    }));
+}
+
+std::string kind(MigrationStep::Kind kind)
+{
+    return std::to_string(static_cast<int>(kind));
+}
+
+} // namespace
+
+int main()
+{
+    {
+        const auto columns = MigrationEngine::parse("(id INTEGER NOT NULL, name VARCHAR(50) NOT NULL DEFAULT '', parent INTEGER DEFAULT NULL, PRIMARY KEY (id));");
+        expect("parsed columns", columns.size(), 3);
+        if (columns.size() == 3) {
+            expect("primary key", columns[0].primaryKey ? 1 : 0, 1);
+            expect("empty default is a default", columns[1].defaultValue.value_or("<none>"), "''");
+            expect("not null", columns[1].notNull ? 1 : 0, 1);
+        }
+    }
+
+    const auto file = std::filesystem::temp_directory_path() / ("tegra_migration_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".db");
+    std::filesystem::remove(file);
+    {
+        ConnectionPool pool(sqliteConfig(file));
+        pool.execute("CREATE TABLE teg_items (id INTEGER NOT NULL, name VARCHAR(50), parent INTEGER, kept VARCHAR(10) DEFAULT 'x', PRIMARY KEY (id))");
+        pool.execute("INSERT INTO teg_items (id, name) VALUES (1, NULL), (2, 'two')");
+
+        MigrationEngine engine(pool);
+        engine.add("items", "(id INTEGER NOT NULL, name VARCHAR(50) NOT NULL DEFAULT '', parent INTEGER DEFAULT NULL,"
+                            " kept VARCHAR(10) DEFAULT 'x', added SMALLINT NOT NULL DEFAULT 0, PRIMARY KEY (id))");
+        engine.add("extra", "(id INTEGER NOT NULL, PRIMARY KEY (id))");
+        const MigrationPlan plan = engine.plan();
+
+        expect("missing table", stepsOf(plan, "teg_extra", ""), kind(MigrationStep::Kind::CreateTable));
+        expect("new column", stepsOf(plan, "teg_items", "added"), kind(MigrationStep::Kind::AddColumn));
+        //! A nullable column without a default that gains NOT NULL DEFAULT '' is filled and constrained,
+        //! its new empty default differs from no default at all.
+        expect("empty default is planned", warningsOf(plan, "teg_items.name has another default"), 1);
+        expect("empty default is filled", stepsOf(plan, "teg_items", "name").find(kind(MigrationStep::Kind::Backfill)) != std::string::npos ? 1 : 0, 1);
+        //! DEFAULT NULL is the same as no default, an equal default is not planned either.
+        expect("null default is no default", warningsOf(plan, "teg_items.parent"), 0);
+        expect("null default has no step", stepsOf(plan, "teg_items", "parent"), "");
+        expect("same default", stepsOf(plan, "teg_items", "kept"), "");
+
+        const MigrationReport report = engine.apply(plan);
+        expect("backfilled rows", report.backfilled, 1);
+        const ResultView rows = pool.select("SELECT count(*) FROM teg_items WHERE name IS NULL");
+        expect("no NULL left", rows.empty() ? std::string() : std::string(rows.text(0, 0)), "0");
+        const ResultView created = pool.select("SELECT count(*) FROM sqlite_master WHERE name = 'teg_extra'");
+        expect("table created", created.empty() ? std::string() : std::string(created.text(0, 0)), "1");
+    }
+    std::filesystem::remove(file);
+
+    if (failures != 0) {
+        std::fprintf(stderr, "%d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
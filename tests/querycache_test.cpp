@@ -0,0 +1,122 @@
+#include "core/querycache.hpp"
+#include "core/core.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+
+TEGRA_USING_NAMESPACE Tegra;
+TEGRA_USING_NAMESPACE Tegra::CMS;
+TEGRA_USING_NAMESPACE Tegra::Database;
+
+namespace {
+
+int failures = 0;
+
+void expect(std::string_view name, const std::string& actual, std::string_view expected)
+{
+    if (actual != expected) {
+        std::fprintf(stderr, "%.*s: got \"%s\", expected \"%.*s\"\n", static_cast<int>(name.size()), name.data(),
+                     actual.c_str(), static_cast<int>(expected.size()), expected.data());
+        ++failures;
+    }
+}
+
+void expect(std::string_view name, std::size_t actual, std::size_t expected)
+{
+    expect(name, std::to_string(actual), std::to_string(expected));
+}
+
+//! The tables of a statement, sorted and joined by commas.
+std::string tables(std::string_view sql)
+{
+    VectorString found = QueryCache::tablesOf(sql);
+    std::sort(found.begin(), found.end());
+    std::string text;
+    for (const auto& table : found) text.append(text.empty() ? "" : ",").append(table);
+    return text;
+}
+
+ConnectionConfig sqliteConfig(const std::filesystem::path& file)
+{
+    ConnectionConfig config;
+    config.name        = "test";
+    config.driver      = DriverTypes::SQLite;
+    config.filename    = file.string();
+    config.connections = 2;
+    return config;
+}
+
+std::string first(const ResultView& rows)
+{
+    return rows.empty() ? std::string() : std::string(rows.text(0, 0));
+}
+
+} // namespace
+
+int main()
+{
+    expect("plain", tables("SELECT * FROM a WHERE id = ?"), "a");
+    expect("schema", tables("SELECT * FROM public.a"), "a");
+    expect("comma join", tables("SELECT * FROM a, b x, c AS y WHERE a.id = x.id"), "a,b,c");
+    expect("join", tables("SELECT * FROM a JOIN b ON a.id = b.id LEFT JOIN c USING (id)"), "a,b,c");
+    expect("comma after join", tables("SELECT * FROM a JOIN b ON a.id = b.id, c"), "a,b,c");
+    expect("derived table then comma", tables("SELECT * FROM (SELECT * FROM p) s, q2"), "p,q2");
+    expect("two derived tables", tables("SELECT * FROM (SELECT * FROM p) s, (SELECT * FROM q) t, r"), "p,q,r");
+    expect("subquery in the filter", tables("SELECT * FROM a WHERE id IN (SELECT id FROM b, c) AND x = 1"), "a,b,c");
+    expect("subquery in the select list", tables("SELECT (SELECT max(id) FROM b), name FROM a, c"), "a,b,c");
+    expect("cte", tables("WITH w AS (SELECT * FROM a, b) SELECT * FROM w, c"), "a,b,c,w");
+    expect("union", tables("SELECT id FROM a UNION SELECT id FROM b, c"), "a,b,c");
+    expect("delete using", tables("DELETE FROM a USING b, c WHERE a.id = b.id"), "a,b,c");
+    expect("update from", tables("UPDATE a SET x = 1 FROM b, c WHERE a.id = b.id"), "a,b,c");
+    expect("insert select", tables("INSERT INTO a (id) SELECT id FROM b"), "a,b");
+    expect("quoted", tables("SELECT * FROM \"A\", `b`"), "a,b");
+    expect("string is not a table", tables("SELECT * FROM a WHERE name = 'x FROM y, z'"), "a");
+
+    const auto file = std::filesystem::temp_directory_path() / ("tegra_query_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".db");
+    std::filesystem::remove(file);
+    {
+        ConnectionPool pool(sqliteConfig(file));
+        pool.execute("CREATE TABLE teg_cache (name VARCHAR(16) NOT NULL, query TEXT NOT NULL DEFAULT '', tags VARCHAR(500) NOT NULL DEFAULT '',"
+                     " value TEXT NOT NULL DEFAULT '', expires BIGINT NOT NULL DEFAULT 0, PRIMARY KEY (name))");
+        pool.execute("CREATE TABLE p (id INTEGER PRIMARY KEY, name TEXT)");
+        pool.execute("CREATE TABLE q2 (id INTEGER PRIMARY KEY, name TEXT)");
+        pool.execute("INSERT INTO p (id, name) VALUES (1, 'one')");
+        pool.execute("INSERT INTO q2 (id, name) VALUES (1, 'first')");
+
+        QueryCacheOptions options;
+        options.persistentTtl = std::chrono::milliseconds(60000);
+        QueryCache cache(pool, options);
+        const std::string sql = "SELECT q2.name FROM (SELECT * FROM p) s, q2 WHERE q2.id = s.id";
+
+        expect("first read", first(cache.select(sql)), "first");
+        expect("second read is a hit", first(cache.select(sql)), "first");
+        expect("hits", cache.stats().hits, 1);
+        expect("shared row", first(pool.select("SELECT count(*) FROM teg_cache")), "1");
+
+        //! A write of the table after the derived table drops the entry of both tiers.
+        cache.execute("UPDATE q2 SET name = ? WHERE id = ?", {"changed", "1"});
+        expect("shared row is forgotten", first(pool.select("SELECT count(*) FROM teg_cache")), "0");
+        expect("read after the write", first(cache.select(sql)), "changed");
+
+        //! A second cache stands for another process, it reads the shared row.
+        QueryCache other(pool, options);
+        expect("other process", first(other.select(sql)), "changed");
+        expect("other process hit the table", other.stats().persistentHits, 1);
+
+        //! Parameters are part of the key.
+        expect("parameter one", first(cache.select("SELECT name FROM p WHERE id = ?", {"1"})), "one");
+        expect("parameter two", first(cache.select("SELECT name FROM p WHERE id = ?", {"2"})), "");
+
+        cache.invalidate();
+        expect("all entries dropped", cache.stats().entries, 0);
+        expect("all shared rows dropped", first(pool.select("SELECT count(*) FROM teg_cache")), "0");
+    }
+    std::filesystem::remove(file);
+
+    if (failures != 0) {
+        std::fprintf(stderr, "%d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
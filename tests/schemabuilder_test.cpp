@@ -0,0 +1,113 @@
+#include "core/schemabuilder.hpp"
+#include "core/bulkloader.hpp"
+#include "core/seedfile.hpp"
+#include "core/core.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+
+TEGRA_USING_NAMESPACE Tegra;
+TEGRA_USING_NAMESPACE Tegra::CMS;
+TEGRA_USING_NAMESPACE Tegra::Database;
+
+namespace {
+
+int failures = 0;
+
+void expect(std::string_view name, const std::string& actual, std::string_view expected)
+{
+    if (actual != expected) {
+        std::fprintf(stderr, "%.*s: got \"%s\", expected \"%.*s\"\n", static_cast<int>(name.size()), name.data(),
+                     actual.c_str(), static_cast<int>(expected.size()), expected.data());
+        ++failures;
+    }
+}
+
+void expect(std::string_view name, std::size_t actual, std::size_t expected)
+{
+    expect(name, std::to_string(actual), std::to_string(expected));
+}
+
+ConnectionConfig sqliteConfig(const std::filesystem::path& file)
+{
+    ConnectionConfig config;
+    config.name        = "test";
+    config.driver      = DriverTypes::SQLite;
+    config.filename    = file.string();
+    config.connections = 4;
+    return config;
+}
+
+} // namespace
+
+int main()
+{
+    const std::string tables = std::string(TEGRA_TEST_ROOT) + "/config/system-tables.json";
+    const auto file = std::filesystem::temp_directory_path() / ("tegra_schema_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".db");
+    std::filesystem::remove(file);
+
+    {
+        ConnectionPool pool(sqliteConfig(file));
+
+        //! The default tables are written for postgresql, sqlite3 gets them rewritten.
+        SchemaBuilder builder(pool);
+        builder.addFromFile(tables, TEGRA_RDBMS::SQLite);
+        expect("default tables are read", builder.tables().empty() ? 0 : 1, 1);
+        try {
+            const auto report = builder.create();
+            expect("every table is created", report.tables.size(), builder.tables().size());
+        } catch (const Exception& e) {
+            std::fprintf(stderr, "create: %s\n", e.what());
+            ++failures;
+        }
+        const ResultView created = pool.select("SELECT count(*) FROM sqlite_master WHERE type = 'table' AND name LIKE 'teg_%'");
+        expect("tables exist", created.empty() ? std::string() : std::string(created.text(0, 0)), std::to_string(builder.tables().size()));
+
+        //! The seed rows of the postgresql entries load into the created tables.
+        try {
+            auto connection = pool.acquire();
+            BulkLoader loader(*connection);
+            for (const auto& seed : BulkLoader::readSeeds(tables, TEGRA_RDBMS::SQLite)) {
+                (void)loader.load(seed);
+            }
+        } catch (const Exception& e) {
+            std::fprintf(stderr, "seeds: %s\n", e.what());
+            ++failures;
+        }
+
+        //! An identity column is the rowid, new rows are numbered after the seeds without a value.
+        const ResultView before = pool.select("SELECT coalesce(max(id), 0) FROM teg_menu");
+        pool.execute("INSERT INTO teg_menu (priority) VALUES (?)", {"1"});
+        pool.execute("INSERT INTO teg_menu (priority) VALUES (?)", {"2"});
+        const ResultView ids = pool.select("SELECT id FROM teg_menu WHERE id > ? ORDER BY id", {std::string(before.text(0, 0))});
+        expect("identity rows", ids.size(), 2);
+        if (ids.size() == 2) {
+            const u64 last = std::stoull(std::string(before.text(0, 0)));
+            expect("identity numbers", std::string(ids.text(0, 0)) + "," + std::string(ids.text(1, 0)),
+                   std::to_string(last + 1) + "," + std::to_string(last + 2));
+        }
+
+        //! DEFAULT NOW() became CURRENT_TIMESTAMP.
+        pool.execute("INSERT INTO teg_static (priority) VALUES (?)", {"0"});
+        const ResultView dated = pool.select("SELECT created_date FROM teg_static");
+        expect("timestamp default", dated.empty() || dated.isNull(0, 0) ? 0 : 1, 1);
+    }
+
+    {
+        const auto entries = SeedFile::section(SeedFile::read(tables), "create", TEGRA_RDBMS::SQLite);
+        bool identity = false;
+        for (const auto& entry : entries) {
+            if (entry.content.find("IDENTITY") != std::string::npos || entry.content.find("NOW()") != std::string::npos) identity = true;
+        }
+        expect("sqlite3 definitions are rewritten", identity ? 1 : 0, 0);
+    }
+
+    std::filesystem::remove(file);
+
+    if (failures != 0) {
+        std::fprintf(stderr, "%d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}